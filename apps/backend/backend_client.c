@@ -55,6 +55,7 @@
 #include <sys/socket.h>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -88,6 +89,649 @@ ce_find_byid(struct client_entry *ce_list,
     return NULL;
 }
 
+/* Number of running read workers, see CLICON_BACKEND_READ_WORKERS */
+static int _read_workers = 0;
+
+/* Set in a read worker process: write end of pipe to parent */
+static int _read_worker_fd = -1;
+
+/*! Pause or resume reading requests from a client
+ *
+ * Reading is paused while a read worker handles a request of the client, so that replies
+ * are sent in request order, and while more than CLICON_SOCK_HIGHWATER bytes are queued
+ * for output. After the latter it is resumed when the queue is drained to half of it.
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+ce_input_update(clicon_handle        h,
+                struct client_entry *ce)
+{
+    int hw;
+    int pause;
+
+    hw = clicon_option_int(h, "CLICON_SOCK_HIGHWATER");
+    if (ce->ce_worker != NULL)
+        pause = 1;
+    else if (hw <= 0)
+        pause = 0;
+    else if (ce->ce_blocked)
+        pause = ce->ce_outlen > hw/2;
+    else
+        pause = ce->ce_outlen > hw;
+    if (pause && !ce->ce_blocked){
+        clicon_debug(1, "%s client %d paused, %zu bytes queued", __FUNCTION__, ce->ce_nr, ce->ce_outlen);
+        clixon_event_unreg_fd(ce->ce_s, from_client);
+        ce->ce_blocked = 1;
+    }
+    else if (!pause && ce->ce_blocked){
+        clicon_debug(1, "%s client %d resumed", __FUNCTION__, ce->ce_nr);
+        if (clixon_event_reg_fd(ce->ce_s, from_client, (void*)ce, "local netconf client socket") < 0)
+            return -1;
+        ce->ce_blocked = 0;
+    }
+    return 0;
+}
+
+/*! Serialize next chunk of reply written in chunks
+ *
+ * The chunk replaces the previous, which must have been written. It is framed by its
+ * length, see clicon_msg_rcv_fd. The first chunk starts with the start of the reply.
+ * After the last part of the tree, the end of the reply and the terminating chunk of
+ * length 0 are added, and the tree is freed.
+ * @param[in]  os   Chunked reply
+ * @retval     0    OK
+ * @retval    -1    Error, errno set
+ * @see backend_client_reply_chunked
+ */
+static int
+ce_outstream_fill(struct ce_outstream *os)
+{
+    int      ret;
+    uint32_t clen = 0;
+
+    cbuf_reset(os->os_cb);
+    os->os_pos = 0;
+    if (os->os_xch == NULL){ /* Should not happen: end of reply is detected by caller */
+        clicon_err(OE_XML, EINVAL, "Chunked reply already serialized");
+        errno = EINVAL;
+        return -1;
+    }
+    /* Length of chunk, set when serialized */
+    if (cbuf_append_buf(os->os_cb, &clen, sizeof(clen)) < 0){
+        errno = ENOMEM;
+        return -1;
+    }
+    if (!os->os_begun){
+        cprintf(os->os_cb, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
+        os->os_begun = 1;
+    }
+    if ((ret = clixon_xml2cbuf_chunk(os->os_xch, os->os_cb, os->os_chunk)) < 0){
+        errno = ENOMEM;
+        return -1;
+    }
+    if (ret == 0)
+        cprintf(os->os_cb, "</rpc-reply>");
+    clen = htonl(cbuf_len(os->os_cb) - sizeof(clen));
+    memcpy(cbuf_get(os->os_cb), &clen, sizeof(clen));
+    if (ret == 0){
+        clen = 0; /* End of reply */
+        if (cbuf_append_buf(os->os_cb, &clen, sizeof(clen)) < 0){
+            errno = ENOMEM;
+            return -1;
+        }
+        clixon_xml2cbuf_chunk_free(os->os_xch);
+        os->os_xch = NULL;
+        xml_free(os->os_xml);
+        os->os_xml = NULL;
+    }
+    return 0;
+}
+
+/*! Write queued output to client until done or until the socket would block
+ *
+ * @param[in]  ce   Client entry
+ * @retval     1    All queued output written
+ * @retval     0    Socket would block, output remains in queue
+ * @retval    -1    Error, errno set, eg EPIPE or ECONNRESET if client closed socket
+ */
+static int
+ce_output_write(struct client_entry *ce)
+{
+    struct ce_outmsg    *om;
+    struct ce_outstream *os;
+    uint32_t             mlen;
+    char                *buf;
+    size_t               len;
+    ssize_t              n;
+
+    while ((om = ce->ce_outq) != NULL){
+        mlen = ntohl(om->om_msg->op_len);
+        os = om->om_stream;
+        if (os == NULL){
+            buf = (char*)om->om_msg + ce->ce_outpos;
+            len = mlen - ce->ce_outpos;
+        }
+        else if (ce->ce_outpos < sizeof(struct clicon_msg)){
+            buf = (char*)om->om_msg + ce->ce_outpos;
+            len = sizeof(struct clicon_msg) - ce->ce_outpos;
+        }
+        else {
+            if (os->os_pos == cbuf_len(os->os_cb)){
+                if (ce_outstream_fill(os) < 0)
+                    return -1;
+                ce->ce_outlen += cbuf_len(os->os_cb);
+            }
+            buf = cbuf_get(os->os_cb) + os->os_pos;
+            len = cbuf_len(os->os_cb) - os->os_pos;
+        }
+        if ((n = send(ce->ce_s, buf, len, MSG_DONTWAIT)) < 0){
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            return -1;
+        }
+        if (os && ce->ce_outpos >= sizeof(struct clicon_msg))
+            os->os_pos += n;
+        ce->ce_outpos += n;
+        ce->ce_outlen -= n;
+        if (os == NULL ? ce->ce_outpos == mlen :
+            (ce->ce_outpos >= sizeof(struct clicon_msg) &&
+             os->os_xch == NULL && os->os_pos == cbuf_len(os->os_cb))){
+            DELQ(om, ce->ce_outq, struct ce_outmsg *);
+            ce_outmsg_free(om);
+            ce->ce_outpos = 0;
+        }
+    }
+    return 1;
+}
+
+/*! Client socket is writable: write queued output
+ *
+ * @param[in]  s    Client socket
+ * @param[in]  arg  Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see ce_send
+ */
+static int
+ce_output_cb(int   s,
+             void *arg)
+{
+    struct client_entry *ce = (struct client_entry *)arg;
+    clicon_handle        h = ce->ce_handle;
+    int                  ret;
+
+    if ((ret = ce_output_write(ce)) < 0){
+        if (errno == EPIPE || errno == ECONNRESET){
+            clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
+            backend_client_rm(h, ce);
+            netconf_monitoring_counter_inc(h, "dropped-sessions");
+            return 0;
+        }
+        clicon_err(OE_UNIX, errno, "send");
+        return -1;
+    }
+    if (ret == 1)
+        clixon_event_unreg_fd(s, ce_output_cb);
+    return ce_input_update(h, ce);
+}
+
+/*! Queue output message to client and write what can be written without blocking
+ *
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  om   Output message, consumed by this function
+ * @retval     0    OK, written or queued
+ * @retval    -1    Error, errno is EPIPE or ECONNRESET if client closed socket
+ */
+static int
+ce_send_om(clicon_handle        h,
+           struct client_entry *ce,
+           struct ce_outmsg    *om)
+{
+    int                retval = -1;
+    struct clicon_msg *msg = om->om_msg;
+    uint32_t           mlen = ntohl(msg->op_len);
+    int                queued;
+    int                ret;
+
+    /* Only text bodies are printed, binary bodies and descriptors may contain null */
+    if ((CLIXON_DBG_MSG & clicon_debug_get()) != 0){
+        if (om->om_stream)
+            clicon_debug(CLIXON_DBG_MSG, "Send: chunked reply");
+        else if (mlen <= sizeof(*msg) || clicon_msg_isbin(msg) || clicon_msg_isshm(msg))
+            clicon_debug(CLIXON_DBG_MSG, "Send: %u bytes", mlen);
+        else
+            clicon_debug(CLIXON_DBG_MSG, "Send: %.*s", (int)(mlen - sizeof(*msg)), msg->op_body);
+    }
+    queued = (ce->ce_outq != NULL);
+    ADDQ(om, ce->ce_outq);
+    /* Chunks of a chunked reply are counted as they are serialized */
+    ce->ce_outlen += om->om_stream ? sizeof(*msg) : mlen;
+    if (!queued){ /* Otherwise ce_output_cb is already registered */
+        if ((ret = ce_output_write(ce)) < 0)
+            goto done;
+        if (ret == 0 &&
+            clixon_event_reg_fd_write(ce->ce_s, ce_output_cb, (void*)ce, "client output") < 0)
+            goto done;
+    }
+    if (ce_input_update(h, ce) < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Send message to client without blocking the backend, queue what cannot be written
+ *
+ * Output that the client does not read is queued and written when the socket is
+ * writable. When more than CLICON_SOCK_HIGHWATER bytes are queued, no more requests
+ * are read from the client until the queue is drained.
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  msg  Encoded message, consumed by this function
+ * @retval     0    OK, written or queued
+ * @retval    -1    Error, errno is EPIPE or ECONNRESET if client closed socket
+ */
+static int
+ce_send(clicon_handle        h,
+        struct client_entry *ce,
+        struct clicon_msg   *msg)
+{
+    struct ce_outmsg *om;
+
+    if ((om = calloc(1, sizeof(*om))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        free(msg);
+        return -1;
+    }
+    om->om_msg = msg;
+    return ce_send_om(h, ce, om);
+}
+
+/*! Send message shared with other clients, see ce_send
+ *
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  sm   Shared message, a reference is taken by this function
+ * @retval     0    OK, written or queued
+ * @retval    -1    Error, errno is EPIPE or ECONNRESET if client closed socket
+ */
+static int
+ce_send_shared(clicon_handle        h,
+               struct client_entry *ce,
+               struct ce_sharedmsg *sm)
+{
+    struct ce_outmsg *om;
+
+    if ((om = calloc(1, sizeof(*om))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    om->om_msg = sm->sm_msg;
+    om->om_shared = sm;
+    sm->sm_refs++;
+    return ce_send_om(h, ce, om);
+}
+
+/*! Send reply to client
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  ce      Client entry
+ * @param[in]  data    Reply, XML text or binary
+ * @param[in]  datalen Length of reply
+ * @retval     0       OK, written or queued
+ * @retval    -1       Error, errno is EPIPE or ECONNRESET if client closed socket
+ * @see send_msg_reply
+ */
+static int
+ce_reply(clicon_handle        h,
+         struct client_entry *ce,
+         char                *data,
+         size_t               datalen)
+{
+    struct clicon_msg *reply;
+    uint32_t           len;
+    int                ret;
+
+    /* Large replies via shared memory ring if attached, otherwise on socket */
+    if (ce->ce_shm && datalen >= CLICON_SHM_MIN){
+        if ((ret = clicon_shm_put(ce->ce_shm, data, datalen, &reply)) < 0)
+            return -1;
+        if (ret == 1)
+            return ce_send(h, ce, reply);
+    }
+    /* Terminating null added */
+    len = sizeof(*reply) + datalen + 1;
+    if ((reply = (struct clicon_msg *)calloc(1, len)) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    reply->op_len = htonl(len);
+    memcpy(reply->op_body, data, datalen);
+    return ce_send(h, ce, reply);
+}
+
+/*! Send reply tree to client, serialized in chunks as the client socket drains
+ *
+ * The reply is not printed into one string, and the tree is serialized only once. The
+ * message header has length 0 and is followed by chunks framed by their length, see
+ * clicon_msg_rcv_fd. A chunk is serialized each time the previous chunk has been written
+ * to the socket.
+ * Only text replies sent on the socket of the backend process itself are chunked.
+ * @param[in]     h      Clixon handle
+ * @param[in]     ce     Client entry
+ * @param[in,out] xret   Reply data tree, consumed and set to NULL if sent
+ * @param[in]     depth  Levels of the tree to print, -1 is all, see clixon_xml2cbuf
+ * @retval        1      Sent or queued, caller does not send a reply
+ * @retval        0      Not chunked, caller sends reply as usual
+ * @retval       -1      Error
+ * @see CLICON_SOCK_CHUNK
+ */
+int
+backend_client_reply_chunked(clicon_handle        h,
+                             struct client_entry *ce,
+                             cxobj              **xret,
+                             int32_t              depth)
+{
+    int                  retval = -1;
+    struct ce_outstream *os = NULL;
+    struct ce_outmsg    *om = NULL;
+    int                  chunk;
+    int                  ret;
+
+    if ((chunk = clicon_option_int(h, "CLICON_SOCK_CHUNK")) <= 0 ||
+        ce->ce_binary || ce->ce_shm || _read_worker_fd != -1)
+        return 0;
+    if ((os = calloc(1, sizeof(*os))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    os->os_chunk = chunk;
+    if ((os->os_cb = cbuf_new_alloc(chunk + 2*sizeof(uint32_t))) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new_alloc");
+        goto done;
+    }
+    if ((os->os_xch = clixon_xml2cbuf_chunk_new(*xret, depth)) == NULL)
+        goto done;
+    os->os_xml = *xret;
+    *xret = NULL;
+    if ((om = calloc(1, sizeof(*om))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    /* Header only, with length 0 and empty body for debug */
+    if ((om->om_msg = calloc(1, sizeof(struct clicon_msg) + 1)) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    om->om_stream = os;
+    os = NULL;
+    ret = ce_send_om(h, ce, om);
+    om = NULL; /* Queued also on error */
+    if (ret < 0){
+        if (errno != EPIPE && errno != ECONNRESET)
+            goto done;
+        clicon_log(LOG_WARNING, "client rpc reset");
+    }
+    ce->ce_replied = 1;
+    retval = 1;
+ done:
+    if (om)
+        ce_outmsg_free(om);
+    if (os){
+        if (os->os_xch)
+            clixon_xml2cbuf_chunk_free(os->os_xch);
+        if (os->os_xml)
+            xml_free(os->os_xml);
+        if (os->os_cb)
+            cbuf_free(os->os_cb);
+        free(os);
+    }
+    return retval;
+}
+
+/*! Read worker has written (part of) its reply, or exited
+ *
+ * On end of file the reply is sent to the client and reading requests from the
+ * client is resumed.
+ * @param[in]  fd   Read end of pipe from worker
+ * @param[in]  arg  Read worker
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see read_worker_start
+ */
+static int
+read_worker_cb(int   fd,
+               void *arg)
+{
+    int                  retval = -1;
+    struct read_worker  *rw = (struct read_worker *)arg;
+    struct client_entry *ce = rw->rw_ce;
+    clicon_handle        h = ce->ce_handle;
+    char                 buf[65536];
+    ssize_t              n;
+    cbuf                *cberr = NULL;
+
+    if ((n = read(fd, buf, sizeof(buf))) < 0){
+        if (errno == EINTR)
+            return 0;
+        clicon_err(OE_UNIX, errno, "read");
+        goto done;
+    }
+    if (n > 0){
+        if (cbuf_append_buf(rw->rw_cb, buf, n) < 0){
+            clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+            goto done;
+        }
+        return 0;
+    }
+    /* End of file: worker is done */
+    clixon_event_unreg_fd(fd, read_worker_cb);
+    close(fd);
+    waitpid(rw->rw_pid, NULL, 0);
+    _read_workers--;
+    ce->ce_worker = NULL;
+    clicon_debug(1, "%s client %d reply %zu bytes", __FUNCTION__, ce->ce_nr, cbuf_len(rw->rw_cb));
+    if (cbuf_len(rw->rw_cb) == 0){ /* Worker crashed */
+        if ((cberr = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if (netconf_operation_failed(cberr, "application", "Read worker failed") < 0)
+            goto done;
+        cbuf_append_buf(rw->rw_cb, cbuf_get(cberr), cbuf_len(cberr));
+    }
+    if (ce_reply(h, ce, cbuf_get(rw->rw_cb), cbuf_len(rw->rw_cb)) < 0){
+        if (errno != EPIPE && errno != ECONNRESET)
+            goto done;
+        clicon_log(LOG_WARNING, "client rpc reset");
+    }
+    if (ce_input_update(h, ce) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (ce->ce_worker == NULL){
+        cbuf_free(rw->rw_cb);
+        free(rw);
+    }
+    if (cberr)
+        cbuf_free(cberr);
+    return retval;
+}
+
+/*! Terminate read worker of a client that is removed
+ * @param[in]  rw   Read worker
+ */
+static void
+read_worker_kill(struct read_worker *rw)
+{
+    clixon_event_unreg_fd(rw->rw_fd, read_worker_cb);
+    close(rw->rw_fd);
+    kill(rw->rw_pid, SIGKILL);
+    waitpid(rw->rw_pid, NULL, 0);
+    _read_workers--;
+    rw->rw_ce->ce_worker = NULL;
+    cbuf_free(rw->rw_cb);
+    free(rw);
+}
+
+/*! Handle a read-only request in a forked worker process, if enabled and applicable
+ *
+ * get, get-config and get-schema are handled in a worker process, in a copy-on-write
+ * snapshot of the backend including the datastore caches. Other requests, including
+ * commits, are meanwhile handled by the backend.
+ * A get of state data is handled by the backend if a plugin has a state deadline or max age,
+ * since state workers and cache would otherwise only be updated in the worker.
+ * The worker writes the reply to a pipe and exits. The backend reads the reply from the
+ * event loop and sends it to the client. Requests from the client are not read while the
+ * worker runs, so that replies are sent in request order.
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  x    Request: <rpc><xn></rpc>
+ * @retval     1    Parent: worker started, it sends the reply
+ * @retval     0    Not applicable, or in worker: handle request
+ * @retval    -1    Error
+ * @see CLICON_BACKEND_READ_WORKERS
+ */
+static int
+read_worker_start(clicon_handle        h,
+                  struct client_entry *ce,
+                  cxobj               *x)
+{
+    struct read_worker *rw = NULL;
+    cxobj              *xe;
+    char               *name;
+    char               *ns = NULL;
+    char               *attr;
+    int                 p[2];
+    pid_t               pid;
+
+    if (_read_workers >= clicon_option_int(h, "CLICON_BACKEND_READ_WORKERS"))
+        return 0;
+    if (xml_child_nr_type(x, CX_ELMNT) != 1 ||
+        (xe = xml_child_i_type(x, 0, CX_ELMNT)) == NULL)
+        return 0;
+    name = xml_name(xe);
+    if (xml2ns(xe, xml_prefix(xe), &ns) < 0)
+        return -1;
+    if (ns == NULL)
+        return 0;
+    if (!(strcmp(ns, NETCONF_BASE_NAMESPACE) == 0 &&
+          (strcmp(name, "get") == 0 || strcmp(name, "get-config") == 0)) &&
+        !(strcmp(ns, NETCONF_MONITORING_NAMESPACE) == 0 && strcmp(name, "get-schema") == 0))
+        return 0;
+    /* State workers and cache of plugins are kept by the backend, collect state here */
+    if (strcmp(name, "get") == 0 &&
+        ((attr = xml_find_value(xe, "content")) == NULL ||
+         netconf_content_str2int(attr) != CONTENT_CONFIG) &&
+        clixon_plugin_statedata_kept(h))
+        return 0;
+    if ((rw = calloc(1, sizeof(*rw))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    if ((rw->rw_cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        free(rw);
+        return -1;
+    }
+    if (pipe(p) < 0){
+        clicon_err(OE_UNIX, errno, "pipe");
+        goto fail;
+    }
+    if ((pid = fork()) < 0){
+        clicon_err(OE_UNIX, errno, "fork");
+        close(p[0]);
+        close(p[1]);
+        goto fail;
+    }
+    if (pid == 0){ /* Worker: handle request and write reply, see from_client_msg */
+        cbuf_free(rw->rw_cb);
+        free(rw);
+        close(p[0]);
+        _read_worker_fd = p[1];
+        return 0;
+    }
+    close(p[1]);
+    rw->rw_ce = ce;
+    rw->rw_pid = pid;
+    rw->rw_fd = p[0];
+    if (clixon_event_reg_fd(p[0], read_worker_cb, (void*)rw, "read worker") < 0){
+        close(p[0]);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        goto fail;
+    }
+    _read_workers++;
+    ce->ce_worker = rw;
+    clicon_debug(1, "%s client %d %s in worker %d", __FUNCTION__, ce->ce_nr, name, pid);
+    if (ce_input_update(h, ce) < 0)
+        return -1;
+    return 1;
+ fail:
+    cbuf_free(rw->rw_cb);
+    free(rw);
+    return -1;
+}
+
+/*! Write reply to parent and exit read worker process
+ *
+ * @param[in]  cbret  Reply
+ * @see read_worker_start
+ */
+static void
+read_worker_exit(cbuf *cbret)
+{
+    char   *s = cbuf_get(cbret);
+    size_t  len = cbuf_len(cbret);
+    ssize_t n;
+    int     status = 0;
+
+    while (len > 0){
+        if ((n = write(_read_worker_fd, s, len)) < 0){
+            if (errno == EINTR)
+                continue;
+            status = 1;
+            break;
+        }
+        s += n;
+        len -= n;
+    }
+    close(_read_worker_fd);
+    /* Exit without atexit handlers or stdio flush of the parent's buffers */
+    _exit(status);
+}
+
+/*! Write error reply to parent and exit read worker process
+ *
+ * Called on error in the worker, the parent always gets a reply
+ * @see read_worker_exit
+ */
+static void
+read_worker_fail(void)
+{
+    cbuf *cb;
+
+    if ((cb = cbuf_new()) == NULL ||
+        netconf_operation_failed(cb, "application", clicon_errno?clicon_err_reason:"Read worker failed") < 0)
+        _exit(1);
+    read_worker_exit(cb); /* Does not return */
+}
+
+/*! Release reference of distributed event to shared message
+ * @see stream_event_shared_set
+ */
+static void
+ce_sharedmsg_free(void *arg)
+{
+    ce_sharedmsg_release((struct ce_sharedmsg *)arg);
+}
+
 /*! Stream callback for netconf stream notification (RFC 5277)
  * @param[in]  h     Clicon handle
  * @param[in]  op    0:event, 1:rm
@@ -102,6 +746,9 @@ ce_event_cb(clicon_handle h,
             void         *arg)
 {
     struct client_entry *ce = (struct client_entry *)arg;
+    cbuf                *cb = NULL;
+    struct ce_sharedmsg *sm;
+    int                  hw;
     
     clicon_debug(1, "%s op:%d", __FUNCTION__, op);
     switch (op){
@@ -111,7 +758,30 @@ ce_event_cb(clicon_handle h,
             backend_client_rm(h, ce);
         break;
     default:
-        if (send_msg_notify_xml(h, ce->ce_s, event) < 0){
+        /* Slow subscriber: do not queue more */
+        hw = clicon_option_int(h, "CLICON_SOCK_HIGHWATER");
+        if (hw > 0 && ce->ce_outlen > hw){
+            clicon_log(LOG_WARNING, "client %d: notification dropped, %zu bytes queued",
+                       ce->ce_nr, ce->ce_outlen);
+            break;
+        }
+        /* Encode event once, the message is shared by all subscribers of the event */
+        if ((sm = stream_event_shared_get(event)) == NULL){
+            if (stream_event_cbuf(event, FORMAT_XML, &cb) < 0)
+                break;
+            if ((sm = calloc(1, sizeof(*sm))) == NULL){
+                clicon_err(OE_UNIX, errno, "calloc");
+                break;
+            }
+            if ((sm->sm_msg = clicon_msg_encode(0, "%s", cbuf_get(cb))) == NULL){
+                free(sm);
+                break;
+            }
+            sm->sm_refs = 1; /* Reference of the event */
+            if (stream_event_shared_set(event, sm, ce_sharedmsg_free) < 0)
+                break;
+        }
+        if (ce_send_shared(h, ce, sm) < 0){
             if (errno == ECONNRESET || errno == EPIPE){
                 clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
             }
@@ -291,8 +961,13 @@ backend_client_rm(clicon_handle        h,
     ce_prev = &c0; /* this points to stack and is not real backpointer */
     for (c = *ce_prev; c; c = c->ce_next){
         if (c == ce){
+            if (ce->ce_worker)
+                read_worker_kill(ce->ce_worker);
             if (ce->ce_s){
-                clixon_event_unreg_fd(ce->ce_s, from_client);
+                if (!ce->ce_blocked)
+                    clixon_event_unreg_fd(ce->ce_s, from_client);
+                if (ce->ce_outq)
+                    clixon_event_unreg_fd(ce->ce_s, ce_output_cb);
                 close(ce->ce_s);
                 ce->ce_s = 0;
                 if (release_all_dbs(h, ce->ce_id) < 0)
@@ -1342,6 +2017,10 @@ from_client_stats(clicon_handle h,
     yang_stats_global(&nr);
     cprintf(cbret, "<yangnr>%" PRIu64 "</yangnr>", nr);
     cprintf(cbret, "</global>");
+    if (clixon_event_stats(cbret, CLIXON_LIB_NS) < 0)
+        goto done;
+    if (clixon_plugin_statedata_stats(h, cbret) < 0)
+        goto done;
     if (clixon_stats_datastore_get(h, "running", cbret) < 0)
         goto done;
     if (clixon_stats_datastore_get(h, "candidate", cbret) < 0)
@@ -1477,6 +2156,11 @@ from_client_hello(clicon_handle       h,
 {
     int      retval = -1;
     char    *val;
+    cxobj  **vec = NULL;
+    size_t   veclen;
+    int      i;
+    uint64_t fp = 0;
+    int      ret;
 
     if ((val = xml_find_type_value(x, "cl", "transport", CX_ATTR)) != NULL){
         if ((ce->ce_transport = strdup(val)) == NULL){
@@ -1490,10 +2174,49 @@ from_client_hello(clicon_handle       h,
             goto done;
         }
     }
-    cprintf(cbret, "<hello xmlns=\"%s\"><session-id>%u</session-id></hello>",
-            NETCONF_BASE_NAMESPACE, ce->ce_id);
+    if (xpath_vec(x, NULL, "capabilities/capability", &vec, &veclen) < 0)
+        goto done;
+    for (i=0; i<veclen; i++){
+        if ((val = xml_body(vec[i])) == NULL)
+            continue;
+        /* Binary encoding proposed by client */
+        if (clicon_option_bool(h, "CLICON_SOCK_BINARY") &&
+            strncmp(val, CLIXON_BIN_CAPABILITY, strlen(CLIXON_BIN_CAPABILITY)) == 0){
+            ce->ce_binary = 1;
+            ce->ce_peerfp = strtoull(val + strlen(CLIXON_BIN_CAPABILITY), NULL, 16);
+        }
+        /* Shared memory ring passed by client with hello */
+        else if (strcmp(val, CLICON_SHM_CAPABILITY) == 0 &&
+                 ce->ce_shmfd != -1 && ce->ce_shm == NULL &&
+                 clicon_option_int(h, "CLICON_SOCK_SHM") > 0){
+            if ((ret = clicon_shm_attach(ce->ce_shmfd, &ce->ce_shm)) < 0)
+                goto done;
+            if (ret == 0)
+                clicon_log(LOG_WARNING, "%s: invalid shared memory segment from client %u",
+                           __FUNCTION__, ce->ce_id);
+            /* Mapping, if any, remains after close */
+            close(ce->ce_shmfd);
+            ce->ce_shmfd = -1;
+        }
+    }
+    cprintf(cbret, "<hello xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
+    if (ce->ce_binary || ce->ce_shm){
+        cprintf(cbret, "<capabilities>");
+        if (ce->ce_binary){
+            if (clixon_bin_fingerprint(h, clicon_dbspec_yang(h), &fp) < 0)
+                goto done;
+            cprintf(cbret, "<capability>%s%016" PRIx64 "</capability>",
+                    CLIXON_BIN_CAPABILITY, fp);
+        }
+        if (ce->ce_shm)
+            cprintf(cbret, "<capability>%s</capability>", CLICON_SHM_CAPABILITY);
+        cprintf(cbret, "</capabilities>");
+    }
+    cprintf(cbret, "<session-id>%u</session-id></hello>", ce->ce_id);
     retval = 0;
  done:
+    if (vec)
+        free(vec);
     return retval;
 }
 
@@ -1544,7 +2267,11 @@ from_client_msg(clicon_handle        h,
     /* Decode msg from client -> xml top (ct) and session id 
      * Bind is a part of the decode function
      */
-    if ((ret = clicon_msg_decode(msg, yspec, &op_id, &xt, &xret)) < 0){
+    if (clicon_msg_isbin(msg))
+        ret = clicon_msg_decode_bin(h, msg, yspec, &op_id, &xt, &xret);
+    else
+        ret = clicon_msg_decode(msg, yspec, &op_id, &xt, &xret);
+    if (ret < 0){
         if (netconf_malformed_message(cbret, "XML parse error") < 0)
             goto done;
         goto reply;
@@ -1638,7 +2365,13 @@ from_client_msg(clicon_handle        h,
     }
     ce->ce_in_rpcs++; /* Track all RPCs */
     netconf_monitoring_counter_inc(h, "in-rpcs");
-
+    /* Read-only requests may be handled by a worker process */
+    if ((ret = read_worker_start(h, ce, x)) < 0)
+        goto done;
+    if (ret == 1){
+        retval = 0;
+        goto done;
+    }
     xe = NULL;
     username = xml_find_value(x, "username");
     /* May be used by callbacks, etc */
@@ -1719,13 +2452,20 @@ from_client_msg(clicon_handle        h,
         }
     } /* while */
  reply:
+    if (ce->ce_replied){ /* Queued by handler, see backend_client_reply_chunked */
+        ce->ce_replied = 0;
+        retval = 0;
+        goto done;
+    }
     if (cbuf_len(cbret) == 0)
         if (netconf_operation_failed(cbret, "application", clicon_errno?clicon_err_reason:"unknown")< 0)
             goto done;
     // XXX    clicon_debug(CLIXON_DBG_MSG, "Reply:%s", cbuf_get(cbret));
     /* XXX problem here is that cbret has not been parsed so may contain 
        parse errors */
-    if (send_msg_reply(ce->ce_s, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
+    if (_read_worker_fd != -1)
+        read_worker_exit(cbret); /* Does not return */
+    if (ce_reply(h, ce, cbuf_get(cbret), cbuf_len(cbret)) < 0){
         switch (errno){
         case EPIPE:
             /* man (2) write: 
@@ -1746,6 +2486,8 @@ from_client_msg(clicon_handle        h,
     retval = 0;
   done:  
     clicon_debug(CLIXON_DBG_DETAIL, "%s retval:%d", __FUNCTION__, retval);
+    if (_read_worker_fd != -1)
+        read_worker_fail(); /* Error in worker, does not return */
     if (xnacm){
         xml_free(xnacm);
         if (clicon_nacm_cache_set(h, NULL) < 0)
@@ -1766,6 +2508,10 @@ from_client_msg(clicon_handle        h,
 }
 
 /*! An internal clicon message has arrived from a client. Receive and dispatch.
+ *
+ * Exactly one message is read and replied to per call. Further messages pipelined by the
+ * client remain on the socket and are handled in later event loop passes, so that replies
+ * are sent in the order requests were received.
  * @param[in]   s    Socket where message arrived. read from this.
  * @param[in]   arg  Client entry (from).
  * @retval      0    OK
@@ -1781,24 +2527,35 @@ from_client(int   s,
     struct client_entry *ce = (struct client_entry *)arg;
     clicon_handle        h = ce->ce_handle;
     int                  eof = 0;
+    int                  fd = -1;
 
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     if (s != ce->ce_s){
         clicon_err(OE_NETCONF, EINVAL, "Internal error: s != ce->ce_s");
         goto done;
     }
-    if (clicon_msg_rcv(ce->ce_s, 0, &msg, &eof) < 0)
+    /* A descriptor may be passed by the client with hello, see CLICON_SOCK_SHM */
+    if (clicon_msg_rcv_fd(ce->ce_s, 0, &fd, &msg, &eof) < 0)
         goto done;
     if (eof){
         backend_client_rm(h, ce); 
         netconf_monitoring_counter_inc(h, "dropped-sessions");
     }
-    else
+    else{
+        if (fd != -1){ /* Segment is mapped and closed in hello, if accepted */
+            if (ce->ce_shmfd != -1)
+                close(ce->ce_shmfd);
+            ce->ce_shmfd = fd;
+            fd = -1;
+        }
         if (from_client_msg(h, ce, msg) < 0)
             goto done;
+    }
     retval = 0;
   done:
     clicon_debug(CLIXON_DBG_DETAIL, "%s retval=%d", __FUNCTION__, retval);
+    if (fd != -1)
+        close(fd);
     if (msg)
         free(msg);
     return retval; /* -1 here terminates backend */
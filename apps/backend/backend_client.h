@@ -43,6 +43,7 @@
 int backend_monitoring_state_get(clicon_handle h, yang_stmt *yspec, char *xpath, cvec *nsc, cxobj **xret, cxobj **xerr);
 int backend_client_rm(clicon_handle h, struct client_entry *ce);
 int from_client(int fd, void *arg);
+int backend_client_reply_chunked(clicon_handle h, struct client_entry *ce, cxobj **xret, int32_t depth);
 int backend_rpc_init(clicon_handle h);
 
 #endif  /* _BACKEND_CLIENT_H_ */
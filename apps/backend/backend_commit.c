@@ -101,8 +101,17 @@ generic_validate(clicon_handle       h,
     int        ret;
     cbuf      *cb = NULL;
 
-    /* All entries */
-    if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0) 
+    /* All entries, or only entries affected by the change */
+    if (clicon_option_bool(h, "CLICON_VALIDATE_INCREMENTAL") &&
+        !clicon_option_bool(h, "CLICON_YANG_SCHEMA_MOUNT")){
+        if ((ret = xml_yang_validate_all_top_changed(h, td->td_target,
+                                                     td->td_dvec, td->td_dlen,
+                                                     td->td_avec, td->td_alen,
+                                                     td->td_tcvec, td->td_clen,
+                                                     xret)) < 0)
+            goto done;
+    }
+    else if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0) 
         goto done;
     if (ret == 0)
         goto fail;
@@ -439,8 +439,11 @@ filter_xpath_again(clicon_handle h,
 
 /*! Help function for NACM access and returnmessage
  *
- * @param[in]  h        Clicon handle 
- * @param[in]  xret     Result XML tree
+ * If binary encoding is negotiated with the client, the reply is binary encoded.
+ * If CLICON_SOCK_CHUNK is set, the reply is serialized in chunks directly to the client.
+ * @param[in]     h        Clicon handle 
+ * @param[in]     ce       Client entry
+ * @param[in,out] xretp    Result XML tree, set to NULL if consumed by chunked reply
  * @param[in]  xvec    xpath lookup result on xret
  * @param[in]  xlen    length of xvec
  * @param[in]  xpath    XPath point to object to get
@@ -452,18 +455,21 @@ filter_xpath_again(clicon_handle h,
  * @retval    -1        Error
  */
 static int
-get_nacm_and_reply(clicon_handle h,
-                   cxobj        *xret,
-                   cxobj       **xvec,
-                   size_t        xlen,
-                   char         *xpath,
-                   cvec         *nsc,
-                   char         *username,
-                   int32_t       depth,
-                   cbuf         *cbret)
+get_nacm_and_reply(clicon_handle        h,
+                   struct client_entry *ce,
+                   cxobj              **xretp,
+                   cxobj              **xvec,
+                   size_t               xlen,
+                   char                *xpath,
+                   cvec                *nsc,
+                   char                *username,
+                   int32_t              depth,
+                   cbuf                *cbret)
 {
     int     retval = -1;
+    cxobj  *xret = *xretp;
     cxobj  *xnacm = NULL;
+    int     ret;
 
     /* Pre-NACM access step */
     xnacm = clicon_nacm_cache(h);
@@ -472,6 +478,26 @@ get_nacm_and_reply(clicon_handle h,
         if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
             goto done;
     }
+    /* Binary encoding, but not if other callbacks have written text to cbret */
+    if (ce->ce_binary && xret != NULL && cbuf_len(cbret) == 0){
+        if (xml_name_set(xret, NETCONF_OUTPUT_DATA) < 0)
+            goto done;
+        /* Top level is rpc-reply/data, so add 2 to depth if significant */
+        if (clixon_xml2bin(h, cbret, "rpc-reply", NETCONF_BASE_NAMESPACE, &xret, 1,
+                           depth>0?depth+2:depth, ce->ce_peerfp) < 0)
+            goto done;
+        goto ok;
+    }
+    /* Chunked text reply, same condition on cbret */
+    if (xret != NULL && cbuf_len(cbret) == 0){
+        if (xml_name_set(xret, NETCONF_OUTPUT_DATA) < 0)
+            goto done;
+        /* Top level is data, so add 1 to depth if significant */
+        if ((ret = backend_client_reply_chunked(h, ce, xretp, depth>0?depth+1:depth)) < 0)
+            goto done;
+        if (ret == 1)
+            goto ok;
+    }
     cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);     /* OK */
     if (xret==NULL)
         cprintf(cbret, "<data/>");
@@ -483,6 +509,7 @@ get_nacm_and_reply(clicon_handle h,
             goto done;
     }
     cprintf(cbret, "</rpc-reply>");
+ ok:
     retval = 0;
  done:
     return retval;
@@ -549,10 +576,895 @@ list_pagination_hdr(clicon_handle h,
     return retval;
 }
 
+/* Max number of cached pagination indexes, the least recently used is removed */
+#define PAGINATION_INDEX_MAX 8
+
+/*! Index of a list or leaf-list in a datastore cache, entries in sort-by order
+ *
+ * The index is valid as long as the datastore cache has the same generation
+ * @see xmldb_generation
+ */
+struct pagination_index{
+    qelem_t    pi_q;      /* queue header */
+    char      *pi_db;     /* Datastore */
+    char      *pi_xpath;  /* Canonical XPath of list or leaf-list */
+    char      *pi_sort;   /* sort-by node, or NULL for list order */
+    cxobj     *pi_top;    /* Top of cached tree when built */
+    uint64_t   pi_gen;    /* Generation of cache when built, 0 is never valid */
+    cxobj    **pi_vec;    /* Entries */
+    size_t     pi_len;    /* Number of entries */
+};
+
+/*! Sort key of an entry, see pagination_sort
+ */
+struct pagination_key{
+    cxobj      *pk_x;       /* Entry */
+    char       *pk_val;     /* Value of sort-by node, or NULL if missing */
+    long double pk_num;     /* Numeric value, if pk_numeric */
+    int         pk_numeric; /* Value is numeric */
+    size_t      pk_pos;     /* Position in list order */
+};
+
+/*! Compare sort-by values of sort keys: ascending, missing values last
+ */
+static int
+pagination_val_cmp(const struct pagination_key *pa,
+                   const struct pagination_key *pb)
+{
+    if (pa->pk_val == NULL || pb->pk_val == NULL)
+        return (pa->pk_val == NULL) - (pb->pk_val == NULL);
+    if (pa->pk_numeric && pb->pk_numeric)
+        return (pa->pk_num > pb->pk_num) - (pa->pk_num < pb->pk_num);
+    return strcmp(pa->pk_val, pb->pk_val);
+}
+
+/*! Compare sort keys: on sort-by value, then on list keys as in list order, then stable
+ */
+static int
+pagination_key_cmp(const void *a,
+                   const void *b)
+{
+    const struct pagination_key *pa = (const struct pagination_key *)a;
+    const struct pagination_key *pb = (const struct pagination_key *)b;
+    int                          eq;
+
+    if ((eq = pagination_val_cmp(pa, pb)) == 0 &&
+        (eq = xml_cmp(pa->pk_x, pb->pk_x, 0, 0, NULL)) == 0)
+        eq = (pa->pk_pos > pb->pk_pos) - (pa->pk_pos < pb->pk_pos);
+    return eq;
+}
+
+/*! Get value of sort-by node of an entry
+ * @param[in]  x      List entry
+ * @param[in]  steps  Node identifiers of sort-by, prefixes are ignored
+ * @param[in]  nsteps Number of steps
+ * @retval     value  Body of sort-by node
+ * @retval     NULL   Not found
+ */
+static char *
+pagination_sort_value(cxobj  *x,
+                      char  **steps,
+                      int     nsteps)
+{
+    int   i;
+    char *id;
+
+    for (i=0; i<nsteps && x != NULL; i++){
+        if ((id = strchr(steps[i], ':')) != NULL)
+            id++;
+        else
+            id = steps[i];
+        x = xml_find_type(x, NULL, id, CX_ELMNT);
+    }
+    return x?xml_body(x):NULL;
+}
+
+/*! Set sort key of an entry
+ *
+ * @param[out] pk      Sort key
+ * @param[in]  x       Entry
+ * @param[in]  val     Value of sort-by node, or NULL if missing
+ * @param[in]  numeric Leaf is of integer or decimal64 type
+ */
+static void
+pagination_key_set(struct pagination_key *pk,
+                   cxobj                 *x,
+                   char                  *val,
+                   int                    numeric)
+{
+    char *ep;
+
+    memset(pk, 0, sizeof(*pk));
+    pk->pk_x = x;
+    if ((pk->pk_val = val) != NULL && numeric){
+        pk->pk_num = strtold(val, &ep);
+        pk->pk_numeric = (ep != val && *ep == '\0');
+    }
+}
+
+/*! Sort entries of a list on the value of a descendant leaf
+ *
+ * Sorts are in ascending order, numerically if the leaf is of numeric type. Missing values
+ * are sorted last. Entries with equal values are sorted on their keys, as in list order.
+ * @param[in,out] vec     Entries
+ * @param[in]     len     Number of entries
+ * @param[in]     sort    sort-by, descendant schema node identifier
+ * @param[in]     numeric Leaf is of integer or decimal64 type
+ * @retval        0       OK
+ * @retval       -1       Error
+ */
+static int
+pagination_sort(cxobj **vec,
+                size_t  len,
+                char   *sort,
+                int     numeric)
+{
+    int                    retval = -1;
+    struct pagination_key *keys = NULL;
+    char                 **steps = NULL;
+    int                    nsteps;
+    size_t                 i;
+
+    if (len == 0)
+        goto ok;
+    if ((steps = clicon_strsep(sort, "/", &nsteps)) == NULL)
+        goto done;
+    if ((keys = calloc(len, sizeof(*keys))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (i=0; i<len; i++){
+        pagination_key_set(&keys[i], vec[i], pagination_sort_value(vec[i], steps, nsteps), numeric);
+        keys[i].pk_pos = i;
+    }
+    qsort(keys, len, sizeof(*keys), pagination_key_cmp);
+    for (i=0; i<len; i++)
+        vec[i] = keys[i].pk_x;
+ ok:
+    retval = 0;
+ done:
+    if (keys)
+        free(keys);
+    if (steps)
+        free(steps);
+    return retval;
+}
+
+/*! Check sort-by of a list
+ *
+ * @param[in]  ylist   Yang of list or leaf-list
+ * @param[in]  sort    sort-by, descendant schema node identifier
+ * @param[out] numeric Leaf is of integer or decimal64 type
+ * @param[out] cbret   Netconf error message if invalid
+ * @retval     1       OK
+ * @retval     0       Invalid, netconf invalid-value error cbret set
+ * @retval    -1       Error
+ */
+static int
+pagination_sort_check(yang_stmt *ylist,
+                      char      *sort,
+                      int       *numeric,
+                      cbuf      *cbret)
+{
+    int           retval = -1;
+    char        **steps = NULL;
+    int           nsteps;
+    yang_stmt    *y = ylist;
+    char         *id;
+    int           i;
+    enum cv_type  cvtype;
+
+    if ((steps = clicon_strsep(sort, "/", &nsteps)) == NULL)
+        goto done;
+    for (i=0; i<nsteps && y != NULL; i++){
+        if ((id = strchr(steps[i], ':')) != NULL)
+            id++;
+        else
+            id = steps[i];
+        y = yang_find_datanode(y, id);
+    }
+    if (yang_keyword_get(ylist) != Y_LIST || y == NULL || yang_keyword_get(y) != Y_LEAF){
+        if (netconf_invalid_value(cbret, "application", "sort-by is not a descendant leaf of the list") < 0)
+            goto done;
+        goto fail;
+    }
+    cvtype = yang_type2cv(y);
+    *numeric = cv_isint(cvtype) || cvtype == CGV_DEC64;
+    retval = 1;
+ done:
+    if (steps)
+        free(steps);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Get index of a list in a datastore cache, build it if not cached or not valid
+ *
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Datastore
+ * @param[in]  x0t    Cached top of tree, see xmldb_cache_bind
+ * @param[in]  xpath  Canonical XPath of list
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  sort   sort-by or NULL
+ * @param[in]  numeric Sort numerically
+ * @param[out] pip    Index, valid until next call
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+pagination_index_get(clicon_handle             h,
+                     char                     *db,
+                     cxobj                    *x0t,
+                     char                     *xpath,
+                     cvec                     *nsc,
+                     char                     *sort,
+                     int                       numeric,
+                     struct pagination_index **pip)
+{
+    int                      retval = -1;
+    struct pagination_index *head = NULL;
+    struct pagination_index *pi;
+    struct pagination_index *pi1 = NULL;
+    uint64_t                 gen;
+    int                      nr = 0;
+
+    clicon_ptr_get(h, "pagination-index", (void**)&head);
+    if ((pi = head) != NULL){
+        do {
+            nr++;
+            if (strcmp(pi->pi_db, db) == 0 &&
+                strcmp(pi->pi_xpath, xpath) == 0 &&
+                (sort?(pi->pi_sort && strcmp(pi->pi_sort, sort) == 0):pi->pi_sort == NULL))
+                pi1 = pi;
+            pi = NEXTQ(struct pagination_index *, pi);
+        } while (pi && pi != head);
+    }
+    if ((pi = pi1) != NULL){
+        DELQ(pi, head, struct pagination_index *);
+    }
+    else if (nr >= PAGINATION_INDEX_MAX){ /* Reuse least recently used */
+        pi = PREVQ(struct pagination_index *, head);
+        DELQ(pi, head, struct pagination_index *);
+        free(pi->pi_db);
+        free(pi->pi_xpath);
+        if (pi->pi_sort)
+            free(pi->pi_sort);
+        if (pi->pi_vec)
+            free(pi->pi_vec);
+        memset(pi, 0, sizeof(*pi));
+    }
+    else if ((pi = calloc(1, sizeof(*pi))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    INSQ(pi, head); /* Most recently used first */
+    if (clicon_ptr_set(h, "pagination-index", head) < 0)
+        goto done;
+    if (pi->pi_db == NULL){
+        if ((pi->pi_db = strdup(db)) == NULL ||
+            (pi->pi_xpath = strdup(xpath)) == NULL ||
+            (sort && (pi->pi_sort = strdup(sort)) == NULL)){
+            clicon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+    }
+    gen = xmldb_generation(h, db);
+    if (pi->pi_gen == 0 || pi->pi_gen != gen || pi->pi_top != x0t){
+        if (pi->pi_vec){
+            free(pi->pi_vec);
+            pi->pi_vec = NULL;
+        }
+        pi->pi_len = 0;
+        if (xpath_vec(x0t, nsc, "%s", &pi->pi_vec, &pi->pi_len, xpath) < 0)
+            goto done;
+        if (sort && pagination_sort(pi->pi_vec, pi->pi_len, sort, numeric) < 0)
+            goto done;
+        pi->pi_top = x0t;
+        pi->pi_gen = gen;
+    }
+    *pip = pi;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Free all cached pagination indexes
+ *
+ * @param[in]  h      Clicon handle
+ * @retval     0      OK
+ */
+int
+backend_get_exit(clicon_handle h)
+{
+    struct pagination_index *head = NULL;
+    struct pagination_index *pi;
+
+    clicon_ptr_get(h, "pagination-index", (void**)&head);
+    while ((pi = head) != NULL){
+        DELQ(pi, head, struct pagination_index *);
+        free(pi->pi_db);
+        free(pi->pi_xpath);
+        if (pi->pi_sort)
+            free(pi->pi_sort);
+        if (pi->pi_vec)
+            free(pi->pi_vec);
+        free(pi);
+    }
+    clicon_ptr_del(h, "pagination-index");
+    return 0;
+}
+
+/*! Add a body to an entry or key leaf of a cursor, if it is a valid value of its type
+ *
+ * The parsed value is cached in the node, as in list order compares
+ * @param[in]  x      Leaf-list entry or key leaf
+ * @param[in]  y      Yang of x
+ * @param[in]  val    Value
+ * @retval     1      OK
+ * @retval     0      Not a valid value
+ * @retval    -1      Error
+ * @see xml_cmp
+ */
+static int
+pagination_cursor_body(cxobj     *x,
+                       yang_stmt *y,
+                       char      *val)
+{
+    int          retval = -1;
+    yang_stmt   *yrestype = NULL;
+    int          options = 0;
+    uint8_t      fraction = 0;
+    enum cv_type cvtype;
+    cg_var      *cv = NULL;
+    char        *reason = NULL;
+    cxobj       *xb;
+    int          ret;
+
+    if (yang_type_get(y, NULL, &yrestype, &options, NULL, NULL, NULL, &fraction) < 0)
+        goto done;
+    yang2cv_type(yang_argument_get(yrestype), &cvtype);
+    if (cvtype == CGV_ERR){
+        clicon_err(OE_YANG, errno, "yang->cligen type %s mapping failed",
+                   yang_argument_get(yrestype));
+        goto done;
+    }
+    if ((cv = cv_new(cvtype)) == NULL){
+        clicon_err(OE_YANG, errno, "cv_new");
+        goto done;
+    }
+    if (cvtype == CGV_DEC64)
+        cv_dec64_n_set(cv, fraction);
+    if ((ret = cv_parse1(val, cv, &reason)) < 0){
+        clicon_err(OE_YANG, errno, "cv_parse1");
+        goto done;
+    }
+    if (ret == 0)
+        goto fail;
+    if ((xb = xml_new("body", x, CX_BODY)) == NULL)
+        goto done;
+    if (xml_value_set(xb, val) < 0)
+        goto done;
+    if (xml_cv_set(x, cv) < 0)
+        goto done;
+    cv = NULL;
+    retval = 1;
+ done:
+    if (reason)
+        free(reason);
+    if (cv)
+        cv_free(cv);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Make an entry with the keys of a cursor, to compare with entries of an index
+ *
+ * @param[in]  ylist  Yang of list or leaf-list
+ * @param[in]  keys   Decoded key values of cursor, or leaf-list value
+ * @param[in]  nkeys  Number of key values
+ * @param[out] xp     Entry, free with xml_free
+ * @retval     1      OK
+ * @retval     0      Wrong number of keys, or a key is not a valid value
+ * @retval    -1      Error
+ */
+static int
+pagination_cursor_entry(yang_stmt *ylist,
+                        char     **keys,
+                        int        nkeys,
+                        cxobj    **xp)
+{
+    int        retval = -1;
+    cxobj     *x = NULL;
+    cxobj     *xk;
+    cvec      *cvk;
+    cg_var    *cvi = NULL;
+    yang_stmt *yk;
+    char      *kname;
+    int        i = 0;
+    int        ret;
+
+    if ((x = xml_new(yang_argument_get(ylist), NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (xml_spec_set(x, ylist) < 0)
+        goto done;
+    if (yang_keyword_get(ylist) == Y_LEAF_LIST){
+        if (nkeys != 1)
+            goto fail;
+        if ((ret = pagination_cursor_body(x, ylist, keys[0])) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+    }
+    else {
+        cvk = yang_cvec_get(ylist);
+        if (nkeys != cvec_len(cvk))
+            goto fail;
+        while ((cvi = cvec_each(cvk, cvi)) != NULL){
+            kname = cv_string_get(cvi);
+            if ((yk = yang_find(ylist, Y_LEAF, kname)) == NULL){
+                clicon_err(OE_YANG, ENOENT, "yang spec of key %s not found", kname);
+                goto done;
+            }
+            if ((xk = xml_new(kname, x, CX_ELMNT)) == NULL)
+                goto done;
+            if (xml_spec_set(xk, yk) < 0)
+                goto done;
+            if ((ret = pagination_cursor_body(xk, yk, keys[i++])) < 0)
+                goto done;
+            if (ret == 0)
+                goto fail;
+        }
+    }
+    *xp = x;
+    x = NULL;
+    retval = 1;
+ done:
+    if (x)
+        xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Make opaque cursor of an entry: its position in the index, sort-by value and keys
+ *
+ * The cursor is "<position>[,<sort-by>],<key>[,<key>]*" with percent-encoded values. The
+ * sort-by field is present if sort-by is given, and is "=<value>", or empty if the entry
+ * has no such node. A leaf-list has its value as key.
+ * @param[in]  x      List or leaf-list entry
+ * @param[in]  ylist  Yang of list or leaf-list
+ * @param[in]  sort   sort-by or NULL
+ * @param[in]  pos    Position in index
+ * @param[out] cb     Cursor
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+pagination_cursor_encode(cxobj     *x,
+                         yang_stmt *ylist,
+                         char      *sort,
+                         int        pos,
+                         cbuf      *cb)
+{
+    int     retval = -1;
+    cvec   *cvk;
+    cg_var *cvi = NULL;
+    char   *body;
+    char   *enc = NULL;
+    char  **steps = NULL;
+    int     nsteps;
+
+    cprintf(cb, "%d", pos);
+    if (sort){
+        if ((steps = clicon_strsep(sort, "/", &nsteps)) == NULL)
+            goto done;
+        cprintf(cb, ",");
+        if ((body = pagination_sort_value(x, steps, nsteps)) != NULL){
+            if (uri_percent_encode(&enc, "%s", body) < 0)
+                goto done;
+            cprintf(cb, "=%s", enc);
+            free(enc);
+            enc = NULL;
+        }
+    }
+    if (yang_keyword_get(ylist) == Y_LEAF_LIST){
+        body = xml_body(x);
+        if (uri_percent_encode(&enc, "%s", body?body:"") < 0)
+            goto done;
+        cprintf(cb, ",%s", enc);
+    }
+    else {
+        cvk = yang_cvec_get(ylist);
+        while ((cvi = cvec_each(cvk, cvi)) != NULL){
+            body = xml_find_body(x, cv_string_get(cvi));
+            if (uri_percent_encode(&enc, "%s", body?body:"") < 0)
+                goto done;
+            cprintf(cb, ",%s", enc);
+            free(enc);
+            enc = NULL;
+        }
+    }
+    retval = 0;
+ done:
+    if (steps)
+        free(steps);
+    if (enc)
+        free(enc);
+    return retval;
+}
+
+/*! Compare the entry of a cursor with an entry of an index, in index order
+ *
+ * @param[in]  pkc     Sort key of cursor entry
+ * @param[in]  x       Entry of index
+ * @param[in]  steps   Node identifiers of sort-by, or NULL if no sort-by
+ * @param[in]  nsteps  Number of steps
+ * @param[in]  numeric Sort numerically
+ * @retval     0       Equal
+ * @retval    <0       Cursor entry is before x
+ * @retval    >0       Cursor entry is after x
+ */
+static int
+pagination_cursor_cmp(struct pagination_key *pkc,
+                      cxobj                 *x,
+                      char                 **steps,
+                      int                    nsteps,
+                      int                    numeric)
+{
+    struct pagination_key pk;
+    int                   eq = 0;
+
+    if (steps){
+        pagination_key_set(&pk, x, pagination_sort_value(x, steps, nsteps), numeric);
+        eq = pagination_val_cmp(pkc, &pk);
+    }
+    if (eq == 0)
+        eq = xml_cmp(pkc->pk_x, x, 0, 0, NULL);
+    return eq;
+}
+
+/*! Find where to continue after the entry of a cursor in an index
+ *
+ * If the entry is still at the position of the cursor, it is found directly. Otherwise,
+ * eg after the list has been modified, the index is binary searched for the sort-by value
+ * and keys of the cursor, which is the index order if sort-by is given or the list is
+ * ordered-by system. If the entry has been deleted, the search ends at the entry
+ * following it, and the page starts there.
+ * An ordered-by user or state list without sort-by is searched linearly for the keys.
+ * If not found, the entry following it is assumed to have taken its position.
+ * @param[in]  cursor    Cursor, see pagination_cursor_encode
+ * @param[in]  ylist     Yang of list or leaf-list
+ * @param[in]  sort      sort-by or NULL
+ * @param[in]  numeric   Sort numerically
+ * @param[in]  backwards Traverse from last to first entry
+ * @param[in]  vec       Index
+ * @param[in]  len       Length of index
+ * @param[out] startp    Position to start after, see pagination_scan
+ * @retval     1         OK
+ * @retval     0         Invalid cursor
+ * @retval    -1         Error
+ */
+static int
+pagination_cursor_find(char      *cursor,
+                       yang_stmt *ylist,
+                       char      *sort,
+                       int        numeric,
+                       int        backwards,
+                       cxobj    **vec,
+                       size_t     len,
+                       int       *startp)
+{
+    int                   retval = -1;
+    char                **vals = NULL;
+    int                   nvals;
+    char                **keys = NULL;
+    int                   nkeys = 0;
+    int                   k0 = sort?2:1; /* First key field */
+    char                 *sval = NULL;
+    char                **steps = NULL;
+    int                   nsteps = 0;
+    cxobj                *xc = NULL;
+    struct pagination_key pkc;
+    char                 *ep;
+    long                  pos;
+    size_t                lo;
+    size_t                hi;
+    size_t                mid;
+    int                   i;
+    int                   ret;
+
+    if ((vals = clicon_strsep(cursor, ",", &nvals)) == NULL)
+        goto done;
+    pos = strtol(vals[0], &ep, 10);
+    if (nvals <= k0 || ep == vals[0] || *ep != '\0' || pos < 0)
+        goto fail;
+    if (sort){
+        if (*vals[1] == '='){
+            if (uri_percent_decode(vals[1]+1, &sval) < 0)
+                goto done;
+        }
+        else if (*vals[1] != '\0')
+            goto fail;
+        if ((steps = clicon_strsep(sort, "/", &nsteps)) == NULL)
+            goto done;
+    }
+    if ((keys = calloc(nvals-k0, sizeof(char*))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (nkeys=0; nkeys<nvals-k0; nkeys++)
+        if (uri_percent_decode(vals[nkeys+k0], &keys[nkeys]) < 0)
+            goto done;
+    if ((ret = pagination_cursor_entry(ylist, keys, nkeys, &xc)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+    if (pos < len && xml_cmp(xc, vec[pos], 0, 0, NULL) == 0){
+        *startp = pos;
+        goto ok;
+    }
+    if (sort == NULL &&
+        (yang_find(ylist, Y_ORDERED_BY, "user") != NULL || yang_config_ancestor(ylist) == 0)){
+        for (i=0; i<len; i++)
+            if (xml_cmp(xc, vec[i], 0, 0, NULL) == 0){
+                *startp = i;
+                goto ok;
+            }
+        if (pos > len)
+            pos = len;
+        *startp = backwards?pos:pos-1;
+        goto ok;
+    }
+    /* Binary search for the first entry not before the cursor entry */
+    pagination_key_set(&pkc, xc, sval, numeric);
+    lo = 0;
+    hi = len;
+    while (lo < hi){
+        mid = lo + (hi-lo)/2;
+        if (pagination_cursor_cmp(&pkc, vec[mid], steps, nsteps, numeric) > 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    /* Continue after the entry if found, otherwise at the entry following it */
+    if (backwards ||
+        (lo < len && pagination_cursor_cmp(&pkc, vec[lo], steps, nsteps, numeric) == 0))
+        *startp = lo;
+    else
+        *startp = (int)lo - 1;
+ ok:
+    retval = 1;
+ done:
+    if (xc)
+        xml_free(xc);
+    if (steps)
+        free(steps);
+    if (sval)
+        free(sval);
+    if (keys){
+        for (i=0; i<nkeys; i++)
+            if (keys[i])
+                free(keys[i]);
+        free(keys);
+    }
+    if (vals)
+        free(vals);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Select a page of entries from an index
+ *
+ * The where filter is evaluated on each entry during the scan. Without a where filter,
+ * the start of the page is found directly from offset.
+ * @param[in]  vec       Index, entries in sort-by order
+ * @param[in]  len       Length of index
+ * @param[in]  xwhere    Parsed where XPath, or NULL
+ * @param[in]  nscw      Namespace context of where
+ * @param[in]  backwards Traverse from last to first entry
+ * @param[in]  start     Position to start after, see pagination_cursor_find, or -1 for first entry
+ * @param[in]  offset    Number of entries to skip
+ * @param[in]  limit     Max number of entries, 0 is unbounded
+ * @param[out] pagep     Entries of page, free with free()
+ * @param[out] plenp     Number of entries of page
+ * @param[out] lastp     Position of last entry of page in index, or -1
+ * @param[out] remaining Number of entries after the page, 0 if not counted
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
+static int
+pagination_scan(cxobj      **vec,
+                size_t       len,
+                xpath_tree  *xwhere,
+                cvec        *nscw,
+                int          backwards,
+                int          start,
+                uint32_t     offset,
+                uint32_t     limit,
+                cxobj     ***pagep,
+                int         *plenp,
+                int         *lastp,
+                uint32_t    *remaining)
+{
+    int      retval = -1;
+    int      step = backwards?-1:1;
+    long     i;
+    xp_ctx  *xc = NULL;
+    int      ret;
+
+    *lastp = -1;
+    *remaining = 0;
+    if (start < 0)
+        i = backwards?(long)len-1:0;
+    else
+        i = start + step;
+    if (xwhere == NULL){
+        i += (long)step*offset;
+        offset = 0;
+    }
+    for (; i >= 0 && i < len; i += step){
+        if (xwhere){
+            if (xpath_tree_ctx(vec[i], nscw, xwhere, 0, &xc) < 0)
+                goto done;
+            ret = ctx2boolean(xc);
+            ctx_free(xc);
+            xc = NULL;
+            if (ret != 1)
+                continue;
+        }
+        if (offset){
+            offset--;
+            continue;
+        }
+        if (limit && *plenp == limit){
+            (*remaining)++;
+#ifdef LIST_PAGINATION_REMAINING
+            continue;
+#else
+            break; /* Only check that there is one more */
+#endif
+        }
+        if (cxvec_append(vec[i], pagep, plenp) < 0)
+            goto done;
+        *lastp = i;
+    }
+    retval = 0;
+ done:
+    if (xc)
+        ctx_free(xc);
+    return retval;
+}
+
+/*! Select a page of a list in a tree, remove other entries and reorder in page order
+ *
+ * Used when there is no datastore cache to index, and for state lists.
+ * @param[in]  xret      XML tree
+ * @param[in]  ylist     Yang of list or leaf-list
+ * @param[in]  xpath     XPath of list
+ * @param[in]  nsc       Namespace context of xpath
+ * @param[in]  sort      sort-by or NULL
+ * @param[in]  numeric   Sort numerically
+ * @param[in]  xwhere    Parsed where XPath, or NULL
+ * @param[in]  nscw      Namespace context of where
+ * @param[in]  backwards Traverse from last to first entry
+ * @param[in]  cursor    Cursor of request, or NULL
+ * @param[in]  offset    Number of entries to skip
+ * @param[in]  limit     Max number of entries, 0 is unbounded
+ * @param[out] cbcursor  Cursor of last entry if there are more entries
+ * @param[out] remaining Number of entries after the page
+ * @retval     1         OK
+ * @retval     0         Invalid cursor
+ * @retval    -1         Error
+ */
+static int
+pagination_tree(cxobj      *xret,
+                yang_stmt  *ylist,
+                char       *xpath,
+                cvec       *nsc,
+                char       *sort,
+                int         numeric,
+                xpath_tree *xwhere,
+                cvec       *nscw,
+                int         backwards,
+                char       *cursor,
+                uint32_t    offset,
+                uint32_t    limit,
+                cbuf       *cbcursor,
+                uint32_t   *remaining)
+{
+    int      retval = -1;
+    cxobj  **vec = NULL;
+    size_t   len = 0;
+    cxobj  **page = NULL;
+    int      plen = 0;
+    int      start = -1;
+    int      last;
+    cxobj   *xp;
+    size_t   i;
+    int      ret;
+
+    if (xpath_vec(xret, nsc, "%s", &vec, &len, xpath?xpath:"/") < 0)
+        goto done;
+    if (sort && pagination_sort(vec, len, sort, numeric) < 0)
+        goto done;
+    if (cursor){
+        if ((ret = pagination_cursor_find(cursor, ylist, sort, numeric, backwards, vec, len, &start)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+    }
+    if (pagination_scan(vec, len, xwhere, nscw, backwards, start, offset, limit,
+                        &page, &plen, &last, remaining) < 0)
+        goto done;
+    if (*remaining && last != -1)
+        if (pagination_cursor_encode(vec[last], ylist, sort, last, cbcursor) < 0)
+            goto done;
+    for (i=0; i<plen; i++)
+        xml_flag_set(page[i], XML_FLAG_MARK);
+    for (i=0; i<len; i++)
+        if (!xml_flag(vec[i], XML_FLAG_MARK))
+            if (xml_purge(vec[i]) < 0)
+                goto done;
+    for (i=0; i<plen; i++){
+        xml_flag_reset(page[i], XML_FLAG_MARK);
+        xp = xml_parent(page[i]);
+        if (xml_rm(page[i]) < 0)
+            goto done;
+        if (xml_addsub(xp, page[i]) < 0)
+            goto done;
+    }
+    retval = 1;
+ done:
+    if (vec)
+        free(vec);
+    if (page)
+        free(page);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Check if list-pagination has parameters other than offset and limit
+ *
+ * @param[in]  xe     Request: <list-pagination>
+ * @retval     1      Any of cursor, sort-by, where, or direction backwards
+ * @retval     0      No, or default values
+ */
+static int
+list_pagination_ordered(cxobj *xe)
+{
+    char *str;
+
+    if (xml_find_value(xe, "cursor") != NULL)
+        return 1;
+    if ((str = xml_find_body(xe, "direction")) != NULL && strcmp(str, "forwards") != 0)
+        return 1;
+    if ((str = xml_find_body(xe, "sort-by")) != NULL && strcmp(str, "none") != 0)
+        return 1;
+    if ((str = xml_find_body(xe, "where")) != NULL && strcmp(str, "unfiltered") != 0)
+        return 1;
+    return 0;
+}
+
 /*! Specialized get for list-pagination
  *
  * It is specialized enough to have its own function. Specifically, extra attributes as well
  * as the list-paginaiton API
+ * Config lists are paged from an index of the datastore cache, in sort-by order and kept
+ * until the datastore is changed. Offset is a direct seek unless there is a where filter,
+ * which is evaluated on each entry during the scan.
+ * If there are more entries, the reply has a clixon-lib cursor attribute on the data
+ * element. The client can give it as cursor attribute on list-pagination to get the next
+ * page, starting directly after the last entry of the previous page, or where it was if it
+ * has been deleted.
  * @param[in]  h       Clicon handle 
  * @param[in]  ce      Client entry, for locking
  * @param[in]  xe      Request: <rpc><xn></rpc> 
@@ -567,8 +1479,6 @@ list_pagination_hdr(clicon_handle h,
  * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
  * @retval     0       OK
  * @retval    -1       Error
- * @note pagination uses appending xpath with predicate, eg [position()<limit], this may not work 
- *       if there is an existing predicate
  * XXX Lots of this code (in particular at the end) is copy of get_common
  */
 static int
@@ -589,25 +1499,34 @@ get_list_pagination(clicon_handle        h,
     int             retval = -1;
     uint32_t        offset = 0;
     uint32_t        limit = 0;
-    cbuf           *cbpath = NULL;
     int             list_config;
     yang_stmt      *ylist;
     cxobj          *xerr = NULL;
     cbuf           *cbmsg = NULL; /* For error msg */
     cxobj          *xret = NULL;
-    char           *xpath2; /* With optional pagination predicate */
     int             ret;
     uint32_t        iddb; /* DBs lock, if any */
     int             locked;
     cbuf           *cberr = NULL; 
     cxobj         **xvec = NULL;
     size_t          xlen;
-#ifdef NOTYET
     cxobj          *x;
-    char           *direction = NULL;
+    char           *direction;
+    int             backwards = 0;
     char           *sort = NULL;
+    int             numeric = 0;
     char           *where = NULL;
-#endif
+    xpath_tree     *xwhere = NULL;
+    cvec           *nscw = NULL;
+    char           *cursor;
+    cxobj          *x0t = NULL;
+    struct pagination_index *pi;
+    int             start = -1;
+    cxobj         **page = NULL;
+    int             plen = 0;
+    int             last;
+    cbuf           *cbcursor = NULL;
+    uint32_t        remaining = 0;
 
     if (cbret == NULL){
         clicon_err(OE_PLUGIN, EINVAL, "cbret is NULL");
@@ -650,63 +1569,82 @@ get_list_pagination(clicon_handle        h,
     }
     if ((ret = list_pagination_hdr(h, xe, &offset, &limit, cbret)) < 0)
         goto done;
-#ifdef NOTYET
+    if (ret == 0)
+        goto ok;
     /* direction */
-    if (ret && (x = xml_find_type(xe, NULL, "direction", CX_ELMNT)) != NULL){
-        direction = xml_body(x);
-        if (strcmp(direction, "forward") != 0 && strcmp(direction, "reverse") != 0){
+    if ((direction = xml_find_body(xe, "direction")) != NULL){
+        if (strcmp(direction, "backwards") == 0)
+            backwards = 1;
+        else if (strcmp(direction, "forwards") != 0){
             if (netconf_bad_attribute(cbret, "application",
                                       "direction", "Unrecognized value of direction attribute") < 0)
                 goto done;
             goto ok;
         }
     }
-    /* sort */
-    if (ret && (x = xml_find_type(xe, NULL, "sort-by", CX_ELMNT)) != NULL)
-        sort = xml_body(x);
-    if (sort) {
-        /* XXX: nothing yet */
+    /* sort-by */
+    if ((sort = xml_find_body(xe, "sort-by")) != NULL && strcmp(sort, "none") == 0)
+        sort = NULL;
+    if (sort){
+        if ((ret = pagination_sort_check(ylist, sort, &numeric, cbret)) < 0)
+            goto done;
+        if (ret == 0)
+            goto ok;
+    }
+    /* where, parsed once and evaluated on each entry
+     * Prefixes are bound by the where element, names without prefix are in the namespace
+     * of the list, as in YANG XPath expressions
+     */
+    if ((x = xml_find_type(xe, NULL, "where", CX_ELMNT)) != NULL &&
+        (where = xml_body(x)) != NULL && strcmp(where, "unfiltered") != 0){
+        if (xml_nsctx_node(x, &nscw) < 0)
+            goto done;
+        if (xml_nsctx_add(nscw, NULL, yang_find_mynamespace(ylist)) < 0)
+            goto done;
+        if (xpath_parse(where, &xwhere) < 0){
+            clicon_err_reset();
+            if (netconf_invalid_value(cbret, "application", "where is not a valid XPath expression") < 0)
+                goto done;
+            goto ok;
+        }
+    }
+    /* Clixon extension: cursor of last entry of previous page */
+    cursor = xml_find_value(xe, "cursor");
+    if ((cbcursor = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
     }
-    /* where */
-    if (ret && (x = xml_find_type(xe, NULL, "where", CX_ELMNT)) != NULL)
-        where = xml_body(x);
-#endif
-    if (ret == 0)
-        goto ok;
     /* Read config */
     switch (content){
     case CONTENT_CONFIG:    /* config data only */
     case CONTENT_ALL:       /* both config and state */
-        /* Build a "predicate" cbuf 
-         * This solution uses xpath predicates to translate "limit" and "offset" to
-         * relational operators <>.
-         */
-        if ((cbpath = cbuf_new()) == NULL){
-            clicon_err(OE_UNIX, errno, "cbuf_new");
+        if ((ret = xmldb_cache_bind(h, db, &x0t)) < 0)
             goto done;
+        if (ret == 1){
+            /* Page from index of datastore cache, copy page entries in page order */
+            if (pagination_index_get(h, db, x0t, xpath?xpath:"/", nsc, sort, numeric, &pi) < 0)
+                goto done;
+            if (cursor &&
+                (ret = pagination_cursor_find(cursor, ylist, sort, numeric, backwards,
+                                          pi->pi_vec, pi->pi_len, &start)) <= 0){
+                if (ret < 0)
+                    goto done;
+                if (netconf_invalid_value(cbret, "application", "list-pagination cursor is not valid") < 0)
+                    goto done;
+                goto ok;
+            }
+            if (pagination_scan(pi->pi_vec, pi->pi_len, xwhere, nscw, backwards, start,
+                                offset, limit, &page, &plen, &last, &remaining) < 0)
+                goto done;
+            if (remaining && last != -1)
+                if (pagination_cursor_encode(pi->pi_vec[last], ylist, sort, last, cbcursor) < 0)
+                    goto done;
+            if (xmldb_get0_vec(h, x0t, page, plen, wdef, &xret) < 0)
+                goto done;
+            break;
         }
-        /* This uses xpath. Maybe limit should use parameters */
-        if (xpath)
-            cprintf(cbpath, "%s", xpath);
-        else
-            cprintf(cbpath, "/");
-#ifdef NOTYET
-        if (where)
-            cprintf(cbpath, "[%s]", where);
-#endif
-        if (offset){
-            cprintf(cbpath, "[%u <= position()", offset);
-            if (limit)
-                cprintf(cbpath, " and position() < %u", limit+offset);
-            cprintf(cbpath, "]");
-        }
-        else if (limit)
-            cprintf(cbpath, "[position() < %u]", limit);
-
-        /* Append predicate to original xpath and replace it */
-        xpath2 = cbuf_get(cbpath);
-        /* specific xpath */
-        if (xmldb_get0(h, db, YB_MODULE, nsc, xpath2?xpath2:"/", 1, wdef, &xret, NULL, NULL) < 0) {
+        /* No cache: get whole list and page in tree */
+        if (xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL) < 0) {
             if ((cbmsg = cbuf_new()) == NULL){
                 clicon_err(OE_UNIX, errno, "cbuf_new");
                 goto done;
@@ -716,6 +1654,14 @@ get_list_pagination(clicon_handle        h,
                 goto done;
             goto ok;
         }
+        if ((ret = pagination_tree(xret, ylist, xpath, nsc, sort, numeric, xwhere, nscw,
+                                   backwards, cursor, offset, limit, cbcursor, &remaining)) < 0)
+            goto done;
+        if (ret == 0){
+            if (netconf_invalid_value(cbret, "application", "list-pagination cursor is not valid") < 0)
+                goto done;
+            goto ok;
+        }
         break;
     case CONTENT_NONCONFIG: /* state data only */
         if ((xret = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)/* Only top tree */
@@ -723,28 +1669,19 @@ get_list_pagination(clicon_handle        h,
         break;
     }/* switch content */
 
-    if (list_config){
-#ifdef LIST_PAGINATION_REMAINING
-        /* Get total/remaining
-         * XXX: Works only for cache
-         */
-        if ((xcache = xmldb_cache_get(h, db)) != NULL){
-            if (xpath_count(xcache, nsc, xpath, &total) < 0)
-                goto done;
-            if (total >= (offset + limit))
-                remaining = total - (offset + limit);
-        }
-#endif
-    }
-    else {/* Check if running locked (by this session) */
+    if (!list_config){
+        /* Check if running locked (by this session) */
         if ((iddb = xmldb_islocked(h, "running")) != 0 &&
             iddb == ce->ce_id)
             locked = 1;
         else
             locked = 0;
-        if ((ret = clixon_pagination_cb_call(h, xpath, locked,
-                                             offset, limit,
-                                             xret)) < 0)
+        /* The callback pages with offset and limit, otherwise all entries are paged below */
+        if (list_pagination_ordered(xe))
+            ret = clixon_pagination_cb_call(h, xpath, locked, 0, 0, xret);
+        else
+            ret = clixon_pagination_cb_call(h, xpath, locked, offset, limit, xret);
+        if (ret < 0)
             goto done;
         if (ret == 0){
             if ((cberr = cbuf_new()) == NULL){
@@ -774,18 +1711,30 @@ get_list_pagination(clicon_handle        h,
                 goto done;
             goto ok;
         }
+        if (list_pagination_ordered(xe)){
+            if ((ret = pagination_tree(xret, ylist, xpath, nsc, sort, numeric, xwhere, nscw,
+                                       backwards, cursor, offset, limit, cbcursor, &remaining)) < 0)
+                goto done;
+            if (ret == 0){
+                if (netconf_invalid_value(cbret, "application", "list-pagination cursor is not valid") < 0)
+                    goto done;
+                goto ok;
+            }
+        }
     }
     if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
         goto done;
     /* Help function to filter out anything that is outside of xpath */
     if (filter_xpath_again(h, yspec, xret, xvec, xlen, xpath, nsc) < 0)
         goto done;
+    if (cbuf_len(cbcursor))
+        if (xml_add_attr(xret, "cursor", cbuf_get(cbcursor), CLIXON_LIB_PREFIX, CLIXON_LIB_NS) < 0)
+            goto done;
 #ifdef LIST_PAGINATION_REMAINING
     /* Add remaining attribute Sec 3.1.5: 
        Any list or leaf-list that is limited includes, on the first element in the result set, 
        a metadata value [RFC7952] called "remaining"*/
-    if (limit && x1){ 
-        cxobj *xa;
+    if (limit && remaining && xlen){ 
         cbuf  *cba = NULL;
 
         /* Add remaining attribute */
@@ -794,23 +1743,29 @@ get_list_pagination(clicon_handle        h,
             goto done;
         }
         cprintf(cba, "%u", remaining);
-        if (xml_add_attr(x1, "remaining", cbuf_get(cba), "cp", "http://clicon.org/clixon-netconf-list-pagination") < 0)
-        goto done;
+        if (xml_add_attr(xvec[0], "remaining", cbuf_get(cba), "lp", IETF_PAGINATON_NAMESPACE) < 0)
+            goto done;
         if (cba)
             cbuf_free(cba);
     }
 #endif /* LIST_PAGINATION_REMAINING */
-    if (get_nacm_and_reply(h, xret, xvec, xlen, xpath, nsc, username, depth, cbret) < 0)
+    if (get_nacm_and_reply(h, ce, &xret, xvec, xlen, xpath, nsc, username, depth, cbret) < 0)
         goto done;
  ok:
     retval = 0;
  done:
     if (xvec)
         free(xvec);
+    if (page)
+        free(page);
+    if (cbcursor)
+        cbuf_free(cbcursor);
+    if (xwhere)
+        xpath_tree_free(xwhere);
+    if (nscw)
+        xml_nsctx_free(nscw);
     if (cbmsg)
         cbuf_free(cbmsg);
-    if (cbpath)
-        cbuf_free(cbpath);
     if (xerr)
         xml_free(xerr);
     if (cberr)
@@ -846,6 +1801,7 @@ get_common(clicon_handle        h,
     cxobj          *xfilter;
     char           *xpath = NULL;
     cxobj          *xret = NULL;
+    cxobj          *xstate = NULL;
     char           *username;
     cvec           *nsc0 = NULL; /* Create a netconf namespace context from filter */
     cvec           *nsc = NULL;
@@ -860,12 +1816,13 @@ get_common(clicon_handle        h,
     cbuf           *cbreason = NULL;
     int             list_pagination = 0;
     cxobj         **xvec = NULL;
-    size_t          xlen;
+    size_t          xlen = 0;
     cxobj          *xfind;
     uint32_t        offset = 0;
     uint32_t        limit = 0;
     withdefaults_type wdef;
     char             *wdefstr;
+    int             depthcopy = 0;
 
 #ifdef NETCONF_DEFAULT_RETRIEVAL_REPORT_ALL
     /* Clixon 6.0 backward compatibly for NETCONF get/get-config behavior */
@@ -928,7 +1885,7 @@ get_common(clicon_handle        h,
             goto done;
         if (ret == 0)
             goto ok;
-        list_pagination = (offset != 0 || limit != 0);
+        list_pagination = (offset != 0 || limit != 0 || list_pagination_ordered(xfind));
     }
     /* Sanity check for list pagination: path must be a list/leaf-list, if it is,
      * check config/state
@@ -945,8 +1902,16 @@ get_common(clicon_handle        h,
     /* Read configuration */
     switch (content){
     case CONTENT_CONFIG:    /* config data only */
+        /* Without NACM, copy only the levels printed with depth, the copy is then
+         * already filtered by xpath */
+        ret = 0;
+        if (depth > 0 && clicon_nacm_cache(h) == NULL)
+            ret = xmldb_get0_depth(h, db, nsc, xpath?xpath:"/", wdef, depth, &xret);
+        if (ret == 1)
+            depthcopy = 1;
         /* specific xpath */
-        if (xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL) < 0) {
+        else if (ret < 0 ||
+                 xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL) < 0) {
             if ((cbmsg = cbuf_new()) == NULL){
                 clicon_err(OE_UNIX, errno, "cbuf_new");
                 goto done;
@@ -973,8 +1938,15 @@ get_common(clicon_handle        h,
             }
         }
         else if (content == CONTENT_ALL){
+            /* Without NACM, copy only the levels printed with depth, as config only */
+            ret = 0;
+            if (depth > 0 && clicon_nacm_cache(h) == NULL)
+                ret = xmldb_get0_depth(h, db, nsc, xpath?xpath:"/", wdef, depth, &xret);
+            if (ret == 1)
+                depthcopy = 1;
             /* specific xpath */
-            if (xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL) < 0) {
+            else if (ret < 0 ||
+                     xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL) < 0) {
                 if ((cbmsg = cbuf_new()) == NULL){
                     clicon_err(OE_UNIX, errno, "cbuf_new");
                     goto done;
@@ -999,9 +1971,37 @@ get_common(clicon_handle        h,
         break;
     case CONTENT_ALL:       /* both config and state */
     case CONTENT_NONCONFIG: /* state data only */
-        if ((ret = get_statedata(h, xpath?xpath:"/", nsc, wdef, &xret)) < 0)
+        if (!depthcopy){
+            if ((ret = get_statedata(h, xpath?xpath:"/", nsc, wdef, &xret)) < 0)
+                goto done;
+            if (ret == 0){ /* Error from callback (error in xret) */
+                if (clixon_xml2cbuf(cbret, xret, 0, 0, -1, 0) < 0)
+                    goto done;
+                goto ok;
+            }
+            break;
+        }
+        /* The depth-limited config copy can not be filtered again, state is read and
+         * filtered in its own tree, which is then merged with the config copy */
+        if ((xstate = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if ((ret = get_statedata(h, xpath?xpath:"/", nsc, wdef, &xstate)) < 0)
             goto done;
-        if (ret == 0){ /* Error from callback (error in xret) */
+        if (ret == 0){ /* Error from callback (error in xstate) */
+            if (clixon_xml2cbuf(cbret, xstate, 0, 0, -1, 0) < 0)
+                goto done;
+            goto ok;
+        }
+        if (xpath_vec(xstate, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+            goto done;
+        if (filter_xpath_again(h, yspec, xstate, xvec, xlen, xpath, nsc) < 0)
+            goto done;
+        free(xvec);
+        xvec = NULL;
+        xlen = 0;
+        if ((ret = netconf_trymerge(xstate, yspec, &xret)) < 0)
+            goto done;
+        if (ret == 0){ /* Merge error in xret */
             if (clixon_xml2cbuf(cbret, xret, 0, 0, -1, 0) < 0)
                 goto done;
             goto ok;
@@ -1042,11 +2042,13 @@ get_common(clicon_handle        h,
         if (xml_apply(xret, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
             goto done;
     }
-    if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
-        goto done;
-    if (filter_xpath_again(h, yspec, xret, xvec, xlen, xpath, nsc) < 0)
-        goto done;
-    if (get_nacm_and_reply(h, xret, xvec, xlen, xpath, nsc, username, depth, cbret) < 0)
+    if (!depthcopy){
+        if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+            goto done;
+        if (filter_xpath_again(h, yspec, xret, xvec, xlen, xpath, nsc) < 0)
+            goto done;
+    }
+    if (get_nacm_and_reply(h, ce, &xret, xvec, xlen, xpath, nsc, username, depth, cbret) < 0)
         goto done;
  ok:
     retval = 0;
@@ -1056,6 +2058,8 @@ get_common(clicon_handle        h,
         free(xvec);
     if (xret)
         xml_free(xret);
+    if (xstate)
+        xml_free(xstate);
     if (cbreason)
         cbuf_free(cbreason);
     if (nsc0)
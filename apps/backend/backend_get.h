@@ -40,6 +40,7 @@
 /*
  * Prototypes
  */ 
+int backend_get_exit(clicon_handle h);
 int from_client_get_config(clicon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg);
 int from_client_get(clicon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg);
 int from_client_get_pageable_list(clicon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg); /* XXX */
@@ -52,6 +52,8 @@ struct client_entry *backend_client_add(clicon_handle h, struct sockaddr *addr);
 struct client_entry *backend_client_list(clicon_handle h);
 
 int backend_client_delete(clicon_handle h, struct client_entry *ce);
+int ce_outmsg_free(struct ce_outmsg *om);
+int ce_sharedmsg_release(struct ce_sharedmsg *sm);
 
 int backend_client_print(clicon_handle h, FILE *f);
 
@@ -76,6 +76,7 @@
 #include "clixon_backend_commit.h"
 #include "backend_handle.h"
 #include "backend_startup.h"
+#include "backend_get.h"
 #include "backend_plugin_restconf.h"
 
 /* Command line options to be passed to getopt(3) */
@@ -112,6 +113,7 @@ backend_terminate(clicon_handle h)
     /* Free changelog */
     if ((x = clicon_xml_changelog_get(h)) != NULL)
         xml_free(x);
+    yang_deps_free(h);
     if ((yspec = clicon_dbspec_yang(h)) != NULL){
         ys_free(yspec);
     }
@@ -124,10 +126,13 @@ backend_terminate(clicon_handle h)
     clicon_data_cvec_del(h, "netconf-statistics");
     if ((x = clicon_nacm_ext(h)) != NULL)
         xml_free(x);
+    nacm_compiled_free(h);
     if ((x = clicon_conf_xml(h)) != NULL)
         xml_free(x);
     confirmed_commit_free(h);
     stream_publish_exit();
+    clixon_plugin_statedata_exit(h);
+    backend_get_exit(h);
     /* Delete all plugins, RPC callbacks, and upgrade callbacks */
     clixon_plugin_module_exit(h);
     /* Delete all process-control entries */
@@ -849,6 +854,10 @@ main(int    argc,
         goto done;
     if (clicon_nsctx_global_set(h, nsctx_global) < 0)
         goto done;
+    /* Compute YANG dependency graph for incremental validation */
+    if (clicon_option_bool(h, "CLICON_VALIDATE_INCREMENTAL") &&
+        yang_deps_init(h, yspec) < 0)
+        goto done;
 
     /* Initialize server socket and save it to handle */
     if (backend_rpc_init(h) < 0)
@@ -44,6 +44,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <inttypes.h>
 #include <dlfcn.h>
 #include <unistd.h>
 #include <errno.h>
@@ -52,7 +53,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/param.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
+#include <poll.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -313,6 +317,1054 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
     goto done;
 }
 
+/* Max number of cached XPaths per plugin, the least recently refreshed is removed */
+#define STATE_CACHE_MAX 16
+
+/*! Cached state of a plugin for one XPath and namespace context
+ */
+struct state_cache_entry{
+    qelem_t         se_q;      /* queue header */
+    char           *se_key;    /* Key of request, see state_request_key */
+    cxobj          *se_xml;    /* Bound and sorted state XML */
+    struct timeval  se_time;   /* Time of state */
+};
+
+/*! State cache of a plugin, see ca_statedata_maxage
+ */
+struct state_cache{
+    qelem_t                   sc_q;         /* queue header */
+    clixon_plugin_t          *sc_cp;        /* Plugin */
+    struct state_cache_entry *sc_entries;   /* Least recently refreshed first */
+    int                       sc_nr;        /* Number of entries */
+    uint64_t                  sc_hits;      /* Requests served from cache */
+    uint64_t                  sc_misses;    /* Requests where state callback is called */
+    uint64_t                  sc_refreshes; /* Entries refreshed in background */
+};
+
+/*! Get state cache of plugin, create if not found
+ * @param[in]  h    Clicon handle
+ * @param[in]  cp   Plugin handle
+ * @retval     sc   State cache
+ * @retval     NULL Error
+ */
+static struct state_cache *
+state_cache_plugin(clicon_handle    h,
+                   clixon_plugin_t *cp)
+{
+    struct state_cache *head = NULL;
+    struct state_cache *sc;
+
+    clicon_ptr_get(h, "state-cache", (void**)&head);
+    if ((sc = head) != NULL){
+        do {
+            if (sc->sc_cp == cp)
+                return sc;
+            sc = NEXTQ(struct state_cache *, sc);
+        } while (sc && sc != head);
+    }
+    if ((sc = malloc(sizeof(*sc))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(sc, 0, sizeof(*sc));
+    sc->sc_cp = cp;
+    ADDQ(sc, head);
+    if (clicon_ptr_set(h, "state-cache", head) < 0)
+        return NULL;
+    return sc;
+}
+
+/*! Compare namespace context entries on prefix, default namespace first
+ */
+static int
+state_nsc_cmp(const void *a,
+              const void *b)
+{
+    char *pa = cv_name_get(*(cg_var **)a);
+    char *pb = cv_name_get(*(cg_var **)b);
+
+    return strcmp(pa?pa:"", pb?pb:"");
+}
+
+/*! Key of state request: XPath and namespace context with prefixes in order
+ *
+ * The same prefixed XPath may bind its prefixes to other namespaces in another request,
+ * so state of a request is identified by both.
+ * @param[in]  xpath  XPath of request, or NULL
+ * @param[in]  nsc    Namespace context of XPath, or NULL
+ * @param[out] cb     Key
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+state_request_key(char *xpath,
+                  cvec *nsc,
+                  cbuf *cb)
+{
+    cg_var **vec = NULL;
+    cg_var  *cv = NULL;
+    char    *prefix;
+    int      n;
+    int      i;
+
+    cprintf(cb, "%s", xpath?xpath:"/");
+    if (nsc == NULL || (n = cvec_len(nsc)) == 0)
+        return 0;
+    if ((vec = calloc(n, sizeof(*vec))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    i = 0;
+    while ((cv = cvec_each(nsc, cv)) != NULL && i < n)
+        vec[i++] = cv;
+    qsort(vec, i, sizeof(*vec), state_nsc_cmp);
+    for (n=0; n<i; n++){
+        prefix = cv_name_get(vec[n]);
+        cprintf(cb, " xmlns%s%s=\"%s\"", prefix?":":"", prefix?prefix:"", cv_string_get(vec[n]));
+    }
+    free(vec);
+    return 0;
+}
+
+/*! Find cache entry of request
+ */
+static struct state_cache_entry *
+state_cache_find(struct state_cache *sc,
+                 char               *key)
+{
+    struct state_cache_entry *se;
+
+    if ((se = sc->sc_entries) != NULL){
+        do {
+            if (strcmp(se->se_key, key) == 0)
+                return se;
+            se = NEXTQ(struct state_cache_entry *, se);
+        } while (se && se != sc->sc_entries);
+    }
+    return NULL;
+}
+
+static void
+state_cache_entry_free(struct state_cache_entry *se)
+{
+    if (se->se_key)
+        free(se->se_key);
+    if (se->se_xml)
+        xml_free(se->se_xml);
+    free(se);
+}
+
+/*! Age of cached state of plugin
+ * @param[in]  sc    State cache of plugin
+ * @param[in]  key   Key of request, see state_request_key
+ * @retval     ms    Age in ms
+ * @retval    -1     Not cached
+ */
+static long
+state_cache_age(struct state_cache *sc,
+                char               *key)
+{
+    struct state_cache_entry *se;
+    struct timeval            t;
+
+    if ((se = state_cache_find(sc, key)) == NULL)
+        return -1;
+    gettimeofday(&t, NULL);
+    timersub(&t, &se->se_time, &t);
+    return t.tv_sec*1000 + t.tv_usec/1000;
+}
+
+/*! Get cached state of plugin if younger than max age of plugin
+ * @param[in]  h     Clicon handle
+ * @param[in]  cp    Plugin handle
+ * @param[in]  key   Key of request, see state_request_key
+ * @param[out] xp    Copy of cached state. Free with xml_free
+ * @retval     1     Cached state found
+ * @retval     0     Not cached, or too old
+ * @retval    -1     Error
+ */
+static int
+state_cache_get(clicon_handle    h,
+                clixon_plugin_t *cp,
+                char            *key,
+                cxobj          **xp)
+{
+    struct state_cache *sc;
+    long                age;
+
+    if ((sc = state_cache_plugin(h, cp)) == NULL)
+        return -1;
+    if ((age = state_cache_age(sc, key)) < 0 ||
+        age >= clixon_plugin_api_get(cp)->ca_statedata_maxage){
+        sc->sc_misses++;
+        return 0;
+    }
+    if ((*xp = xml_dup(state_cache_find(sc, key)->se_xml)) == NULL)
+        return -1;
+    sc->sc_hits++;
+    return 1;
+}
+
+/*! Save state of plugin in cache
+ * @param[in]  h     Clicon handle
+ * @param[in]  cp    Plugin handle
+ * @param[in]  key   Key of request, see state_request_key
+ * @param[in]  x     Bound and sorted state XML, copied
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+state_cache_set(clicon_handle    h,
+                clixon_plugin_t *cp,
+                char            *key,
+                cxobj           *x)
+{
+    struct state_cache       *sc;
+    struct state_cache_entry *se;
+    cxobj                    *xc;
+
+    if ((sc = state_cache_plugin(h, cp)) == NULL)
+        return -1;
+    if ((xc = xml_dup(x)) == NULL)
+        return -1;
+    if ((se = state_cache_find(sc, key)) != NULL){
+        DELQ(se, sc->sc_entries, struct state_cache_entry *);
+        xml_free(se->se_xml);
+    }
+    else {
+        if ((se = malloc(sizeof(*se))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            xml_free(xc);
+            return -1;
+        }
+        memset(se, 0, sizeof(*se));
+        if ((se->se_key = strdup(key)) == NULL){
+            clicon_err(OE_UNIX, errno, "strdup");
+            xml_free(xc);
+            free(se);
+            return -1;
+        }
+        if (++sc->sc_nr > STATE_CACHE_MAX){
+            struct state_cache_entry *se0 = sc->sc_entries;
+
+            DELQ(se0, sc->sc_entries, struct state_cache_entry *);
+            state_cache_entry_free(se0);
+            sc->sc_nr--;
+        }
+    }
+    se->se_xml = xc;
+    gettimeofday(&se->se_time, NULL);
+    ADDQ(se, sc->sc_entries);
+    return 0;
+}
+
+/*! State data path registered by a plugin
+ * @see clixon_plugin_statedata_path_register
+ */
+struct state_path{
+    qelem_t         sp_q;      /* queue header */
+    plgstatedata_t *sp_fn;     /* State callback of plugin */
+    char           *sp_path;   /* Registered path with canonical prefixes */
+    cvec           *sp_steps;  /* Steps of path: name and namespace, NULL if not resolved */
+    int             sp_all;    /* Path is not a simple path, always call */
+};
+
+/*! Get steps of a simple location path from parsed XPath
+ *
+ * A simple path is an absolute or relative path of child steps, eg /a:x/a:y[a:k='1']/a:z.
+ * Predicates are ignored.
+ * @param[in]  xs     Parsed XPath
+ * @param[in]  nsc    Namespace context of XPath
+ * @param[out] steps  Steps with name ("*" for any) and namespace (NULL for any)
+ * @retval     1      Simple path, steps set
+ * @retval     0      Not a simple path, eg union, function or descendant axis
+ * @retval    -1      Error
+ */
+static int
+xpath_tree_steps(xpath_tree *xs,
+                 cvec       *nsc,
+                 cvec       *steps)
+{
+    int         ret;
+    xpath_tree *xn;
+    char       *ns;
+    cg_var     *cv;
+
+    switch (xs->xs_type){
+    case XP_EXP:
+    case XP_AND:
+    case XP_RELEX:
+    case XP_ADD:
+    case XP_UNION:
+    case XP_PATHEXPR:
+    case XP_LOCPATH:
+        if (xs->xs_c0 == NULL || xs->xs_c1 != NULL) /* Operator */
+            return 0;
+        return xpath_tree_steps(xs->xs_c0, nsc, steps);
+    case XP_ABSPATH:
+        if (xs->xs_int != A_ROOT)
+            return 0;
+        if (xs->xs_c0 == NULL) /* "/" */
+            return 1;
+        return xpath_tree_steps(xs->xs_c0, nsc, steps);
+    case XP_RELLOCPATH:
+        if (xs->xs_int == A_DESCENDANT_OR_SELF)
+            return 0;
+        if ((ret = xpath_tree_steps(xs->xs_c0, nsc, steps)) != 1)
+            return ret;
+        if (xs->xs_c1)
+            return xpath_tree_steps(xs->xs_c1, nsc, steps);
+        return 1;
+    case XP_STEP:
+        if (xs->xs_int != A_CHILD ||
+            (xn = xs->xs_c0) == NULL || xn->xs_type != XP_NODE)
+            return 0;
+        ns = nsc ? xml_nsctx_get(nsc, xn->xs_s0) : NULL;
+        if (xn->xs_s0 && ns == NULL) /* Unknown prefix */
+            return 0;
+        if ((cv = cvec_add(steps, CGV_STRING)) == NULL){
+            clicon_err(OE_UNIX, errno, "cvec_add");
+            return -1;
+        }
+        if (cv_name_set(cv, xn->xs_s1?xn->xs_s1:"*") == NULL ||
+            (ns && cv_string_set(cv, ns) == NULL)){
+            clicon_err(OE_UNIX, errno, "cv_string_set");
+            return -1;
+        }
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*! Two simple paths intersect if one is a prefix of the other
+ * @param[in]  steps0  Steps of path 0
+ * @param[in]  steps1  Steps of path 1
+ * @retval     1       Intersect
+ * @retval     0       Disjoint
+ */
+static int
+xpath_steps_intersect(cvec *steps0,
+                      cvec *steps1)
+{
+    int     i;
+    cg_var *cv0;
+    cg_var *cv1;
+    char   *ns0;
+    char   *ns1;
+
+    for (i=0; i<cvec_len(steps0) && i<cvec_len(steps1); i++){
+        cv0 = cvec_i(steps0, i);
+        cv1 = cvec_i(steps1, i);
+        if (strcmp(cv_name_get(cv0), "*") != 0 &&
+            strcmp(cv_name_get(cv1), "*") != 0 &&
+            strcmp(cv_name_get(cv0), cv_name_get(cv1)) != 0)
+            return 0;
+        ns0 = cv_string_get(cv0);
+        ns1 = cv_string_get(cv1);
+        if (ns0 && ns1 && strcmp(ns0, ns1) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*! Register a path that a state callback provides state data for
+ *
+ * A state callback with registered paths is only called if a path intersects with the
+ * requested XPath, ie the XPath selects nodes in, above or below a registered path.
+ * A state callback without registered paths is always called.
+ * @param[in]  h      Clixon handle
+ * @param[in]  fn     State callback, ie ca_statedata of plugin
+ * @param[in]  path   Schema path using canonical prefixes, eg /if:interfaces/if:interface
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @code
+ *   if (clixon_plugin_statedata_path_register(h, example_statedata, "/if:interfaces") < 0)
+ *      goto done;
+ * @endcode
+ * @see clixon_plugin_statedata_xpath_tree  Parsed XPath of request
+ */
+int
+clixon_plugin_statedata_path_register(clicon_handle   h,
+                                      plgstatedata_t *fn,
+                                      char           *path)
+{
+    struct state_path *head = NULL;
+    struct state_path *sp;
+
+    if ((sp = malloc(sizeof(*sp))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return -1;
+    }
+    memset(sp, 0, sizeof(*sp));
+    sp->sp_fn = fn;
+    if ((sp->sp_path = strdup(path)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        free(sp);
+        return -1;
+    }
+    clicon_ptr_get(h, "state-paths", (void**)&head);
+    ADDQ(sp, head);
+    if (clicon_ptr_set(h, "state-paths", head) < 0)
+        return -1;
+    return 0;
+}
+
+/*! Check if state callback provides state for requested XPath
+ *
+ * Registered paths are resolved on first use, since canonical prefixes are known when
+ * YANG is loaded.
+ * @param[in]  h      Clixon handle
+ * @param[in]  fn     State callback
+ * @param[in]  steps  Steps of requested XPath, or NULL if not a simple path
+ * @retval     1      Call state callback
+ * @retval     0      Do not call state callback
+ * @retval    -1      Error
+ */
+static int
+state_path_match(clicon_handle   h,
+                 plgstatedata_t *fn,
+                 cvec           *steps)
+{
+    int                retval = -1;
+    struct state_path *head = NULL;
+    struct state_path *sp;
+    xpath_tree        *xpt = NULL;
+    int                found = 0;
+    int                ret;
+
+    if (steps == NULL){
+        retval = 1;
+        goto done;
+    }
+    clicon_ptr_get(h, "state-paths", (void**)&head);
+    if ((sp = head) != NULL){
+        do {
+            if (sp->sp_fn != fn)
+                goto next;
+            found++;
+            if (sp->sp_steps == NULL && !sp->sp_all){
+                if ((sp->sp_steps = cvec_new(0)) == NULL){
+                    clicon_err(OE_UNIX, errno, "cvec_new");
+                    goto done;
+                }
+                if (xpath_parse(sp->sp_path, &xpt) < 0)
+                    goto done;
+                if ((ret = xpath_tree_steps(xpt, clicon_nsctx_global_get(h), sp->sp_steps)) < 0)
+                    goto done;
+                if (ret == 0){
+                    clicon_log(LOG_WARNING, "%s: Registered state path is not a simple path: %s",
+                               __FUNCTION__, sp->sp_path);
+                    cvec_free(sp->sp_steps);
+                    sp->sp_steps = NULL;
+                    sp->sp_all = 1;
+                }
+                xpath_tree_free(xpt);
+                xpt = NULL;
+            }
+            if (sp->sp_all || xpath_steps_intersect(sp->sp_steps, steps)){
+                retval = 1;
+                goto done;
+            }
+        next:
+            sp = NEXTQ(struct state_path *, sp);
+        } while (sp != head);
+    }
+    retval = found?0:1;
+ done:
+    if (xpt)
+        xpath_tree_free(xpt);
+    return retval;
+}
+
+/*! Get parsed XPath of current state data request
+ *
+ * May be used by a state callback instead of parsing the xpath parameter.
+ * @param[in]  h      Clixon handle
+ * @retval     xpt    Parsed XPath, valid during the state callback
+ * @retval     NULL   Not called from a state callback
+ * @see xpath_tree_ctx  To evaluate the parsed XPath
+ */
+xpath_tree *
+clixon_plugin_statedata_xpath_tree(clicon_handle h)
+{
+    xpath_tree *xpt = NULL;
+
+    clicon_ptr_get(h, "state-xpath-tree", (void**)&xpt);
+    return xpt;
+}
+
+/*! Header of result written by state worker to parent, followed by payload
+ * The payload is state XML if sh_status is 1, or error reason if 0
+ */
+struct state_worker_hdr{
+    int sh_status;  /* 1: OK, 0: State callback failed */
+};
+
+/*! State worker of a plugin with concurrent state data, see ca_statedata_deadline
+ * One worker process per plugin is in flight at a time. A worker that misses its deadline
+ * continues, and its result is saved when it arrives, for use by later requests.
+ */
+struct state_worker{
+    qelem_t          sw_q;           /* queue header */
+    clicon_handle    sw_h;           /* Clicon handle */
+    clixon_plugin_t *sw_cp;          /* Plugin */
+    pid_t            sw_pid;         /* Worker process in flight, or 0 */
+    pid_t            sw_owner;       /* Process that forked the worker */
+    int              sw_fd;          /* Read end of pipe from worker, or -1 */
+    int              sw_late;        /* sw_fd is registered in event loop */
+    char            *sw_key;         /* Key of request of worker in flight */
+    cbuf            *sw_cb;          /* Result read from worker */
+    char            *sw_state;       /* Last state XML of plugin, or NULL */
+    char            *sw_state_key;   /* Key of request of sw_state */
+};
+
+/*! Get state worker of plugin, create if not found
+ * @param[in]  h    Clicon handle
+ * @param[in]  cp   Plugin handle
+ * @retval     sw   State worker
+ * @retval     NULL Error
+ */
+static struct state_worker *
+state_worker_get(clicon_handle    h,
+                 clixon_plugin_t *cp)
+{
+    struct state_worker *head = NULL;
+    struct state_worker *sw;
+
+    clicon_ptr_get(h, "state-workers", (void**)&head);
+    if ((sw = head) != NULL){
+        do {
+            if (sw->sw_cp == cp)
+                return sw;
+            sw = NEXTQ(struct state_worker *, sw);
+        } while (sw && sw != head);
+    }
+    if ((sw = malloc(sizeof(*sw))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(sw, 0, sizeof(*sw));
+    sw->sw_h = h;
+    sw->sw_cp = cp;
+    sw->sw_fd = -1;
+    if ((sw->sw_cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        free(sw);
+        return NULL;
+    }
+    ADDQ(sw, head);
+    if (clicon_ptr_set(h, "state-workers", head) < 0)
+        return NULL;
+    return sw;
+}
+
+/*! Write all of buffer to file descriptor
+ */
+static int
+state_worker_write(int         fd,
+                   const void *buf,
+                   size_t      len)
+{
+    const char *s = buf;
+    ssize_t     n;
+
+    while (len > 0){
+        if ((n = write(fd, s, len)) < 0){
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        s += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*! State worker process: call state callback of plugin and write result to parent
+ * Does not return
+ * @param[in]  h      Clicon handle
+ * @param[in]  cp     Plugin handle
+ * @param[in]  nsc    Namespace context
+ * @param[in]  xpath  XPath of requested state
+ * @param[in]  fd     Write end of pipe to parent
+ */
+static void
+state_worker_run(clicon_handle    h,
+                 clixon_plugin_t *cp,
+                 cvec            *nsc,
+                 char            *xpath,
+                 int              fd)
+{
+    struct state_worker_hdr hdr = {0,};
+    cxobj *x = NULL;
+    cbuf  *cb = NULL;
+    int    status = 0;
+
+    if ((cb = cbuf_new()) == NULL)
+        _exit(1);
+    hdr.sh_status = clixon_plugin_statedata_one(cp, h, nsc, xpath, &x);
+    if (hdr.sh_status == 1 && x != NULL){
+        if (clixon_xml2cbuf(cb, x, 0, 0, -1, 1) < 0)
+            hdr.sh_status = -1;
+    }
+    if (hdr.sh_status != 1){
+        cbuf_reset(cb);
+        hdr.sh_status = 0;
+        cprintf(cb, "%s", clicon_err_reason);
+    }
+    if (state_worker_write(fd, &hdr, sizeof(hdr)) < 0 ||
+        state_worker_write(fd, cbuf_get(cb), cbuf_len(cb)) < 0)
+        status = 1;
+    close(fd);
+    /* Exit without atexit handlers or stdio flush of the parent's buffers */
+    _exit(status);
+}
+
+/*! Fork state worker of plugin
+ * @param[in]  h      Clicon handle
+ * @param[in]  sw     State worker, not in flight
+ * @param[in]  nsc    Namespace context
+ * @param[in]  xpath  XPath of requested state
+ * @param[in]  key    Key of request, see state_request_key
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+state_worker_start(clicon_handle        h,
+                   struct state_worker *sw,
+                   cvec                *nsc,
+                   char                *xpath,
+                   char                *key)
+{
+    int   retval = -1;
+    int   p[2];
+    pid_t pid;
+
+    if (sw->sw_key)
+        free(sw->sw_key);
+    if ((sw->sw_key = strdup(key)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if (pipe(p) < 0){
+        clicon_err(OE_UNIX, errno, "pipe");
+        goto done;
+    }
+    if ((pid = fork()) < 0){
+        clicon_err(OE_UNIX, errno, "fork");
+        close(p[0]);
+        close(p[1]);
+        goto done;
+    }
+    if (pid == 0){   /* Child */
+        close(p[0]);
+        state_worker_run(h, sw->sw_cp, nsc, xpath, p[1]);
+    }
+    /* Parent */
+    close(p[1]);
+    sw->sw_pid = pid;
+    sw->sw_owner = getpid();
+    sw->sw_fd = p[0];
+    cbuf_reset(sw->sw_cb);
+    clicon_debug(1, "%s %s pid:%d", __FUNCTION__, clixon_plugin_name_get(sw->sw_cp), pid);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Read result from state worker
+ * @param[in]  sw   State worker
+ * @retval     1    End of file
+ * @retval     0    More to read
+ * @retval    -1    Error
+ */
+static int
+state_worker_read(struct state_worker *sw)
+{
+    char    buf[4096];
+    ssize_t n;
+
+    if ((n = read(sw->sw_fd, buf, sizeof(buf))) < 0){
+        if (errno == EINTR)
+            return 0;
+        clicon_err(OE_UNIX, errno, "read");
+        return -1;
+    }
+    if (n == 0)
+        return 1;
+    if (cbuf_append_buf(sw->sw_cb, buf, n) < 0){
+        clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+        return -1;
+    }
+    return 0;
+}
+
+/*! State worker has exited: reap it, and save state if OK
+ * @param[in]  sw     State worker
+ * @param[out] status 1: state saved, 0: state callback failed, -1: worker gave no result
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+state_worker_done(struct state_worker *sw,
+                  int                 *status)
+{
+    struct state_worker_hdr hdr;
+
+    close(sw->sw_fd);
+    sw->sw_fd = -1;
+    waitpid(sw->sw_pid, NULL, 0);
+    sw->sw_pid = 0;
+    if (cbuf_len(sw->sw_cb) < sizeof(hdr)){
+        *status = -1;
+        return 0;
+    }
+    memcpy(&hdr, cbuf_get(sw->sw_cb), sizeof(hdr));
+    if ((*status = hdr.sh_status) == 1){
+        if (sw->sw_state)
+            free(sw->sw_state);
+        if ((sw->sw_state = strdup(cbuf_get(sw->sw_cb) + sizeof(hdr))) == NULL){
+            clicon_err(OE_UNIX, errno, "strdup");
+            return -1;
+        }
+        if (sw->sw_state_key)
+            free(sw->sw_state_key);
+        sw->sw_state_key = sw->sw_key;
+        sw->sw_key = NULL;
+    }
+    return 0;
+}
+
+/*! Save late result of state worker in state cache of plugin
+ * @param[in]  sw   State worker, with state saved
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+state_cache_refresh(struct state_worker *sw)
+{
+    int                 retval = -1;
+    clicon_handle       h = sw->sw_h;
+    struct state_cache *sc;
+    cxobj              *x = NULL;
+    cxobj              *xerr = NULL;
+    int                 ret;
+
+    if ((x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (clixon_xml_parse_string(sw->sw_state, YB_NONE, NULL, &x, NULL) < 0)
+        goto done;
+    if ((ret = xml_bind_yang(h, x, YB_MODULE, clicon_dbspec_yang(h), &xerr)) < 0)
+        goto done;
+    if (ret == 0){
+        clicon_log(LOG_WARNING, "%s: State callback returned invalid XML from plugin %s, not cached",
+                   __FUNCTION__, clixon_plugin_name_get(sw->sw_cp));
+        goto ok;
+    }
+    if (xml_sort_recurse(x) < 0)
+        goto done;
+    if (xml_defaults_nopresence(x, 2) < 0)
+        goto done;
+    if (state_cache_set(h, sw->sw_cp, sw->sw_state_key, x) < 0)
+        goto done;
+    if ((sc = state_cache_plugin(h, sw->sw_cp)) == NULL)
+        goto done;
+    sc->sc_refreshes++;
+ ok:
+    retval = 0;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    if (x)
+        xml_free(x);
+    return retval;
+}
+
+/*! Result of state worker arrived after its deadline, or of background refresh
+ * @param[in]  fd   Read end of pipe from worker
+ * @param[in]  arg  State worker
+ */
+static int
+state_worker_cb(int   fd,
+                void *arg)
+{
+    struct state_worker *sw = (struct state_worker *)arg;
+    int                  ret;
+    int                  status;
+
+    if ((ret = state_worker_read(sw)) < 0)
+        return -1;
+    if (ret == 0)
+        return 0;
+    clixon_event_unreg_fd(fd, state_worker_cb);
+    sw->sw_late = 0;
+    if (state_worker_done(sw, &status) < 0)
+        return -1;
+    clicon_debug(1, "%s %s late state status:%d", __FUNCTION__,
+                 clixon_plugin_name_get(sw->sw_cp), status);
+    if (status == 1 &&
+        clixon_plugin_api_get(sw->sw_cp)->ca_statedata_maxage &&
+        state_cache_refresh(sw) < 0)
+        return -1;
+    return 0;
+}
+
+/*! Stop state worker in flight, if any
+ *
+ * A worker inherited from a parent process, eg in a backend read worker, is not killed but
+ * only closed, it is owned by the parent.
+ * @param[in]  sw   State worker
+ */
+static void
+state_worker_stop(struct state_worker *sw)
+{
+    if (sw->sw_pid == 0)
+        return;
+    if (sw->sw_late){
+        clixon_event_unreg_fd(sw->sw_fd, state_worker_cb);
+        sw->sw_late = 0;
+    }
+    close(sw->sw_fd);
+    sw->sw_fd = -1;
+    if (sw->sw_owner == getpid()){
+        kill(sw->sw_pid, SIGKILL);
+        waitpid(sw->sw_pid, NULL, 0);
+    }
+    sw->sw_pid = 0;
+}
+
+/*! Wait for result of state worker until deadline
+ * @param[in]  sw       State worker in flight
+ * @param[in]  deadline Absolute time
+ * @retval     1        Worker done
+ * @retval     0        Deadline passed
+ * @retval    -1        Error
+ */
+static int
+state_worker_wait(struct state_worker *sw,
+                  struct timeval      *deadline)
+{
+    struct pollfd  pfd;
+    struct timeval t;
+    int            ms;
+    int            ret;
+
+    while (1){
+        gettimeofday(&t, NULL);
+        if (timercmp(&t, deadline, >=))
+            ms = 0;
+        else{
+            timersub(deadline, &t, &t);
+            ms = t.tv_sec*1000 + (t.tv_usec+999)/1000;
+        }
+        pfd.fd = sw->sw_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if ((ret = poll(&pfd, 1, ms)) < 0){
+            if (errno == EINTR)
+                continue;
+            clicon_err(OE_UNIX, errno, "poll");
+            return -1;
+        }
+        if (ret == 0)
+            return 0;
+        if ((ret = state_worker_read(sw)) != 0)
+            return ret;
+    }
+}
+
+/*! Get state data of plugin from its state worker
+ *
+ * Wait for the worker until the deadline of the plugin. If the deadline is missed, or if
+ * the worker gave no result, the previous state of the plugin is used, if any.
+ * @param[in]  h     Clicon handle
+ * @param[in]  cp    Plugin handle
+ * @param[in]  key   Key of request, see state_request_key
+ * @param[in]  t0    Start time of state data collection
+ * @param[out] xp    State XML tree, or NULL if no state
+ * @param[out] stale State is previous state
+ * @retval    -1     Error
+ * @retval     0     Statedata callback failed (clicon_err called)
+ * @retval     1     OK
+ */
+static int
+clixon_plugin_statedata_worker(clicon_handle    h,
+                               clixon_plugin_t *cp,
+                               char            *key,
+                               struct timeval  *t0,
+                               cxobj          **xp,
+                               int             *stale)
+{
+    int                      retval = -1;
+    struct state_worker     *sw;
+    struct timeval           deadline;
+    struct timeval           t;
+    uint32_t                 ms;
+    int                      ret;
+    int                      status;
+    cxobj                   *x = NULL;
+
+    if ((sw = state_worker_get(h, cp)) == NULL)
+        goto done;
+    ms = clixon_plugin_api_get(cp)->ca_statedata_deadline;
+    t.tv_sec = ms/1000;
+    t.tv_usec = (ms%1000)*1000;
+    timeradd(t0, &t, &deadline);
+    if (sw->sw_late){
+        clixon_event_unreg_fd(sw->sw_fd, state_worker_cb);
+        sw->sw_late = 0;
+    }
+    if (sw->sw_pid == 0) /* Not started since state was cached, but has expired meanwhile */
+        ret = 0;
+    else if ((ret = state_worker_wait(sw, &deadline)) < 0)
+        goto done;
+    if (ret == 1){
+        if (state_worker_done(sw, &status) < 0)
+            goto done;
+        if (status == 0){
+            clicon_err(OE_PLUGIN, 0, "%s", cbuf_get(sw->sw_cb) + sizeof(struct state_worker_hdr));
+            goto fail;
+        }
+        if (status < 0){
+            clicon_log(LOG_WARNING, "%s: State worker of plugin %s exited without result, using previous state",
+                       __FUNCTION__, clixon_plugin_name_get(cp));
+            *stale = 1;
+        }
+    }
+    else {
+        clicon_log(LOG_WARNING, "%s: State callback of plugin %s missed deadline of %u ms, using previous state",
+                   __FUNCTION__, clixon_plugin_name_get(cp), ms);
+        if (sw->sw_pid){
+            if (clixon_event_reg_fd(sw->sw_fd, state_worker_cb, sw, "state worker") < 0)
+                goto done;
+            sw->sw_late = 1;
+        }
+        *stale = 1;
+    }
+    if (sw->sw_state && strcmp(sw->sw_state_key, key) == 0){
+        if ((x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (clixon_xml_parse_string(sw->sw_state, YB_NONE, NULL, &x, NULL) < 0)
+            goto done;
+        *xp = x;
+        x = NULL;
+    }
+    retval = 1;
+ done:
+    if (x)
+        xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Stop all state workers, free saved and cached state, and registered state paths
+ * @param[in]  h    Clicon handle
+ * @retval     0    OK
+ */
+int
+clixon_plugin_statedata_exit(clicon_handle h)
+{
+    struct state_worker      *head = NULL;
+    struct state_worker      *sw;
+    struct state_cache       *sc = NULL;
+    struct state_cache       *sc0;
+    struct state_cache_entry *se;
+    struct state_path        *sp = NULL;
+    struct state_path        *sp0;
+
+    clicon_ptr_get(h, "state-workers", (void**)&head);
+    while ((sw = head) != NULL){
+        DELQ(sw, head, struct state_worker *);
+        state_worker_stop(sw);
+        if (sw->sw_key)
+            free(sw->sw_key);
+        if (sw->sw_state)
+            free(sw->sw_state);
+        if (sw->sw_state_key)
+            free(sw->sw_state_key);
+        cbuf_free(sw->sw_cb);
+        free(sw);
+    }
+    clicon_ptr_del(h, "state-workers");
+    clicon_ptr_get(h, "state-cache", (void**)&sc);
+    while (sc != NULL){
+        while ((se = sc->sc_entries) != NULL){
+            DELQ(se, sc->sc_entries, struct state_cache_entry *);
+            state_cache_entry_free(se);
+        }
+        sc0 = sc;
+        DELQ(sc0, sc, struct state_cache *);
+        free(sc0);
+    }
+    clicon_ptr_del(h, "state-cache");
+    clicon_ptr_get(h, "state-paths", (void**)&sp);
+    while ((sp0 = sp) != NULL){
+        DELQ(sp0, sp, struct state_path *);
+        if (sp0->sp_steps)
+            cvec_free(sp0->sp_steps);
+        free(sp0->sp_path);
+        free(sp0);
+    }
+    clicon_ptr_del(h, "state-paths");
+    return 0;
+}
+
+/*! Print state cache statistics of plugins as XML
+ * @param[in]  h    Clicon handle
+ * @param[out] cb   Statistics XML, in stats RPC reply
+ * @retval     0    OK
+ * @see ca_statedata_maxage
+ */
+int
+clixon_plugin_statedata_stats(clicon_handle h,
+                              cbuf         *cb)
+{
+    struct state_cache *head = NULL;
+    struct state_cache *sc;
+
+    clicon_ptr_get(h, "state-cache", (void**)&head);
+    if ((sc = head) != NULL){
+        do {
+            cprintf(cb, "<state-cache xmlns=\"%s\">", CLIXON_LIB_NS);
+            cprintf(cb, "<name>%s</name>", clixon_plugin_name_get(sc->sc_cp));
+            cprintf(cb, "<entries>%d</entries>", sc->sc_nr);
+            cprintf(cb, "<hits>%" PRIu64 "</hits>", sc->sc_hits);
+            cprintf(cb, "<misses>%" PRIu64 "</misses>", sc->sc_misses);
+            cprintf(cb, "<refreshes>%" PRIu64 "</refreshes>", sc->sc_refreshes);
+            cprintf(cb, "</state-cache>");
+            sc = NEXTQ(struct state_cache *, sc);
+        } while (sc != head);
+    }
+    return 0;
+}
+
+/*! Check if state data of any plugin is kept in the backend between requests
+ *
+ * State workers and state cache of plugins with ca_statedata_deadline or
+ * ca_statedata_maxage are only updated if state is collected by the backend process
+ * @param[in]  h    Clicon handle
+ * @retval     1    Yes, at least one plugin has a state deadline or max age
+ * @retval     0    No
+ * @see read_worker_start
+ */
+int
+clixon_plugin_statedata_kept(clicon_handle h)
+{
+    clixon_plugin_t   *cp = NULL;
+    clixon_plugin_api *api;
+
+    while ((cp = clixon_plugin_each(h, cp)) != NULL) {
+        api = clixon_plugin_api_get(cp);
+        if (api->ca_statedata &&
+            (api->ca_statedata_deadline || api->ca_statedata_maxage))
+            return 1;
+    }
+    return 0;
+}
+
 /*! Go through all backend statedata callbacks and collect state data
  * This is internal system call, plugin is invoked (does not call) this function
  * Backend plugins can register 
@@ -326,6 +1378,11 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
  * @retval        0       Statedata callback failed (xret set with netconf-error)
  * @retval        1       OK
  * @note xret can be replaced in this function
+ * @note Plugins with ca_statedata_deadline set are called first in worker processes, and
+ *       their state is then merged in plugin order
+ * @note State of plugins with ca_statedata_maxage set is taken from cache while fresh. A worker
+ *       refreshes the cache in background when half of max age has passed
+ * @note Plugins with registered state paths are only called if a path intersects with xpath
  */
 int
 clixon_plugin_statedata_all(clicon_handle   h,
@@ -341,10 +1398,97 @@ clixon_plugin_statedata_all(clicon_handle   h,
     clixon_plugin_t *cp = NULL;
     cbuf            *cberr = NULL; 
     cxobj           *xerr = NULL;
+    clixon_plugin_api *api;
+    struct state_worker *sw;
+    struct state_cache *sc;
+    struct timeval   t0;
+    long             age;
+    int              cached;
+    int              stale;
+    xpath_tree      *xpt = NULL;
+    cvec            *steps = NULL;
+    cbuf            *cbkey = NULL;
+    char            *key;
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    gettimeofday(&t0, NULL);
+    /* Saved and cached state is identified by XPath and namespace context */
+    if ((cbkey = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (state_request_key(xpath, nsc, cbkey) < 0)
+        goto done;
+    key = cbuf_get(cbkey);
+    /* Parse requested XPath once, for routing to plugins and for the plugins themselves */
+    if (xpath_parse(xpath?xpath:"/", &xpt) < 0)
+        goto done;
+    if ((steps = cvec_new(0)) == NULL){
+        clicon_err(OE_UNIX, errno, "cvec_new");
+        goto done;
+    }
+    if ((ret = xpath_tree_steps(xpt, nsc, steps)) < 0)
+        goto done;
+    if (ret == 0){ /* Not a simple path, call all plugins */
+        cvec_free(steps);
+        steps = NULL;
+    }
+    if (clicon_ptr_set(h, "state-xpath-tree", xpt) < 0)
+        goto done;
+    /* Start state workers, they run concurrently with the other plugins */
     while ((cp = clixon_plugin_each(h, cp)) != NULL) {
-        if ((ret = clixon_plugin_statedata_one(cp, h, nsc, xpath, &x)) < 0)
+        api = clixon_plugin_api_get(cp);
+        if (api->ca_statedata == NULL || api->ca_statedata_deadline == 0)
+            continue;
+        if ((ret = state_path_match(h, api->ca_statedata, steps)) < 0)
+            goto done;
+        if (ret == 0)
+            continue;
+        age = -1;
+        if (api->ca_statedata_maxage){
+            if ((sc = state_cache_plugin(h, cp)) == NULL)
+                goto done;
+            age = state_cache_age(sc, key);
+            if (age >= 0 && age < api->ca_statedata_maxage/2) /* Fresh */
+                continue;
+        }
+        if ((sw = state_worker_get(h, cp)) == NULL)
+            goto done;
+        /* Reuse worker in flight if same request, eg a previous request missed deadline */
+        if (sw->sw_pid &&
+            (sw->sw_owner != getpid() || strcmp(sw->sw_key, key) != 0))
+            state_worker_stop(sw);
+        if (sw->sw_pid == 0 &&
+            state_worker_start(h, sw, nsc, xpath, key) < 0)
+            goto done;
+        /* Cached state is served, refresh it in background */
+        if (age >= 0 && age < api->ca_statedata_maxage && !sw->sw_late){
+            if (clixon_event_reg_fd(sw->sw_fd, state_worker_cb, sw, "state worker") < 0)
+                goto done;
+            sw->sw_late = 1;
+        }
+    }
+    cp = NULL;
+    while ((cp = clixon_plugin_each(h, cp)) != NULL) {
+        api = clixon_plugin_api_get(cp);
+        if (api->ca_statedata == NULL)
+            continue;
+        if ((ret = state_path_match(h, api->ca_statedata, steps)) < 0)
+            goto done;
+        if (ret == 0)
+            continue;
+        cached = 0;
+        stale = 0;
+        if (api->ca_statedata_maxage &&
+            (cached = state_cache_get(h, cp, key, &x)) < 0)
+            goto done;
+        if (cached)
+            ret = 1;
+        else if (api->ca_statedata_deadline){
+            if ((ret = clixon_plugin_statedata_worker(h, cp, key, &t0, &x, &stale)) < 0)
+                goto done;
+        }
+        else if ((ret = clixon_plugin_statedata_one(cp, h, nsc, xpath, &x)) < 0)
             goto done;
         if (ret == 0){
             if ((cberr = cbuf_new()) == NULL){
@@ -364,30 +1508,38 @@ clixon_plugin_statedata_all(clicon_handle   h,
         if (x == NULL)
             continue;
         if (xml_child_nr(x) == 0){
+            if (!cached && !stale && api->ca_statedata_maxage &&
+                state_cache_set(h, cp, key, x) < 0)
+                goto done;
             xml_free(x);
             x = NULL;
             continue;
         }
-        clicon_debug_xml(CLIXON_DBG_DETAIL, x, "%s %s STATE:", __FUNCTION__, clixon_plugin_name_get(cp));
-        /* XXX: ret == 0 invalid yang binding should be handled as internal error */
-        if ((ret = xml_bind_yang(h, x, YB_MODULE, yspec, &xerr)) < 0)
-            goto done;
-        if (ret == 0){
-            if (clixon_netconf_internal_error(xerr,
-                                              ". Internal error, state callback returned invalid XML from plugin: ",
-                                              clixon_plugin_name_get(cp)) < 0)
+        if (!cached){
+            clicon_debug_xml(CLIXON_DBG_DETAIL, x, "%s %s STATE:", __FUNCTION__, clixon_plugin_name_get(cp));
+            /* XXX: ret == 0 invalid yang binding should be handled as internal error */
+            if ((ret = xml_bind_yang(h, x, YB_MODULE, yspec, &xerr)) < 0)
+                goto done;
+            if (ret == 0){
+                if (clixon_netconf_internal_error(xerr,
+                                                  ". Internal error, state callback returned invalid XML from plugin: ",
+                                                  clixon_plugin_name_get(cp)) < 0)
+                    goto done;
+                xml_free(*xret);
+                *xret = xerr;
+                xerr = NULL;
+                goto fail;
+            }
+            if (xml_sort_recurse(x) < 0)
+                goto done;
+            /* Remove global defaults and empty non-presence containers */
+            /* XXX: only for state data and according to with-defaults setting */
+            if (xml_defaults_nopresence(x, 2) < 0)
+                goto done;
+            if (!stale && api->ca_statedata_maxage &&
+                state_cache_set(h, cp, key, x) < 0)
                 goto done;
-            xml_free(*xret);
-            *xret = xerr;
-            xerr = NULL;
-            goto fail;
         }
-        if (xml_sort_recurse(x) < 0)
-            goto done;
-        /* Remove global defaults and empty non-presence containers */
-        /* XXX: only for state data and according to with-defaults setting */
-        if (xml_defaults_nopresence(x, 2) < 0)
-            goto done;
         if ((ret = netconf_trymerge(x, yspec, xret)) < 0)
             goto done;
         if (ret == 0)
@@ -399,6 +1551,13 @@ clixon_plugin_statedata_all(clicon_handle   h,
     } /* while plugin */
     retval = 1;
  done:
+    clicon_ptr_del(h, "state-xpath-tree");
+    if (xpt)
+        xpath_tree_free(xpt);
+    if (steps)
+        cvec_free(steps);
+    if (cbkey)
+        cbuf_free(cbkey);
     if (xerr)
         xml_free(xerr);
     if (cberr)
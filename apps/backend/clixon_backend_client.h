@@ -45,6 +45,40 @@
 /*
  * Types
  */
+/* Message queued for output to client, see CLICON_SOCK_HIGHWATER
+ */
+/* Message shared by reference by the output queues of several clients, eg a notification */
+struct ce_sharedmsg{
+    int                   sm_refs;    /* Number of references */
+    struct clicon_msg    *sm_msg;     /* Encoded message */
+};
+
+/* Reply serialized in chunks as it is written to the client, see CLICON_SOCK_CHUNK */
+struct ce_outstream{
+    cxobj                *os_xml;     /* Reply tree, owned, freed when serialized */
+    xml2cbuf_chunk       *os_xch;     /* Serializer of os_xml, NULL when done */
+    size_t                os_chunk;   /* Chunk size */
+    int                   os_begun;   /* Start of reply written */
+    cbuf                 *os_cb;      /* Current chunk, framed by its length */
+    size_t                os_pos;     /* Bytes of current chunk already written */
+};
+
+struct ce_outmsg{
+    qelem_t               om_q;       /* List header */
+    struct clicon_msg    *om_msg;     /* Encoded message */
+    struct ce_sharedmsg  *om_shared;  /* If set, om_msg is owned by it */
+    struct ce_outstream  *om_stream;  /* If set, om_msg is only the header, with length 0 */
+};
+
+/* Read-only request handled by a forked worker process, see CLICON_BACKEND_READ_WORKERS
+ */
+struct read_worker{
+    struct client_entry  *rw_ce;      /* Client of request */
+    pid_t                 rw_pid;     /* Worker process */
+    int                   rw_fd;      /* Read end of pipe from worker */
+    cbuf                 *rw_cb;      /* Reply read so far */
+};
+
 /* Backend client entry.
  * Keep state about every connected client.
  * References from RFC 6022, ietf-netconf-monitoring.yang sessions container
@@ -72,6 +106,16 @@ struct client_entry{
     uint32_t              ce_in_bad_rpcs;    /* Not correct <rpc> messages */
     uint32_t              ce_out_rpc_errors; /*  <rpc-error> messages*/
     uint32_t              ce_out_notifications; /* Outgoing notifications */
+    int                   ce_binary;  /* Binary encoding negotiated in hello, see CLICON_SOCK_BINARY */
+    uint64_t              ce_peerfp;  /* Schema fingerprint of client if ce_binary */
+    struct ce_outmsg     *ce_outq;    /* Output not yet written to client socket */
+    size_t                ce_outpos;  /* Bytes of first message in ce_outq already written */
+    size_t                ce_outlen;  /* Bytes in ce_outq not yet written */
+    int                   ce_blocked; /* Requests not read from client, see ce_input_update */
+    struct read_worker   *ce_worker;  /* Worker handling request of client, if any */
+    int                   ce_shmfd;   /* Descriptor passed by client, closed in hello, or -1 */
+    struct clicon_shm    *ce_shm;     /* Shared memory ring for replies, see CLICON_SOCK_SHM */
+    int                   ce_replied; /* Reply of current request already queued */
 };
 typedef struct client_entry client_entry;
 
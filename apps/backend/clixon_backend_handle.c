@@ -146,6 +146,7 @@ backend_client_add(clicon_handle    h,
     memcpy(&ce->ce_addr, addr, sizeof(*addr));
     ce->ce_next = bh->bh_ce_list;
     ce->ce_handle = h;
+    ce->ce_shmfd = -1;
     if (clicon_session_id_get(h, &ce->ce_id) < 0){
         clicon_err(OE_NETCONF, ENOENT, "session_id not set");
         return NULL;
@@ -169,6 +170,48 @@ backend_client_list(clicon_handle h)
     return bh->bh_ce_list;
 }
 
+/*! Release reference to shared message, free it if last
+ *
+ * @param[in]  sm   Shared message
+ * @retval     0    OK
+ */
+int
+ce_sharedmsg_release(struct ce_sharedmsg *sm)
+{
+    if (--sm->sm_refs == 0){
+        free(sm->sm_msg);
+        free(sm);
+    }
+    return 0;
+}
+
+/*! Free queued output message
+ *
+ * @param[in]  om   Output message, not in queue
+ * @retval     0    OK
+ */
+int
+ce_outmsg_free(struct ce_outmsg *om)
+{
+    struct ce_outstream *os;
+
+    if ((os = om->om_stream) != NULL){
+        if (os->os_xch)
+            clixon_xml2cbuf_chunk_free(os->os_xch);
+        if (os->os_xml)
+            xml_free(os->os_xml);
+        if (os->os_cb)
+            cbuf_free(os->os_cb);
+        free(os);
+    }
+    if (om->om_shared)
+        ce_sharedmsg_release(om->om_shared);
+    else
+        free(om->om_msg);
+    free(om);
+    return 0;
+}
+
 /*! Actually remove client from client list
  * @param[in]  h   Clicon handle
  * @param[in]  ce  Client handle
@@ -181,6 +224,7 @@ backend_client_delete(clicon_handle        h,
     struct client_entry   *c;
     struct client_entry  **ce_prev;
     struct backend_handle *bh = handle(h);
+    struct ce_outmsg      *om;
 
     ce_prev = &bh->bh_ce_list;
     for (c = *ce_prev; c; c = c->ce_next){
@@ -192,6 +236,14 @@ backend_client_delete(clicon_handle        h,
                 free(ce->ce_transport);
             if (ce->ce_source_host)
                 free(ce->ce_source_host);
+            while ((om = ce->ce_outq) != NULL){
+                DELQ(om, ce->ce_outq, struct ce_outmsg *);
+                ce_outmsg_free(om);
+            }
+            if (ce->ce_shm)
+                clicon_shm_free(ce->ce_shm);
+            if (ce->ce_shmfd != -1)
+                close(ce->ce_shmfd);
             free(ce);
             break;
         }
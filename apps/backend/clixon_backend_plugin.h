@@ -100,6 +100,11 @@ int clixon_plugin_daemon_all(clicon_handle h);
 
 int clixon_plugin_statedata_all(clicon_handle h, yang_stmt *yspec, cvec *nsc, char *xpath,
                                 withdefaults_type wdef, cxobj **xtop);
+int clixon_plugin_statedata_path_register(clicon_handle h, plgstatedata_t *fn, char *path);
+xpath_tree *clixon_plugin_statedata_xpath_tree(clicon_handle h);
+int clixon_plugin_statedata_exit(clicon_handle h);
+int clixon_plugin_statedata_stats(clicon_handle h, cbuf *cb);
+int clixon_plugin_statedata_kept(clicon_handle h);
 int clixon_plugin_lockdb_all(clicon_handle h, char *db, int lock, int id);
 
 int clixon_pagination_cb_register(clicon_handle h, handler_function fn, char *path, void *arg);
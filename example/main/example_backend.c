@@ -68,7 +68,7 @@
 #include <clixon/clixon_backend.h> 
 
 /* Command line options to be passed to getopt(3) */
-#define BACKEND_EXAMPLE_OPTS "a:nrsS:x:iuUtV:"
+#define BACKEND_EXAMPLE_OPTS "a:nrsS:x:iuUtV:d:w:m:p:"
 
 /* Enabling this improves performance in tests, but there may trigger the "double XPath"
  * problem.
@@ -121,6 +121,30 @@ static char *_state_xpath = NULL;
  */
 static int _state_file_cached = 0;
 
+/*! Deadline of state callback in ms, the callback is called in a worker process
+ * Primarily for testing, see ca_statedata_deadline
+ * Start backend with -- -d <ms>
+ */
+static uint32_t _state_deadline = 0;
+
+/*! Max age of cached state in ms, see ca_statedata_maxage
+ * Primarily for testing
+ * Start backend with -- -m <ms>
+ */
+static uint32_t _state_maxage = 0;
+
+/*! Path that the state callback provides state for, see clixon_plugin_statedata_path_register
+ * Primarily for testing
+ * Start backend with -- -p <path>
+ */
+static char *_state_path = NULL;
+
+/*! Delay of reading state file in ms, emulates a slow state callback
+ * Primarily for testing
+ * Start backend with -- -sS <file> -w <ms>
+ */
+static uint32_t _state_delay = 0;
+
 /*! Cache control of read state file pagination example,
  * keep xml tree cache as long as db is locked
  */
@@ -542,6 +566,8 @@ example_statefile(clicon_handle     h,
     /* If -S is set, then read state data from file */
     if (!_state || !_state_file)
         goto ok;
+    if (_state_delay)
+        usleep(_state_delay*1000);
     yspec = clicon_dbspec_yang(h);
     /* Read state file if either not cached, or the cache is NULL */
     if (_state_file_cached == 0 ||
@@ -1436,8 +1462,22 @@ clixon_plugin_init(clicon_handle h)
         case 'V': /* validate fail */
             _validate_fail_xpath = optarg;
             break;
+        case 'd': /* state callback deadline */
+            _state_deadline = atoi(optarg);
+            break;
+        case 'w': /* state file delay (requires -sS) */
+            _state_delay = atoi(optarg);
+            break;
+        case 'm': /* state cache max age */
+            _state_maxage = atoi(optarg);
+            break;
+        case 'p': /* state path */
+            _state_path = optarg;
+            break;
         }
 
+    api.ca_statedata_deadline = _state_deadline;
+    api.ca_statedata_maxage = _state_maxage;
     if (_state_file){
         api.ca_statedata = example_statefile; /* Switch state data callback */
         if (_state_xpath){
@@ -1449,6 +1489,9 @@ clixon_plugin_init(clicon_handle h)
                 goto done;
         }
     }
+    if (_state_path &&
+        clixon_plugin_statedata_path_register(h, api.ca_statedata, _state_path) < 0)
+        goto done;
         
     if (_notification_stream){
         /* Example stream initialization:
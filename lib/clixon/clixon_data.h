@@ -57,6 +57,8 @@ typedef struct {
     cxobj    *de_xml;      /* cache */
     int       de_modified; /* Dirty since loaded/copied/committed/etc XXX:nocache? */
     int       de_empty;    /* Empty on read from file, xmldb_readfile and xmldb_put sets it */
+    uint64_t  de_gen;      /* Generation of cache, new on each set, 0 while modified in place */
+    uint64_t  de_bound;    /* Generation of cache bound to YANG with defaults, see xmldb_cache_bind */
 } db_elmnt;
 
 /*
@@ -98,6 +100,7 @@ int clicon_nacm_ext_set(clicon_handle h, cxobj *xn);
 
 cxobj *clicon_nacm_cache(clicon_handle h);
 int clicon_nacm_cache_set(clicon_handle h, cxobj *xn);
+uint64_t clicon_nacm_cache_gen(clicon_handle h);
 
 cxobj *clicon_conf_xml(clicon_handle h);
 int clicon_conf_xml_set(clicon_handle h, cxobj *x);
@@ -56,6 +56,11 @@ int xmldb_get0(clicon_handle h, const char *db, yang_bind yb,
                cxobj **xtop, modstate_diff_t *msd, cxobj **xerr); 
 int xmldb_get0_clear(clicon_handle h, cxobj *x);
 int xmldb_get0_free(clicon_handle h, cxobj **xp);
+int xmldb_get0_depth(clicon_handle h, const char *db, cvec *nsc, const char *xpath,
+                     withdefaults_type wdef, int32_t depth, cxobj **xret);
+int xmldb_cache_bind(clicon_handle h, const char *db, cxobj **xtp);
+int xmldb_get0_vec(clicon_handle h, cxobj *x0t, cxobj **xvec, size_t xlen,
+                   withdefaults_type wdef, cxobj **xtop);
 int xmldb_put(clicon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret); /* in clixon_datastore_write.[ch] */
 int xmldb_copy(clicon_handle h, const char *from, const char *to);
 int xmldb_lock(clicon_handle h, const char *db, uint32_t id);
@@ -71,6 +76,7 @@ int xmldb_create(clicon_handle h, const char *db);
 int xmldb_db_reset(clicon_handle h, const char *db);
 
 cxobj *xmldb_cache_get(clicon_handle h, const char *db);
+uint64_t xmldb_generation(clicon_handle h, const char *db);
 
 int xmldb_modified_get(clicon_handle h, const char *db);
 int xmldb_modified_set(clicon_handle h, const char *db, int value);
@@ -57,6 +57,8 @@ int clicon_sig_ignore_get(void);
 
 int clixon_event_reg_fd(int fd, int (*fn)(int, void*), void *arg, char *str);
 
+int clixon_event_reg_fd_write(int fd, int (*fn)(int, void*), void *arg, char *str);
+
 int clixon_event_unreg_fd(int s, int (*fn)(int, void*));
 
 int clixon_event_reg_timeout(struct timeval t,  int (*fn)(int, void*), 
@@ -70,4 +72,6 @@ int clixon_event_loop(clicon_handle h);
 
 int clixon_event_exit(void);
 
+int clixon_event_stats(cbuf *cb, char *ns);
+
 #endif  /* _CLIXON_EVENT_H_ */
@@ -63,6 +63,11 @@ typedef int (clicon_output_cb)(
    const char *templ, ... 
 ) __attribute__ ((format (printf, 2, 3)));
 
+/*! Callback freeing module state kept in a handle, see clicon_handle_exit_reg
+ * @param[in]  h   Clicon handle
+ */
+typedef int (clicon_handle_exit_cb)(clicon_handle h);
+
 /*
  * Prototypes
  */
@@ -75,6 +80,9 @@ clicon_handle clicon_handle_init0(int size);
 /* Deallocate handle */
 int clicon_handle_exit(clicon_handle h);
 
+/* Register callback called when handle is deallocated */
+int clicon_handle_exit_reg(clicon_handle h, clicon_handle_exit_cb *fn);
+
 /* Check struct magic number for sanity checks */
 int clicon_handle_check(clicon_handle h);
 
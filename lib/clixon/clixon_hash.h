@@ -46,6 +46,9 @@ struct clicon_hash {
 };
 typedef struct clicon_hash *clicon_hash_t;
 
+/* Initial value of clicon_hash_fnv1a */
+#define CLICON_HASH_FNV_INIT 2166136261U
+
 clicon_hash_t *clicon_hash_init (void);
 int            clicon_hash_free (clicon_hash_t *);
 clicon_hash_t  clicon_hash_lookup (clicon_hash_t *head, const char *key);
@@ -54,6 +57,7 @@ clicon_hash_t  clicon_hash_add (clicon_hash_t *head, const char *key, void *val,
 int            clicon_hash_del (clicon_hash_t *head, const char *key);
 int            clicon_hash_dump(clicon_hash_t *head, FILE *f);
 int            clicon_hash_keys(clicon_hash_t *hash, char ***vector, size_t *nkeys);
+uint32_t       clicon_hash_fnv1a(uint32_t h, const char *str);
 
 /*
  *   Macros to iterate over hash contents.
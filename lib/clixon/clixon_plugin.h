@@ -220,6 +220,10 @@ typedef int (plgreset_t)(clicon_handle h, const char *db);
  *
  * @note The system will make an xpath check and filter out non-matching trees
  * @note The system does not validate the xml, unless CLICON_VALIDATE_STATE_XML is set
+ * @note If ca_statedata_deadline is set, the callback is called in a forked worker process,
+ *       concurrently with other plugins. If the deadline is missed, the previous result is used.
+ * @note If ca_statedata_maxage is set, state is cached per XPath and namespace context, and
+ *       the callback is not called while cached state is younger than max age.
  * @see clixon_pagination_cb_register for special paginated state data callback
  */
 typedef int (plgstatedata_t)(clicon_handle h, cvec *nsc, char *xpath, cxobj *xtop);
@@ -360,6 +364,8 @@ struct clixon_plugin_api{
             trans_cb_t       *cb_trans_end;      /* Transaction completed  */
             trans_cb_t       *cb_trans_abort;    /* Transaction aborted */
             datastore_upgrade_t *cb_datastore_upgrade; /* General-purpose datastore upgrade */
+            uint32_t          cb_statedata_deadline; /* If set, statedata in worker with deadline [ms] */
+            uint32_t          cb_statedata_maxage;   /* If set, statedata is cached max age [ms] */
         } cau_backend;
     } u;
 };
@@ -382,6 +388,8 @@ struct clixon_plugin_api{
 #define ca_trans_end      u.cau_backend.cb_trans_end
 #define ca_trans_abort    u.cau_backend.cb_trans_abort
 #define ca_datastore_upgrade  u.cau_backend.cb_datastore_upgrade
+#define ca_statedata_deadline u.cau_backend.cb_statedata_deadline
+#define ca_statedata_maxage u.cau_backend.cb_statedata_maxage
 
 /*
  * Macros
@@ -46,7 +46,8 @@
 
 /* Protocol message header */
 struct clicon_msg {
-    uint32_t    op_len;     /* length of whole message: body+header, network byte order. */
+    uint32_t    op_len;     /* length of whole message: body+header, network byte order.
+                               0: body follows in chunks, see clicon_msg_rcv_fd */
     uint32_t    op_id;      /* session-id. network byte order. 1..max(u32), can be zero in client hello */
     char        op_body[0]; /* rest of message, actual data */
 };
@@ -59,6 +60,9 @@ enum format_enum format_str2int(char *str);
 
 struct clicon_msg *clicon_msg_encode(uint32_t id, const char *format, ...) __attribute__ ((format (printf, 2, 3)));
 int clicon_msg_decode(struct clicon_msg *msg, yang_stmt *yspec, uint32_t *id, cxobj **xml, cxobj **xerr);
+struct clicon_msg *clicon_msg_encode_bin(uint32_t id, cbuf *cb);
+int clicon_msg_isbin(struct clicon_msg *msg);
+int clicon_msg_decode_bin(clicon_handle h, struct clicon_msg *msg, yang_stmt *yspec, uint32_t *id, cxobj **xml, cxobj **xerr);
 
 int clicon_connect_unix(clicon_handle h, char *sockpath);
 
@@ -80,8 +84,12 @@ int clicon_msg_send(int s, struct clicon_msg *msg);
 
 int clicon_msg_send1(int s, cbuf *cb);
 
+int clicon_msg_send_fd(int s, struct clicon_msg *msg, int fd);
+
 int clicon_msg_rcv(int s, int intr, struct clicon_msg **msg, int *eof);
 
+int clicon_msg_rcv_fd(int s, int intr, int *fdp, struct clicon_msg **msg, int *eof);
+
 int clicon_msg_rcv1(int s, cbuf *cb, int *eof);
 
 int send_msg_notify_xml(clicon_handle h, int s, cxobj *xev);
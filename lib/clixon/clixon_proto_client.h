@@ -42,11 +42,43 @@
 #ifndef _CLIXON_PROTO_CLIENT_H_
 #define _CLIXON_PROTO_CLIENT_H_
 
+/*
+ * Constants
+ */
+/* Max number of outstanding asynchronous requests on the client socket
+ * @see clicon_rpc_msg_async
+ */
+#define CLICON_RPC_ASYNC_MAX 64
+
+/*
+ * Types
+ */
+/*! Reply callback of asynchronous request
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  id    Request id as returned by clicon_rpc_msg_async
+ * @param[in]  xret  Reply as XML tree, freed after the call
+ * @param[in]  arg   Argument given to clicon_rpc_msg_async
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+typedef int (clicon_rpc_async_cb)(clicon_handle h, uint32_t id, cxobj *xret, void *arg);
+
+/*
+ * Prototypes
+ */
+
 int clicon_rpc_connect(clicon_handle h, int *sock0);
 int clicon_rpc_msg(clicon_handle h, struct clicon_msg *msg, cxobj **xret0);
 int clicon_rpc_msg_persistent(clicon_handle h, struct clicon_msg *msg, cxobj **xret0, int *sock0);
+int clicon_rpc_msg_async(clicon_handle h, struct clicon_msg *msg, clicon_rpc_async_cb *fn, void *arg, uint32_t *id);
+int clicon_rpc_async_wait(clicon_handle h, uint32_t id);
+int clicon_rpc_async_pending(clicon_handle h);
+int clicon_rpc_async_exit(clicon_handle h);
+int clicon_rpc_shm_exit(clicon_handle h);
 int clicon_rpc_netconf(clicon_handle h, char *xmlst, cxobj **xret, int *sp);
 int clicon_rpc_netconf_xml(clicon_handle h, cxobj *xml, cxobj **xret, int *sp);
+int clicon_rpc_binary_peer(clicon_handle h, uint64_t *peerfp);
 int clicon_rpc_get_config(clicon_handle h, char *username, char *db, char *xpath, cvec *nsc, char *defaults, cxobj **xret);
 int clicon_rpc_edit_config(clicon_handle h, char *db, enum operation_type op, 
                            char *xml);
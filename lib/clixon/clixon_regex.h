@@ -38,6 +38,24 @@
 #ifndef _CLIXON_REGEX_H_
 #define _CLIXON_REGEX_H_
 
+/*
+ * Constants
+ */
+/* Name of compiled regexp cv:s that are fast paths, see regex_fast_compile */
+#define REGEX_FAST_NAME "regex-fast"
+
+/*
+ * Types
+ */
+/*! Native validator replacing the pattern statements of a typedef
+ * @param[in]  str  String to validate
+ * @retval     1    Match
+ * @retval     0    No match
+ * @retval     2    Not decided (eg non-ASCII characters), use the regexp engine
+ * @see regex_native_register
+ */
+typedef int (regex_native_fn)(char *str);
+
 /*
  * Prototypes
  */ 
@@ -45,5 +63,10 @@ int regexp_xsd2posix(char *xsd, char **posix);
 int regex_compile(clicon_handle h, char *regexp, void **recomp);
 int regex_exec(clicon_handle h, void *recomp, char *string);
 int regex_free(clicon_handle h, void *recomp);
+int regex_native_register(clicon_handle h, char *module, char *name, char *pattern, regex_native_fn *fn);
+int regex_native_free(clicon_handle h);
+int regex_fast_compile(clicon_handle h, cvec *patterns, cg_var *pcv, void **fast);
+int regex_fast_exec(clicon_handle h, void *fast, char *string);
+int regex_fast_free(void *fast);
 
 #endif  /* _CLIXON_REGEX_H_ */
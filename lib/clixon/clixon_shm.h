@@ -0,0 +1,68 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Shared-memory ring buffer for replies from backend to co-located clients
+ */
+
+#ifndef _CLIXON_SHM_H_
+#define _CLIXON_SHM_H_
+
+/*
+ * Constants
+ */
+/* First bytes of a descriptor message body, NUL cannot start a text body */
+#define CLICON_SHM_MAGIC      "\0CXS"
+
+/* Capability announced in internal hello */
+#define CLICON_SHM_CAPABILITY "http://clicon.org/lib/shm"
+
+/* Replies shorter than this are sent on the socket */
+#define CLICON_SHM_MIN        4096
+
+/*
+ * Types
+ */
+struct clicon_shm;
+
+/*
+ * Prototypes
+ */
+int clicon_shm_create(uint32_t size, int *fdp, struct clicon_shm **shmp);
+int clicon_shm_attach(int fd, struct clicon_shm **shmp);
+int clicon_shm_free(struct clicon_shm *shm);
+int clicon_shm_put(struct clicon_shm *shm, char *data, size_t len, struct clicon_msg **msgp);
+int clicon_msg_isshm(struct clicon_msg *msg);
+int clicon_shm_get(struct clicon_shm *shm, struct clicon_msg *desc, struct clicon_msg **msgp);
+
+#endif  /* _CLIXON_SHM_H_ */
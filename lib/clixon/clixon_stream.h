@@ -54,22 +54,30 @@
  */
 typedef int (*stream_fn_t)(clicon_handle h, int op, cxobj *event, void *arg);
 
+/* Subscription filter, shared by all subscriptions of a stream with the same xpath.
+ * It is parsed once and evaluated once per event.
+ */
+struct stream_filter{
+    qelem_t                     sf_q;     /* queue header */
+    char                       *sf_xpath; /* Filter selector as xpath */
+    struct xpath_tree          *sf_xpt;   /* Parsed xpath */
+    int                         sf_refs;  /* Number of subscriptions using filter */
+    int                         sf_match; /* Set if current event matches filter */
+};
+
 struct stream_subscription{
     qelem_t                     ss_q;   /* queue header */
     char                       *ss_stream; /* Name of associated stream */
     char                       *ss_xpath;  /* Filter selector as xpath */
+    struct stream_filter       *ss_filter; /* Filter or NULL if no selector */
     struct timeval              ss_starttime; /* Replay starttime */
     struct timeval              ss_stoptime; /* Replay stoptime */
     stream_fn_t                 ss_fn;     /* Callback when event occurs */
     void                       *ss_arg;    /* Callback argument */
 };
 
-/* Replay time-series */
-struct stream_replay{
-    qelem_t        r_q;   /* queue header */
-    struct timeval r_tv;  /* time index */
-    cxobj         *r_xml; /* event in xml form */
-};
+/* Replay store of serialized events indexed by time, see clixon_stream_replay.c */
+struct stream_replay_ring;
 
 /* See RFC8040 9.3, stream list, no replay support for now
  */
@@ -78,9 +86,10 @@ struct event_stream{
     char                *es_name; /* name of notification event stream */
     char                *es_description;
     struct stream_subscription *es_subscription;
+    struct stream_filter *es_filters;  /* Filters of subscriptions */
     int                  es_replay_enabled; /* set if replay is enables */
     struct timeval       es_retention; /* replay retention - how much to save */
-    struct stream_replay *es_replay;
+    struct stream_replay_ring *es_replay; /* replay store if replay enabled */
 
 };
 typedef struct event_stream event_stream_t;
@@ -103,12 +112,23 @@ struct stream_subscription *stream_ss_find(event_stream_t *es,
 int stream_ss_delete_all(clicon_handle h, stream_fn_t fn, void *arg);
 int stream_ss_delete(clicon_handle h, char *name, stream_fn_t fn, void *arg);
 
+int stream_event_cbuf(cxobj *event, enum format_enum format, cbuf **cbp);
+void *stream_event_shared_get(cxobj *event);
+int stream_event_shared_set(cxobj *event, void *arg, void (*freefn)(void *));
+
 int stream_notify_xml(clicon_handle h, char *stream, cxobj *xml);
 int stream_notify(clicon_handle h, char *stream, const char *event, ...)  __attribute__ ((format (printf, 3, 4)));
 
 /* Replay */
 int stream_replay_add(event_stream_t *es, struct timeval *tv, cxobj *xv);
 int stream_replay_trigger(clicon_handle h, char *stream, stream_fn_t fn, void *arg);
+int stream_replay_ring_new(clicon_handle h, const char *name, struct stream_replay_ring **rrp);
+int stream_replay_ring_free(struct stream_replay_ring *rr);
+int stream_replay_ring_add(struct stream_replay_ring *rr, struct timeval *tv, char *data, size_t len);
+int stream_replay_ring_expire(struct stream_replay_ring *rr, struct timeval *tv);
+uint32_t stream_replay_ring_len(struct stream_replay_ring *rr);
+uint32_t stream_replay_ring_find(struct stream_replay_ring *rr, struct timeval *tv);
+int stream_replay_ring_get(struct stream_replay_ring *rr, uint32_t i, struct timeval *tv, cbuf *cb);
 
 /* Experimental publish streams using SSE. CLIXON_PUBLISH_STREAMS should be set */
 int stream_publish(clicon_handle h, char *stream);
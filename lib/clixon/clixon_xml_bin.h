@@ -0,0 +1,67 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Binary encoding of XML trees for the internal NETCONF protocol between clients and backend
+ */
+
+#ifndef _CLIXON_XML_BIN_H_
+#define _CLIXON_XML_BIN_H_
+
+/*
+ * Constants
+ */
+/* First bytes of a binary message body, NUL cannot start a text body */
+#define CLIXON_BIN_MAGIC     "\0CXB"
+#define CLIXON_BIN_VERSION   1
+#define CLIXON_BIN_HDRLEN    20
+
+/* Header flag: schema-node ids are encoded */
+#define CLIXON_BIN_FLAG_SPEC 0x01
+
+/* Capability announced in internal hello, fingerprint is appended as hex */
+#define CLIXON_BIN_CAPABILITY "http://clicon.org/lib/binary?fingerprint="
+
+/*
+ * Prototypes
+ */
+int    clixon_bin_fingerprint(clicon_handle h, yang_stmt *yspec, uint64_t *fp);
+int    clixon_bin_exit(clicon_handle h);
+int    clixon_xml2bin(clicon_handle h, cbuf *cb, char *wrapper, char *wrapns,
+                      cxobj **xvec, int xlen, int32_t depth, uint64_t peerfp);
+int    clixon_bin_is(char *buf, size_t len);
+size_t clixon_bin_len(char *buf);
+int    clixon_bin2xml(clicon_handle h, char *buf, size_t len, cxobj **xt);
+int    clixon_bin_bound(cxobj *x);
+
+#endif  /* _CLIXON_XML_BIN_H_ */
@@ -55,5 +55,6 @@ int xml_defaults_nopresence(cxobj *xn, int purge);
 int xml_add_default_tag(cxobj *x, uint16_t flags);
 int xml_flag_state_default_value(cxobj *x, uint16_t flag);
 int xml_flag_default_value(cxobj *x, uint16_t flag);
+int xml_defaults_xpath_independent(const char *xpath, cvec *nsc, yang_stmt *yspec);
 
 #endif  /* _CLIXON_XML_DEFAULT_H_ */
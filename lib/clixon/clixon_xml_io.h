@@ -40,6 +40,11 @@
 #ifndef _CLIXON_XML_IO_H_
 #define _CLIXON_XML_IO_H_
 
+/*
+ * Types
+ */
+typedef struct xml2cbuf_chunk xml2cbuf_chunk; /* Resumable serializer, see clixon_xml2cbuf_chunk */
+
 /*
  * Prototypes
  */
@@ -47,6 +52,9 @@ int   clixon_xml2file(FILE *f, cxobj *xn, int level, int pretty, clicon_output_c
 int   xml_print(FILE *f, cxobj *xn);
 int   xml_dump(FILE  *f, cxobj *x);
 int   clixon_xml2cbuf(cbuf *cb, cxobj *x, int level, int prettyprint, int32_t depth, int skiptop);
+xml2cbuf_chunk *clixon_xml2cbuf_chunk_new(cxobj *xn, int32_t depth);
+int   clixon_xml2cbuf_chunk_free(xml2cbuf_chunk *xch);
+int   clixon_xml2cbuf_chunk(xml2cbuf_chunk *xch, cbuf *cb, size_t len);
 int   xmltree2cbuf(cbuf *cb, cxobj *x, int level);
 int   clixon_xml_parse_file(FILE *f, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
 int   clixon_xml_parse_string(const char *str, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
@@ -77,6 +77,12 @@
 #include "clixon_xpath.h"
 #include "clixon_data.h"
 
+/* Generation counter of datastore caches and NACM trees
+ * @see clicon_db_elmnt_set
+ * @see clicon_nacm_cache_gen
+ */
+static uint64_t data_gen = 0;
+
 /*! Get generic clixon data on the form <name>=<val> where <val> is string
  * @param[in]  h    Clicon handle
  * @param[in]  name Data name
@@ -438,6 +444,8 @@ clicon_nacm_ext(clicon_handle h)
 }
 
 /*! Set NACM (rfc 8341) external XML parse tree, free old if any
+ *
+ * The tree is given a new generation, see clicon_nacm_cache_gen
  * @param[in]  h   Clicon handle
  * @param[in]  xn  XML Nacm tree
  * @note only used if config option CLICON_NACM_MODE is external
@@ -447,10 +455,14 @@ int
 clicon_nacm_ext_set(clicon_handle h,
                      cxobj        *x)
 {
-    cxobj *x0 = NULL;
+    cxobj   *x0 = NULL;
+    uint64_t g;
 
     if ((x0 = clicon_nacm_ext(h)) != NULL)
         xml_free(x0);
+    g = x ? ++data_gen : 0;
+    if (clicon_hash_add(clicon_data(h), "nacm_ext_gen", &g, sizeof(g)) == NULL)
+        return -1;
     return clicon_ptr_set(h, "nacm_xml", x);
 }
 
@@ -471,6 +483,9 @@ clicon_nacm_cache(clicon_handle h)
 }
 
 /*! Set NACM (rfc 8341) external XML parse tree cache
+ *
+ * The cache is given the generation of the NACM tree it is read from, see
+ * clicon_nacm_cache_gen
  * @param[in]  h   Clicon handle
  * @param[in]  xn  XML Nacm tree direct pointer, no copying
  * @note  Use with caution, only valid on a stack, direct pointer freed on function return
@@ -480,9 +495,49 @@ int
 clicon_nacm_cache_set(clicon_handle h,
                       cxobj        *xn)
 {
+    clicon_hash_t *cdat = clicon_data(h);
+    char          *mode;
+    db_elmnt      *de;
+    uint64_t      *ge;
+    uint64_t       g = 0;
+
+    if (xn != NULL){
+        mode = clicon_option_str(h, "CLICON_NACM_MODE");
+        if (mode && strcmp(mode, "external") == 0){
+            if ((ge = clicon_hash_value(cdat, "nacm_ext_gen", NULL)) != NULL)
+                g = *ge;
+        }
+        else if ((de = clicon_db_elmnt_get(h, "running")) != NULL && de->de_xml != NULL)
+            g = de->de_gen;
+        if (g == 0) /* Not known, eg running is not cached: valid for this request only */
+            g = ++data_gen;
+    }
+    if (clicon_hash_add(cdat, "nacm_cache_gen", &g, sizeof(g)) == NULL)
+        return -1;
     return clicon_ptr_set(h, "nacm_cache", xn);
 }
 
+/*! Get generation of NACM XML parse tree cache
+ *
+ * The generation is that of the NACM tree the cache is read from: the generation of the
+ * running datastore cache in internal NACM mode, or of the external NACM tree in external
+ * mode. It is the same for requests as long as the NACM tree is not changed, and data
+ * derived from the cached tree is valid as long as the generation is the same.
+ * @param[in]  h    Clicon handle
+ * @retval     gen  Generation of cache
+ * @retval     0    No cache
+ * @see xmldb_generation
+ */
+uint64_t
+clicon_nacm_cache_gen(clicon_handle h)
+{
+    uint64_t *g;
+
+    if ((g = clicon_hash_value(clicon_data(h), "nacm_cache_gen", NULL)) == NULL)
+        return 0;
+    return *g;
+}
+
 /*! Get YANG specification for Clixon system options and features
  * Must use hash functions directly since they are not strings.
  * Example: features are typically accessed directly in the config tree.
@@ -847,6 +902,8 @@ clicon_db_elmnt_get(clicon_handle h,
 }
 
 /*! Set xml database element including id, xml cache, empty on startup and dirty bit
+ *
+ * The element is given a new generation, see xmldb_generation
  * @param[in] h   Clicon handle
  * @param[in] db  Name of database
  * @param[in] de  Database element
@@ -861,6 +918,8 @@ clicon_db_elmnt_set(clicon_handle h,
 {
     clicon_hash_t  *cdat = clicon_db_elmnt(h);
 
+    de->de_gen = ++data_gen;
+
     if (clicon_hash_add(cdat, db, de, sizeof(*de))==NULL)
         return -1;
     return 0;
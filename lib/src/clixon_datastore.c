@@ -536,6 +536,26 @@ xmldb_cache_get(clicon_handle h,
     return de->de_xml;
 }
 
+/*! Get generation of datastore XML cache
+ *
+ * A new generation is given each time the cache is set. Derived data, such as an index
+ * of the cached tree, is valid as long as the generation is the same.
+ * @param[in]  h    Clicon handle
+ * @param[in]  db   Database name
+ * @retval     gen  Generation of cache
+ * @retval     0    No cache, or cache is being modified
+ */
+uint64_t
+xmldb_generation(clicon_handle h,
+                 const char   *db)
+{
+    db_elmnt *de;
+    
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL || de->de_xml == NULL)
+        return 0;
+    return de->de_gen;
+}
+
 /*! Get modified flag from datastore
  * @param[in]  h     Clicon handle
  * @param[in]  db    Database name
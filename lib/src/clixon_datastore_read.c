@@ -205,20 +205,137 @@ xml_copy_bottom_recurse(cxobj  *x0t,
     return retval;
 }
 
+/*! Find a child that keeps a node from being purged as an empty non-presence container
+ *
+ * A child is only chosen if that can be decided without looking at its children,
+ * see xml_defaults_nopresence.
+ * @param[in]  x0     XML node
+ * @param[in]  wdef   With-defaults parameter, with trim also leaves with a default are skipped
+ * @retval     xw     Child
+ * @retval     NULL   No such child
+ */
+static cxobj *
+xml_copy_depth_witness(cxobj            *x0,
+                       withdefaults_type wdef)
+{
+    cxobj     *xc = NULL;
+    yang_stmt *yc;
+    cg_var    *cv;
+
+    while ((xc = xml_child_each(x0, xc, CX_ELMNT)) != NULL) {
+        if ((yc = xml_spec(xc)) == NULL)
+            return xc;
+        switch (yang_keyword_get(yc)){
+        case Y_CONTAINER:
+            if (yang_find(yc, Y_PRESENCE, NULL) != NULL)
+                return xc;
+            break;
+        case Y_LEAF:
+        case Y_LEAF_LIST:
+            if (xml_flag(xc, XML_FLAG_DEFAULT))
+                break;
+            if (wdef == WITHDEFAULTS_TRIM &&
+                (cv = yang_cv_get(yc)) != NULL && cv_name_get(cv) != NULL)
+                break;
+            return xc;
+        default:
+            return xc;
+        }
+    }
+    return NULL;
+}
+
+/*! Copy an XML node and its element children down to a depth
+ *
+ * Attributes and bodies are always copied. At depth 0, of the element children only
+ * list keys and one child that keeps the node after with-defaults are copied, or all
+ * children if no such child is found. The copy is printed the same as a complete copy
+ * with the same depth.
+ * @param[in]  x0     Original node
+ * @param[in]  x1     New empty node
+ * @param[in]  depth  Levels of element children to copy
+ * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see clixon_xml2cbuf  with depth
+ */
+static int
+xml_copy_depth(cxobj            *x0,
+               cxobj            *x1,
+               int32_t           depth,
+               withdefaults_type wdef)
+{
+    int        retval = -1;
+    cxobj     *x0c = NULL;
+    cxobj     *x1c;
+    cxobj     *xw = NULL;
+    yang_stmt *y;
+    int        iskey;
+
+    if (depth <= 0 && xml_child_nr_type(x0, CX_ELMNT) != 0 &&
+        (xw = xml_copy_depth_witness(x0, wdef)) == NULL){
+        if (xml_copy(x0, x1) < 0)
+            goto done;
+        goto ok;
+    }
+    if (xml_copy_one(x0, x1) < 0)
+        goto done;
+    y = xml_spec(x0);
+    while ((x0c = xml_child_each(x0, x0c, -1)) != NULL) {
+        if (xml_type(x0c) == CX_ELMNT && depth <= 0){
+            iskey = 0;
+            if (y && yang_keyword_get(y) == Y_LIST &&
+                (iskey = yang_key_match(y, xml_name(x0c), NULL)) < 0)
+                goto done;
+            if (!iskey && x0c != xw)
+                continue;
+            if ((x1c = xml_new(xml_name(x0c), x1, CX_ELMNT)) == NULL)
+                goto done;
+            if (iskey){
+                if (xml_copy(x0c, x1c) < 0)
+                    goto done;
+            }
+            else if (xml_copy_one(x0c, x1c) < 0) /* Not printed, one level only */
+                goto done;
+            continue;
+        }
+        if ((x1c = xml_new(xml_name(x0c), x1, xml_type(x0c))) == NULL)
+            goto done;
+        if (xml_type(x0c) == CX_ELMNT){
+            if (xml_copy_depth(x0c, x1c, depth-1, wdef) < 0)
+                goto done;
+        }
+        else if (xml_copy_one(x0c, x1c) < 0)
+            goto done;
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Copy an XML tree bottom-up
+ * @param[in]  x0t    Top of original tree
+ * @param[in]  x0     Node in original tree to copy with its ancestors
+ * @param[in]  x1t    Top of new tree
+ * @param[in]  depth  Levels below the top-level nodes to copy, or -1 for all
+ * @param[in]  wdef   With-defaults parameter, see xml_copy_depth
  * @retval     -1    General error, check specific clicon_errno, clicon_suberrno
  * @retval     0     OK
  */
 static int
-xml_copy_from_bottom(cxobj  *x0t, 
-                     cxobj  *x0,
-                     cxobj  *x1t)
+xml_copy_from_bottom(cxobj            *x0t, 
+                     cxobj            *x0,
+                     cxobj            *x1t,
+                     int32_t           depth,
+                     withdefaults_type wdef)
 {
     int        retval = -1;
     cxobj     *x1p    = NULL;
     cxobj     *x0p    = NULL;
     cxobj     *x1     = NULL;
     yang_stmt *y      = NULL;
+    cxobj     *xa;
     
     if (x0 == x0t)
         goto ok;
@@ -233,8 +350,17 @@ xml_copy_from_bottom(cxobj  *x0t,
     if (x1 == NULL){ /* If not, create it and copy complete tree */
         if ((x1 = xml_new(xml_name(x0), x1p, CX_ELMNT)) == NULL)
             goto done;
-        if (xml_copy(x0, x1) < 0)
-            goto done;
+        if (depth == -1){
+            if (xml_copy(x0, x1) < 0)
+                goto done;
+        }
+        else {
+            /* Remaining depth is depth minus level of x0, top-level nodes are level 1 */
+            for (xa = x0; xa != x0t && depth >= 0; xa = xml_parent(xa))
+                depth--;
+            if (xml_copy_depth(x0, x1, depth, wdef) < 0)
+                goto done;
+        }
     }
  ok:
     retval = 0;
@@ -242,6 +368,67 @@ xml_copy_from_bottom(cxobj  *x0t,
     return retval;
 }
 
+/*! Apply with-defaults to a tree copied from the cache
+ *
+ * @param[in]  xt     XML tree, defaults are removed or tagged in place
+ * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+xmldb_get_wdef(cxobj            *xt,
+               withdefaults_type wdef)
+{
+    int retval = -1;
+
+    switch (wdef){
+    case WITHDEFAULTS_REPORT_ALL:
+        break;
+    case WITHDEFAULTS_TRIM:
+        /* Mark and remove nodes having schema default values */
+        if (xml_apply(xt, CX_ELMNT, (xml_applyfn_t*) xml_flag_default_value, (void*) XML_FLAG_MARK) < 0)
+            goto done;
+        if (xml_tree_prune_flags(xt, XML_FLAG_MARK, XML_FLAG_MARK)
+            < 0)
+            goto done;        
+        if (xml_defaults_nopresence(xt, 1) < 0)
+            goto done;
+        break;
+    case WITHDEFAULTS_EXPLICIT:
+        if (xml_defaults_nopresence(xt, 2) < 0)
+            goto done;
+        break;
+    case WITHDEFAULTS_REPORT_ALL_TAGGED:{
+        cxobj *x;
+        char  *ns;
+        x = NULL;
+        while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL){
+            ns = NULL;
+            if (xml2ns(x, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, &ns) < 0)
+                goto done;
+            if (ns == NULL){
+                if (xmlns_set(x, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) < 0)
+                    goto done;
+            }
+            else if (strcmp(ns, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) != 0){
+                /* XXX: Assume if namespace is set that it is withdefaults otherwise just ignore?  */
+                    continue;
+            }
+        }
+        /* Mark nodes having default schema values */
+        if (xml_apply(xt, CX_ELMNT, (xml_applyfn_t*) xml_flag_default_value, (void*) XML_FLAG_MARK) < 0)
+            goto done;
+        /* Add tag attributes to default nodes */
+        if (xml_apply(xt, CX_ELMNT, (xml_applyfn_t*) xml_add_default_tag, (void*) (XML_FLAG_DEFAULT | XML_FLAG_MARK)) < 0)
+            goto done;
+        break;
+    }
+    } /* switch wdef */
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Read module-state in an XML tree
  *
  * @param[in]  th     Datastore text handle
@@ -825,6 +1012,7 @@ xmldb_get_nocache(clicon_handle    h,
  * @param[in]  nsc    External XML namespace context, or NULL
  * @param[in]  xpath  String with XPATH syntax. or NULL for all
  * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @param[in]  depth  Levels below the top-level nodes to copy, or -1 for all
  * @param[out] xtop   Single return XML tree. Free with xml_free()
  * @param[out] msdiff If set, return modules-state differences
  * @param[out] xerr   XML error if retval is 0
@@ -841,6 +1029,7 @@ xmldb_get_cache(clicon_handle     h,
                 cvec             *nsc,
                 const char       *xpath,
                 withdefaults_type wdef,
+                int32_t           depth,
                 cxobj           **xtop,
                 modstate_diff_t  *msdiff,
                 cxobj           **xerr)
@@ -857,6 +1046,7 @@ xmldb_get_cache(clicon_handle     h,
     cxobj     *x1t = NULL;
     db_elmnt   de0 = {0,};
     int        ret;
+    int        defaults = 0; /* 1: Defaults added to cache, 2: to copy only */
 
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
         clicon_err(OE_YANG, ENOENT, "No yang spec");
@@ -887,6 +1077,19 @@ xmldb_get_cache(clicon_handle     h,
         if (ret == 0)
             ; /* XXX */
         else {
+            /* Defaults are not added to the cache if they do not change the xpath
+             * selection: all is selected, or defaults are not reported */
+            if (xpath == NULL || strcmp(xpath, "/") == 0)
+                defaults = 2;
+            else if (wdef == WITHDEFAULTS_EXPLICIT || wdef == WITHDEFAULTS_TRIM){
+                if ((ret = xml_defaults_xpath_independent(xpath, nsc, yspec)) < 0)
+                    goto done;
+                defaults = ret?2:1;
+            }
+            else
+                defaults = 1;
+        }
+        if (defaults == 1){
             /* Add default global values (to make xpath below include defaults) */
             if (xml_global_defaults(h, x0t, nsc, xpath, yspec, 0) < 0)
                 goto done;
@@ -913,14 +1116,15 @@ xmldb_get_cache(clicon_handle     h,
     xml_flag_set(x1t, XML_FLAG_TOP);    
     xml_spec_set(x1t, xml_spec(x0t));
     
-    if (xlen < 1000){
+    if (xlen < 1000 || depth != -1){
         /* This is optimized for the case when the tree is large and xlen is small
          * If the tree is large and xlen too, then the other is better.
          * This only works if yang bind
+         * With depth, only the levels that are printed are copied
          */
         for (i=0; i<xlen; i++){
             x0 = xvec[i];
-            if (xml_copy_from_bottom(x0t, x0, x1t) < 0) /* config */
+            if (xml_copy_from_bottom(x0t, x0, x1t, depth, wdef) < 0) /* config */
                 goto done;
         }
     }
@@ -941,52 +1145,20 @@ xmldb_get_cache(clicon_handle     h,
         if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
             goto done;
     }
-    /* Original tree: Remove global defaults and empty non-presence containers */
-    if (xml_defaults_nopresence(x0t, 2) < 0)
-        goto done;
-    switch (wdef){
-    case WITHDEFAULTS_REPORT_ALL:
-        break;
-    case WITHDEFAULTS_TRIM:
-        /* Mark and remove nodes having schema default values */
-        if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*) xml_flag_default_value, (void*) XML_FLAG_MARK) < 0)
-            goto done;
-        if (xml_tree_prune_flags(x1t, XML_FLAG_MARK, XML_FLAG_MARK)
-            < 0)
-            goto done;        
-        if (xml_defaults_nopresence(x1t, 1) < 0)
-            goto done;
-        break;
-    case WITHDEFAULTS_EXPLICIT:
-        if (xml_defaults_nopresence(x1t, 2) < 0)
-            goto done;
-        break;
-    case WITHDEFAULTS_REPORT_ALL_TAGGED:{
-        cxobj *x;
-        char  *ns;
-        x = NULL;
-        while ((x = xml_child_each(x1t, x, CX_ELMNT)) != NULL){
-            ns = NULL;
-            if (xml2ns(x, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, &ns) < 0)
+    if (defaults == 2){
+        /* Add defaults to the copy only, if they are reported */
+        if (wdef == WITHDEFAULTS_REPORT_ALL || wdef == WITHDEFAULTS_REPORT_ALL_TAGGED){
+            if (xml_global_defaults(h, x1t, nsc, xpath, yspec, 0) < 0)
+                goto done;
+            if (xml_default_recurse(x1t, 0) < 0)
                 goto done;
-            if (ns == NULL){
-                if (xmlns_set(x, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) < 0)
-                    goto done;
-            }
-            else if (strcmp(ns, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) != 0){
-                /* XXX: Assume if namespace is set that it is withdefaults otherwise just ignore?  */
-                    continue;
-            }
         }
-        /* Mark nodes having default schema values */
-        if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*) xml_flag_default_value, (void*) XML_FLAG_MARK) < 0)
-            goto done;
-        /* Add tag attributes to default nodes */
-        if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*) xml_add_default_tag, (void*) (XML_FLAG_DEFAULT | XML_FLAG_MARK)) < 0)
-            goto done;
-        break;
     }
-    } /* switch wdef */
+    /* Original tree: Remove global defaults and empty non-presence containers */
+    else if (xml_defaults_nopresence(x0t, 2) < 0)
+        goto done;
+    if (xmldb_get_wdef(x1t, wdef) < 0)
+        goto done;
     /* If empty NACM config, then disable NACM if loaded
      */
     if (clicon_option_bool(h, "CLICON_NACM_DISABLED_ON_EMPTY")){
@@ -1276,13 +1448,58 @@ xmldb_get0(clicon_handle    h,
          * Add default values in copy, return copy
          * Copy deleted by xmldb_free
          */
-        retval = xmldb_get_cache(h, db, yb, nsc, xpath, wdef, xret, msdiff, xerr);
+        retval = xmldb_get_cache(h, db, yb, nsc, xpath, wdef, -1, xret, msdiff, xerr);
         break;
     }
  done:
     return retval;
 }
 
+/*! Get a copy of content of database limited to a depth
+ *
+ * As xmldb_get0 with copy, but only the levels of the matching sub-trees that are
+ * printed with depth are copied from the cache, see xml_copy_depth.
+ * Since the copy is limited, the xpath can not be evaluated again on the returned tree.
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Name of datastore, eg "running"
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xpath  String with XPATH syntax. or NULL for all
+ * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @param[in]  depth  Levels below the top-level nodes to copy
+ * @param[out] xret   Single return XML tree. Free with xml_free()
+ * @retval     1      OK
+ * @retval     0      No cache, or datastore can not be bound, use xmldb_get0 instead
+ * @retval    -1      Error
+ * @see xmldb_get0
+ */
+int
+xmldb_get0_depth(clicon_handle     h,
+                 const char       *db,
+                 cvec             *nsc,
+                 const char       *xpath,
+                 withdefaults_type wdef,
+                 int32_t           depth,
+                 cxobj           **xret)
+{
+    int    retval = -1;
+    cxobj *xerr = NULL;
+
+    if (xret == NULL){
+        clicon_err(OE_DB, EINVAL, "xret is NULL");
+        goto done;
+    }
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE || depth < 0)
+        goto fail;
+    retval = xmldb_get_cache(h, db, YB_MODULE, nsc, xpath, wdef, depth, xret, NULL, &xerr);
+ done:
+    if (xerr)
+        xml_free(xerr);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Clear cached xml tree obtained with xmldb_get0, if zerocopy
  *
  * @param[in]  h    Clicon handle
@@ -1335,3 +1552,116 @@ xmldb_get0_free(clicon_handle    h,
     return 0;
 }
 
+
+/*! Get the cached tree of a datastore bound to YANG, read it from file if not cached
+ *
+ * The tree is the cache itself and must not be modified or freed. It is valid until the
+ * datastore generation changes, see xmldb_generation.
+ * The cache is bound and default values are added to it once per generation. As in
+ * xmldb_get_cache, the defaults are kept in the cache.
+ * @param[in]  h      Clixon handle
+ * @param[in]  db     Name of database
+ * @param[out] xtp    Cached top of tree, <config>...</config>
+ * @retval     1      OK, xtp set
+ * @retval     0      No cache, or datastore can not be bound, use xmldb_get0 instead
+ * @retval    -1      Error
+ * @see xmldb_get0_vec  To copy parts of the cached tree
+ */
+int
+xmldb_cache_bind(clicon_handle h,
+                 const char   *db,
+                 cxobj       **xtp)
+{
+    int        retval = -1;
+    yang_stmt *yspec;
+    db_elmnt  *de;
+    db_elmnt   de0 = {0,};
+    cxobj     *x0t = NULL;
+    cxobj     *xerr = NULL;
+    int        ret;
+
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE)
+        goto fail;
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+        clicon_err(OE_YANG, ENOENT, "No yang spec");
+        goto done;
+    }
+    de = clicon_db_elmnt_get(h, db);
+    if (de == NULL || de->de_xml == NULL){
+        if ((ret = xmldb_readfile(h, db, YB_MODULE, yspec, &x0t, &de0, NULL, &xerr)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+        de0.de_xml = x0t;
+        if (de)
+            de0.de_id = de->de_id;
+        clicon_db_elmnt_set(h, db, &de0); /* Content is copied */
+        if ((de = clicon_db_elmnt_get(h, db)) == NULL){
+            clicon_err(OE_CFG, EFAULT, "datastore %s does not exist", db);
+            goto done;
+        }
+    }
+    else
+        x0t = de->de_xml;
+    if (de->de_gen == 0 || de->de_bound != de->de_gen){
+        if ((ret = xml_bind_yang(h, x0t, YB_MODULE, yspec, NULL)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+        if (xml_default_recurse(x0t, 0) < 0)
+            goto done;
+        de->de_bound = de->de_gen;
+    }
+    *xtp = x0t;
+    retval = 1;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Copy a vector of nodes in the cached tree, with their ancestors, to a new tree
+ *
+ * The nodes are copied in vector order, not in tree order. This is used to return
+ * list entries in the order of a sorted or reversed index.
+ * @param[in]  h      Clixon handle
+ * @param[in]  x0t    Cached top of tree, see xmldb_cache_bind
+ * @param[in]  xvec   Nodes in x0t to copy
+ * @param[in]  xlen   Length of xvec
+ * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @param[out] xtop   New tree. Free with xml_free()
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+xmldb_get0_vec(clicon_handle     h,
+               cxobj            *x0t,
+               cxobj           **xvec,
+               size_t            xlen,
+               withdefaults_type wdef,
+               cxobj           **xtop)
+{
+    int        retval = -1;
+    cxobj     *x1t = NULL;
+    int        i;
+
+    if ((x1t = xml_new(xml_name(x0t), NULL, CX_ELMNT)) == NULL)
+        goto done;
+    xml_flag_set(x1t, XML_FLAG_TOP);
+    xml_spec_set(x1t, xml_spec(x0t));
+    for (i=0; i<xlen; i++)
+        if (xml_copy_from_bottom(x0t, xvec[i], x1t, -1, wdef) < 0)
+            goto done;
+    if (xmldb_get_wdef(x1t, wdef) < 0)
+        goto done;
+    *xtop = x1t;
+    x1t = NULL;
+    retval = 0;
+ done:
+    if (x1t)
+        xml_free(x1t);
+    return retval;
+}
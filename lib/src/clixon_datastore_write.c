@@ -1218,6 +1218,7 @@ xmldb_put(clicon_handle       h,
     if ((de = clicon_db_elmnt_get(h, db)) != NULL){
         if (clicon_datastore_cache(h) != DATASTORE_NOCACHE)
             x0 = de->de_xml; /* XXX flag is not XML_FLAG_TOP */
+        de->de_gen = 0; /* Modified in place, new generation is set below if OK */
     }
     /* If there is no xml x0 tree (in cache), then read it from file */
     if (x0 == NULL){
@@ -44,14 +44,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <signal.h>
 #include <syslog.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#ifdef HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#else
+#include <sys/select.h>
+#endif
 
 #include <cligen/cligen.h>
 
@@ -60,6 +67,7 @@
 #include "clixon_hash.h"
 #include "clixon_handle.h"
 #include "clixon_err.h"
+#include "clixon_string.h"
 #include "clixon_sig.h"
 #include "clixon_proc.h"
 #include "clixon_event.h"
@@ -69,28 +77,75 @@
  */
 #define EVENT_STRLEN 32
 
+/* Max number of events returned by one epoll_wait */
+#define EVENT_MAXEVENTS 64
+
 /*
  * Types
  */
 struct event_data{
-    struct event_data *e_next;     /* next in list */
+    struct event_data *e_next;     /* next in removed or deferred list */
     int (*e_fn)(int, void*);            /* function */
     enum {EVENT_FD, EVENT_TIME} e_type;        /* type of event */
     int e_fd;                      /* File descriptor */
     struct timeval e_time;         /* Timeout */
     void *e_arg;                   /* function argument */
     char e_string[EVENT_STRLEN];             /* string for debugging */
+    struct event_data *e_fdnext;   /* next registration of same fd, see ee_fdvec */
+    uint64_t e_seq;                /* Registration order */
+    int e_always;                  /* fd cannot be polled (eg regular file), always ready */
+    int e_removed;                 /* Unregistered, free at end of loop pass */
+    int e_stat;                    /* Index in ee_stats of callback statistics */
+    int e_write;                   /* Call when fd is writable, else when readable */
+};
+
+/* Runtime statistics per callback name */
+struct event_stat{
+    char     es_name[EVENT_STRLEN]; /* Name as given at registration */
+    uint64_t es_calls;              /* Number of calls */
+    uint64_t es_runtime;            /* Total runtime in us */
+    uint64_t es_max;                /* Max runtime of one call in us */
 };
 
 /*
  * Internal variables
  * XXX consider use handle variables instead of global
  */
-static struct event_data *ee = NULL;
-static struct event_data *ee_timers = NULL;
+/* File descriptor registrations indexed by fd, chained by e_fdnext */
+static struct event_data **ee_fdvec = NULL;
+static int ee_fdlen = 0;
+
+/* Number of registrations with e_always set */
+static int ee_always = 0;
+
+/* Timers as binary min-heap ordered on (e_time, e_seq) */
+static struct event_data **ee_heap = NULL;
+static int ee_heaplen = 0;
+static int ee_heapmax = 0;
+static uint64_t ee_seq = 0;
+
+/* Expired timers registered during event_timers_run, set aside from the heap, see e_next */
+static struct event_data *ee_deferred = NULL;
+
+#ifdef HAVE_EPOLL_CREATE1
+/* Epoll instance, created at first fd registration */
+static int ee_epfd = -1;
+#endif
+
+/* Unregistered fd registrations, freed at end of loop pass since they may be in dispatch */
+static struct event_data *ee_removed = NULL;
 
-/* Set if element in ee is deleted (clixon_event_unreg_fd). Check in ee loops */
-static int _ee_unreg = 0;
+/* Round-robin start position of fd dispatch */
+static unsigned int ee_rr = 0;
+
+/* Event loop statistics */
+static struct event_stat *ee_stats = NULL;
+static int ee_statslen = 0;
+static uint64_t ee_passes = 0;
+static uint64_t ee_pass_max = 0;
+static uint64_t ee_timer_calls = 0;
+static uint64_t ee_timer_late_max = 0;
+static uint64_t ee_timer_late_total = 0;
 
 /* If set (eg by signal handler) exit select loop on next run and return 0 */
 static int _clicon_exit = 0;
@@ -161,6 +216,204 @@ clicon_sig_ignore_get(void)
     return _clicon_sig_ignore;
 }
 
+#ifdef HAVE_EPOLL_CREATE1
+/*! Set epoll interest of fd to input and/or output as given by its registrations
+ * @param[in]  fd   File descriptor
+ * @param[in]  op   EPOLL_CTL_ADD or EPOLL_CTL_MOD
+ * @retval     0    OK
+ * @retval    -1    Error, errno set
+ */
+static int
+event_epoll_ctl(int fd,
+                int op)
+{
+    struct epoll_event  ev = {0,};
+    struct event_data  *e;
+
+    for (e = ee_fdvec[fd]; e; e = e->e_fdnext)
+        ev.events |= e->e_write ? EPOLLOUT : EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(ee_epfd, op, fd, &ev);
+}
+#endif
+
+/*! Add fd registration to fd index, and to epoll instance if first registration of fd
+ * @param[in]  e   Event registration
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+event_fd_add(struct event_data *e)
+{
+    int                 fd = e->e_fd;
+    int                 len;
+    int                 first;
+
+    if (fd < 0){
+        clicon_err(OE_EVENTS, EBADF, "fd %d", fd);
+        return -1;
+    }
+    if (fd >= ee_fdlen){
+        len = ee_fdlen ? ee_fdlen : 64;
+        while (len <= fd)
+            len *= 2;
+        if ((ee_fdvec = realloc(ee_fdvec, len*sizeof(*ee_fdvec))) == NULL){
+            clicon_err(OE_EVENTS, errno, "realloc");
+            return -1;
+        }
+        memset(&ee_fdvec[ee_fdlen], 0, (len-ee_fdlen)*sizeof(*ee_fdvec));
+        ee_fdlen = len;
+    }
+    if ((first = (ee_fdvec[fd] == NULL)) == 0)
+        e->e_always = ee_fdvec[fd]->e_always;
+    e->e_fdnext = ee_fdvec[fd];
+    ee_fdvec[fd] = e;
+#ifdef HAVE_EPOLL_CREATE1
+    if (first){
+        if (ee_epfd == -1 && (ee_epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+            clicon_err(OE_EVENTS, errno, "epoll_create1");
+            goto fail;
+        }
+        if (event_epoll_ctl(fd, EPOLL_CTL_ADD) < 0){
+            if (errno == EPERM)  /* Eg regular file: always ready as in select */
+                e->e_always = 1;
+            /* Still in epoll set, eg fd was closed and reused while a dup was open:
+             * replace its interest */
+            else if (errno != EEXIST || event_epoll_ctl(fd, EPOLL_CTL_MOD) < 0){
+                clicon_err(OE_EVENTS, errno, "epoll_ctl");
+                goto fail;
+            }
+        }
+    }
+    else if (!e->e_always && event_epoll_ctl(fd, EPOLL_CTL_MOD) < 0){
+        clicon_err(OE_EVENTS, errno, "epoll_ctl");
+        goto fail;
+    }
+#endif
+    if (e->e_always)
+        ee_always++;
+    return 0;
+#ifdef HAVE_EPOLL_CREATE1
+ fail:
+    ee_fdvec[fd] = e->e_fdnext;
+    return -1;
+#endif
+}
+
+/*! Remove fd registration from fd index, and from epoll instance if last registration
+ * @param[in]  e   Event registration
+ */
+static int
+event_fd_rm(struct event_data *e)
+{
+    struct event_data **ep;
+
+    if (e->e_fd < 0 || e->e_fd >= ee_fdlen)
+        return 0;
+    for (ep = &ee_fdvec[e->e_fd]; *ep; ep = &(*ep)->e_fdnext)
+        if (*ep == e){
+            *ep = e->e_fdnext;
+            break;
+        }
+    if (e->e_always)
+        ee_always--;
+#ifdef HAVE_EPOLL_CREATE1
+    /* fd may already be closed, which also removes it from the epoll set */
+    if (ee_epfd != -1 && !e->e_always){
+        if (ee_fdvec[e->e_fd] == NULL)
+            epoll_ctl(ee_epfd, EPOLL_CTL_DEL, e->e_fd, NULL);
+        else
+            event_epoll_ctl(e->e_fd, EPOLL_CTL_MOD);
+    }
+#endif
+    return 0;
+}
+
+/*! Find or create statistics entry of a callback name
+ * @param[in]  name  Name of callback as given at registration
+ * @retval     i     Index in ee_stats
+ * @retval    -1     Error
+ */
+static int
+event_stat_find(char *name)
+{
+    int i;
+
+    for (i=0; i<ee_statslen; i++)
+        if (strncmp(ee_stats[i].es_name, name, EVENT_STRLEN-1) == 0)
+            return i;
+    if ((ee_stats = realloc(ee_stats, (ee_statslen+1)*sizeof(*ee_stats))) == NULL){
+        clicon_err(OE_EVENTS, errno, "realloc");
+        return -1;
+    }
+    memset(&ee_stats[ee_statslen], 0, sizeof(*ee_stats));
+    strncpy(ee_stats[ee_statslen].es_name, name, EVENT_STRLEN-1);
+    return ee_statslen++;
+}
+
+/*! Call an fd or timeout callback and account its runtime
+ * @param[in]  e    Event registration
+ * @param[in]  fd   File descriptor, or 0 for timeouts
+ * @param[in]  t0   Time of call
+ * @retval     0    OK
+ * @retval    -1    Error in callback
+ */
+static int
+event_call(struct event_data *e,
+           int                fd,
+           struct timeval    *t0)
+{
+    int                retval;
+    struct timeval     t1;
+    struct event_stat *es;
+    uint64_t           us;
+
+    retval = (*e->e_fn)(fd, e->e_arg);
+    gettimeofday(&t1, NULL);
+    timersub(&t1, t0, &t1);
+    us = t1.tv_sec*1000000 + t1.tv_usec;
+    es = &ee_stats[e->e_stat];
+    es->es_calls++;
+    es->es_runtime += us;
+    if (us > es->es_max)
+        es->es_max = us;
+    return retval;
+}
+
+/*! Register a callback function to be called when a file descriptor is readable or writable
+ * @see clixon_event_reg_fd
+ * @see clixon_event_reg_fd_write
+ */
+static int
+event_reg_fd(int   fd, 
+             int (*fn)(int, void*), 
+             void *arg, 
+             char *str,
+             int   write)
+{
+    struct event_data *e;
+
+    if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
+        clicon_err(OE_EVENTS, errno, "malloc");
+        return -1;
+    }
+    memset(e, 0, sizeof(struct event_data));
+    strncpy(e->e_string, str, EVENT_STRLEN-1);
+    e->e_fd = fd;
+    e->e_fn = fn;
+    e->e_arg = arg;
+    e->e_type = EVENT_FD;
+    e->e_write = write;
+    e->e_seq = ee_seq++;
+    if ((e->e_stat = event_stat_find(str)) < 0 ||
+        event_fd_add(e) < 0){
+        free(e);
+        return -1;
+    }
+    clicon_debug(CLIXON_DBG_DETAIL, "%s, registering %s", __FUNCTION__, e->e_string);
+    return 0;
+}
+
 /*! Register a callback function to be called on input on a file descriptor.
  *
  * @param[in]  fd  File descriptor
@@ -180,28 +433,34 @@ clixon_event_reg_fd(int   fd,
                     void *arg, 
                     char *str)
 {
-    struct event_data *e;
+    return event_reg_fd(fd, fn, arg, str, 0);
+}
 
-    if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
-        clicon_err(OE_EVENTS, errno, "malloc");
-        return -1;
-    }
-    memset(e, 0, sizeof(struct event_data));
-    strncpy(e->e_string, str, EVENT_STRLEN-1);
-    e->e_fd = fd;
-    e->e_fn = fn;
-    e->e_arg = arg;
-    e->e_type = EVENT_FD;
-    e->e_next = ee;
-    ee = e;
-    clicon_debug(CLIXON_DBG_DETAIL, "%s, registering %s", __FUNCTION__, e->e_string);
-    return 0;
+/*! Register a callback function to be called when a file descriptor is writable
+ *
+ * Used to drain output queued on a non-blocking socket. The callback is called in every
+ * loop pass while the fd is writable, unregister it when the output queue is empty.
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @see clixon_event_unreg_fd  also for unregistering write callbacks
+ */
+int
+clixon_event_reg_fd_write(int   fd, 
+                          int (*fn)(int, void*), 
+                          void *arg, 
+                          char *str)
+{
+    return event_reg_fd(fd, fn, arg, str, 1);
 }
 
 /*! Deregister a file descriptor callback
  * @param[in]  s   File descriptor
  * @param[in]  fn  Function to call when input available on fd
  * Note: deregister when exactly function and socket match, not argument
+ * Only the registrations of the fd are searched, see ee_fdvec
+ * The registration may be in dispatch and is freed at the end of the loop pass
  * @see clixon_event_reg_fd
  * @see clixon_event_unreg_timeout
  */
@@ -209,21 +468,80 @@ int
 clixon_event_unreg_fd(int   s, 
                       int (*fn)(int, void*))
 {
-    struct event_data *e, **e_prev;
-    int found = 0;
-
-    e_prev = &ee;
-    for (e = ee; e; e = e->e_next){
-        if (fn == e->e_fn && s == e->e_fd) {
-            found++;
-            *e_prev = e->e_next;
-            _ee_unreg++;
-            free(e);
+    struct event_data *e;
+
+    if (s < 0 || s >= ee_fdlen)
+        return -1;
+    for (e = ee_fdvec[s]; e; e = e->e_fdnext)
+        if (fn == e->e_fn)
             break;
-        }
-        e_prev = &e->e_next;
+    if (e == NULL)
+        return -1;
+    event_fd_rm(e);
+    e->e_removed = 1;
+    e->e_next = ee_removed;
+    ee_removed = e;
+    return 0;
+}
+
+/*! Timer heap order: earliest timeout first, then in registration order
+ */
+static int
+event_timer_before(struct event_data *e1,
+                   struct event_data *e2)
+{
+    if (timercmp(&e1->e_time, &e2->e_time, !=))
+        return timercmp(&e1->e_time, &e2->e_time, <);
+    return e1->e_seq < e2->e_seq;
+}
+
+static void
+event_heap_up(int i)
+{
+    struct event_data *e = ee_heap[i];
+    int                p;
+
+    while (i > 0){
+        p = (i-1)/2;
+        if (!event_timer_before(e, ee_heap[p]))
+            break;
+        ee_heap[i] = ee_heap[p];
+        i = p;
+    }
+    ee_heap[i] = e;
+}
+
+static void
+event_heap_down(int i)
+{
+    struct event_data *e = ee_heap[i];
+    int                c;
+
+    while ((c = 2*i+1) < ee_heaplen){
+        if (c+1 < ee_heaplen && event_timer_before(ee_heap[c+1], ee_heap[c]))
+            c++;
+        if (!event_timer_before(ee_heap[c], e))
+            break;
+        ee_heap[i] = ee_heap[c];
+        i = c;
+    }
+    ee_heap[i] = e;
+}
+
+/*! Remove timer at heap index i
+ * @retval  e  Removed timer
+ */
+static struct event_data *
+event_heap_rm(int i)
+{
+    struct event_data *e = ee_heap[i];
+
+    if (--ee_heaplen > i){
+        ee_heap[i] = ee_heap[ee_heaplen];
+        event_heap_down(i);
+        event_heap_up(i);
     }
-    return found?0:-1;
+    return e;
 }
 
 /*! Call a callback function at an absolute time
@@ -256,32 +574,35 @@ clixon_event_reg_timeout(struct timeval t,
 {
     int                 retval = -1;
     struct event_data  *e;
-    struct event_data  *e1;
-    struct event_data **e_prev;
 
     if (str == NULL || fn == NULL){
         clicon_err(OE_CFG, EINVAL, "str or fn is NULL");
         goto done;
     }
+    if (ee_heaplen >= ee_heapmax){
+        ee_heapmax = ee_heapmax ? 2*ee_heapmax : 64;
+        if ((ee_heap = realloc(ee_heap, ee_heapmax*sizeof(*ee_heap))) == NULL){
+            clicon_err(OE_EVENTS, errno, "realloc");
+            goto done;
+        }
+    }
     if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
         clicon_err(OE_EVENTS, errno, "malloc");
         return -1;
     }
     memset(e, 0, sizeof(struct event_data));
     strncpy(e->e_string, str, EVENT_STRLEN-1);
+    if ((e->e_stat = event_stat_find(str)) < 0){
+        free(e);
+        goto done;
+    }
     e->e_fn = fn;
     e->e_arg = arg;
     e->e_type = EVENT_TIME;
     e->e_time = t;
-    /* Sort into right place */
-    e_prev = &ee_timers;
-    for (e1=ee_timers; e1; e1=e1->e_next){
-        if (timercmp(&e->e_time, &e1->e_time, <))
-            break;
-        e_prev = &e1->e_next;
-    }
-    e->e_next = e1;
-    *e_prev = e;
+    e->e_seq = ee_seq++;
+    ee_heap[ee_heaplen++] = e;
+    event_heap_up(ee_heaplen-1);
     clicon_debug(CLIXON_DBG_DETAIL, "%s: %s", __FUNCTION__, str); 
     retval = 0;
  done:
@@ -292,6 +613,7 @@ clixon_event_reg_timeout(struct timeval t,
  * Note: deregister when exactly function and function arguments match, not time. So you
  * cannot have same function and argument callback on different timeouts. This is a little
  * different from clixon_event_unreg_fd.
+ * If several timeouts match, the earliest is removed.
  * @param[in]  fn   Function to call at time t
  * @param[in]  arg  Argument to function fn
  * @retval     0    OK, timeout unregistered
@@ -303,20 +625,36 @@ int
 clixon_event_unreg_timeout(int (*fn)(int, void*), 
                            void *arg)
 {
-    struct event_data *e, **e_prev;
-    int found = 0;
-
-    e_prev = &ee_timers;
-    for (e = ee_timers; e; e = e->e_next){
-        if (fn == e->e_fn && arg == e->e_arg) {
-            found++;
-            *e_prev = e->e_next;
-            free(e);
-            break;
-        }
-        e_prev = &e->e_next;
+    struct event_data  *e;
+    struct event_data **ep;
+    struct event_data **dfound = NULL;
+    int                 i;
+    int                 found = -1;
+
+    /* Timers set aside by a running event_timers_run */
+    for (ep = &ee_deferred; *ep; ep = &(*ep)->e_next){
+        e = *ep;
+        if (fn == e->e_fn && arg == e->e_arg &&
+            (dfound == NULL || event_timer_before(e, *dfound)))
+            dfound = ep;
+    }
+    for (i=0; i<ee_heaplen; i++){
+        e = ee_heap[i];
+        if (fn == e->e_fn && arg == e->e_arg &&
+            (found == -1 || event_timer_before(e, ee_heap[found])) &&
+            (dfound == NULL || event_timer_before(e, *dfound)))
+            found = i;
+    }
+    if (found != -1)
+        free(event_heap_rm(found));
+    else if (dfound != NULL){
+        e = *dfound;
+        *dfound = e->e_next;
+        free(e);
     }
-    return found?0:-1;
+    else
+        return -1;
+    return 0;
 }
 
 /*! Poll to see if there is any data available on this file descriptor.
@@ -328,59 +666,227 @@ clixon_event_unreg_timeout(int (*fn)(int, void*),
 int 
 clixon_event_poll(int fd)
 {
-    int            retval = -1;
-    fd_set         fdset;
-    struct timeval tnull = {0,};
-
-    FD_ZERO(&fdset);
-    FD_SET(fd, &fdset);
-    if ((retval = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull)) < 0)
-        clicon_err(OE_EVENTS, errno, "select");
+    int           retval = -1;
+    struct pollfd pfd = {0,};
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if ((retval = poll(&pfd, 1, 0)) < 0)
+        clicon_err(OE_EVENTS, errno, "poll");
+    return retval;
+}
+
+/*! Call all timers that have expired at the start of the call
+ * Timers registered by the callbacks are not called, even if they have expired,
+ * this is to not starve file descriptors. They are set aside while the heap is
+ * run, so that a re-armed timer at the top of the heap does not block older
+ * expired timers, and are called in the next loop pass.
+ * @retval   0   OK
+ * @retval  -1   Error in callback
+ */
+static int
+event_timers_run(void)
+{
+    int                retval = -1;
+    struct event_data *e;
+    struct timeval     now;
+    struct timeval     t;
+    uint64_t           seq;
+    uint64_t           late;
+    int                ret;
+
+    gettimeofday(&now, NULL);
+    seq = ee_seq;
+    while (ee_heaplen > 0 &&
+           timercmp(&ee_heap[0]->e_time, &now, <=)){
+        e = event_heap_rm(0);
+        if (e->e_seq >= seq){ /* Registered during this call */
+            e->e_next = ee_deferred;
+            ee_deferred = e;
+            continue;
+        }
+        clicon_debug(CLIXON_DBG_DETAIL, "%s timeout: %s", __FUNCTION__, e->e_string);
+        gettimeofday(&t, NULL);
+        ee_timer_calls++;
+        if (timercmp(&t, &e->e_time, >)){
+            timersub(&t, &e->e_time, &now);
+            late = now.tv_sec*1000000 + now.tv_usec;
+            ee_timer_late_total += late;
+            if (late > ee_timer_late_max)
+                ee_timer_late_max = late;
+        }
+        now = t;
+        ret = event_call(e, 0, &t);
+        free(e);
+        if (ret < 0)
+            goto done;
+        if (clixon_exit_get() == 1)
+            break;
+    }
+    retval = 0;
+ done:
+    /* Heap has room: deferred timers were removed from it */
+    while ((e = ee_deferred) != NULL){
+        ee_deferred = e->e_next;
+        e->e_next = NULL;
+        ee_heap[ee_heaplen++] = e;
+        event_heap_up(ee_heaplen-1);
+    }
     return retval;
 }
 
+/*! Check if the earliest timeout has expired
+ */
+static int
+event_timer_expired(void)
+{
+    struct timeval now;
+
+    if (ee_heaplen == 0)
+        return 0;
+    gettimeofday(&now, NULL);
+    return timercmp(&ee_heap[0]->e_time, &now, <=);
+}
+
+/*! Call the callbacks of a file descriptor that is readable and/or writable
+ * Registrations made or removed after the start of the pass are not called, the fd number may
+ * have been reused.
+ * @param[in]  fd   File descriptor
+ * @param[in]  seq  Registration sequence number at start of loop pass
+ * @param[in]  rd   fd is readable (or has error or hangup)
+ * @param[in]  wr   fd is writable (or has error or hangup)
+ * @retval     0    OK
+ * @retval    -1    Error in callback
+ */
+static int
+event_fd_dispatch(int      fd,
+                  uint64_t seq,
+                  int      rd,
+                  int      wr)
+{
+    struct event_data *e;
+    struct timeval     t0;
+
+    if (fd < 0 || fd >= ee_fdlen)
+        return 0;
+    for (e = ee_fdvec[fd]; e; e = e->e_fdnext){
+        if (e->e_removed || e->e_seq >= seq)
+            continue;
+        if (!(e->e_write ? wr : rd))
+            continue;
+        if (clixon_exit_get() == 1)
+            break;
+        clicon_debug(CLIXON_DBG_DETAIL, "%s: FD_ISSET: %s", __FUNCTION__, e->e_string);
+        gettimeofday(&t0, NULL);
+        if (event_call(e, e->e_fd, &t0) < 0){
+            clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*! Free registrations removed during a loop pass
+ */
+static void
+event_removed_free(void)
+{
+    struct event_data *e;
+
+    while ((e = ee_removed) != NULL){
+        ee_removed = e->e_next;
+        free(e);
+    }
+}
+
 /*! Dispatch file descriptor events (and timeouts) by invoking callbacks.
  *
+ * File descriptors are polled with epoll where available, else with select.
+ * Scheduling in each loop pass:
+ * - All expired timers are called first
+ * - The callbacks of each ready file descriptor are called at most once, starting at a
+ *   round-robin position, so that one busy client cannot starve others
+ * - Expired timers are also called in between file descriptor callbacks, so that timers
+ *   are serviced also under sustained load
  * @param[in] h  Clixon handle
  * @retval    0  OK
  * @retval   -1  Error: eg select, callback, timer, 
- * @note There is an issue with fairness between timeouts and events
- *       Currently a socket that is not read/emptied properly starve timeouts.
- *       One could try to poll the file descriptors after a timeout?
+ * @see clixon_event_stats  for loop latency and callback runtime statistics
  */
 int
 clixon_event_loop(clicon_handle h)
 {
-    struct event_data *e;
-    struct event_data *e_next;
     int                n;
+    int                i;
+    int                fd;
     struct timeval     t;
     struct timeval     t0;
+    uint64_t           seq;
+    uint64_t           us;
+#ifdef HAVE_EPOLL_CREATE1
+    struct epoll_event events[EVENT_MAXEVENTS];
+    int                ms;
+    int                rd;
+    int                wr;
+#else
     struct timeval     tnull = {0,};
     fd_set             fdset;
+    fd_set             wrset;
+    struct event_data *e;
+#endif
     int                retval = -1;
 
     while (clixon_exit_get() != 1){
-        FD_ZERO(&fdset);
         if (clicon_sig_child_get()){
             /* Go through processes and wait for child processes */
             if (clixon_process_waitpid(h) < 0)
                 goto err;
             clicon_sig_child_set(0);
         }
-        for (e=ee; e; e=e->e_next)
-            if (e->e_type == EVENT_FD)
-                FD_SET(e->e_fd, &fdset);
-        if (ee_timers != NULL){
+        seq = ee_seq;
+        if (ee_heaplen > 0){
             gettimeofday(&t0, NULL);
-            timersub(&ee_timers->e_time, &t0, &t); 
+            timersub(&ee_heap[0]->e_time, &t0, &t);
             if (t.tv_sec < 0)
-                n = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull); 
+                timerclear(&t);
+        }
+#ifdef HAVE_EPOLL_CREATE1
+        if (ee_always)
+            ms = 0;
+        else if (ee_heaplen > 0)  /* Round up to not wake up before timeout */
+            ms = t.tv_sec*1000 + (t.tv_usec+999)/1000;
+        else
+            ms = -1;
+        if (ee_epfd == -1){ /* No file descriptors registered */
+            if (ms == -1){
+                clicon_err(OE_EVENTS, EINVAL, "No events registered");
+                goto err;
+            }
+            n = 0;
+            if (ms > 0 && usleep(ms*1000) < 0)
+                n = -1;
+        }
+        else
+            n = epoll_wait(ee_epfd, events, EVENT_MAXEVENTS, ms);
+#else
+        FD_ZERO(&fdset);
+        FD_ZERO(&wrset);
+        for (i=0; i<ee_fdlen; i++)
+            for (e = ee_fdvec[i]; e; e = e->e_fdnext){
+                if (e->e_write)
+                    FD_SET(i, &wrset);
+                else
+                    FD_SET(i, &fdset);
+            }
+        if (ee_heaplen > 0){
+            if (!timerisset(&t))
+                n = select(FD_SETSIZE, &fdset, &wrset, NULL, &tnull); 
             else
-                n = select(FD_SETSIZE, &fdset, NULL, NULL, &t); 
+                n = select(FD_SETSIZE, &fdset, &wrset, NULL, &t); 
         }
         else
-            n = select(FD_SETSIZE, &fdset, NULL, NULL, NULL);
+            n = select(FD_SETSIZE, &fdset, &wrset, NULL, NULL);
+#endif
         if (clixon_exit_get() == 1){
             break;
         }
@@ -419,37 +925,54 @@ clixon_event_loop(clicon_handle h)
                 clicon_err(OE_EVENTS, errno, "select");
             goto err;
         }
-        if (n==0){ /* Timeout */
-            e = ee_timers;
-            ee_timers = ee_timers->e_next;
-            clicon_debug(CLIXON_DBG_DETAIL, "%s timeout: %s", __FUNCTION__, e->e_string);
-            if ((*e->e_fn)(0, e->e_arg) < 0){
-                free(e);
+        gettimeofday(&t0, NULL);
+        if (ee_heaplen > 0 && event_timers_run() < 0)
+            goto err;
+#ifdef HAVE_EPOLL_CREATE1
+        for (i=0; i<n; i++){
+            if (clixon_exit_get() == 1)
+                break;
+            fd = events[(ee_rr+i)%n].data.fd;
+            rd = (events[(ee_rr+i)%n].events & (EPOLLIN|EPOLLERR|EPOLLHUP)) != 0;
+            wr = (events[(ee_rr+i)%n].events & (EPOLLOUT|EPOLLERR|EPOLLHUP)) != 0;
+            if (event_fd_dispatch(fd, seq, rd, wr) < 0)
+                goto err;
+#else
+        for (i=0; i<ee_fdlen; i++){
+            if (clixon_exit_get() == 1)
+                break;
+            fd = (ee_rr+i)%ee_fdlen;
+            if (n <= 0 || !(FD_ISSET(fd, &fdset) || FD_ISSET(fd, &wrset)))
+                continue;
+            if (event_fd_dispatch(fd, seq, FD_ISSET(fd, &fdset), FD_ISSET(fd, &wrset)) < 0)
+                goto err;
+#endif
+            if (event_timer_expired() && event_timers_run() < 0)
                 goto err;
-            }
-            free(e);
         }
-        _ee_unreg = 0;
-        for (e=ee; e; e=e_next){
-            if (clixon_exit_get() == 1){
+#ifdef HAVE_EPOLL_CREATE1
+        /* Regular files cannot be polled, they are always ready */
+        for (fd=0; ee_always && fd<ee_fdlen; fd++){
+            if (clixon_exit_get() == 1)
                 break;
-            }
-            e_next = e->e_next;
-            if(e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &fdset)){
-                clicon_debug(CLIXON_DBG_DETAIL, "%s: FD_ISSET: %s", __FUNCTION__, e->e_string);
-                if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
-                    clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
-                    goto err;
-                }
-                if (_ee_unreg){
-                    _ee_unreg = 0;
-                    break;
-                }
-            }
+            if (ee_fdvec[fd] == NULL || !ee_fdvec[fd]->e_always)
+                continue;
+            if (event_fd_dispatch(fd, seq, 1, 1) < 0)
+                goto err;
         }
+#endif
+        ee_rr++;
+        event_removed_free();
+        ee_passes++;
+        gettimeofday(&t, NULL);
+        timersub(&t, &t0, &t);
+        us = t.tv_sec*1000000 + t.tv_usec;
+        if (us > ee_pass_max)
+            ee_pass_max = us;
         clixon_exit_decr(); /* If exit is set and > 1, decrement it (and exit when 1) */
         continue;
       err:
+        event_removed_free();
         clicon_debug(1, "%s err", __FUNCTION__);
         break;
     }
@@ -462,19 +985,72 @@ clixon_event_loop(clicon_handle h)
 int
 clixon_event_exit(void)
 {
-    struct event_data *e, *e_next;
+    struct event_data *e;
+    int                i;
     
-    e_next = ee;
-    while ((e = e_next) != NULL){
-        e_next = e->e_next;
-        free(e);
-    }
-    ee = NULL;
-    e_next = ee_timers;
-    while ((e = e_next) != NULL){
-        e_next = e->e_next;
-        free(e);
+    for (i=0; i<ee_fdlen; i++)
+        while ((e = ee_fdvec[i]) != NULL){
+            ee_fdvec[i] = e->e_fdnext;
+            free(e);
+        }
+    event_removed_free();
+    for (i=0; i<ee_heaplen; i++)
+        free(ee_heap[i]);
+    if (ee_heap)
+        free(ee_heap);
+    ee_heap = NULL;
+    ee_heaplen = ee_heapmax = 0;
+    if (ee_fdvec)
+        free(ee_fdvec);
+    ee_fdvec = NULL;
+    ee_fdlen = 0;
+    ee_always = 0;
+    if (ee_stats)
+        free(ee_stats);
+    ee_stats = NULL;
+    ee_statslen = 0;
+#ifdef HAVE_EPOLL_CREATE1
+    if (ee_epfd != -1)
+        close(ee_epfd);
+    ee_epfd = -1;
+#endif
+    return 0;
+}
+
+/*! Print event loop statistics as XML
+ * Times are in microseconds.
+ * @param[in]  cb   CLIgen buffer
+ * @param[in]  ns   Namespace of top element, or NULL
+ * @retval     0    OK
+ * @see clixon-lib.yang rpc stats
+ */
+int
+clixon_event_stats(cbuf *cb,
+                   char *ns)
+{
+    int                i;
+    struct event_stat *es;
+
+    cprintf(cb, "<event-loop");
+    if (ns)
+        cprintf(cb, " xmlns=\"%s\"", ns);
+    cprintf(cb, ">");
+    cprintf(cb, "<passes>%" PRIu64 "</passes>", ee_passes);
+    cprintf(cb, "<pass-max>%" PRIu64 "</pass-max>", ee_pass_max);
+    cprintf(cb, "<timer-calls>%" PRIu64 "</timer-calls>", ee_timer_calls);
+    cprintf(cb, "<timer-late-max>%" PRIu64 "</timer-late-max>", ee_timer_late_max);
+    cprintf(cb, "<timer-late-total>%" PRIu64 "</timer-late-total>", ee_timer_late_total);
+    for (i=0; i<ee_statslen; i++){
+        es = &ee_stats[i];
+        cprintf(cb, "<callback>");
+        cprintf(cb, "<name>");
+        xml_chardata_cbuf_append(cb, es->es_name);
+        cprintf(cb, "</name>");
+        cprintf(cb, "<calls>%" PRIu64 "</calls>", es->es_calls);
+        cprintf(cb, "<runtime>%" PRIu64 "</runtime>", es->es_runtime);
+        cprintf(cb, "<runtime-max>%" PRIu64 "</runtime-max>", es->es_max);
+        cprintf(cb, "</callback>");
     }
-    ee_timers = NULL;
+    cprintf(cb, "</event-loop>");
     return 0;
 }
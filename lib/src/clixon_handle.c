@@ -60,9 +60,14 @@
 #include "clixon_stream.h"
 #include "clixon_data.h"
 #include "clixon_options.h"
+#include "clixon_regex.h"
+#include "clixon_xml_bin.h"
 
 #define CLICON_MAGIC 0x99aafabe
 
+/* Name of exit callback vector in clicon_ptr, see clicon_handle_exit_reg */
+#define HANDLE_EXIT_PTR "handle-exit"
+
 #define handle(h) (assert(clicon_handle_check(h)==0),(struct clicon_handle *)(h))
 
 /*! Internal structure of basic handle. Also header of all other handles.
@@ -145,9 +150,74 @@ clicon_handle_init(void)
     return clicon_handle_init0(sizeof(struct clicon_handle));
 }
 
+/*! Vector of exit callbacks of a handle
+ */
+struct handle_exit {
+    int                     he_len;
+    clicon_handle_exit_cb **he_vec;
+};
+
+/*! Register a callback to free handle data when the handle is deallocated
+ *
+ * Used by modules that keep state in the handle, so that the handle does not depend on
+ * them. Callbacks are called in reverse registration order by clicon_handle_exit, before
+ * handle data is freed. Registering the same callback again has no effect.
+ * @param[in]  h   Clicon handle
+ * @param[in]  fn  Callback
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see clicon_handle_exit
+ */
+int
+clicon_handle_exit_reg(clicon_handle          h,
+                       clicon_handle_exit_cb *fn)
+{
+    struct handle_exit *he = NULL;
+    int                 i;
+
+    if (clicon_ptr_get(h, HANDLE_EXIT_PTR, (void**)&he) < 0 || he == NULL){
+        if ((he = calloc(1, sizeof(*he))) == NULL){
+            clicon_err(OE_UNIX, errno, "calloc");
+            return -1;
+        }
+        if (clicon_ptr_set(h, HANDLE_EXIT_PTR, he) < 0){
+            free(he);
+            return -1;
+        }
+    }
+    for (i=0; i<he->he_len; i++)
+        if (he->he_vec[i] == fn)
+            return 0;
+    if ((he->he_vec = realloc(he->he_vec, (he->he_len+1)*sizeof(*he->he_vec))) == NULL){
+        clicon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    he->he_vec[he->he_len++] = fn;
+    return 0;
+}
+
+/*! Call and free exit callbacks of a handle
+ */
+static void
+handle_exit_call(clicon_handle h)
+{
+    struct handle_exit *he = NULL;
+    int                 i;
+
+    if (clicon_ptr_get(h, HANDLE_EXIT_PTR, (void**)&he) < 0 || he == NULL)
+        return;
+    for (i=he->he_len-1; i>=0; i--)
+        he->he_vec[i](h);
+    if (he->he_vec)
+        free(he->he_vec);
+    free(he);
+    clicon_ptr_del(h, HANDLE_EXIT_PTR);
+}
+
 /*! Deallocate clicon handle, including freeing handle data.
  * @param[in]  h   Clicon handle
  * @Note: handle 'h' cannot be used in calls after this
+ * @see clicon_handle_exit_reg  to free module state kept in the handle
  */
 int
 clicon_handle_exit(clicon_handle h)
@@ -156,6 +226,10 @@ clicon_handle_exit(clicon_handle h)
     struct clicon_handle *ch = handle(h);
     clicon_hash_t        *ha;
 
+    if (clicon_data(h) != NULL)
+        handle_exit_call(h);
+    regex_native_free(h);
+    clixon_bin_exit(h);
     if ((ha = clicon_options(h)) != NULL)
         clicon_hash_free(ha);
     if ((ha = clicon_data(h)) != NULL)
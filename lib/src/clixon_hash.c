@@ -113,6 +113,25 @@ hash_bucket(const char *str)
     return n % HASH_SIZE;
 }
 
+/*! Add a string to a FNV-1a hash
+ *
+ * Start with CLICON_HASH_FNV_INIT. Call again with the result to hash several strings
+ * in sequence. Not used by the clicon_hash tables themselves.
+ * @param[in]  h    Hash so far, or CLICON_HASH_FNV_INIT
+ * @param[in]  str  String to add
+ * @retval     h    Hash including str
+ */
+uint32_t
+clicon_hash_fnv1a(uint32_t    h,
+                  const char *str)
+{
+    while (*str){
+        h ^= (uint8_t)*str++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
 /*! Initialize hash table.
  *
  * @retval  hash  Pointer to new hash table.
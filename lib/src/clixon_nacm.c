@@ -68,6 +68,7 @@
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_yang_module.h"
+#include "clixon_yang_schema_mount.h"
 #include "clixon_datastore.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_xml_map.h"
@@ -311,87 +312,382 @@ nacm_rpc(char         *rpc,
     goto done;
 }
 
+/*---------------------------------------------------------------
+ * Compiled NACM data-node rules
+ */
+
+/* Access operation bit of a compiled rule, see enum nacm_access */
+#define NACM_ACCESS_BIT(a) (1 << (a))
+
+/* Compiled NACM data-node rule
+ * Copied from the NACM XML tree so that it is independent of the tree it is compiled from
+ */
+struct nacm_rule{
+    qelem_t      nr_q;
+    char        *nr_module;   /* module-name, or NULL */
+    char        *nr_action;   /* action, permit or deny */
+    int          nr_access;   /* Access operations, see NACM_ACCESS_BIT */
+    clixon_path *nr_path;     /* Path parsed and bound to YANG, or NULL if rule has no path */
+    int          nr_pathlen;  /* Number of elements of path */
+    int          nr_index;    /* Position of rule in program */
+};
+typedef struct nacm_rule nacm_rule;
+
+/* Decision of a schema node of a compiled program, per access operation
+ * Rules before the barrier match either all or none of the data nodes of a subtree, as
+ * they match its top node. Schema nodes not in the decision map have no barrier.
+ */
+struct nacm_ydecision{
+    yang_stmt *nd_ys;                 /* Schema node */
+    int        nd_barrier[NACM_EXEC]; /* Index of first rule of access that may match part of
+                                       * the subtree, exec is not a data node access */
+};
+typedef struct nacm_ydecision nacm_ydecision;
+
+/* Compiled NACM program of a user: data-node rules of the user's rule-lists in order */
+struct nacm_program{
+    nacm_rule      *np_rules;
+    nacm_ydecision *np_ydec;     /* Decision map sorted on schema node */
+    size_t          np_ydeclen;  /* Length of decision map */
+};
+typedef struct nacm_program nacm_program;
+
+/* Compiled NACM programs keyed by username, valid for one NACM tree
+ * Stored in handle as "nacm_compiled", see nacm_program_get
+ */
+struct nacm_compiled{
+    yang_stmt     *nc_yspec;     /* YANG spec that rule paths are bound to */
+    uint64_t       nc_gen;       /* Generation of NACM tree compiled from, see clicon_nacm_cache_gen */
+    clicon_hash_t *nc_programs;  /* username -> nacm_program* */
+};
+typedef struct nacm_compiled nacm_compiled;
+
 /* Local struct for keeping preparation/compiled data in NACM data path code */
 struct prepvec{
     qelem_t       pv_q;
-    cxobj        *pv_xrule;
+    nacm_rule    *pv_rule;
     clixon_xvec  *pv_xpathvec;
 };
 typedef struct prepvec prepvec;
 
-/*! Delete all Upgrade callbacks
+/*! Free compiled NACM program
  */
-int
-prepvec_free(prepvec *pv_list)
+static int
+nacm_program_free(nacm_program *np)
 {
-    prepvec *pv;
+    nacm_rule *nr;
 
-    while((pv = pv_list) != NULL) {
-        DELQ(pv, pv_list, prepvec *);
-        if (pv->pv_xpathvec)
-            clixon_xvec_free(pv->pv_xpathvec);
-        free(pv);
+    while ((nr = np->np_rules) != NULL) {
+        DELQ(nr, np->np_rules, nacm_rule *);
+        if (nr->nr_module)
+            free(nr->nr_module);
+        if (nr->nr_action)
+            free(nr->nr_action);
+        if (nr->nr_path)
+            clixon_path_free(nr->nr_path);
+        free(nr);
     }
+    if (np->np_ydec)
+        free(np->np_ydec);
+    free(np);
     return 0;
 }
 
-prepvec *
-prepvec_add(prepvec  **pv_listp,
-            cxobj     *xrule)
+/*! Add schema node to decision map, sort it with nacm_ydecision_sort after adding
+ * @param[in]  np       Compiled NACM program
+ * @param[in]  ys       Schema node
+ * @param[in]  barrier  Barrier per access operation, INT_MAX if none
+ */
+static int
+nacm_ydecision_add(nacm_program *np,
+                   yang_stmt    *ys,
+                   int          *barrier)
 {
-    prepvec *pv;
+    nacm_ydecision *nd;
 
-    if ((pv = malloc(sizeof(*pv))) == NULL){
-        clicon_err(OE_UNIX, errno, "malloc");
-        return NULL;
+    if ((nd = realloc(np->np_ydec, (np->np_ydeclen+1)*sizeof(*nd))) == NULL){
+        clicon_err(OE_UNIX, errno, "realloc");
+        return -1;
     }
-    memset(pv, 0, sizeof(*pv));
-    ADDQ(pv, *pv_listp);
-    pv->pv_xrule = xrule;
-    if ((pv->pv_xpathvec = clixon_xvec_new()) == NULL)
-        return NULL;
-    return pv;
+    np->np_ydec = nd;
+    nd = &np->np_ydec[np->np_ydeclen++];
+    nd->nd_ys = ys;
+    memcpy(nd->nd_barrier, barrier, sizeof(nd->nd_barrier));
+    return 0;
 }
 
-/*! Prepare datastructures before running through XML tree
- * Save rules in a "cache"
- * These rules match:
- *  - user/group
- *  - have read access-op, etc
- * Also make instance-id lookups on top object for each rule. Assume at most one result
+/*! Compare decisions on schema node
  */
 static int
-nacm_datanode_prepare(clicon_handle     h,
-                      cxobj            *xt,
-                      enum nacm_access  access,
-                      cxobj           **gvec,
-                      size_t            glen,
-                      cxobj           **rlistvec,
-                      size_t            rlistlen,
-                      cvec             *nsc,
-                      prepvec         **pv_listp)
+nacm_ydecision_cmp(const void *a,
+                   const void *b)
 {
-    int        retval = -1;
-    cxobj     *rlist;
-    int        i;
-    int        j;
-    int        k;
-    char      *gname;
-    cxobj    **rvec = NULL; /* rules */
-    size_t     rlen;    
-    cxobj     *xrule;
-    cxobj     *pathobj;
-    char      *access_operations;
-    char      *path0;         /* Non-canonical path */
-    char      *path=NULL;     /* Canonical path */
-    cvec      *nsc0 = NULL;   /* Non-canonical namespace context */
-    yang_stmt *yspec;
-    cxobj   **xvec = NULL;
-    int       xlen = 0;
-    int       ret;
-    prepvec *pv;
+    uintptr_t ya = (uintptr_t)((const nacm_ydecision *)a)->nd_ys;
+    uintptr_t yb = (uintptr_t)((const nacm_ydecision *)b)->nd_ys;
 
-    yspec = clicon_dbspec_yang(h);
+    return ya < yb ? -1 : ya > yb ? 1 : 0;
+}
+
+/*! Sort decision map and keep the lowest barrier of each schema node and access
+ */
+static int
+nacm_ydecision_sort(nacm_program *np)
+{
+    size_t i;
+    size_t j = 0;
+    int    a;
+
+    if (np->np_ydeclen == 0)
+        return 0;
+    qsort(np->np_ydec, np->np_ydeclen, sizeof(nacm_ydecision), nacm_ydecision_cmp);
+    for (i=1; i<np->np_ydeclen; i++){
+        if (np->np_ydec[i].nd_ys != np->np_ydec[j].nd_ys)
+            np->np_ydec[++j] = np->np_ydec[i];
+        else
+            for (a=0; a<NACM_EXEC; a++)
+                if (np->np_ydec[i].nd_barrier[a] < np->np_ydec[j].nd_barrier[a])
+                    np->np_ydec[j].nd_barrier[a] = np->np_ydec[i].nd_barrier[a];
+    }
+    np->np_ydeclen = j+1;
+    return 0;
+}
+
+/*! Get barrier of a schema node for an access operation
+ * @param[in]  np     Compiled NACM program
+ * @param[in]  ys     Schema node of requested data node
+ * @param[in]  access NACM access, not exec
+ * @retval     i      Index of first rule of access that may match part of the subtree of ys
+ * @retval INT_MAX    All rules match all or none of the subtree
+ */
+static int
+nacm_ydecision_barrier(nacm_program    *np,
+                       yang_stmt       *ys,
+                       enum nacm_access access)
+{
+    nacm_ydecision  key;
+    nacm_ydecision *nd;
+
+    if (np->np_ydeclen == 0)
+        return INT_MAX;
+    key.nd_ys = ys;
+    if ((nd = bsearch(&key, np->np_ydec, np->np_ydeclen, sizeof(nacm_ydecision),
+                      nacm_ydecision_cmp)) == NULL)
+        return INT_MAX;
+    return nd->nd_barrier[access];
+}
+
+/*! Free all compiled NACM programs, but keep the cache itself
+ */
+static int
+nacm_compiled_clear(nacm_compiled *nc)
+{
+    int            retval = -1;
+    char         **keys = NULL;
+    size_t         klen = 0;
+    int            i;
+    nacm_program **npp;
+
+    if (nc->nc_programs){
+        if (clicon_hash_keys(nc->nc_programs, &keys, &klen) < 0)
+            goto done;
+        for (i=0; i<klen; i++)
+            if ((npp = clicon_hash_value(nc->nc_programs, keys[i], NULL)) != NULL)
+                nacm_program_free(*npp);
+        clicon_hash_free(nc->nc_programs);
+        nc->nc_programs = NULL;
+    }
+    nc->nc_yspec = NULL;
+    nc->nc_gen = 0;
+    retval = 0;
+ done:
+    if (keys)
+        free(keys);
+    return retval;
+}
+
+/*! Free compiled NACM programs of all users
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see nacm_program_get
+ */
+int
+nacm_compiled_free(clicon_handle h)
+{
+    nacm_compiled *nc = NULL;
+
+    if (clicon_ptr_get(h, "nacm_compiled", (void**)&nc) < 0 || nc == NULL)
+        return 0;
+    if (nacm_compiled_clear(nc) < 0)
+        return -1;
+    free(nc);
+    return clicon_ptr_del(h, "nacm_compiled");
+}
+
+/*! Add schema nodes whose data subtree has data nodes of other namespaces to decision map
+ * A module-name rule may match only part of the subtree of such a schema node, eg augmented
+ * nodes, or nodes below a mount-point.
+ * @param[in]  np       Compiled NACM program
+ * @param[in]  ys       YANG module, data node, choice or case
+ * @param[in]  ns       Namespace of ys, or of closest data node ancestor
+ * @param[in]  barrier  Index of first rule with module-name other than "*", per access
+ * @retval     1        Data subtree of ys has nodes of other namespaces than ns
+ * @retval     0        No
+ * @retval    -1        Error
+ */
+static int
+nacm_ydecision_mixed(nacm_program *np,
+                     yang_stmt    *ys,
+                     char         *ns,
+                     int          *barrier)
+{
+    int        mixed = 0;
+    yang_stmt *yc = NULL;
+    char      *ycns;
+    int        ret;
+
+    while ((yc = yn_each(ys, yc)) != NULL){
+        ret = 0;
+        switch (yang_keyword_get(yc)){
+        case Y_CHOICE:
+        case Y_CASE:
+            if ((ret = nacm_ydecision_mixed(np, yc, ns, barrier)) < 0)
+                return -1;
+            break;
+        case Y_CONTAINER:
+        case Y_LIST:
+        case Y_LEAF:
+        case Y_LEAF_LIST:
+        case Y_ANYXML:
+        case Y_ANYDATA:
+            ycns = yang_find_mynamespace(yc);
+            if ((ret = nacm_ydecision_mixed(np, yc, ycns, barrier)) < 0)
+                return -1;
+            if (ret == 0 && (ret = yang_schema_mount_point(yc)) < 0)
+                return -1;
+            if (ret == 1 && nacm_ydecision_add(np, yc, barrier) < 0)
+                return -1;
+            if (ns == NULL || ycns == NULL || strcmp(ns, ycns) != 0)
+                ret = 1;
+            break;
+        default:
+            break;
+        }
+        if (ret == 1)
+            mixed = 1;
+    }
+    return mixed;
+}
+
+/*! Compute decision map of a compiled program from its rules
+ * A rule may match only part of the data subtree of a schema node if
+ * - the rule has a path, and the schema node is an ancestor of the path target, or
+ * - the rule has a module-name other than "*", and the subtree has nodes of other modules
+ * All other rules match either all or none of the subtree, as they match its top node.
+ * @param[in]  np       Compiled NACM program
+ * @param[in]  yspec    YANG spec
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_ydecision_build(nacm_program *np,
+                     yang_stmt    *yspec)
+{
+    nacm_rule    *nr;
+    yang_stmt    *ys;
+    yang_stmt    *ymod = NULL;
+    int           barrier[NACM_EXEC];
+    int           modbarrier[NACM_EXEC];
+    int           modrules = 0;
+    int           a;
+    enum rfc_6020 keyw;
+
+    for (a=0; a<NACM_EXEC; a++)
+        modbarrier[a] = INT_MAX;
+    if ((nr = np->np_rules) != NULL){
+        do {
+            for (a=0; a<NACM_EXEC; a++){
+                barrier[a] = INT_MAX;
+                if ((nr->nr_access & NACM_ACCESS_BIT(a)) == 0)
+                    continue;
+                barrier[a] = nr->nr_index;
+                if (nr->nr_module && strcmp(nr->nr_module, "*") != 0 &&
+                    modbarrier[a] == INT_MAX){
+                    modbarrier[a] = nr->nr_index;
+                    modrules++;
+                }
+            }
+            if (nr->nr_path){
+                ys = PREVQ(clixon_path *, nr->nr_path)->cp_yang; /* Path target */
+                while ((ys = yang_parent_get(ys)) != NULL){
+                    keyw = yang_keyword_get(ys);
+                    if (keyw == Y_MODULE || keyw == Y_SUBMODULE || keyw == Y_SPEC)
+                        break;
+                    if (nacm_ydecision_add(np, ys, barrier) < 0)
+                        return -1;
+                }
+            }
+            nr = NEXTQ(nacm_rule *, nr);
+        } while (nr && nr != np->np_rules);
+    }
+    if (modrules)
+        while ((ymod = yn_each(yspec, ymod)) != NULL)
+            if (nacm_ydecision_mixed(np, ymod, yang_find_mynamespace(ymod), modbarrier) < 0)
+                return -1;
+    return nacm_ydecision_sort(np);
+}
+
+/*! Compile NACM data-node rules of a user
+ * Rules are filtered on the groups of the user, access-operations are translated to bits,
+ * and paths are parsed and bound to YANG. The decision map is computed from the rules.
+ * @param[in]  xnacm    NACM XML tree, root should be "nacm"
+ * @param[in]  username User name
+ * @param[in]  nsc      Namespace context with NACM as default namespace
+ * @param[in]  yspec    YANG spec
+ * @param[out] npp      Compiled program, free with nacm_program_free
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_program_compile(cxobj         *xnacm,
+                     char          *username,
+                     cvec          *nsc,
+                     yang_stmt     *yspec,
+                     nacm_program **npp)
+{
+    int           retval = -1;
+    nacm_program *np = NULL;
+    nacm_rule    *nr;
+    cxobj       **gvec = NULL; /* groups */
+    size_t        glen;
+    cxobj       **rlistvec = NULL; /* rule-list */
+    size_t        rlistlen;
+    cxobj       **rvec = NULL; /* rules */
+    size_t        rlen;
+    cxobj        *rlist;
+    cxobj        *xrule;
+    cxobj        *pathobj;
+    char         *gname;
+    char         *access_operations;
+    char         *str;
+    clixon_path  *cplist = NULL;
+    clixon_path  *cp;
+    int           access;
+    int           index = 0;
+    int           i;
+    int           j;
+    int           ret;
+
+    if ((np = malloc(sizeof(*np))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(np, 0, sizeof(*np));
+    /* User's group */
+    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+        goto done;
+    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+        goto done;
     for (i=0; i<rlistlen; i++){         /* Loop through rule list */
         rlist = rlistvec[i];
         /* Loop through user's group to find match in this rule-list */
@@ -402,113 +698,247 @@ nacm_datanode_prepare(clicon_handle     h,
         }
         if (j==glen) /* not found */
             continue;
-        /* 6. For each rule-list entry found, process all rules, in order,
-           until a rule that matches the requested access operation is
-           found. (see 6 sub rules in nacm_rule_datanode
-        */
         if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
             goto done;
         for (j=0; j<rlen; j++){ /* Loop through rules */
             xrule = rvec[j];
-            /* 6c) For a "read" access operation, the rule's "access-operations"
-               leaf has the "read" bit set or has the special value "*" */
+            /* 6c-f) The rule's "access-operations" has the bit set or has the special value "*" */
             access_operations = xml_find_body(xrule, "access-operations");
-            switch (access){
-            case NACM_READ: 
-                /* 6c) For a "read" access operation, the rule's "access-operations"
-                   leaf has the "read" bit set or has the special value "*" */
-                if (!match_access(access_operations, "read", NULL))
-                    continue;
-                break;
-            case NACM_CREATE:
-                /* 6d) For a "create" access operation, the rule's "access-operations" 
-                   leaf has the "create" bit set or has the special value "*". */
-                if (!match_access(access_operations, "create", "write"))
-                    continue;
-                break;
-            case NACM_DELETE:
-                /* 6e) For a "delete" access operation, the rule's "access-operations" 
-                   leaf has the "delete" bit set or has the  special value "*". */
-                if (!match_access(access_operations, "delete", "write"))
-                    continue;
-                break;
-            case NACM_UPDATE:
-                /* 6f) For an "update" access operation, the rule's "access-operations"
-                   leaf has the "update" bit set or has the special value "*". */ 
-                if (!match_access(access_operations, "update", "write"))
-                    continue;
-                break;
-            default:
-                clicon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
-                goto done;
-                break;
-            }
+            access = 0;
+            if (match_access(access_operations, "read", NULL))
+                access |= NACM_ACCESS_BIT(NACM_READ);
+            if (match_access(access_operations, "create", "write"))
+                access |= NACM_ACCESS_BIT(NACM_CREATE);
+            if (match_access(access_operations, "delete", "write"))
+                access |= NACM_ACCESS_BIT(NACM_DELETE);
+            if (match_access(access_operations, "update", "write"))
+                access |= NACM_ACCESS_BIT(NACM_UPDATE);
+            if (access == 0)
+                continue;
             /*  6b) Either (1) the rule does not have a "rule-type" defined or
                 (2) the "rule-type" is "data-node" and the "path" matches the
-                requested data node, action node, or notification node. */    
+                requested data node, action node, or notification node. */
             if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) == NULL){
                 if (xml_find_body(xrule, "rpc-name") || xml_find_body(xrule, "notification-name"))
                     continue;
-                /* Here a new xrule is found, add it */
-                if (prepvec_add(pv_listp, xrule) == NULL)
-                    goto done;
             }
-            else{
-                path0 = clixon_trim2(xml_body(pathobj), " \t\n");
-                /* Get canonical namespace context for nacm paths */
-                if ((path = strdup(path0)) == NULL){
-                    clicon_err(OE_UNIX, errno, "strdup");
-                    goto done;
-                }
-#if 0
-                /* See https://github.com/clicon/clixon/issues/129:
-                 * If this is enabled, you are back to the problem of JSON encodings
-                 */
-                /* Create namespace context for with nacm namespace as default */
-                if (xml_nsctx_node(pathobj, &nsc0) < 0)
-                    goto done;
-                /* instance-id requires canonical paths */
-                if (xpath2canonical(path0, nsc0, yspec, &path, NULL) < 0)
-                    goto done;
-#endif
-                if ((ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", path)) < 0)
+            else {
+                /* Paths are not canonicalized, see https://github.com/clicon/clixon/issues/129 */
+                str = clixon_trim2(xml_body(pathobj), " \t\n");
+                if ((ret = clixon_instance_id_parse(yspec, &cplist, NULL, "%s", str)) < 0)
                     goto done;
                 if (ret == 0)
                     continue;
-                /* Here a new xrule is found, add it */
-                if ((pv = prepvec_add(pv_listp, xrule)) == NULL)
-                    goto done;
-                for (k=0; k<xlen; k++){
-                    if (clixon_xvec_append(pv->pv_xpathvec, xvec[k]) < 0)
-                        goto done;
-                }
-                if (xvec){
-                    free(xvec);
-                    xvec = NULL;
-                }
-                if (nsc0){
-                    cvec_free(nsc0);
-                    nsc0 = NULL;
-                }
-                if (path){
-                    free(path);
-                    path = NULL;
-                }
+            }
+            if ((nr = malloc(sizeof(*nr))) == NULL){
+                clicon_err(OE_UNIX, errno, "malloc");
+                goto done;
+            }
+            memset(nr, 0, sizeof(*nr));
+            ADDQ(nr, np->np_rules);
+            nr->nr_access = access;
+            nr->nr_index = index++;
+            if ((cp = cplist) != NULL)
+                do {
+                    nr->nr_pathlen++;
+                    cp = NEXTQ(clixon_path *, cp);
+                } while (cp && cp != cplist);
+            nr->nr_path = cplist;
+            cplist = NULL;
+            if ((str = xml_find_body(xrule, "module-name")) != NULL &&
+                (nr->nr_module = strdup(str)) == NULL){
+                clicon_err(OE_UNIX, errno, "strdup");
+                goto done;
+            }
+            if ((str = xml_find_body(xrule, "action")) != NULL &&
+                (nr->nr_action = strdup(str)) == NULL){
+                clicon_err(OE_UNIX, errno, "strdup");
+                goto done;
             }
         }
         if (rvec){
             free(rvec);
-            rvec=NULL;
-        }       
+            rvec = NULL;
+        }
     }
+    if (nacm_ydecision_build(np, yspec) < 0)
+        goto done;
+    *npp = np;
+    np = NULL;
     retval = 0;
  done:
-    if (xvec)
-        free(xvec);
-    if (path)
-        free(path);
-    if (nsc0)
-        cvec_free(nsc0);
+    if (np)
+        nacm_program_free(np);
+    if (cplist)
+        clixon_path_free(cplist);
+    if (gvec)
+        free(gvec);
+    if (rlistvec)
+        free(rlistvec);
+    if (rvec)
+        free(rvec);
+    return retval;
+}
+
+/*! Get compiled NACM program of a user, compile it if not found
+ * Programs are compiled once and cached per user. All programs are discarded when the
+ * generation of the NACM tree changes, ie when the running datastore is changed in internal
+ * mode or the external NACM tree is reloaded, see clicon_nacm_cache_gen.
+ * A NACM tree that is not the NACM cache of the request has no generation, and its
+ * program is compiled on each call.
+ * @param[in]  h        Clicon handle
+ * @param[in]  xnacm    NACM XML tree, root should be "nacm"
+ * @param[in]  username User name
+ * @param[out] npp      Compiled program, direct pointer valid until NACM tree is changed
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_program_get(clicon_handle  h,
+                 cxobj         *xnacm,
+                 char          *username,
+                 nacm_program **npp)
+{
+    int            retval = -1;
+    nacm_compiled *nc = NULL;
+    nacm_program  *np = NULL;
+    nacm_program **p;
+    yang_stmt     *yspec;
+    cvec          *nsc = NULL;
+    uint64_t       gen;
+
+    yspec = clicon_dbspec_yang(h);
+    if (clicon_ptr_get(h, "nacm_compiled", (void**)&nc) < 0 || nc == NULL){
+        if ((nc = malloc(sizeof(*nc))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        memset(nc, 0, sizeof(*nc));
+        if (clicon_ptr_set(h, "nacm_compiled", nc) < 0){
+            free(nc);
+            goto done;
+        }
+    }
+    /* Generation is only known if tree is the NACM cache of the request */
+    gen = xnacm == clicon_nacm_cache(h) ? clicon_nacm_cache_gen(h) : 0;
+    if (gen == 0 || gen != nc->nc_gen || nc->nc_yspec != yspec){
+        clicon_debug(1, "%s NACM changed, recompile", __FUNCTION__);
+        if (nacm_compiled_clear(nc) < 0)
+            goto done;
+        if ((nc->nc_programs = clicon_hash_init()) == NULL)
+            goto done;
+        nc->nc_yspec = yspec;
+        nc->nc_gen = gen;
+    }
+    if ((p = clicon_hash_value(nc->nc_programs, username, NULL)) != NULL)
+        np = *p;
+    else {
+        /* Namespace context with nacm namespace as default */
+        if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+            goto done;
+        if (nacm_program_compile(xnacm, username, nsc, yspec, &np) < 0)
+            goto done;
+        if (clicon_hash_add(nc->nc_programs, username, &np, sizeof(np)) == NULL){
+            nacm_program_free(np);
+            goto done;
+        }
+    }
+    *npp = np;
+    retval = 0;
+ done:
+    if (nsc)
+        xml_nsctx_free(nsc);
+    return retval;
+}
+
+/*! Free prepared rules
+ */
+static int
+prepvec_free(prepvec *pv_list)
+{
+    prepvec *pv;
+
+    while((pv = pv_list) != NULL) {
+        DELQ(pv, pv_list, prepvec *);
+        if (pv->pv_xpathvec)
+            clixon_xvec_free(pv->pv_xpathvec);
+        free(pv);
+    }
+    return 0;
+}
+
+/*! Add prepared rule
+ * @param[in,out] pv_listp  Prepared rules
+ * @param[in]     nr        Compiled rule
+ * @param[in]     xv        Path search result, consumed on success. If NULL an empty vector is made
+ */
+static prepvec *
+prepvec_add(prepvec    **pv_listp,
+            nacm_rule   *nr,
+            clixon_xvec *xv)
+{
+    prepvec *pv;
+
+    if ((pv = malloc(sizeof(*pv))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(pv, 0, sizeof(*pv));
+    ADDQ(pv, *pv_listp);
+    pv->pv_rule = nr;
+    if (xv != NULL)
+        pv->pv_xpathvec = xv;
+    else if ((pv->pv_xpathvec = clixon_xvec_new()) == NULL)
+        return NULL;
+    return pv;
+}
+
+/*! Prepare datastructures before running through XML tree
+ * Select rules of the compiled user program that have the access-op, and make path
+ * lookups on top object for each rule.
+ * @param[in]  h        Clicon handle
+ * @param[in]  xt       XML root tree
+ * @param[in]  access   NACM access
+ * @param[in]  np       Compiled NACM program of user
+ * @param[out] pv_listp Prepared rules, free with prepvec_free
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_datanode_prepare(clicon_handle     h,
+                      cxobj            *xt,
+                      enum nacm_access  access,
+                      nacm_program     *np,
+                      prepvec         **pv_listp)
+{
+    int          retval = -1;
+    nacm_rule   *nr;
+    yang_stmt   *yspec;
+    clixon_xvec *xv = NULL;
+    int          ret;
+
+    yspec = clicon_dbspec_yang(h);
+    if ((nr = np->np_rules) != NULL){
+        do {
+            if (nr->nr_access & NACM_ACCESS_BIT(access)){
+                ret = 1;
+                if (nr->nr_path &&
+                    (ret = clixon_path_search(xt, yspec, nr->nr_path, &xv)) < 0)
+                    goto done;
+                if (ret == 1){
+                    /* Here a new rule is found, add it */
+                    if (prepvec_add(pv_listp, nr, xv) == NULL)
+                        goto done;
+                    xv = NULL;
+                }
+            }
+            nr = NEXTQ(nacm_rule *, nr);
+        } while (nr && nr != np->np_rules);
+    }
+    retval = 0;
+ done:
+    if (xv)
+        clixon_xvec_free(xv);
     return retval;
 }
 
@@ -516,10 +946,114 @@ nacm_datanode_prepare(clicon_handle     h,
  * Datanode write
  */
 
+/*! Match XML node with one element of a compiled rule path
+ * @param[in]  x   XML node
+ * @param[in]  cp  Path element bound to YANG
+ * @retval     1   Match
+ * @retval     0   No match
+ * @retval    -1   Error
+ * @see clixon_path_search  for the same match made as a search from the top
+ */
+static int
+nacm_path_elem_match(cxobj       *x,
+                     clixon_path *cp)
+{
+    yang_stmt    *yc = cp->cp_yang;
+    enum rfc_6020 keyw;
+    cg_var       *cv;
+    cxobj        *xc;
+    char         *ns = NULL;
+    char         *ycns;
+    char         *name;
+    char         *body;
+    char         *val;
+    uint32_t      u;
+
+    if (xml_spec(x) != NULL){
+        if (xml_spec(x) != yc)
+            return 0;
+    }
+    else { /* Not bound to YANG, match name and namespace */
+        if (strcmp(xml_name(x), yang_argument_get(yc)) != 0)
+            return 0;
+        if (xml2ns(x, xml_prefix(x), &ns) < 0)
+            return -1;
+        if (ns == NULL || (ycns = yang_find_mynamespace(yc)) == NULL || strcmp(ns, ycns) != 0)
+            return 0;
+    }
+    if (cp->cp_cvk == NULL)
+        return 1;
+    keyw = yang_keyword_get(yc);
+    if ((keyw == Y_LIST || keyw == Y_LEAF_LIST) &&
+        cvec_len(cp->cp_cvk) == 1 && (cv = cvec_i(cp->cp_cvk, 0)) &&
+        cv_type_get(cv) == CGV_UINT32){ /* instance-id [<pos>] */
+        u = 0;
+        xc = NULL;
+        while ((xc = xml_child_each(xml_parent(x), xc, CX_ELMNT)) != NULL && xc != x)
+            if (strcmp(xml_name(xc), xml_name(x)) == 0)
+                u++;
+        return u == cv_uint32_get(cv);
+    }
+    cv = NULL;
+    while ((cv = cvec_each(cp->cp_cvk, cv)) != NULL) {
+        name = cv_name_get(cv);
+        val = cv_string_get(cv);
+        if (name == NULL || strcmp(name, ".") == 0) /* .=<val> (self) */
+            body = xml_body(x);
+        else if ((xc = xml_find_type(x, NULL, name, CX_ELMNT)) != NULL)
+            body = xml_body(xc);
+        else
+            return 0;
+        if (body == NULL){
+            if (val != NULL && strlen(val))
+                return 0;
+        }
+        else if (val == NULL || strcmp(body, val) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*! Match path of compiled rule with XML node or one of its ancestors
+ * The path is matched upwards from the ancestor at the depth of the path, there is no search
+ * in the tree.
+ * @param[in]  xn   XML node (requested node)
+ * @param[in]  xt   XML root tree, parent of top-level nodes
+ * @param[in]  nr   Compiled NACM rule with path
+ * @retval     1    Path selects xn or one of its ancestors
+ * @retval     0    No match
+ * @retval    -1    Error
+ */
+static int
+nacm_path_match(cxobj     *xn,
+                cxobj     *xt,
+                nacm_rule *nr)
+{
+    cxobj       *x;
+    clixon_path *cp;
+    int          depth = 0;
+    int          ret;
+
+    for (x = xn; x != xt && x != NULL; x = xml_parent(x))
+        depth++;
+    if (x == NULL || depth < nr->nr_pathlen)
+        return 0;
+    for (x = xn; depth > nr->nr_pathlen; depth--)
+        x = xml_parent(x);
+    cp = PREVQ(clixon_path *, nr->nr_path); /* Last element, matched with x */
+    do {
+        if ((ret = nacm_path_elem_match(x, cp)) <= 0)
+            return ret;
+        x = xml_parent(x);
+        cp = PREVQ(clixon_path *, cp);
+    } while (x != xt);
+    return 1;
+}
+
 /*! Match specific rule to specific requested node
  * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
- * @param[in]  xp       Xpath match
+ * @param[in]  xt       XML root tree of xn
+ * @param[in]  nr       Compiled NACM rule
  * @param[in]  yspec    YANG spec
  * @retval -1  Error
  * @retval  0  OK and rule does not match
@@ -528,18 +1062,17 @@ nacm_datanode_prepare(clicon_handle     h,
  */
 static int
 nacm_data_write_xrule_xml(cxobj       *xn,
-                          cxobj       *xrule,
-                          clixon_xvec *xpathvec,
+                          cxobj       *xt,
+                          nacm_rule   *nr,
                           yang_stmt   *yspec)
 {
     int        retval = -1;
     yang_stmt *ymod;
     char      *module_pattern; /* rule module name */
     char      *action;
-    cxobj     *xp;
-    int        i;
+    int        ret;
 
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
+    if ((module_pattern = nr->nr_module) == NULL)
         goto nomatch;
     /* 6a) The rule's "module-name" leaf is "*" or equals the name of
      * the YANG module where the requested data node is defined. 
@@ -551,26 +1084,19 @@ nacm_data_write_xrule_xml(cxobj       *xn,
         if (ymod && strcmp(yang_argument_get(ymod), module_pattern) != 0)
             goto nomatch;
     }
-    action = xml_find_body(xrule, "action"); /* mandatory */
+    if ((action = nr->nr_action) == NULL) /* mandatory */
+        goto nomatch;
     /*  6b) Either (1) the rule does not have a "rule-type" defined or
         (2) the "rule-type" is "data-node" and the "path" matches the
         Requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-        if (strcmp(action, "deny")==0)
-            goto deny;
-        goto permit;
-    }
-    for (i=0; i<clixon_xvec_len(xpathvec); i++){
-        xp = clixon_xvec_i(xpathvec, i);
-        /* Check if ancestor is xp (for every xpathvec?) */
-        if (xn == xp || xml_isancestor(xn, xp)){
-            if (strcmp(action, "deny")==0)
-                goto deny;
-            goto permit;
-        }
+    if (nr->nr_path != NULL){
+        if ((ret = nacm_path_match(xn, xt, nr)) < 0)
+            goto done;
+        if (ret == 0)
+            goto nomatch;
     }
-    goto nomatch;
- permit:
+    if (strcmp(action, "deny")==0)
+        goto deny;
     retval = 2;       /* rule match and permit */
  done:
     return retval;
@@ -583,72 +1109,82 @@ nacm_data_write_xrule_xml(cxobj       *xn,
 }
 
 /*! Recursive check for NACM write rules among all XML nodes
+ * A subtree is not traversed if the decision map of the program shows that all its nodes
+ * match the same rule as its top node, or no rule.
  * @param[in]  h         Clicon handle
  * @param[in]  xn        XML node (requested node)
- * @param[in]  rulevec   Precomputed rules that apply to this user group
- * @param[in]  xpathvec  Precomputed xpath results that apply to this XML tree
+ * @param[in]  xt        XML root tree of xn
+ * @param[in]  np        Compiled NACM program of user
+ * @param[in]  access    NACM access of xn
  * @param[in]  defpermit 0 if default deny, 1 is default permit
  * @param[in]  yspec     YANG spec
  * @param[out] cbret     Error message if retval = 0
  * @retval     1         OK and accept
  * @retval     0         Deny and cbret set
  * @retval     -1        Error
- * XXX differentiate between nomatch: default. or match deny, match accept 
  * nomatch: check write-default rules, next v
  * accept:  Hunky dory
  * deny:    Send error message
  */
 static int
-nacm_datanode_write_recurse(clicon_handle h,
-                            cxobj        *xn,
-                            prepvec      *pv_list,
-                            int           defpermit,
-                            yang_stmt    *yspec,
-                            cbuf         *cbret)
+nacm_datanode_write_recurse(clicon_handle    h,
+                            cxobj           *xn,
+                            cxobj           *xt,
+                            nacm_program    *np,
+                            enum nacm_access access,
+                            int              defpermit,
+                            yang_stmt       *yspec,
+                            cbuf            *cbret)
 {
-    int       retval = -1;
-    cxobj   *x;
-    int      ret = 0;
-    prepvec *pv;
-    
-    pv = pv_list;
-    if (pv){
+    int        retval = -1;
+    cxobj     *x;
+    int        ret;
+    nacm_rule *nr;
+    yang_stmt *ys;
+    int        match = INT_MAX; /* Index of matching rule */
+    int        barrier;
+
+    if ((nr = np->np_rules) != NULL){
         do {
-            /* return values: -1:Error /0:no match /1: deny /2: permit
-             */
-            if ((ret = nacm_data_write_xrule_xml(xn, pv->pv_xrule, pv->pv_xpathvec, yspec)) < 0) 
-                goto done;
-            switch(ret){
-            case 0: /* No match, continue with next rule */
-                break;
-            case 1: /* Match and deny: break all traversal and send error back to client */
-                if (netconf_access_denied(cbret, "application", "access denied") < 0)
+            if (nr->nr_access & NACM_ACCESS_BIT(access)){
+                /* return values: -1:Error /0:no match /1: deny /2: permit
+                 */
+                if ((ret = nacm_data_write_xrule_xml(xn, xt, nr, yspec)) < 0)
                     goto done;
-                goto deny;
-                break;
-            case 2: /* Match and permit: break rule processing but continue recursion */
-                break;
+                if (ret == 1){ /* Match and deny: break all traversal and send error back to client */
+                    if (netconf_access_denied(cbret, "application", "access denied") < 0)
+                        goto done;
+                    goto deny;
+                }
+                if (ret == 2){ /* Match and permit: break rule processing but continue recursion */
+                    match = nr->nr_index;
+                    break;
+                }
             }
-            if (ret == 2)
-                break;
-            pv = NEXTQ(prepvec *, pv);
-        } while (pv && pv != pv_list);
+            nr = NEXTQ(nacm_rule *, nr);
+        } while (nr && nr != np->np_rules);
     }
     /* If no rule match, check default rule: if deny then break traversal and send error */
-    if (ret == 0 && !defpermit){
+    if (match == INT_MAX && !defpermit){
         if (netconf_access_denied(cbret, "application", "default deny") < 0)
             goto done;
         goto deny;
     }
-    /* If node should be purged, dont recurse and defer removal to caller */
+    /* Rules before the barrier match all or none of the subtree, as they match xn */
+    if ((ys = xml_spec(xn)) != NULL){
+        barrier = nacm_ydecision_barrier(np, ys, access);
+        if (match < barrier || barrier == INT_MAX)
+            goto ok;
+    }
     x = NULL;   /* Recursively check XML */
     while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-        if ((ret = nacm_datanode_write_recurse(h, x, pv_list,
+        if ((ret = nacm_datanode_write_recurse(h, x, xt, np, access,
                                                defpermit, yspec, cbret)) < 0)
             goto done;
         if (ret == 0)
             goto deny;
     }
+ ok:
     retval = 1; /* accept */
  done:
     return retval;
@@ -684,19 +1220,10 @@ nacm_datanode_write(clicon_handle    h,
                     cbuf            *cbret)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
-    cxobj         **rvec = NULL; /* rules */
     char           *write_default = NULL;
-    cvec           *nsc = NULL;
     int             ret;
-    prepvec        *pv_list = NULL;
+    nacm_program   *np = NULL;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-        goto done;
     if (xnacm == NULL)
         goto permit;
     /* write-default (create, update, or delete) has default deny so should never be NULL */
@@ -711,24 +1238,17 @@ nacm_datanode_write(clicon_handle    h,
        transport layer.)               */
     if (username == NULL)
         goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-        goto done;
-    /* 4. If no groups are found, continue with step 9. */
-    if (glen == 0)
-        goto step9;
-    /* 5. Process all rule-list entries, in the order they appear in the
+    /* 4. If no groups are found, continue with step 9 (no rules in program).
+       5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+        entry. 
+       Steps 3-5 are compiled once per user and NACM tree */
+    if (nacm_program_get(h, xnacm, username, &np) < 0)
         goto done;
-    /* First run through rules and cache rules as well as lookup objects in xt. 
-     */
-    if (nacm_datanode_prepare(h, xt, access, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
-        goto done;
-    /* Then recursivelyy traverse all requested nodes */
-    if ((ret = nacm_datanode_write_recurse(h, xreq, pv_list,
+    /* Then recursively traverse requested nodes. Rule paths are matched with the ancestors
+     * of each node, there is no lookup in xt */
+    if ((ret = nacm_datanode_write_recurse(h, xreq, xt, np, access,
                                            strcmp(write_default, "deny"),
                                            clicon_dbspec_yang(h),
                                            cbret)) < 0)
@@ -760,16 +1280,6 @@ nacm_datanode_write(clicon_handle    h,
     retval = 1;
  done:
     clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
-    if (pv_list)
-        prepvec_free(pv_list);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
-    if (rvec)
-        free(rvec);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -782,19 +1292,19 @@ nacm_datanode_write(clicon_handle    h,
  */
 
 /*! Perform NACM action: mark if permit, del if deny
- * @param[in] xrule    NACM rule
+ * @param[in] nr       Compiled NACM rule
  * @param[in] xn       XML node (requested node)
  * @retval    -1       Error
  * @retval    0        OK
  */
 static int
-nacm_data_read_action(cxobj *xrule,
-                      cxobj *xn)
+nacm_data_read_action(nacm_rule *nr,
+                      cxobj     *xn)
 {
     int   retval = -1;
     char *action;
 
-    if ((action = xml_find_body(xrule, "action")) != NULL){
+    if ((action = nr->nr_action) != NULL){
         if (strcmp(action, "deny")==0)
             xml_flag_set(xn, XML_FLAG_DEL);
         else if (strcmp(action, "permit")==0)
@@ -807,7 +1317,8 @@ nacm_data_read_action(cxobj *xrule,
 
 /*! Match specific rule to specific requested node
  * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
+ * @param[in]  nr       Compiled NACM rule
+ * @param[in]  xpathvec Path matches of rule
  * @param[in]  yspec    YANG spec
  * @retval -1  Error
  * @retval  0  OK and rule does not match
@@ -820,7 +1331,7 @@ nacm_data_read_action(cxobj *xrule,
  */
 static int
 nacm_data_read_xrule_xml(cxobj        *xn,
-                         cxobj        *xrule,
+                         nacm_rule    *nr,
                          clixon_xvec  *xpathvec,
                          yang_stmt    *yspec)
 {
@@ -830,7 +1341,7 @@ nacm_data_read_xrule_xml(cxobj        *xn,
     cxobj     *xp;
     int        i;
     
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
+    if ((module_pattern = nr->nr_module) == NULL)
         goto nomatch;
     /* 6a) The rule's "module-name" leaf is "*" or equals the name of
      * the YANG module where the requested data node is defined. 
@@ -844,8 +1355,8 @@ nacm_data_read_xrule_xml(cxobj        *xn,
     /*  6b) Either (1) the rule does not have a "rule-type" defined or
         (2) the "rule-type" is "data-node" and the "path" matches the
         requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-        if (nacm_data_read_action(xrule, xn) < 0)
+    if (nr->nr_path == NULL){
+        if (nacm_data_read_action(nr, xn) < 0)
             goto done;
         goto match;
     }
@@ -853,7 +1364,7 @@ nacm_data_read_xrule_xml(cxobj        *xn,
         xp = clixon_xvec_i(xpathvec, i);
         /* Check if ancestor is xp (for every xpathvec?) */
         if (xn == xp || xml_isancestor(xn, xp)){
-            if (nacm_data_read_action(xrule, xn) < 0)
+            if (nacm_data_read_action(nr, xn) < 0)
                 goto done;
             goto match;
         }
@@ -868,10 +1379,12 @@ nacm_data_read_xrule_xml(cxobj        *xn,
 }
 
 /*! Recursive check for NACM read rules among all XML nodes
+ * A subtree is not traversed if the read decision map of the program shows that all
+ * its nodes match the same rule as its top node, or no rule.
  * @param[in]  h        Clicon handle
  * @param[in]  xn       XML node (requested node)
- * @param[in]  rulevec  Precomputed rules that apply to this user group
- * @param[in]  xpathvec Precomputed xpath results that apply to this XML tree
+ * @param[in]  np       Compiled NACM program of user
+ * @param[in]  pv_list  Precomputed rules and path matches that apply to this XML tree
  * @param[in]  yspec    YANG spec
  * @retval  0  OK
  * @retval -1  Error
@@ -879,29 +1392,39 @@ nacm_data_read_xrule_xml(cxobj        *xn,
 static int
 nacm_datanode_read_recurse(clicon_handle h,
                            cxobj        *xn,
+                           nacm_program *np,
                            prepvec      *pv_list,
                            yang_stmt    *yspec)
 {
-    int      retval = -1;
-    cxobj   *x;
-    cxobj   *xprev;
-    int      ret;
-    prepvec *pv;
+    int        retval = -1;
+    cxobj     *x;
+    cxobj     *xprev;
+    int        ret;
+    prepvec   *pv;
+    yang_stmt *ys;
+    int        match = INT_MAX; /* Index of matching rule */
+    int        barrier;
     
-    if (xml_spec(xn)){ /* Check this node */
+    if ((ys = xml_spec(xn)) != NULL){ /* Check this node */
         pv = pv_list;
         if (pv){
             do {
                 if ((ret = nacm_data_read_xrule_xml(xn,
-                                                    pv->pv_xrule,
+                                                    pv->pv_rule,
                                                     pv->pv_xpathvec,
                                                     yspec)) < 0) 
                     goto done;      
-                if (ret == 1)
+                if (ret == 1){
+                    match = pv->pv_rule->nr_index;
                     break; /* stop at first match */                
+                }
                 pv = NEXTQ(prepvec *, pv);
             } while (pv && pv != pv_list);
         }
+        /* Rules before the barrier match all or none of the subtree, as they match xn */
+        barrier = nacm_ydecision_barrier(np, ys, NACM_READ);
+        if (match < barrier || barrier == INT_MAX)
+            goto ok;
 
 #if 0 /* 6(A) in algorithm 
        * If N did not match any rule R, and default rule is deny, remove that subtree */
@@ -916,7 +1439,7 @@ nacm_datanode_read_recurse(clicon_handle h,
         x = NULL;       /* Recursively check XML */
         xprev = NULL;
         while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-            if (nacm_datanode_read_recurse(h, x, pv_list, yspec) < 0)
+            if (nacm_datanode_read_recurse(h, x, np, pv_list, yspec) < 0)
                 goto done;
             /* check for delayed remove */
             if (xml_flag(x, XML_FLAG_DEL)){
@@ -924,8 +1447,10 @@ nacm_datanode_read_recurse(clicon_handle h,
                     goto done;
                 x = xprev;
             }
+            xprev = x;
         }
     }
+ ok:
     retval = 0;
  done:
     return retval;
@@ -988,18 +1513,11 @@ nacm_datanode_read(clicon_handle h,
                    cxobj        *xnacm)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
     int             i;
     char           *read_default = NULL;
-    cvec           *nsc = NULL;
+    nacm_program   *np = NULL;
     prepvec        *pv_list = NULL;
     
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-        goto done;
     /* 3.   Check all the "group" entries to see if any of them contain a
        "user-name" entry that equals the username for the session
        making the request.  (If the "enable-external-groups" leaf is
@@ -1007,16 +1525,14 @@ nacm_datanode_read(clicon_handle h,
        transport layer.)               */
     if (username == NULL)
         goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-        goto done;
-    /* 4. If no groups are found (glen=0), continue and check read-default 
+    /* 4. If no groups are found (no rules in program), continue and check read-default 
           in step 11. */
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+        entry. 
+       Steps 3-5 are compiled once per user and NACM tree */
+    if (nacm_program_get(h, xnacm, username, &np) < 0)
         goto done;
     /* read-default has default permit so should never be NULL */
     if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
@@ -1026,10 +1542,10 @@ nacm_datanode_read(clicon_handle h,
     /* First run through rules and cache rules as well as lookup objects in xt. 
      * DANGER: objects could be stale if they are removed?
      */
-    if (nacm_datanode_prepare(h, xt, NACM_READ, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_datanode_prepare(h, xt, NACM_READ, np, &pv_list) < 0)
         goto done;
     /* Then recursivelyy traverse all nodes */
-    if (nacm_datanode_read_recurse(h, xt, pv_list, clicon_dbspec_yang(h)) < 0)
+    if (nacm_datanode_read_recurse(h, xt, np, pv_list, clicon_dbspec_yang(h)) < 0)
         goto done;
 #if 1
     /* Step 8(B) above:
@@ -1062,12 +1578,6 @@ nacm_datanode_read(clicon_handle h,
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
     if (pv_list)
         prepvec_free(pv_list);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
     return retval;
 }
 
@@ -1564,8 +1564,10 @@ instance_id_resolve(clixon_path *cplist,
  * @retval    -1        Error
  * @retval     0        Fail  fail: eg no yang 
  * @retval     1        OK with found xml nodes in xvec (if any)
+ * @note cplist is resolved to yang, eg with clixon_instance_id_parse, and may be reused for
+ *       several searches
  */
-static int
+int
 clixon_path_search(cxobj        *xt,
                    yang_stmt    *yt,
                    clixon_path  *cplist,
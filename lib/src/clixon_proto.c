@@ -74,6 +74,9 @@
 #include "clixon_sig.h"
 #include "clixon_xml.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_bind.h"
+#include "clixon_xml_sort.h"
+#include "clixon_xml_bin.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_options.h"
 #include "clixon_proto.h"
@@ -207,6 +210,106 @@ clicon_msg_decode(struct clicon_msg *msg,
     goto done;
 }
 
+/*! Encode a clicon netconf message with a binary body
+ * @param[in] id      Session id of client
+ * @param[in] cb      Binary body, see clixon_xml2bin
+ * @retval    NULL    Error
+ * @retval    msg     Clicon message to send to eg clicon_msg_send()
+ * @see clicon_msg_encode  for text XML
+ */
+struct clicon_msg *
+clicon_msg_encode_bin(uint32_t id,
+                      cbuf    *cb)
+{
+    uint32_t           len;
+    struct clicon_msg *msg = NULL;
+
+    len = sizeof(*msg) + cbuf_len(cb) + 1; /* Keep NUL termination of body */
+    if ((msg = (struct clicon_msg *)malloc(len)) == NULL){
+        clicon_err(OE_PROTO, errno, "malloc");
+        return NULL;
+    }
+    memset(msg, 0, len);
+    msg->op_len = htonl(len);
+    msg->op_id = htonl(id);
+    memcpy(msg->op_body, cbuf_get(cb), cbuf_len(cb));
+    return msg;
+}
+
+/*! Check if a clicon message has a binary body
+ * @param[in]  msg    CLICON msg
+ * @retval     1      Binary, decode with clicon_msg_decode_bin
+ * @retval     0      Text XML, decode with clicon_msg_decode
+ */
+int
+clicon_msg_isbin(struct clicon_msg *msg)
+{
+    return clixon_bin_is(msg->op_body, ntohl(msg->op_len) - sizeof(*msg));
+}
+
+/*! Decode a clicon netconf message with a binary body
+ *
+ * Top-level rpc:s are bound to YANG as in clicon_msg_decode, unless all nodes already are
+ * bound by schema-node ids of the sender.
+ * @param[in]  h      Clixon handle
+ * @param[in]  msg    CLICON msg, checked with clicon_msg_isbin
+ * @param[in]  yspec  Yang specification, (can be NULL)
+ * @param[out] id     Session id
+ * @param[out] xml    XML tree
+ * @param[out] xerr   Reason for failure (yang assignment not made) if retval =0
+ * @retval     1      Decode OK and all yang assignment made
+ * @retval     0      Decode OK but yang assigment not made (or only partial)
+ * @retval    -1      Error with clicon_err called. Includes malformed message
+ * @see clicon_msg_decode  for text XML
+ */
+int
+clicon_msg_decode_bin(clicon_handle      h,
+                      struct clicon_msg *msg, 
+                      yang_stmt         *yspec,
+                      uint32_t          *id,
+                      cxobj            **xml,
+                      cxobj            **xerr)
+{
+    int    retval = -1;
+    cxobj *x;
+    int    ret;
+    int    failed = 0;
+    int    bound = 0;
+
+    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    if (id)
+        *id = ntohl(msg->op_id);
+    if (clixon_bin2xml(h, msg->op_body, ntohl(msg->op_len) - sizeof(*msg), xml) < 0)
+        goto done;
+    if (yspec){
+        x = NULL;
+        while ((x = xml_child_each(*xml, x, CX_ELMNT)) != NULL) {
+            if (strcmp(xml_name(x), "rpc") == 0 && clixon_bin_bound(x)){
+                bound++;
+                continue;
+            }
+            if ((ret = xml_bind_yang_rpc(h, x, yspec, xerr)) < 0)
+                goto done;
+            if (ret == 0){
+                if (*xerr && clixon_xml_attr_copy(x, *xerr, "message-id") < 0)
+                    goto done;
+                failed++;
+            }
+        }
+        if (failed)
+            goto fail;
+        /* Bound nodes are sorted by sender */
+        if (!bound && xml_sort_recurse(*xml) < 0)
+            goto done;
+    }
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Open local connection using unix domain sockets
  * @param[in]  h        Clicon handle
  * @param[in]  sockpath Unix domain file path
@@ -365,6 +468,60 @@ clicon_msg_send(int                s,
     return retval;
 }
 
+/*! Send a CLICON message and pass a file descriptor with it on a UNIX socket
+ *
+ * The descriptor is passed as SCM_RIGHTS ancillary data with the first bytes of the message
+ * and is received by clicon_msg_rcv_fd
+ * @param[in]   s      UNIX socket
+ * @param[in]   msg    CLICON msg data structure
+ * @param[in]   fd     File descriptor to pass, not closed
+ * @see clicon_msg_rcv_fd
+ */
+int
+clicon_msg_send_fd(int                s,
+                   struct clicon_msg *msg,
+                   int                fd)
+{
+    int             retval = -1;
+    struct msghdr   mh = {0,};
+    struct iovec    iov;
+    struct cmsghdr *cmsg;
+    char            ctl[CMSG_SPACE(sizeof(int))];
+    ssize_t         n;
+    size_t          len;
+
+    clicon_debug(CLIXON_DBG_DETAIL, "%s: send msg len=%d fd=%d", __FUNCTION__, ntohl(msg->op_len), fd);
+    clicon_debug(CLIXON_DBG_MSG, "Send: %s", msg->op_body);
+    len = ntohl(msg->op_len);
+    memset(ctl, 0, sizeof(ctl));
+    iov.iov_base = msg;
+    iov.iov_len = len;
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl;
+    mh.msg_controllen = sizeof(ctl);
+    cmsg = CMSG_FIRSTHDR(&mh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    while ((n = sendmsg(s, &mh, 0)) < 0 && errno == EINTR)
+        ;
+    if (n < 0){
+        clicon_err(OE_CFG, errno, "sendmsg");
+        goto done;
+    }
+    /* Rest of message without descriptor */
+    if (n < len &&
+        atomicio((ssize_t (*)(int, void *, size_t))write, s, (char*)msg + n, len - n) < 0){
+        clicon_err(OE_CFG, errno, "atomicio");
+        goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Receive a CLICON message using IPC message struct
  *
  * XXX: timeout? and signals?
@@ -387,6 +544,152 @@ clicon_msg_rcv(int                s,
                int                intr,
                struct clicon_msg **msg,
                int                *eof)
+{
+    return clicon_msg_rcv_fd(s, intr, NULL, msg, eof);
+}
+
+/*! Read message header and a file descriptor passed with it on a UNIX socket
+ *
+ * @param[in]   s      UNIX socket
+ * @param[out]  hdr    Message header
+ * @param[out]  fdp    Received file descriptor, or -1
+ * @retval      n      Number of bytes read, 0 on EOF
+ * @retval     -1      Error
+ */
+static ssize_t
+msg_hdr_rcv_fd(int                s,
+               struct clicon_msg *hdr,
+               int               *fdp)
+{
+    ssize_t         n;
+    ssize_t         n2;
+    struct msghdr   mh = {0,};
+    struct iovec    iov;
+    struct cmsghdr *cmsg;
+    char            ctl[CMSG_SPACE(sizeof(int))];
+
+    iov.iov_base = hdr;
+    iov.iov_len = sizeof(*hdr);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl;
+    mh.msg_controllen = sizeof(ctl);
+    while ((n = recvmsg(s, &mh, 0)) < 0 && errno == EINTR && !_atomicio_sig)
+        ;
+    if (n <= 0)
+        return n;
+    for (cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg))
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS){
+            if (*fdp != -1)
+                close(*fdp);
+            memcpy(fdp, CMSG_DATA(cmsg), sizeof(int));
+        }
+    if (n < sizeof(*hdr)){
+        if ((n2 = atomicio(read, s, (char*)hdr + n, sizeof(*hdr) - n)) < 0)
+            return -1;
+        n += n2;
+    }
+    return n;
+}
+
+/*! Read body of a message sent in chunks
+ *
+ * A header with length 0 is followed by chunks, each a 32-bit length in network byte
+ * order and that many bytes of body, ended by a chunk of length 0. The body is reassembled
+ * and null-terminated, and the length of the message is set in its header.
+ * Used by the backend for large replies, see CLICON_SOCK_CHUNK.
+ * @param[in]   s      Socket
+ * @param[in]   hdr    Message header, already read
+ * @param[out]  msg    Message, or NULL on eof. Free with free()
+ * @param[out]  eof    Set if eof or malformed message encountered
+ * @retval      0      OK, or eof
+ * @retval     -1      Error
+ */
+static int
+msg_rcv_chunks(int                 s,
+               struct clicon_msg  *hdr,
+               struct clicon_msg **msg,
+               int                *eof)
+{
+    int                retval = -1;
+    struct clicon_msg *m = NULL;
+    struct clicon_msg *m1;
+    size_t             mlen = sizeof(*hdr);
+    size_t             size;
+    uint32_t           clen;
+    ssize_t            n;
+
+    size = sizeof(*hdr) + BUFSIZ;
+    if ((m = malloc(size)) == NULL){
+        clicon_err(OE_PROTO, errno, "malloc");
+        goto done;
+    }
+    memcpy(m, hdr, sizeof(*hdr));
+    while (1){
+        if ((n = atomicio(read, s, &clen, sizeof(clen))) < 0){
+            clicon_err(OE_PROTO, errno, "read");
+            goto done;
+        }
+        if (n != sizeof(clen)){
+            clicon_err(OE_PROTO, 0, "chunk length too short");
+            *eof = 1;
+            goto ok;
+        }
+        if ((clen = ntohl(clen)) == 0)
+            break;
+        if (mlen + clen + 1 > UINT32_MAX){
+            clicon_err(OE_PROTO, EFBIG, "chunked message too large");
+            *eof = 1;
+            goto ok;
+        }
+        if (mlen + clen + 1 > size){
+            size = 2*size > mlen + clen + 1 ? 2*size : mlen + clen + 1;
+            if ((m1 = realloc(m, size)) == NULL){
+                clicon_err(OE_PROTO, errno, "realloc");
+                goto done;
+            }
+            m = m1;
+        }
+        if ((n = atomicio(read, s, (char*)m + mlen, clen)) < 0){
+            clicon_err(OE_PROTO, errno, "read");
+            goto done;
+        }
+        if (n != clen){
+            clicon_err(OE_PROTO, 0, "chunk too short");
+            *eof = 1;
+            goto ok;
+        }
+        msg_hex(CLIXON_DBG_EXTRA, (char*)m + mlen, n, __FUNCTION__);
+        mlen += clen;
+    }
+    ((char*)m)[mlen++] = '\0';
+    m->op_len = htonl((uint32_t)mlen);
+    *msg = m;
+    m = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (m)
+        free(m);
+    return retval;
+}
+
+/*! Receive a CLICON message and optionally a file descriptor passed with it
+ *
+ * @param[in]   s      socket (unix or inet) to communicate with backend
+ * @param[in]   intr   If set, make a ^C cause an error
+ * @param[out]  fdp    If given, file descriptor passed with message (UNIX socket), or -1
+ * @param[out]  msg    CLICON msg data reply structure. Free with free()
+ * @param[out]  eof    Set if eof encountered
+ * @see clicon_msg_rcv
+ * @see clicon_msg_send_fd
+ */
+int
+clicon_msg_rcv_fd(int                 s,
+                  int                 intr,
+                  int                *fdp,
+                  struct clicon_msg **msg,
+                  int                *eof)
 { 
     int       retval = -1;
     struct clicon_msg hdr;
@@ -397,11 +700,17 @@ clicon_msg_rcv(int                s,
 
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     *eof = 0;
+    if (fdp)
+        *fdp = -1;
     if (intr){
         clicon_signal_unblock(SIGINT);
         set_signal_flags(SIGINT, 0, atomicio_sig_handler, &oldhandler);
     }
-    if ((hlen = atomicio(read, s, &hdr, sizeof(hdr))) < 0){ 
+    if (fdp)
+        hlen = msg_hdr_rcv_fd(s, &hdr, fdp);
+    else
+        hlen = atomicio(read, s, &hdr, sizeof(hdr));
+    if (hlen < 0){ 
         if (intr && _atomicio_sig)
             ;
         else
@@ -420,6 +729,13 @@ clicon_msg_rcv(int                s,
     mlen = ntohl(hdr.op_len);
     clicon_debug(CLIXON_DBG_EXTRA, "op-len:%u op-id:%u",
                  mlen, ntohl(hdr.op_id));
+    if (mlen == 0){ /* Body in chunks */
+        if (msg_rcv_chunks(s, &hdr, msg, eof) < 0)
+            goto done;
+        if (*msg)
+            clicon_debug(CLIXON_DBG_MSG, "Recv: %s", (*msg)->op_body);
+        goto ok;
+    }
     clicon_debug(CLIXON_DBG_DETAIL, "%s: rcv msg len=%d",  
                  __FUNCTION__, mlen);
     if (mlen <= sizeof(hdr)){
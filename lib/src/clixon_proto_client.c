@@ -47,12 +47,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <unistd.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/syslog.h>
+#include <arpa/inet.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -80,6 +82,8 @@
 #include "clixon_xml_bind.h"
 #include "clixon_xml_sort.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_bin.h"
+#include "clixon_shm.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_proto_client.h"
 
@@ -137,27 +141,131 @@ clicon_rpc_connect(clicon_handle h,
     return retval;
 }
     
+/*! Shared memory ring of the cached client socket, stored as handle pointer
+ * @see clicon_hello_req
+ */
+struct rpc_shm {
+    struct clicon_shm *rs_shm; /* Mapped ring */
+    int                rs_fd;  /* Segment not yet passed to backend, or -1 */
+};
+
+#define RPC_SHM_PTR "backend-shm"
+
+/*! Get shared memory ring state of the cached socket, or NULL
+ */
+static struct rpc_shm *
+rpc_shm_get(clicon_handle h)
+{
+    struct rpc_shm *rs = NULL;
+
+    if (clicon_ptr_get(h, RPC_SHM_PTR, (void**)&rs) == 0)
+        return rs;
+    return NULL;
+}
+
+/*! Replace a shared memory descriptor reply with the reply read from the ring
+ *
+ * @param[in]     h      Clixon handle
+ * @param[in,out] reply  Reply message, replaced if descriptor
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+rpc_shm_resolve(clicon_handle       h,
+                struct clicon_msg **reply)
+{
+    struct rpc_shm    *rs;
+    struct clicon_msg *msg = NULL;
+
+    if (*reply == NULL || !clicon_msg_isshm(*reply))
+        return 0;
+    if ((rs = rpc_shm_get(h)) == NULL){
+        clicon_err(OE_PROTO, 0, "Shared memory reply but no shared memory");
+        return -1;
+    }
+    if (clicon_shm_get(rs->rs_shm, *reply, &msg) < 0)
+        return -1;
+    free(*reply);
+    *reply = msg;
+    return 0;
+}
+
+/*! Free shared memory ring of the cached client socket
+ *
+ * @param[in]  h    Clixon handle
+ * @retval     0    OK
+ */
+int
+clicon_rpc_shm_exit(clicon_handle h)
+{
+    struct rpc_shm *rs;
+
+    if ((rs = rpc_shm_get(h)) != NULL){
+        if (rs->rs_fd != -1)
+            close(rs->rs_fd);
+        clicon_shm_free(rs->rs_shm);
+        free(rs);
+        clicon_ptr_del(h, RPC_SHM_PTR);
+    }
+    return 0;
+}
+
+/*! Create a shared memory ring to be passed to backend with next message on cached socket
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  size  Size of ring in bytes
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+rpc_shm_create(clicon_handle h,
+               uint32_t      size)
+{
+    struct rpc_shm *rs;
+
+    clicon_rpc_shm_exit(h);
+    if ((rs = calloc(1, sizeof(*rs))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    if (clicon_shm_create(size, &rs->rs_fd, &rs->rs_shm) < 0){
+        free(rs);
+        return -1;
+    }
+    if (clicon_ptr_set(h, RPC_SHM_PTR, rs) < 0){
+        close(rs->rs_fd);
+        clicon_shm_free(rs->rs_shm);
+        free(rs);
+        return -1;
+    }
+    if (clicon_handle_exit_reg(h, clicon_rpc_shm_exit) < 0)
+        return -1;
+    return 0;
+}
+
 /*! Connect to backend or use cached socket and send RPC
  *
  * @param[in]  h        Clixon handle
  * @param[in]  msg      Encoded message
  * @param[in]  cache    Use cached (client) socket, otherwise generate new socket
- * @param[out] retdate  Returned data as string
+ * @param[out] reply    Reply message, text or binary. Free with free()
  * @param[out] eof      Set if eof encountered
  * @param[out] sp       Returned socket
  * @retval     0        OK
  * @retval    -1        Error
  */
 static int
-clicon_rpc_msg_once(clicon_handle      h,
-                    struct clicon_msg *msg, 
-                    int                cache,
-                    char             **retdata,
-                    int               *eof,
-                    int               *sp)
+clicon_rpc_msg_once(clicon_handle       h,
+                    struct clicon_msg  *msg, 
+                    int                 cache,
+                    struct clicon_msg **reply,
+                    int                *eof,
+                    int                *sp)
 {
-    int retval = -1;
-    int s;
+    int             retval = -1;
+    int             s;
+    struct rpc_shm *rs = NULL;
+    int             ret;
     
     if (cache){
         if ((s = clicon_client_socket_get(h)) < 0){
@@ -165,16 +273,27 @@ clicon_rpc_msg_once(clicon_handle      h,
                 goto done;
             clicon_client_socket_set(h, s);
         }
+        rs = rpc_shm_get(h);
     }
     else if (clicon_rpc_connect(h, &s) < 0)
         goto done;
-    if (clicon_rpc(s, msg, retdata, eof) < 0){
+    if (rs && rs->rs_fd != -1){ /* Pass shared memory segment to backend */
+        ret = clicon_msg_send_fd(s, msg, rs->rs_fd);
+        close(rs->rs_fd);
+        rs->rs_fd = -1;
+    }
+    else
+        ret = clicon_msg_send(s, msg);
+    if (ret < 0 ||
+        clicon_msg_rcv(s, 0, reply, eof) < 0){
         /* 2. check socket shutdown AFTER rpc */
         close(s);
         s = -1;
         clicon_client_socket_set(h, -1);
         goto done;
     }
+    if (cache && rpc_shm_resolve(h, reply) < 0)
+        goto done;
     if (sp)
         *sp = s;
     retval = 0;
@@ -182,6 +301,27 @@ clicon_rpc_msg_once(clicon_handle      h,
     return retval;
 }
 
+/*! Decode reply from backend, text or binary
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  reply  Reply message
+ * @param[out] xret   XML tree, bound to YANG only if binary with schema-node ids
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+clicon_rpc_reply_decode(clicon_handle      h,
+                        struct clicon_msg *reply,
+                        cxobj            **xret)
+{
+    if (clicon_msg_isbin(reply))
+        return clixon_bin2xml(h, reply->op_body, ntohl(reply->op_len) - sizeof(*reply), xret);
+    /* Cannot populate xret here because need to know RPC name (eg "lock") in order to
+     * associate yang to reply.
+     */
+    return clixon_xml_parse_string(reply->op_body, YB_NONE, NULL, xret, NULL);
+}
+
 /*! Send internal netconf rpc from client to backend
  *
  * @param[in]    h      CLICON handle
@@ -199,18 +339,21 @@ clicon_rpc_msg(clicon_handle      h,
                struct clicon_msg *msg, 
                cxobj            **xret0)
 {
-    int     retval = -1;
-    char   *retdata = NULL;
-    cxobj  *xret = NULL;
-    int     s = -1;
-    int     eof = 0;
+    int                retval = -1;
+    struct clicon_msg *reply = NULL;
+    cxobj             *xret = NULL;
+    int                s = -1;
+    int                eof = 0;
 
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
 #ifdef RPC_USERNAME_ASSERT
     assert(strstr(msg->op_body, "username")!=NULL); /* XXX */
 #endif
+    /* Replies to outstanding asynchronous requests come first on the cached socket */
+    if (clicon_rpc_async_wait(h, 0) < 0)
+        goto done;
     /* Create a socket and connect to it, either UNIX, IPv4 or IPv6 per config options */
-    if (clicon_rpc_msg_once(h, msg, 1, &retdata, &eof, &s) < 0)
+    if (clicon_rpc_msg_once(h, msg, 1, &reply, &eof, &s) < 0)
         goto done;
     if (eof){
         /* 2. check socket shutdown AFTER rpc */
@@ -219,7 +362,7 @@ clicon_rpc_msg(clicon_handle      h,
         clicon_client_socket_set(h, -1);
 #ifdef PROTO_RESTART_RECONNECT
         if (!clixon_exit_get()) { /* May be part of termination */
-            if (clicon_rpc_msg_once(h, msg, 1, &retdata, &eof, NULL) < 0)
+            if (clicon_rpc_msg_once(h, msg, 1, &reply, &eof, NULL) < 0)
                 goto done;
             if (eof){
                 close(s);
@@ -240,11 +383,8 @@ clicon_rpc_msg(clicon_handle      h,
 #endif
     }
 
-    if (retdata){
-        /* Cannot populate xret here because need to know RPC name (eg "lock") in order to associate yang
-         * to reply.
-         */
-        if (clixon_xml_parse_string(retdata, YB_NONE, NULL, &xret, NULL) < 0)
+    if (reply){
+        if (clicon_rpc_reply_decode(h, reply, &xret) < 0)
             goto done;
     }
     if (xret0){
@@ -254,8 +394,8 @@ clicon_rpc_msg(clicon_handle      h,
     retval = 0;
  done:
     clicon_debug(CLIXON_DBG_DETAIL, "%s %d", __FUNCTION__, retval);
-    if (retdata)
-        free(retdata);
+    if (reply)
+        free(reply);
     if (xret)
         xml_free(xret);
     return retval;
@@ -278,11 +418,11 @@ clicon_rpc_msg_persistent(clicon_handle      h,
                           cxobj            **xret0,
                           int               *sock0)
 {
-    int     retval = -1;
-    char   *retdata = NULL;
-    cxobj  *xret = NULL;
-    int     s = -1;
-    int     eof = 0;
+    int                retval = -1;
+    struct clicon_msg *reply = NULL;
+    cxobj             *xret = NULL;
+    int                s = -1;
+    int                eof = 0;
 
     if (sock0 == NULL){
         clicon_err(OE_NETCONF, EINVAL, "Missing socket pointer");
@@ -293,7 +433,7 @@ clicon_rpc_msg_persistent(clicon_handle      h,
 #endif
     clicon_debug(1, "%s request:%s", __FUNCTION__, msg->op_body);
     /* Create a socket and connect to it, either UNIX, IPv4 or IPv6 per config options */
-    if (clicon_rpc_msg_once(h, msg, 0, &retdata, &eof, &s) < 0)
+    if (clicon_rpc_msg_once(h, msg, 0, &reply, &eof, &s) < 0)
         goto done;
     if (eof){
         /* 2. check socket shutdown AFTER rpc */
@@ -306,13 +446,11 @@ clicon_rpc_msg_persistent(clicon_handle      h,
         clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
         goto done;
     }
-    clicon_debug(1, "%s retdata:%s", __FUNCTION__, retdata);
+    if (reply)
+        clicon_debug(1, "%s retdata:%s", __FUNCTION__, reply->op_body);
 
-    if (retdata){
-        /* Cannot populate xret here because need to know RPC name (eg "lock") in order to associate yang
-         * to reply.
-         */
-        if (clixon_xml_parse_string(retdata, YB_NONE, NULL, &xret, NULL) < 0)
+    if (reply){
+        if (clicon_rpc_reply_decode(h, reply, &xret) < 0)
             goto done;
     }
     if (xret0){
@@ -326,13 +464,274 @@ clicon_rpc_msg_persistent(clicon_handle      h,
  done:
     if (s >= 0)
         close(s);
-    if (retdata)
-        free(retdata);
+    if (reply)
+        free(reply);
+    if (xret)
+        xml_free(xret);
+    return retval;
+}
+
+/*! Pending asynchronous request on the cached client socket
+ * @see clicon_rpc_msg_async
+ */
+struct rpc_async {
+    qelem_t              ra_q;   /* List header */
+    uint32_t             ra_id;  /* Client-side request id */
+    clicon_rpc_async_cb *ra_fn;  /* Reply callback */
+    void                *ra_arg; /* Callback argument */
+};
+
+/*! Asynchronous request state, stored as handle pointer
+ */
+struct rpc_async_state {
+    struct rpc_async *as_pending; /* Requests sent but not replied, in send order */
+    int               as_len;     /* Length of pending list */
+    uint32_t          as_seq;     /* Last request id */
+};
+
+#define RPC_ASYNC_PTR "rpc-async"
+
+/*! Get asynchronous request state, create if not exists
+ */
+static struct rpc_async_state *
+rpc_async_state(clicon_handle h)
+{
+    struct rpc_async_state *as = NULL;
+
+    if (clicon_ptr_get(h, RPC_ASYNC_PTR, (void**)&as) == 0 && as != NULL)
+        return as;
+    if ((as = calloc(1, sizeof(*as))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return NULL;
+    }
+    if (clicon_ptr_set(h, RPC_ASYNC_PTR, as) < 0){
+        free(as);
+        return NULL;
+    }
+    if (clicon_handle_exit_reg(h, clicon_rpc_async_exit) < 0)
+        return NULL;
+    return as;
+}
+
+/*! Drop all pending asynchronous requests, eg after the socket is closed
+ */
+static void
+rpc_async_drop(struct rpc_async_state *as)
+{
+    struct rpc_async *ra;
+
+    while ((ra = as->as_pending) != NULL){
+        DELQ(ra, as->as_pending, struct rpc_async *);
+        free(ra);
+    }
+    as->as_len = 0;
+}
+
+/*! Receive one reply from backend and call the callback of the oldest pending request
+ *
+ * The backend handles messages on a socket one at a time and replies in the order
+ * they were received, therefore replies are correlated with requests in send order.
+ * @param[in]  h   Clixon handle
+ * @param[in]  as  Asynchronous request state
+ * @retval     0   OK
+ * @retval    -1   Error, all pending requests are dropped
+ */
+static int
+rpc_async_recv(clicon_handle           h,
+               struct rpc_async_state *as)
+{
+    int                retval = -1;
+    struct rpc_async  *ra;
+    struct clicon_msg *reply = NULL;
+    cxobj             *xret = NULL;
+    int                s;
+    int                eof = 0;
+
+    if ((ra = as->as_pending) == NULL)
+        return 0;
+    if ((s = clicon_client_socket_get(h)) < 0){
+        clicon_err(OE_PROTO, ESHUTDOWN, "No socket for pending requests");
+        rpc_async_drop(as);
+        ra = NULL;
+        goto done;
+    }
+    if (clicon_msg_rcv(s, 0, &reply, &eof) < 0 || eof){
+        close(s);
+        clicon_client_socket_set(h, -1);
+        if (eof)
+            clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
+        rpc_async_drop(as);
+        ra = NULL;
+        goto done;
+    }
+    DELQ(ra, as->as_pending, struct rpc_async *);
+    as->as_len--;
+    if (rpc_shm_resolve(h, &reply) < 0)
+        goto done;
+    if (clicon_rpc_reply_decode(h, reply, &xret) < 0)
+        goto done;
+    if (ra->ra_fn && ra->ra_fn(h, ra->ra_id, xret, ra->ra_arg) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (ra)
+        free(ra);
+    if (reply)
+        free(reply);
     if (xret)
         xml_free(xret);
     return retval;
 }
 
+/*! Send internal netconf rpc from client to backend without waiting for the reply
+ *
+ * The request is sent on the cached client socket and the reply is delivered later to
+ * the callback, in the order the requests were sent.
+ * Replies are received by clicon_rpc_async_wait, and also by this function if the number
+ * of outstanding requests reaches CLICON_RPC_ASYNC_MAX, or if replies are already
+ * available on the socket. Synchronous calls, such as clicon_rpc_msg, first wait for all
+ * outstanding requests.
+ * @param[in]  h      Clixon handle
+ * @param[in]  msg    Encoded message. Deallocate with free
+ * @param[in]  fn     Callback called with the reply, or NULL
+ * @param[in]  arg    Argument to callback
+ * @param[out] id     Request id, also given to the callback (if not NULL)
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @code
+ *   for (i=0; i<n; i++){
+ *      if ((msg = clicon_msg_encode(session_id, "<rpc ...>...</rpc>")) == NULL)
+ *         err;
+ *      if (clicon_rpc_msg_async(h, msg, reply_cb, arg, NULL) < 0)
+ *         err;
+ *      free(msg);
+ *   }
+ *   if (clicon_rpc_async_wait(h, 0) < 0)
+ *      err;
+ * @endcode
+ * @note The XML tree given to the callback is not bound to YANG and is freed after the call
+ * @see clicon_rpc_msg  for the synchronous variant
+ */
+int
+clicon_rpc_msg_async(clicon_handle        h,
+                     struct clicon_msg   *msg,
+                     clicon_rpc_async_cb *fn,
+                     void                *arg,
+                     uint32_t            *id)
+{
+    int                     retval = -1;
+    struct rpc_async_state *as;
+    struct rpc_async       *ra = NULL;
+    int                     s;
+    int                     ret;
+
+    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    if ((as = rpc_async_state(h)) == NULL)
+        goto done;
+    /* Bound the number of requests in flight, and receive replies that have already
+     * arrived, so that the backend is not blocked writing replies */
+    while (as->as_len >= CLICON_RPC_ASYNC_MAX)
+        if (rpc_async_recv(h, as) < 0)
+            goto done;
+    while (as->as_len && (s = clicon_client_socket_get(h)) >= 0){
+        if ((ret = clixon_event_poll(s)) < 0)
+            goto done;
+        if (ret == 0)
+            break;
+        if (rpc_async_recv(h, as) < 0)
+            goto done;
+    }
+    if ((s = clicon_client_socket_get(h)) < 0){
+        if (clicon_rpc_connect(h, &s) < 0)
+            goto done;
+        clicon_client_socket_set(h, s);
+    }
+    if ((ra = calloc(1, sizeof(*ra))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    ra->ra_id = ++as->as_seq;
+    ra->ra_fn = fn;
+    ra->ra_arg = arg;
+    if (clicon_msg_send(s, msg) < 0){
+        close(s);
+        clicon_client_socket_set(h, -1);
+        rpc_async_drop(as);
+        goto done;
+    }
+    ADDQ(ra, as->as_pending);
+    as->as_len++;
+    if (id)
+        *id = ra->ra_id;
+    ra = NULL;
+    retval = 0;
+ done:
+    if (ra)
+        free(ra);
+    return retval;
+}
+
+/*! Wait for replies of outstanding asynchronous requests
+ *
+ * @param[in]  h    Clixon handle
+ * @param[in]  id   Wait until reply of this request id is received, or 0 for all
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see clicon_rpc_msg_async
+ */
+int
+clicon_rpc_async_wait(clicon_handle h,
+                      uint32_t      id)
+{
+    struct rpc_async_state *as = NULL;
+    struct rpc_async       *ra;
+    int                     last;
+
+    if (clicon_ptr_get(h, RPC_ASYNC_PTR, (void**)&as) < 0 || as == NULL)
+        return 0;
+    while ((ra = as->as_pending) != NULL){
+        last = (ra->ra_id == id);
+        if (rpc_async_recv(h, as) < 0)
+            return -1;
+        if (last)
+            break;
+    }
+    return 0;
+}
+
+/*! Number of outstanding asynchronous requests
+ *
+ * @param[in]  h    Clixon handle
+ * @retval     n    Number of requests sent but not replied
+ */
+int
+clicon_rpc_async_pending(clicon_handle h)
+{
+    struct rpc_async_state *as = NULL;
+
+    if (clicon_ptr_get(h, RPC_ASYNC_PTR, (void**)&as) < 0 || as == NULL)
+        return 0;
+    return as->as_len;
+}
+
+/*! Free asynchronous request state, pending requests are dropped
+ *
+ * @param[in]  h    Clixon handle
+ * @retval     0    OK
+ */
+int
+clicon_rpc_async_exit(clicon_handle h)
+{
+    struct rpc_async_state *as = NULL;
+
+    if (clicon_ptr_get(h, RPC_ASYNC_PTR, (void**)&as) == 0 && as != NULL){
+        rpc_async_drop(as);
+        free(as);
+        clicon_ptr_del(h, RPC_ASYNC_PTR);
+    }
+    return 0;
+}
+
 /*! Check if there is a valid (cached) session-id. If not, send a hello request to backend 
  *
  * Session-ids survive TCP sessions that are created for each message sent to the backend.
@@ -363,6 +762,26 @@ session_id_check(clicon_handle h,
     return retval;
 }
 
+/*! Check if binary encoding is negotiated with the backend
+ *
+ * @param[in]  h       Clixon handle
+ * @param[out] peerfp  Schema fingerprint of backend
+ * @retval     1       Binary encoding negotiated in hello
+ * @retval     0       Text XML
+ * @see clicon_hello_req
+ */
+int
+clicon_rpc_binary_peer(clicon_handle h,
+                       uint64_t     *peerfp)
+{
+    char *str = NULL;
+
+    if (clicon_data_get(h, "backend-binary", &str) < 0 || str == NULL)
+        return 0;
+    *peerfp = strtoull(str, NULL, 16);
+    return 1;
+}
+
 /*! Generic xml netconf clicon rpc for persistent
  * Want to go over to use netconf directly between client and server,...
  * @param[in]  h       clicon handle
@@ -440,6 +859,9 @@ clicon_rpc_netconf_xml(clicon_handle  h,
     yang_stmt *yspec;
     cxobj     *xerr = NULL;
     int        ret;
+    uint32_t   session_id;
+    uint64_t   peerfp;
+    struct clicon_msg *msg = NULL;
 
     if ((cb = cbuf_new()) == NULL){
         clicon_err(OE_XML, errno, "cbuf_new");
@@ -450,12 +872,26 @@ clicon_rpc_netconf_xml(clicon_handle  h,
         goto done;
     }
     rpcname = xml_name(xname); /* Store rpc name and use in yang binding after reply */
-    if (clixon_xml2cbuf(cb, xml, 0, 0, -1, 0) < 0)
-        goto done;
-    if (clicon_rpc_netconf(h, cbuf_get(cb), xret, sp) < 0)
+    /* Session id is given by hello, which also negotiates binary encoding */
+    if (session_id_check(h, &session_id) < 0)
         goto done;
+    if (sp == NULL && clicon_rpc_binary_peer(h, &peerfp)){
+        if (clixon_xml2bin(h, cb, NULL, NULL, &xml, 1, -1, peerfp) < 0)
+            goto done;
+        if ((msg = clicon_msg_encode_bin(session_id, cb)) == NULL)
+            goto done;
+        if (clicon_rpc_msg(h, msg, xret) < 0)
+            goto done;
+    }
+    else {
+        if (clixon_xml2cbuf(cb, xml, 0, 0, -1, 0) < 0)
+            goto done;
+        if (clicon_rpc_netconf(h, cbuf_get(cb), xret, sp) < 0)
+            goto done;
+    }
     if ((xreply = xml_find_type(*xret, NULL, "rpc-reply", CX_ELMNT)) != NULL &&
-        xml_find_type(xreply, NULL, "rpc-error", CX_ELMNT) == NULL){
+        xml_find_type(xreply, NULL, "rpc-error", CX_ELMNT) == NULL &&
+        !clixon_bin_bound(xreply)){ /* Binary reply may already be bound */
         yspec = clicon_dbspec_yang(h);
         /* Here use rpc name to bind to yang */
         if ((ret = xml_bind_yang_rpc_reply(h, xreply, rpcname, yspec, &xerr)) < 0) 
@@ -474,6 +910,8 @@ clicon_rpc_netconf_xml(clicon_handle  h,
     }
     retval = 0;
  done:
+    if (msg)
+        free(msg);
     if (xerr)
         xml_free(xerr);
     if (cb)
@@ -582,7 +1020,9 @@ clicon_rpc_get_config(clicon_handle h,
     else{
         if (xml_bind_special(xd, yspec, "/nc:get-config/output/data") < 0)
             goto done;
-        if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
+        if (clixon_bin_bound(xd)) /* Binary reply bound with schema-node ids */
+            ret = 1;
+        else if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
             goto done;
         if (ret == 0){
             if (clixon_netconf_internal_error(xerr,
@@ -1030,7 +1470,9 @@ clicon_rpc_get(clicon_handle   h,
     else{
         if (xml_bind_special(xd, yspec, "/nc:get/output/data") < 0)
             goto done;
-        if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
+        if (clixon_bin_bound(xd)) /* Binary reply bound with schema-node ids */
+            ret = 1;
+        else if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
             goto done;
         if (ret == 0){
             if (clixon_netconf_internal_error(xerr,
@@ -1172,7 +1614,7 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
     if (direction)
         cprintf(cb, "<direction>%s</direction>", direction);
     if (sort)
-        cprintf(cb, "<sort>%s</sort>", sort);
+        cprintf(cb, "<sort-by>%s</sort-by>", sort);
     if (where)
         cprintf(cb, "<where>%s</where>", where);
     cprintf(cb, "</list-pagination>");
@@ -1195,7 +1637,9 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
     else{
         if (xml_bind_special(xd, yspec, "/nc:get/output/data") < 0)
             goto done;
-        if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
+        if (clixon_bin_bound(xd)) /* Binary reply bound with schema-node ids */
+            ret = 1;
+        else if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
             goto done;
         if (ret == 0){
             if (clixon_netconf_internal_error(xerr,
@@ -1773,6 +2217,11 @@ clicon_rpc_restconf_debug(clicon_handle h,
  * @note transport is an identity defined in RFC6022 with added values in clixon-lib.yang for clixon,
  *       and should in those cases be prefixed with the localname "cl:", 
  *       Example: cl:cli, cl:restconf, cl:netconf
+ * @note If CLICON_SOCK_BINARY is set, binary encoding is proposed with a capability. If the
+ *       backend accepts, its schema fingerprint is stored as "backend-binary" data
+ * @note If CLICON_SOCK_SHM is set on a UNIX socket, a shared memory ring for replies is passed
+ *       with the hello. It is kept if the backend accepts with a capability
+ * @see clicon_rpc_binary_peer
  */
 int
 clicon_hello_req(clicon_handle h,
@@ -1790,6 +2239,13 @@ clicon_hello_req(clicon_handle h,
     int                ret;
     cbuf              *cb = NULL;
     int                clixon_lib = 0;
+    uint64_t           fp = 0;
+    yang_stmt         *yspec;
+    cxobj            **vec = NULL;
+    size_t             veclen;
+    int                i;
+    int                shmsize;
+    int                shm = 0;
 
     if ((cb = cbuf_new()) == NULL){
         clicon_err(OE_XML, errno, "cbuf_new");
@@ -1816,8 +2272,23 @@ clicon_hello_req(clicon_handle h,
     if (clixon_lib)
         cprintf(cb, " xmlns:%s=\"%s\"", CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
     cprintf(cb, ">");
-    cprintf(cb, "<capabilities><capability>%s</capability></capabilities>",
+    cprintf(cb, "<capabilities><capability>%s</capability>",
             NETCONF_BASE_CAPABILITY_1_1);
+    clicon_data_del(h, "backend-binary");
+    if (clicon_option_bool(h, "CLICON_SOCK_BINARY")){
+        if ((yspec = clicon_dbspec_yang(h)) != NULL &&
+            clixon_bin_fingerprint(h, yspec, &fp) < 0)
+            goto done;
+        cprintf(cb, "<capability>%s%016" PRIx64 "</capability>", CLIXON_BIN_CAPABILITY, fp);
+    }
+    clicon_rpc_shm_exit(h);
+    if ((shmsize = clicon_option_int(h, "CLICON_SOCK_SHM")) > 0 &&
+        clicon_sock_family(h) == AF_UNIX){
+        if (rpc_shm_create(h, shmsize) < 0)
+            goto done;
+        cprintf(cb, "<capability>%s</capability>", CLICON_SHM_CAPABILITY);
+    }
+    cprintf(cb, "</capabilities>");
     cprintf(cb, "</hello>");
 
     if ((msg = clicon_msg_encode(0, "%s", cbuf_get(cb))) == NULL)
@@ -1837,8 +2308,26 @@ clicon_hello_req(clicon_handle h,
         clicon_err(OE_XML, errno, "parse_uint32"); 
         goto done;
     }
+    /* Backend accepts binary encoding */
+    if (xpath_vec(xret, NULL, "hello/capabilities/capability", &vec, &veclen) < 0)
+        goto done;
+    for (i=0; i<veclen; i++){
+        if ((b = xml_body(vec[i])) == NULL)
+            continue;
+        if (strncmp(b, CLIXON_BIN_CAPABILITY, strlen(CLIXON_BIN_CAPABILITY)) == 0){
+            if (clicon_data_set(h, "backend-binary", b + strlen(CLIXON_BIN_CAPABILITY)) < 0)
+                goto done;
+        }
+        /* Backend attached shared memory ring */
+        else if (strcmp(b, CLICON_SHM_CAPABILITY) == 0)
+            shm++;
+    }
+    if (!shm)
+        clicon_rpc_shm_exit(h);
     retval = 0;
  done:
+    if (vec)
+        free(vec);
     if (cb)
         cbuf_free(cb);
     if (msg)
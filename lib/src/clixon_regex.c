@@ -62,6 +62,8 @@
 #include "clixon_err.h"
 #include "clixon_log.h"
 #include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_data.h"
 #include "clixon_options.h"
 #include "clixon_regex.h"
 
@@ -462,3 +464,1216 @@ regex_free(clicon_handle h,
     return retval;
 }
 
+
+/*-------------------------- Fast path -------------------------*/
+/*
+ * Patterns of well-known typedefs, such as ietf-inet-types:ipv4-address, are validated by
+ * native C functions, keyed by typedef identity "module:typedef", see regex_native_register.
+ * Other patterns in a subset of the XSD regex syntax are compiled to an NFA which is
+ * converted to a DFA, one state at a time, while matching.
+ * The subset excludes character class subtraction, \w, \i, \c and unicode categories
+ * other than N, Nd, L, Lu and Ll.
+ * Both methods only handle ASCII: strings with other characters fall back to the regexp
+ * engine (regex_compile/regex_exec).
+ */
+
+#define REGEX_ASCII          128  /* Characters handled by fast path */
+#define REGEX_DFA_MAXPROG    4096 /* Max NFA instructions, else use regexp engine */
+#define REGEX_DFA_MAXSTATES  512  /* Max DFA states, else use regexp engine */
+#define REGEX_DFA_MAXREPEAT  1000 /* Max {n,m} count */
+
+/* Pattern syntax tree node */
+enum rxn_type {
+    RXN_EMPTY,
+    RXN_CLASS,
+    RXN_CAT,
+    RXN_ALT,
+    RXN_REP
+};
+
+struct rxnode {
+    struct rxnode *rn_next;     /* List of all nodes, for free */
+    enum rxn_type  rn_type;
+    uint8_t        rn_class[REGEX_ASCII/8]; /* RXN_CLASS: bitmap of characters */
+    struct rxnode *rn_left;     /* RXN_CAT, RXN_ALT, RXN_REP */
+    struct rxnode *rn_right;    /* RXN_CAT, RXN_ALT */
+    int            rn_min;      /* RXN_REP */
+    int            rn_max;      /* RXN_REP, -1 is unbounded */
+};
+
+/* Pattern parser state */
+struct rxparse {
+    char          *rp_s;        /* Current position in pattern */
+    struct rxnode *rp_nodes;    /* All allocated nodes */
+};
+
+/* NFA instruction */
+enum rxi_op {
+    RXI_CLASS,  /* Match a character in class, continue with next */
+    RXI_SPLIT,  /* Continue with both ri_x and ri_y */
+    RXI_JMP,    /* Continue with ri_x */
+    RXI_MATCH
+};
+
+struct rxinst {
+    enum rxi_op ri_op;
+    int         ri_x;
+    int         ri_y;
+    uint8_t     ri_class[REGEX_ASCII/8];
+};
+
+/* DFA state: set of NFA CLASS/MATCH instructions */
+struct rxdstate {
+    uint64_t *ds_set;
+    int       ds_match;              /* Set contains RXI_MATCH */
+    int       ds_dead;               /* Set is empty */
+    int       ds_next[REGEX_ASCII];  /* Next DFA state, -1 if not computed */
+};
+
+struct regex_dfa {
+    struct rxinst    *rd_prog;
+    int               rd_len;
+    int               rd_words;  /* Words of a state set */
+    uint64_t         *rd_mask;   /* Set of CLASS and MATCH instructions */
+    int              *rd_stack;  /* Closure stack */
+    struct rxdstate **rd_states;
+    int               rd_nstates;
+};
+
+/* Fast path of one or several (typedef) patterns, all must match */
+struct regex_fast {
+    regex_native_fn  *rf_native;   /* Native validator of typedef, or NULL */
+    struct regex_dfa *rf_dfa;      /* Compiled pattern, or NULL */
+    int               rf_rxmode;   /* Regexp engine of fallback regexps */
+    int               rf_len;      /* Number of patterns */
+    char            **rf_patterns; /* Patterns, used if fast path cannot decide */
+    void            **rf_regexps;  /* Compiled rf_patterns, on demand */
+};
+
+/* Native typedef validator registry entry */
+struct regex_native {
+    char            *rn_pattern;  /* First pattern of typedef, or NULL */
+    regex_native_fn *rn_fn;
+};
+
+#define RXBIT_SET(v, i)   ((v)[(i)/8] |= (1 << ((i)%8)))
+#define RXBIT_ISSET(v, i) ((v)[(i)/8] & (1 << ((i)%8)))
+#define RXSET_SET(s, i)   ((s)[(i)/64] |= ((uint64_t)1 << ((i)%64)))
+#define RXSET_ISSET(s, i) ((s)[(i)/64] & ((uint64_t)1 << ((i)%64)))
+
+static struct rxnode *
+rxnode_new(struct rxparse *rp,
+           enum rxn_type   type)
+{
+    struct rxnode *rn;
+
+    if ((rn = malloc(sizeof(*rn))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(rn, 0, sizeof(*rn));
+    rn->rn_type = type;
+    rn->rn_next = rp->rp_nodes;
+    rp->rp_nodes = rn;
+    return rn;
+}
+
+static void
+rxnode_set_range(uint8_t *class,
+                 int      from,
+                 int      to)
+{
+    int c;
+
+    for (c=from; c<=to && c<REGEX_ASCII; c++)
+        RXBIT_SET(class, c);
+}
+
+/*! Set characters of a multi-character escape (ASCII subset) in class
+ * @param[in]  c      Escape character, eg 'd' in \d
+ * @param[in]  s      Position after escape character (for \p{..})
+ * @param[out] class  Character class bitmap
+ * @param[out] len    Consumed length after escape character
+ * @retval     1      OK
+ * @retval     0      Not a supported multi-character escape
+ */
+static int
+rxparse_class_escape(char     c,
+                     char    *s,
+                     uint8_t *class,
+                     int     *len)
+{
+    uint8_t cl[REGEX_ASCII/8] = {0,};
+    char   *e;
+    int     neg = 0;
+    int     i;
+
+    *len = 0;
+    switch (c){
+    case 'D':
+        neg++; /* fall thru */
+    case 'd':
+        rxnode_set_range(cl, '0', '9');
+        break;
+    case 'S':
+        neg++; /* fall thru */
+    case 's':
+        RXBIT_SET(cl, ' '); RXBIT_SET(cl, '\t'); RXBIT_SET(cl, '\n'); RXBIT_SET(cl, '\r');
+        break;
+    case 'P':
+        neg++; /* fall thru */
+    case 'p':
+        if (*s != '{' || (e = strchr(s, '}')) == NULL)
+            return 0;
+        *len = e - s + 1;
+        if (strncmp(s, "{N}", *len) == 0 || strncmp(s, "{Nd}", *len) == 0)
+            rxnode_set_range(cl, '0', '9');
+        else if (strncmp(s, "{L}", *len) == 0){
+            rxnode_set_range(cl, 'a', 'z');
+            rxnode_set_range(cl, 'A', 'Z');
+        }
+        else if (strncmp(s, "{Lu}", *len) == 0)
+            rxnode_set_range(cl, 'A', 'Z');
+        else if (strncmp(s, "{Ll}", *len) == 0)
+            rxnode_set_range(cl, 'a', 'z');
+        else
+            return 0;
+        break;
+    default:
+        return 0;
+    }
+    for (i=0; i<REGEX_ASCII; i++)
+        if ((RXBIT_ISSET(cl, i) != 0) != (neg != 0))
+            RXBIT_SET(class, i);
+    return 1;
+}
+
+/*! Parse single character escape, eg \n or \.
+ * @retval  c   Character
+ * @retval -1   Not a single character escape
+ */
+static int
+rxparse_char_escape(char c)
+{
+    switch (c){
+    case 'n':
+        return '\n';
+    case 'r':
+        return '\r';
+    case 't':
+        return '\t';
+    case '\\': case '|': case '.': case '?': case '*': case '+': case '-': case '^':
+    case '(': case ')': case '{': case '}': case '[': case ']':
+        return c;
+    default:
+        return -1;
+    }
+}
+
+/*! Parse a character class [...] 
+ * @retval  1  OK
+ * @retval  0  Unsupported syntax
+ */
+static int
+rxparse_class(struct rxparse *rp,
+              uint8_t        *class)
+{
+    uint8_t cl[REGEX_ASCII/8] = {0,};
+    char   *s = rp->rp_s;   /* After '[' */
+    int     neg = 0;
+    int     from;
+    int     to;
+    int     len;
+    int     i;
+
+    if (*s == '^'){
+        neg++;
+        s++;
+    }
+    if (*s == ']')
+        return 0;
+    while (*s != ']'){
+        if (*s == '\0' || *s == '[' || (unsigned char)*s >= REGEX_ASCII)
+            return 0;
+        if (*s == '-' && s[1] == '[')  /* Subtraction */
+            return 0;
+        if (*s == '\\'){
+            if ((from = rxparse_char_escape(s[1])) < 0){
+                if (rxparse_class_escape(s[1], s+2, cl, &len) == 0)
+                    return 0;
+                s += 2 + len;
+                continue;
+            }
+            s += 2;
+        }
+        else
+            from = *s++;
+        to = from;
+        if (*s == '-' && s[1] != ']'){
+            s++;
+            if (*s == '\\'){
+                if ((to = rxparse_char_escape(s[1])) < 0)
+                    return 0;
+                s += 2;
+            }
+            else if (*s == '[' || *s == '\0' || (unsigned char)*s >= REGEX_ASCII)
+                return 0;
+            else
+                to = *s++;
+            if (to < from)
+                return 0;
+        }
+        rxnode_set_range(cl, from, to);
+    }
+    rp->rp_s = s + 1;
+    for (i=0; i<REGEX_ASCII; i++)
+        if ((RXBIT_ISSET(cl, i) != 0) != (neg != 0))
+            RXBIT_SET(class, i);
+    return 1;
+}
+
+static int rxparse_regex(struct rxparse *rp, struct rxnode **rnp);
+
+/*! Parse an atom and its quantifier
+ * @retval -1  Error
+ * @retval  0  Unsupported syntax
+ * @retval  1  OK
+ */
+static int
+rxparse_piece(struct rxparse *rp,
+              struct rxnode **rnp)
+{
+    struct rxnode *rn = NULL;
+    struct rxnode *rr;
+    char          *s = rp->rp_s;
+    char          *e;
+    int            c;
+    int            len;
+    int            ret;
+    long           min;
+    long           max;
+
+    if ((unsigned char)*s >= REGEX_ASCII)
+        return 0;
+    switch (*s){
+    case '(':
+        rp->rp_s = s+1;
+        if ((ret = rxparse_regex(rp, &rn)) < 1)
+            return ret;
+        if (*rp->rp_s != ')')
+            return 0;
+        rp->rp_s++;
+        break;
+    case '[':
+        if ((rn = rxnode_new(rp, RXN_CLASS)) == NULL)
+            return -1;
+        rp->rp_s = s+1;
+        if (rxparse_class(rp, rn->rn_class) == 0)
+            return 0;
+        break;
+    case '.':
+        if ((rn = rxnode_new(rp, RXN_CLASS)) == NULL)
+            return -1;
+        rxnode_set_range(rn->rn_class, 1, REGEX_ASCII-1);
+        rn->rn_class['\n'/8] &= ~(1 << ('\n'%8));
+        rn->rn_class['\r'/8] &= ~(1 << ('\r'%8));
+        rp->rp_s = s+1;
+        break;
+    case '\\':
+        if ((rn = rxnode_new(rp, RXN_CLASS)) == NULL)
+            return -1;
+        if ((c = rxparse_char_escape(s[1])) >= 0){
+            RXBIT_SET(rn->rn_class, c);
+            rp->rp_s = s+2;
+        }
+        else if (rxparse_class_escape(s[1], s+2, rn->rn_class, &len) == 1)
+            rp->rp_s = s+2+len;
+        else
+            return 0;
+        break;
+    case '?': case '*': case '+': case '{': case '}': case ']': case ')': case '|': case '\0':
+        return 0;
+    default:
+        if ((rn = rxnode_new(rp, RXN_CLASS)) == NULL)
+            return -1;
+        RXBIT_SET(rn->rn_class, *s);
+        rp->rp_s = s+1;
+        break;
+    }
+    /* Quantifier */
+    s = rp->rp_s;
+    min = max = 1;
+    switch (*s){
+    case '?':
+        min = 0;
+        s++;
+        break;
+    case '*':
+        min = 0; max = -1;
+        s++;
+        break;
+    case '+':
+        max = -1;
+        s++;
+        break;
+    case '{':
+        if (!isdigit(s[1]))
+            return 0;
+        min = strtol(s+1, &e, 10);
+        if (*e == '}')
+            max = min;
+        else if (*e == ',' && e[1] == '}'){
+            max = -1;
+            e++;
+        }
+        else if (*e == ',' && isdigit(e[1])){
+            s = e+1;
+            max = strtol(s, &e, 10);
+            if (*e != '}' || max < min)
+                return 0;
+        }
+        else
+            return 0;
+        if (min > REGEX_DFA_MAXREPEAT || max > REGEX_DFA_MAXREPEAT)
+            return 0;
+        s = e+1;
+        break;
+    default:
+        break;
+    }
+    rp->rp_s = s;
+    if (min != 1 || max != 1){
+        if ((rr = rxnode_new(rp, RXN_REP)) == NULL)
+            return -1;
+        rr->rn_left = rn;
+        rr->rn_min = min;
+        rr->rn_max = max;
+        rn = rr;
+    }
+    *rnp = rn;
+    return 1;
+}
+
+/*! Parse a branch: a sequence of pieces
+ */
+static int
+rxparse_branch(struct rxparse *rp,
+               struct rxnode **rnp)
+{
+    struct rxnode *rn = NULL;
+    struct rxnode *rp1;
+    struct rxnode *rc;
+    int            ret;
+
+    while (*rp->rp_s != '\0' && *rp->rp_s != '|' && *rp->rp_s != ')'){
+        if ((ret = rxparse_piece(rp, &rp1)) < 1)
+            return ret;
+        if (rn == NULL)
+            rn = rp1;
+        else {
+            if ((rc = rxnode_new(rp, RXN_CAT)) == NULL)
+                return -1;
+            rc->rn_left = rn;
+            rc->rn_right = rp1;
+            rn = rc;
+        }
+    }
+    if (rn == NULL && (rn = rxnode_new(rp, RXN_EMPTY)) == NULL)
+        return -1;
+    *rnp = rn;
+    return 1;
+}
+
+/*! Parse a regex: branches separated by '|'
+ */
+static int
+rxparse_regex(struct rxparse *rp,
+              struct rxnode **rnp)
+{
+    struct rxnode *rn = NULL;
+    struct rxnode *rb;
+    struct rxnode *ra;
+    int            ret;
+
+    if ((ret = rxparse_branch(rp, &rn)) < 1)
+        return ret;
+    while (*rp->rp_s == '|'){
+        rp->rp_s++;
+        if ((ret = rxparse_branch(rp, &rb)) < 1)
+            return ret;
+        if ((ra = rxnode_new(rp, RXN_ALT)) == NULL)
+            return -1;
+        ra->rn_left = rn;
+        ra->rn_right = rb;
+        rn = ra;
+    }
+    *rnp = rn;
+    return 1;
+}
+
+/*! Append an NFA instruction
+ * @retval  i   Index of instruction
+ * @retval -1   Error
+ * @retval -2   Program too large
+ */
+static int
+rxdfa_emit1(struct regex_dfa *rd,
+            enum rxi_op       op)
+{
+    struct rxinst *ri;
+
+    if (rd->rd_len >= REGEX_DFA_MAXPROG)
+        return -2;
+    if ((rd->rd_len % 64) == 0){
+        if ((rd->rd_prog = realloc(rd->rd_prog, (rd->rd_len+64)*sizeof(*ri))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+    }
+    ri = &rd->rd_prog[rd->rd_len];
+    memset(ri, 0, sizeof(*ri));
+    ri->ri_op = op;
+    return rd->rd_len++;
+}
+
+/*! Translate syntax tree to NFA instructions (Thompson construction)
+ * @retval  0   OK
+ * @retval -1   Error
+ * @retval -2   Program too large
+ */
+static int
+rxdfa_emit(struct regex_dfa *rd,
+           struct rxnode    *rn)
+{
+    int  i;
+    int  s;
+    int  j;
+    int  n;
+    int *split = NULL;
+
+    switch (rn->rn_type){
+    case RXN_EMPTY:
+        break;
+    case RXN_CLASS:
+        if ((i = rxdfa_emit1(rd, RXI_CLASS)) < 0)
+            return i;
+        memcpy(rd->rd_prog[i].ri_class, rn->rn_class, sizeof(rn->rn_class));
+        break;
+    case RXN_CAT:
+        if ((i = rxdfa_emit(rd, rn->rn_left)) < 0 ||
+            (i = rxdfa_emit(rd, rn->rn_right)) < 0)
+            return i;
+        break;
+    case RXN_ALT:
+        if ((s = rxdfa_emit1(rd, RXI_SPLIT)) < 0)
+            return s;
+        rd->rd_prog[s].ri_x = s+1;
+        if ((i = rxdfa_emit(rd, rn->rn_left)) < 0)
+            return i;
+        if ((j = rxdfa_emit1(rd, RXI_JMP)) < 0)
+            return j;
+        rd->rd_prog[s].ri_y = rd->rd_len;
+        if ((i = rxdfa_emit(rd, rn->rn_right)) < 0)
+            return i;
+        rd->rd_prog[j].ri_x = rd->rd_len;
+        break;
+    case RXN_REP:
+        for (i=0; i<rn->rn_min; i++)
+            if ((j = rxdfa_emit(rd, rn->rn_left)) < 0)
+                return j;
+        if (rn->rn_max == -1){
+            if ((s = rxdfa_emit1(rd, RXI_SPLIT)) < 0)
+                return s;
+            rd->rd_prog[s].ri_x = s+1;
+            if ((i = rxdfa_emit(rd, rn->rn_left)) < 0)
+                return i;
+            if ((j = rxdfa_emit1(rd, RXI_JMP)) < 0)
+                return j;
+            rd->rd_prog[j].ri_x = s;
+            rd->rd_prog[s].ri_y = rd->rd_len;
+        }
+        else if ((n = rn->rn_max - rn->rn_min) > 0){
+            /* Nested optional: (e(e(e)?)?)? */
+            if ((split = calloc(n, sizeof(int))) == NULL){
+                clicon_err(OE_UNIX, errno, "calloc");
+                return -1;
+            }
+            for (i=0; i<n; i++){
+                if ((s = rxdfa_emit1(rd, RXI_SPLIT)) < 0 ||
+                    (j = rxdfa_emit(rd, rn->rn_left)) < 0){
+                    free(split);
+                    return s<0?s:j;
+                }
+                rd->rd_prog[s].ri_x = s+1;
+                split[i] = s;
+            }
+            for (i=0; i<n; i++)
+                rd->rd_prog[split[i]].ri_y = rd->rd_len;
+            free(split);
+        }
+        break;
+    }
+    return 0;
+}
+
+/*! Add the epsilon-closure of NFA instruction pc to a state set
+ */
+static void
+rxdfa_closure(struct regex_dfa *rd,
+              uint64_t         *set,
+              uint64_t         *visited,
+              int               pc)
+{
+    struct rxinst *ri;
+    int            sp = 0;
+
+    rd->rd_stack[sp++] = pc;
+    while (sp > 0){
+        pc = rd->rd_stack[--sp];
+        if (RXSET_ISSET(visited, pc))
+            continue;
+        RXSET_SET(visited, pc);
+        ri = &rd->rd_prog[pc];
+        switch (ri->ri_op){
+        case RXI_SPLIT:
+            rd->rd_stack[sp++] = ri->ri_y;
+            rd->rd_stack[sp++] = ri->ri_x;
+            break;
+        case RXI_JMP:
+            rd->rd_stack[sp++] = ri->ri_x;
+            break;
+        default:
+            RXSET_SET(set, pc);
+            break;
+        }
+    }
+}
+
+/*! Find or add DFA state with given set
+ * @param[in]  set   State set, consumed 
+ * @retval     i     Index of state
+ * @retval    -1     Error
+ * @retval    -2     Too many states
+ */
+static int
+rxdfa_state(struct regex_dfa *rd,
+            uint64_t         *set)
+{
+    struct rxdstate *ds;
+    int              i;
+    int              empty = 1;
+
+    for (i=0; i<rd->rd_nstates; i++)
+        if (memcmp(rd->rd_states[i]->ds_set, set, rd->rd_words*sizeof(uint64_t)) == 0){
+            free(set);
+            return i;
+        }
+    if (rd->rd_nstates >= REGEX_DFA_MAXSTATES){
+        free(set);
+        return -2;
+    }
+    if ((rd->rd_nstates % 16) == 0){
+        if ((rd->rd_states = realloc(rd->rd_states, (rd->rd_nstates+16)*sizeof(ds))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            free(set);
+            return -1;
+        }
+    }
+    if ((ds = malloc(sizeof(*ds))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        free(set);
+        return -1;
+    }
+    ds->ds_set = set;
+    ds->ds_match = RXSET_ISSET(set, rd->rd_len-1) != 0; /* Last is RXI_MATCH */
+    for (i=0; i<rd->rd_words; i++)
+        if (set[i])
+            empty = 0;
+    ds->ds_dead = empty;
+    for (i=0; i<REGEX_ASCII; i++)
+        ds->ds_next[i] = -1;
+    rd->rd_states[rd->rd_nstates] = ds;
+    return rd->rd_nstates++;
+}
+
+/*! Compute DFA transition from state on character
+ * @retval  i   Index of next state
+ * @retval -1   Error
+ * @retval -2   Too many states
+ */
+static int
+rxdfa_step(struct regex_dfa *rd,
+           int               si,
+           int               c)
+{
+    uint64_t      *set = NULL;
+    uint64_t      *visited = NULL;
+    uint64_t      *cur;
+    struct rxinst *ri;
+    int            pc;
+    int            i;
+
+    if ((set = calloc(rd->rd_words, sizeof(uint64_t))) == NULL ||
+        (visited = calloc(rd->rd_words, sizeof(uint64_t))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        if (set)
+            free(set);
+        return -1;
+    }
+    cur = rd->rd_states[si]->ds_set;
+    for (pc=0; pc<rd->rd_len; pc++){
+        if (!RXSET_ISSET(cur, pc))
+            continue;
+        ri = &rd->rd_prog[pc];
+        if (ri->ri_op == RXI_CLASS && RXBIT_ISSET(ri->ri_class, c))
+            rxdfa_closure(rd, set, visited, pc+1);
+    }
+    free(visited);
+    if ((i = rxdfa_state(rd, set)) >= 0)
+        rd->rd_states[si]->ds_next[c] = i;
+    return i;
+}
+
+static int
+regex_dfa_free(struct regex_dfa *rd)
+{
+    int i;
+
+    for (i=0; i<rd->rd_nstates; i++){
+        free(rd->rd_states[i]->ds_set);
+        free(rd->rd_states[i]);
+    }
+    if (rd->rd_states)
+        free(rd->rd_states);
+    if (rd->rd_prog)
+        free(rd->rd_prog);
+    if (rd->rd_stack)
+        free(rd->rd_stack);
+    free(rd);
+    return 0;
+}
+
+/*! Compile XSD regex to DFA (subset of syntax, ASCII only)
+ * @param[in]  pattern  XSD regex
+ * @param[out] rdp      Compiled DFA, free with regex_dfa_free
+ * @retval     1        OK
+ * @retval     0        Pattern not supported by fast path
+ * @retval    -1        Error
+ */
+static int
+regex_dfa_compile(char              *pattern,
+                  struct regex_dfa **rdp)
+{
+    int               retval = -1;
+    struct rxparse    rp = {pattern, NULL};
+    struct rxnode    *rn = NULL;
+    struct rxnode    *rnext;
+    struct regex_dfa *rd = NULL;
+    uint64_t         *set = NULL;
+    uint64_t         *visited = NULL;
+    int               ret;
+
+    if ((ret = rxparse_regex(&rp, &rn)) < 0)
+        goto done;
+    if (ret == 0 || *rp.rp_s != '\0')
+        goto fail;
+    if ((rd = malloc(sizeof(*rd))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(rd, 0, sizeof(*rd));
+    if ((ret = rxdfa_emit(rd, rn)) == -1)
+        goto done;
+    if (ret == -2)
+        goto fail;
+    if ((ret = rxdfa_emit1(rd, RXI_MATCH)) == -1)
+        goto done;
+    if (ret == -2)
+        goto fail;
+    rd->rd_words = (rd->rd_len + 63)/64;
+    /* Each SPLIT pushes at most two */
+    if ((rd->rd_stack = calloc(2*rd->rd_len+1, sizeof(int))) == NULL ||
+        (set = calloc(rd->rd_words, sizeof(uint64_t))) == NULL ||
+        (visited = calloc(rd->rd_words, sizeof(uint64_t))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    rxdfa_closure(rd, set, visited, 0);
+    ret = rxdfa_state(rd, set); /* Start state is 0 */
+    set = NULL;
+    if (ret == -1)
+        goto done;
+    *rdp = rd;
+    rd = NULL;
+    retval = 1;
+ done:
+    for (rn = rp.rp_nodes; rn; rn = rnext){
+        rnext = rn->rn_next;
+        free(rn);
+    }
+    if (set)
+        free(set);
+    if (visited)
+        free(visited);
+    if (rd)
+        regex_dfa_free(rd);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Match string with DFA
+ * @retval  1   Match
+ * @retval  0   No match
+ * @retval  2   Not decided, non-ASCII or too many states: use regexp engine
+ * @retval -1   Error
+ */
+static int
+regex_dfa_exec(struct regex_dfa *rd,
+               char             *string)
+{
+    unsigned char *s;
+    int            si = 0;
+    int            next;
+
+    for (s = (unsigned char*)string; *s; s++){
+        if (*s >= REGEX_ASCII)
+            return 2;
+        if ((next = rd->rd_states[si]->ds_next[*s]) < 0){
+            if ((next = rxdfa_step(rd, si, *s)) == -1)
+                return -1;
+            if (next == -2)
+                return 2;
+        }
+        si = next;
+        if (rd->rd_states[si]->ds_dead)
+            return 0;
+    }
+    return rd->rd_states[si]->ds_match;
+}
+
+/*-------------------------- Native validators -------------------------*/
+
+/*! Decimal octet: ([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])
+ */
+static int
+native_octet(char **sp)
+{
+    char *s = *sp;
+    int   n = 0;
+    int   v = 0;
+
+    while (s[n] >= '0' && s[n] <= '9' && n < 4)
+        v = v*10 + s[n++] - '0';
+    if (n == 0 || n > 3 || (n > 1 && s[0] == '0') || v > 255)
+        return 0;
+    *sp = s + n;
+    return 1;
+}
+
+/*! Dotted quad: (octet\.){3}octet
+ */
+static int
+native_quad(char **sp)
+{
+    int i;
+
+    for (i=0; i<4; i++){
+        if (i && *(*sp)++ != '.')
+            return 0;
+        if (native_octet(sp) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+static int
+native_hex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/*! Hex digits: [0-9a-fA-F]{n}
+ */
+static int
+native_hexn(char **sp,
+            int    n)
+{
+    int i;
+
+    for (i=0; i<n; i++)
+        if (!native_hex((*sp)[i]))
+            return 0;
+    *sp += n;
+    return 1;
+}
+
+/*! ietf-yang-types:dotted-quad
+ */
+static int
+native_dotted_quad(char *s)
+{
+    return native_quad(&s) && *s == '\0';
+}
+
+/*! ietf-inet-types:ipv4-address: dotted-quad(%[\p{N}\p{L}]+)?
+ */
+static int
+native_ipv4_address(char *s)
+{
+    if (native_quad(&s) == 0)
+        return 0;
+    if (*s == '\0')
+        return 1;
+    if (*s++ != '%' || *s == '\0')
+        return 0;
+    for (; *s; s++){
+        if ((unsigned char)*s >= REGEX_ASCII)
+            return 2; /* Unicode letters and numbers */
+        if (!((*s >= '0' && *s <= '9') || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z')))
+            return 0;
+    }
+    return 1;
+}
+
+/*! ietf-inet-types:ipv4-prefix: dotted-quad/(([0-9])|([1-2][0-9])|(3[0-2]))
+ */
+static int
+native_ipv4_prefix(char *s)
+{
+    if (native_quad(&s) == 0 || *s++ != '/')
+        return 0;
+    if (s[0] >= '0' && s[0] <= '9' && s[1] == '\0')
+        return 1;
+    if (((s[0] == '1' || s[0] == '2') && s[1] >= '0' && s[1] <= '9') ||
+        (s[0] == '3' && s[1] >= '0' && s[1] <= '2'))
+        return s[2] == '\0';
+    return 0;
+}
+
+/*! ietf-yang-types:mac-address: [0-9a-fA-F]{2}(:[0-9a-fA-F]{2}){5}
+ */
+static int
+native_mac_address(char *s)
+{
+    int i;
+
+    for (i=0; i<6; i++){
+        if (i && *s++ != ':')
+            return 0;
+        if (native_hexn(&s, 2) == 0)
+            return 0;
+    }
+    return *s == '\0';
+}
+
+/*! ietf-yang-types:hex-string and phys-address: ([0-9a-fA-F]{2}(:[0-9a-fA-F]{2})*)?
+ */
+static int
+native_hex_string(char *s)
+{
+    if (*s == '\0')
+        return 1;
+    if (native_hexn(&s, 2) == 0)
+        return 0;
+    while (*s){
+        if (*s++ != ':' || native_hexn(&s, 2) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*! ietf-yang-types:uuid
+ * [0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}
+ */
+static int
+native_uuid(char *s)
+{
+    int len[] = {8, 4, 4, 4, 12};
+    int i;
+
+    for (i=0; i<5; i++){
+        if (i && *s++ != '-')
+            return 0;
+        if (native_hexn(&s, len[i]) == 0)
+            return 0;
+    }
+    return *s == '\0';
+}
+
+#define RX_OCTET "([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])"
+#define RX_HEX2  "([0-9a-fA-F]{2}(:[0-9a-fA-F]{2})*)?"
+
+/* Built-in native validators
+ * The pattern is the (first) pattern of the typedef, the validator is only used if the
+ * typedef has the same pattern
+ */
+static const struct {
+    char            *module;
+    char            *name;
+    char            *pattern;
+    regex_native_fn *fn;
+} regex_native_builtin[] = {
+    {"ietf-inet-types", "ipv4-address",
+     "(" RX_OCTET "\\.){3}" RX_OCTET "(%[\\p{N}\\p{L}]+)?", native_ipv4_address},
+    {"ietf-inet-types", "ipv4-prefix",
+     "(" RX_OCTET "\\.){3}" RX_OCTET "/(([0-9])|([1-2][0-9])|(3[0-2]))", native_ipv4_prefix},
+    {"ietf-yang-types", "dotted-quad",
+     "(" RX_OCTET "\\.){3}" RX_OCTET, native_dotted_quad},
+    {"ietf-yang-types", "mac-address",
+     "[0-9a-fA-F]{2}(:[0-9a-fA-F]{2}){5}", native_mac_address},
+    {"ietf-yang-types", "phys-address", RX_HEX2, native_hex_string},
+    {"ietf-yang-types", "hex-string", RX_HEX2, native_hex_string},
+    {"ietf-yang-types", "uuid",
+     "[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}", native_uuid},
+    {NULL, NULL, NULL, NULL}
+};
+
+/*! Get native validator registry, create and add built-in validators if not exists
+ */
+static clicon_hash_t *
+regex_native_registry(clicon_handle h)
+{
+    clicon_hash_t      *reg = NULL;
+    struct regex_native rn;
+    char                key[256];
+    int                 i;
+
+    if (clicon_ptr_get(h, "regex_native", (void**)&reg) == 0 && reg != NULL)
+        return reg;
+    if ((reg = clicon_hash_init()) == NULL)
+        return NULL;
+    for (i=0; regex_native_builtin[i].module; i++){
+        snprintf(key, sizeof(key), "%s:%s",
+                 regex_native_builtin[i].module, regex_native_builtin[i].name);
+        rn.rn_pattern = regex_native_builtin[i].pattern;
+        rn.rn_fn = regex_native_builtin[i].fn;
+        if (clicon_hash_add(reg, key, &rn, sizeof(rn)) == NULL)
+            goto err;
+    }
+    if (clicon_ptr_set(h, "regex_native", reg) < 0)
+        goto err;
+    return reg;
+ err:
+    clicon_hash_free(reg);
+    return NULL;
+}
+
+/*! Register a native validator of the patterns of a typedef
+ *
+ * The validator replaces all pattern statements of the typedef. Patterns of types 
+ * derived from the typedef are validated as before.
+ * @param[in]  h        Clicon handle
+ * @param[in]  module   Name of module of typedef
+ * @param[in]  name     Name of typedef
+ * @param[in]  pattern  First pattern of typedef, or NULL. If given, the validator is only
+ *                      used if the typedef has this pattern. Not copied.
+ * @param[in]  fn       Validator
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @code
+ *   static int my_validator(char *str) { return str[0] == 'x'; }
+ *   if (regex_native_register(h, "my-types", "x-string", NULL, my_validator) < 0)
+ *      err;
+ * @endcode
+ * @note Must be made before the YANG specification is loaded
+ */
+int
+regex_native_register(clicon_handle    h,
+                      char            *module,
+                      char            *name,
+                      char            *pattern,
+                      regex_native_fn *fn)
+{
+    clicon_hash_t      *reg;
+    struct regex_native rn;
+    char                key[256];
+
+    if ((reg = regex_native_registry(h)) == NULL)
+        return -1;
+    snprintf(key, sizeof(key), "%s:%s", module, name);
+    rn.rn_pattern = pattern;
+    rn.rn_fn = fn;
+    if (clicon_hash_add(reg, key, &rn, sizeof(rn)) == NULL)
+        return -1;
+    return 0;
+}
+
+/*! Free native validator registry
+ * @param[in]  h        Clicon handle
+ */
+int
+regex_native_free(clicon_handle h)
+{
+    clicon_hash_t *reg = NULL;
+
+    if (clicon_ptr_get(h, "regex_native", (void**)&reg) == 0 && reg != NULL){
+        clicon_hash_free(reg);
+        clicon_ptr_del(h, "regex_native");
+    }
+    return 0;
+}
+
+/*! Compile fast path of a pattern, or of all patterns of a typedef
+ *
+ * Patterns are tagged with their typedef identity "module:typedef" as cv name, see 
+ * yang_type_resolve_restrictions.
+ * @param[in]  h        Clicon handle
+ * @param[in]  patterns All patterns of a type
+ * @param[in]  pcv      Pattern to compile, element of patterns
+ * @param[out] fast     Compiled fast path, free with regex_fast_free
+ * @retval     2        Native validator of all patterns of the same typedef as pcv
+ * @retval     1        Fast path of pcv only
+ * @retval     0        No fast path, use regex_compile
+ * @retval    -1        Error
+ */
+int
+regex_fast_compile(clicon_handle h,
+                   cvec         *patterns,
+                   cg_var       *pcv,
+                   void        **fast)
+{
+    int                  retval = -1;
+    struct regex_fast   *rf = NULL;
+    struct regex_native *rn = NULL;
+    struct regex_dfa    *rd = NULL;
+    clicon_hash_t       *reg;
+    cg_var              *cv;
+    char                *key;
+    int                  ret;
+    int                  n = 1;
+
+    *fast = NULL;
+    if ((key = cv_name_get(pcv)) != NULL){
+        if ((reg = regex_native_registry(h)) == NULL)
+            goto done;
+        if ((rn = clicon_hash_value(reg, key, NULL)) != NULL &&
+            rn->rn_pattern && strcmp(rn->rn_pattern, cv_string_get(pcv)) != 0)
+            rn = NULL;
+        /* Count patterns of typedef, native validators do not handle invert-match */
+        cv = pcv;
+        if (rn && cv_flag(cv, V_INVERT))
+            rn = NULL;
+        while (rn && (cv = cvec_each(patterns, cv)) != NULL &&
+               cv_name_get(cv) && strcmp(cv_name_get(cv), key) == 0){
+            if (cv_flag(cv, V_INVERT))
+                rn = NULL;
+            n++;
+        }
+    }
+    if (rn == NULL){
+        n = 1;
+        if ((ret = regex_dfa_compile(cv_string_get(pcv), &rd)) < 0)
+            goto done;
+        if (ret == 0){
+            retval = 0;
+            goto done;
+        }
+    }
+    if ((rf = malloc(sizeof(*rf))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(rf, 0, sizeof(*rf));
+    rf->rf_native = rn ? rn->rn_fn : NULL;
+    rf->rf_dfa = rd;
+    rd = NULL;
+    rf->rf_rxmode = clicon_yang_regexp(h);
+    if ((rf->rf_patterns = calloc(n, sizeof(char*))) == NULL ||
+        (rf->rf_regexps = calloc(n, sizeof(void*))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    cv = pcv;
+    for (rf->rf_len=0; rf->rf_len<n; rf->rf_len++){
+        if ((rf->rf_patterns[rf->rf_len] = strdup(cv_string_get(cv))) == NULL){
+            clicon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        cv = cvec_each(patterns, cv);
+    }
+    *fast = rf;
+    rf = NULL;
+    retval = rn ? 2 : 1;
+ done:
+    if (rd)
+        regex_dfa_free(rd);
+    if (rf)
+        regex_fast_free(rf);
+    return retval;
+}
+
+/*! Match string with fast path, fall back to regexp engine if not decided
+ * @param[in]  h       Clicon handle
+ * @param[in]  fast    Compiled fast path, see regex_fast_compile
+ * @param[in]  string  Content string to match
+ * @retval     1       Match
+ * @retval     0       No match
+ * @retval    -1       Error
+ */
+int
+regex_fast_exec(clicon_handle h,
+                void         *fast,
+                char         *string)
+{
+    struct regex_fast *rf = (struct regex_fast *)fast;
+    int                ret;
+    int                i;
+
+    if (rf->rf_native)
+        ret = rf->rf_native(string);
+    else
+        ret = regex_dfa_exec(rf->rf_dfa, string);
+    if (ret != 2)
+        return ret;
+    for (i=0; i<rf->rf_len; i++){
+        if (rf->rf_regexps[i] == NULL){
+            if ((ret = regex_compile(h, rf->rf_patterns[i], &rf->rf_regexps[i])) < 0)
+                return -1;
+            if (ret == 0){
+                clicon_err(OE_YANG, errno, "regexp compile fail: \"%s\"", rf->rf_patterns[i]);
+                return -1;
+            }
+        }
+        if ((ret = regex_exec(h, rf->rf_regexps[i], string)) < 1)
+            return ret;
+    }
+    return 1;
+}
+
+/*! Free fast path
+ * @param[in]  fast    Compiled fast path, see regex_fast_compile
+ */
+int
+regex_fast_free(void *fast)
+{
+    struct regex_fast *rf = (struct regex_fast *)fast;
+    int                i;
+
+    if (rf->rf_dfa)
+        regex_dfa_free(rf->rf_dfa);
+    for (i=0; i<rf->rf_len; i++){
+        if (rf->rf_patterns && rf->rf_patterns[i])
+            free(rf->rf_patterns[i]);
+        if (rf->rf_regexps && rf->rf_regexps[i]){
+            switch (rf->rf_rxmode){
+            case REGEXP_POSIX:
+                cligen_regex_posix_free(rf->rf_regexps[i]);
+                free(rf->rf_regexps[i]);
+                break;
+            case REGEXP_LIBXML2:
+                cligen_regex_libxml2_free(rf->rf_regexps[i]);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    if (rf->rf_patterns)
+        free(rf->rf_patterns);
+    if (rf->rf_regexps)
+        free(rf->rf_regexps);
+    free(rf);
+    return 0;
+}
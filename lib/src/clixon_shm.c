@@ -0,0 +1,380 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Shared-memory ring buffer for replies from backend to co-located clients
+ *
+ * The client creates a shared memory segment and passes its file descriptor to the backend
+ * over the UNIX socket (SCM_RIGHTS) together with the internal hello. The backend then may
+ * write a reply into the ring and send a small descriptor message on the socket instead of
+ * the reply itself. The socket thus remains for control and wakeups, and replies are read
+ * in order of the descriptors.
+ * The backend is the only producer and advances the head, the client is the only consumer
+ * and advances the tail. Positions increase monotonically and are taken modulo the ring size.
+ * The segment is writable by the client, the backend therefore keeps its own copy of the
+ * head, checks the tail before use, and requires the size of the segment to be sealed.
+ * Descriptor message body (integers in network byte order):
+ *   4 bytes  magic: "\0CXS"
+ *   4 bytes  length of reply
+ *   8 bytes  ring position of reply
+ *   1 byte   NUL
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#if defined(HAVE_MEMFD_CREATE) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* memfd_create, file seals */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_proto.h"
+#include "clixon_shm.h"
+
+/*
+ * Constants
+ */
+#define CLICON_SHM_HDR_MAGIC 0x43585348 /* "CXSH" */
+#define CLICON_SHM_DESCLEN   17         /* Descriptor message body length */
+
+/*
+ * Types
+ */
+/* Header at start of shared memory segment, followed by ring data */
+struct clicon_shm_hdr {
+    uint32_t sh_magic;   /* CLICON_SHM_HDR_MAGIC */
+    uint32_t sh_size;    /* Size of ring data */
+    uint64_t sh_head;    /* Write position, advanced by backend */
+    uint64_t sh_tail;    /* Read position, advanced by client */
+};
+
+/* Process-local handle of a mapped segment */
+struct clicon_shm {
+    struct clicon_shm_hdr *sm_hdr;   /* Mapped segment */
+    size_t                 sm_len;   /* Length of mapping */
+    char                  *sm_data;  /* Ring data */
+    uint32_t               sm_size;  /* Size of ring data */
+    uint64_t               sm_head;  /* Write position, private copy of producer */
+};
+
+/*! Map a shared memory segment
+ */
+static int
+shm_map(int                 fd,
+        size_t              len,
+        struct clicon_shm **shmp)
+{
+    struct clicon_shm *shm;
+    void              *addr;
+
+    if ((addr = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+        clicon_err(OE_UNIX, errno, "mmap");
+        return -1;
+    }
+    if ((shm = calloc(1, sizeof(*shm))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        munmap(addr, len);
+        return -1;
+    }
+    shm->sm_hdr = addr;
+    shm->sm_len = len;
+    shm->sm_data = (char*)addr + sizeof(struct clicon_shm_hdr);
+    shm->sm_size = len - sizeof(struct clicon_shm_hdr);
+    *shmp = shm;
+    return 0;
+}
+
+/*! Create a shared memory ring, client side
+ *
+ * @param[in]  size  Size of ring in bytes
+ * @param[out] fdp   File descriptor of segment, to be sent to backend and then closed
+ * @param[out] shmp  Shared memory handle, free with clicon_shm_free
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+int
+clicon_shm_create(uint32_t            size,
+                  int                *fdp,
+                  struct clicon_shm **shmp)
+{
+    int    fd = -1;
+    size_t len;
+#ifndef HAVE_MEMFD_CREATE
+    char   name[64];
+#endif
+
+    len = sizeof(struct clicon_shm_hdr) + size;
+#ifdef HAVE_MEMFD_CREATE
+    if ((fd = memfd_create("clixon-shm", MFD_CLOEXEC|MFD_ALLOW_SEALING)) < 0){
+        clicon_err(OE_UNIX, errno, "memfd_create");
+        goto err;
+    }
+#else
+    snprintf(name, sizeof(name), "/clixon-shm-%d-%p", getpid(), (void*)&len);
+    if ((fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0600)) < 0){
+        clicon_err(OE_UNIX, errno, "shm_open");
+        goto err;
+    }
+    shm_unlink(name); /* Only accessible via fd */
+#endif
+    if (ftruncate(fd, len) < 0){
+        clicon_err(OE_UNIX, errno, "ftruncate");
+        goto err;
+    }
+#ifdef F_SEAL_GROW
+    /* Backend requires that the size cannot change while mapped */
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_SEAL) < 0){
+        clicon_err(OE_UNIX, errno, "fcntl(F_ADD_SEALS)");
+        goto err;
+    }
+#endif
+    if (shm_map(fd, len, shmp) < 0)
+        goto err;
+    (*shmp)->sm_hdr->sh_magic = CLICON_SHM_HDR_MAGIC;
+    (*shmp)->sm_hdr->sh_size = size;
+    *fdp = fd;
+    return 0;
+ err:
+    if (fd != -1)
+        close(fd);
+    return -1;
+}
+
+/*! Attach a shared memory ring created by a client, backend side
+ *
+ * The segment must be sealed against shrinking and growing, so that the client cannot
+ * truncate it while mapped, and the ring must be empty.
+ * @param[in]  fd    File descriptor received from client, may be closed after attach
+ * @param[out] shmp  Shared memory handle, free with clicon_shm_free
+ * @retval     1     OK
+ * @retval     0     Not a valid segment
+ * @retval    -1     Error
+ */
+int
+clicon_shm_attach(int                 fd,
+                  struct clicon_shm **shmp)
+{
+    struct stat st;
+    uint64_t    head;
+#ifdef F_GET_SEALS
+    int         seals;
+
+    if ((seals = fcntl(fd, F_GET_SEALS)) < 0 ||
+        (seals & (F_SEAL_SHRINK|F_SEAL_GROW)) != (F_SEAL_SHRINK|F_SEAL_GROW))
+        return 0;
+#endif
+    if (fstat(fd, &st) < 0){
+        clicon_err(OE_UNIX, errno, "fstat");
+        return -1;
+    }
+    if (st.st_size <= sizeof(struct clicon_shm_hdr) || st.st_size > UINT32_MAX)
+        return 0;
+    if (shm_map(fd, st.st_size, shmp) < 0)
+        return -1;
+    head = __atomic_load_n(&(*shmp)->sm_hdr->sh_head, __ATOMIC_ACQUIRE);
+    if ((*shmp)->sm_hdr->sh_magic != CLICON_SHM_HDR_MAGIC ||
+        (*shmp)->sm_hdr->sh_size != (*shmp)->sm_size ||
+        __atomic_load_n(&(*shmp)->sm_hdr->sh_tail, __ATOMIC_ACQUIRE) != head){
+        clicon_shm_free(*shmp);
+        *shmp = NULL;
+        return 0;
+    }
+    (*shmp)->sm_head = head;
+    return 1;
+}
+
+/*! Unmap and free shared memory handle
+ */
+int
+clicon_shm_free(struct clicon_shm *shm)
+{
+    if (shm){
+        munmap(shm->sm_hdr, shm->sm_len);
+        free(shm);
+    }
+    return 0;
+}
+
+/*! Write reply to ring and create descriptor message, backend side
+ *
+ * @param[in]  shm    Shared memory handle
+ * @param[in]  data   Reply
+ * @param[in]  len    Length of reply
+ * @param[out] msgp   Descriptor message to send on socket, free with free()
+ * @retval     1      OK, msgp set
+ * @retval     0      Not enough free space in ring, or ring is invalid, send reply on socket
+ * @retval    -1      Error
+ * @note The head is taken from the private copy, and the tail written by the client is
+ *       checked against it, so that an invalid tail cannot make the backend write outside
+ *       the ring or overwrite unread replies
+ */
+int
+clicon_shm_put(struct clicon_shm  *shm,
+               char               *data,
+               size_t              len,
+               struct clicon_msg **msgp)
+{
+    struct clicon_msg *msg;
+    uint64_t           head;
+    uint64_t           tail;
+    uint32_t           i;
+    uint32_t           n;
+    uint32_t           u32;
+
+    if (len > shm->sm_size)
+        return 0;
+    head = shm->sm_head;
+    tail = __atomic_load_n(&shm->sm_hdr->sh_tail, __ATOMIC_ACQUIRE);
+    if (tail > head || head - tail > shm->sm_size){
+        clicon_log(LOG_WARNING, "%s: invalid shared memory ring tail", __FUNCTION__);
+        return 0;
+    }
+    if (len > shm->sm_size - (head - tail))
+        return 0;
+    if ((msg = calloc(1, sizeof(*msg) + CLICON_SHM_DESCLEN)) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    i = head % shm->sm_size;
+    n = shm->sm_size - i; /* Contiguous space until end of ring */
+    if (len <= n)
+        memcpy(shm->sm_data + i, data, len);
+    else{
+        memcpy(shm->sm_data + i, data, n);
+        memcpy(shm->sm_data, data + n, len - n);
+    }
+    /* Reply is written before head is advanced */
+    shm->sm_head = head + len;
+    __atomic_store_n(&shm->sm_hdr->sh_head, shm->sm_head, __ATOMIC_RELEASE);
+    msg->op_len = htonl(sizeof(*msg) + CLICON_SHM_DESCLEN);
+    memcpy(msg->op_body, CLICON_SHM_MAGIC, 4);
+    u32 = htonl(len);
+    memcpy(msg->op_body + 4, &u32, 4);
+    u32 = htonl(head >> 32);
+    memcpy(msg->op_body + 8, &u32, 4);
+    u32 = htonl(head & 0xffffffff);
+    memcpy(msg->op_body + 12, &u32, 4);
+    *msgp = msg;
+    return 1;
+}
+
+/*! Check if message is a shared memory descriptor
+ *
+ * @param[in]  msg  Message
+ * @retval     1    Descriptor
+ * @retval     0    Not descriptor
+ */
+int
+clicon_msg_isshm(struct clicon_msg *msg)
+{
+    return ntohl(msg->op_len) == sizeof(*msg) + CLICON_SHM_DESCLEN &&
+        memcmp(msg->op_body, CLICON_SHM_MAGIC, 4) == 0;
+}
+
+/*! Read reply given by descriptor from ring, client side
+ *
+ * The ring space of the reply is released.
+ * @param[in]  shm    Shared memory handle
+ * @param[in]  desc   Descriptor message
+ * @param[out] msgp   Reply message as if received on socket, free with free()
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+clicon_shm_get(struct clicon_shm  *shm,
+               struct clicon_msg  *desc,
+               struct clicon_msg **msgp)
+{
+    struct clicon_msg *msg;
+    uint64_t           pos;
+    uint64_t           head;
+    uint32_t           len;
+    uint32_t           u32;
+    uint32_t           i;
+    uint32_t           n;
+
+    memcpy(&u32, desc->op_body + 4, 4);
+    len = ntohl(u32);
+    memcpy(&u32, desc->op_body + 8, 4);
+    pos = (uint64_t)ntohl(u32) << 32;
+    memcpy(&u32, desc->op_body + 12, 4);
+    pos |= ntohl(u32);
+    head = __atomic_load_n(&shm->sm_hdr->sh_head, __ATOMIC_ACQUIRE);
+    if (pos != shm->sm_hdr->sh_tail || len > head - pos){
+        clicon_err(OE_PROTO, 0, "Shared memory descriptor out of sequence");
+        return -1;
+    }
+    /* Terminating null added, as for messages received on socket */
+    if ((msg = malloc(sizeof(*msg) + len + 1)) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return -1;
+    }
+    msg->op_len = htonl(sizeof(*msg) + len + 1);
+    msg->op_id = desc->op_id;
+    i = pos % shm->sm_size;
+    n = shm->sm_size - i;
+    if (len <= n)
+        memcpy(msg->op_body, shm->sm_data + i, len);
+    else{
+        memcpy(msg->op_body, shm->sm_data + i, n);
+        memcpy(msg->op_body + n, shm->sm_data, len - n);
+    }
+    msg->op_body[len] = '\0';
+    /* Reply is copied before space is released */
+    __atomic_store_n(&shm->sm_hdr->sh_tail, pos + len, __ATOMIC_RELEASE);
+    *msgp = msg;
+    return 0;
+}
@@ -80,6 +80,8 @@
 #include "clixon_yang.h"
 #include "clixon_xml.h"
 #include "clixon_xml_io.h"
+#include "clixon_json.h"
+#include "clixon_proto.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
@@ -90,6 +92,196 @@
 /* Go through and timeout subscription timers [s] */
 #define STREAM_TIMER_TIMEOUT_S 5
 
+/* Serializations of the event being distributed, made at most once per event and shared
+ * by all subscription callbacks. Cleared when the event has been distributed.
+ * @see stream_event_cbuf
+ */
+struct stream_event_cache{
+    cxobj  *ec_event;           /* Event */
+    cbuf   *ec_xml;             /* Event as XML, or NULL */
+    cbuf   *ec_json;            /* Event as JSON, or NULL */
+    void   *ec_arg;             /* Shared by subscribers, eg encoded message */
+    void  (*ec_freefn)(void *); /* Release of ec_arg */
+};
+
+static struct stream_event_cache _event_cache = {0,};
+
+/*! Clear event cache
+ */
+static void
+stream_event_clear(void)
+{
+    struct stream_event_cache *ec = &_event_cache;
+
+    if (ec->ec_xml)
+        cbuf_free(ec->ec_xml);
+    if (ec->ec_json)
+        cbuf_free(ec->ec_json);
+    if (ec->ec_arg && ec->ec_freefn)
+        ec->ec_freefn(ec->ec_arg);
+    memset(ec, 0, sizeof(*ec));
+}
+
+/*! Get event cache of an event, clear it if it belongs to another event
+ */
+static struct stream_event_cache *
+stream_event_cache(cxobj *event)
+{
+    if (_event_cache.ec_event != event){
+        stream_event_clear();
+        _event_cache.ec_event = event;
+    }
+    return &_event_cache;
+}
+
+/*! Get serialized event in a subscription callback, serialize only once per event
+ *
+ * @param[in]  event   Event as given to subscription callback
+ * @param[in]  format  FORMAT_XML or FORMAT_JSON
+ * @param[out] cbp     Serialized event. Valid until the callback returns, do not free
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @code
+ *   cbuf *cb;
+ *   if (stream_event_cbuf(event, FORMAT_XML, &cb) < 0)
+ *      err;
+ * @endcode
+ * @see stream_ss_add
+ */
+int
+stream_event_cbuf(cxobj            *event,
+                  enum format_enum  format,
+                  cbuf            **cbp)
+{
+    int                        retval = -1;
+    struct stream_event_cache *ec;
+    cbuf                     **cbc = NULL;
+
+    ec = stream_event_cache(event);
+    switch (format){
+    case FORMAT_XML:
+        cbc = &ec->ec_xml;
+        break;
+    case FORMAT_JSON:
+        cbc = &ec->ec_json;
+        break;
+    default:
+        clicon_err(OE_XML, EINVAL, "Format %s not supported", format_int2str(format));
+        goto done;
+    }
+    if (*cbc == NULL){
+        if ((*cbc = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if (format == FORMAT_XML){
+            if (clixon_xml2cbuf(*cbc, event, 0, 0, -1, 0) < 0)
+                goto done;
+        }
+        else if (clixon_json2cbuf(*cbc, event, 0, 0, 0) < 0)
+            goto done;
+    }
+    *cbp = *cbc;
+    retval = 0;
+ done:
+    if (retval < 0 && cbc && *cbc){
+        cbuf_free(*cbc);
+        *cbc = NULL;
+    }
+    return retval;
+}
+
+/*! Get data shared by subscription callbacks of an event
+ *
+ * @param[in]  event   Event as given to subscription callback
+ * @retval     arg     Data set by an earlier callback of the same event
+ * @retval     NULL    Not set
+ * @see stream_event_shared_set
+ */
+void *
+stream_event_shared_get(cxobj *event)
+{
+    return stream_event_cache(event)->ec_arg;
+}
+
+/*! Set data shared by subscription callbacks of an event, eg an encoded message
+ *
+ * @param[in]  event   Event as given to subscription callback
+ * @param[in]  arg     Data
+ * @param[in]  freefn  Called with arg when the event has been distributed, or NULL
+ * @retval     0       OK
+ */
+int
+stream_event_shared_set(cxobj  *event,
+                        void   *arg,
+                        void  (*freefn)(void *))
+{
+    struct stream_event_cache *ec;
+
+    ec = stream_event_cache(event);
+    if (ec->ec_arg && ec->ec_freefn)
+        ec->ec_freefn(ec->ec_arg);
+    ec->ec_arg = arg;
+    ec->ec_freefn = freefn;
+    return 0;
+}
+
+/*! Get filter of a stream with the same xpath, or create it
+ *
+ * @param[in]  es     Event stream
+ * @param[in]  xpath  Filter selector
+ * @retval     sf     Filter
+ * @retval     NULL   Error, eg xpath parse error
+ */
+static struct stream_filter *
+stream_filter_get(event_stream_t *es,
+                  char           *xpath)
+{
+    struct stream_filter *sf;
+
+    if ((sf = es->es_filters) != NULL)
+        do {
+            if (strcmp(sf->sf_xpath, xpath) == 0){
+                sf->sf_refs++;
+                return sf;
+            }
+            sf = NEXTQ(struct stream_filter *, sf);
+        } while (sf != es->es_filters);
+    if ((sf = malloc(sizeof(*sf))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(sf, 0, sizeof(*sf));
+    if ((sf->sf_xpath = strdup(xpath)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        free(sf);
+        return NULL;
+    }
+    if (xpath_parse(xpath, &sf->sf_xpt) < 0){
+        free(sf->sf_xpath);
+        free(sf);
+        return NULL;
+    }
+    sf->sf_refs = 1;
+    ADDQ(sf, es->es_filters);
+    return sf;
+}
+
+/*! Release filter of a subscription, free it if not used by other subscriptions
+ */
+static void
+stream_filter_release(event_stream_t       *es,
+                      struct stream_filter *sf)
+{
+    if (--sf->sf_refs > 0)
+        return;
+    DELQ(sf, es->es_filters, struct stream_filter *);
+    if (sf->sf_xpt)
+        xpath_tree_free(sf->sf_xpt);
+    free(sf->sf_xpath);
+    free(sf);
+}
+
 /*! Find an event notification stream given name
  * @param[in]  h    Clicon handle
  * @param[in]  name Name of stream
@@ -148,6 +340,9 @@ stream_add(clicon_handle   h,
     es->es_replay_enabled = replay_enabled;
     if (retention)
         es->es_retention = *retention;
+    if (replay_enabled &&
+        stream_replay_ring_new(h, name, &es->es_replay) < 0)
+        goto done;
     clicon_stream_append(h, es);
  ok:
     retval = 0;
@@ -163,7 +358,6 @@ int
 stream_delete_all(clicon_handle h,
                   int           force)
 {
-    struct stream_replay *r;
     struct stream_subscription *ss;
     event_stream_t       *es;
     event_stream_t       *head = clicon_stream(h);
@@ -177,12 +371,8 @@ stream_delete_all(clicon_handle h,
             free(es->es_description);
         while ((ss = es->es_subscription) != NULL)
             stream_ss_rm(h, es, ss, force); /* XXX in some cases leaks memory due to DONT clause in stream_ss_rm() */
-        while ((r = es->es_replay) != NULL){
-            DELQ(r, es->es_replay, struct stream_replay *);
-            if (r->r_xml)
-                xml_free(r->r_xml);
-            free(r);
-        }
+        if (es->es_replay)
+            stream_replay_ring_free(es->es_replay);
         free(es);
     }
     return 0;
@@ -248,8 +438,6 @@ stream_timer_setup(int   fd,
     event_stream_t              *es;
     struct stream_subscription  *ss;
     struct stream_subscription  *ss1;
-    struct stream_replay        *r;
-    struct stream_replay        *r1;
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     /* Go thru callbacks and see if any have timed out, if so remove them 
@@ -277,21 +465,9 @@ stream_timer_setup(int   fd,
                         ss = NEXTQ(struct stream_subscription *, ss);
                 } while (ss && ss != es->es_subscription);
   /* 2) Go throughreplay buffer and remove entries with passed retention time */
-            if (timerisset(&es->es_retention) &&
-                (r = es->es_replay) != NULL){
+            if (timerisset(&es->es_retention) && es->es_replay){
                 timersub(&now, &es->es_retention, &tret);
-                do {
-                    if (timercmp(&r->r_tv, &tret, <)){
-                        r1 = NEXTQ(struct stream_replay *, r);
-                        DELQ(r, es->es_replay, struct stream_replay *);
-                        if (r->r_xml)
-                            xml_free(r->r_xml);
-                        free(r);
-                        r = r1;
-                    }
-                    else
-                        r = NEXTQ(struct stream_replay *, r);
-                } while (r && r!=es->es_replay);
+                stream_replay_ring_expire(es->es_replay, &tret);
             }
             es = NEXTQ(struct event_stream *, es);
         } while (es && es != clicon_stream(h));
@@ -364,13 +540,22 @@ stream_ss_add(clicon_handle     h,
         clicon_err(OE_CFG, errno, "strdup");
         goto done;
     }
+    /* Subscriptions with the same filter share it */
+    if (xpath && strlen(xpath) &&
+        (ss->ss_filter = stream_filter_get(es, xpath)) == NULL)
+        goto done;
     ss->ss_fn     = fn;
     ss->ss_arg    = arg;
     ADDQ(ss, es->es_subscription);
     return ss;
   done:
-    if (ss)
+    if (ss){
+        if (ss->ss_stream)
+            free(ss->ss_stream);
+        if (ss->ss_xpath)
+            free(ss->ss_xpath);
         free(ss);
+    }
     return NULL;
 }
 
@@ -390,6 +575,10 @@ stream_ss_rm(clicon_handle                h,
 {
     clicon_debug(1, "%s", __FUNCTION__);
     DELQ(ss, es->es_subscription, struct stream_subscription *);
+    if (ss->ss_filter){
+        stream_filter_release(es, ss->ss_filter);
+        ss->ss_filter = NULL;
+    }
     /* Remove from upper layers - close socket etc. */
     (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
     if (force){
@@ -501,8 +690,23 @@ stream_notify1(clicon_handle   h,
 {
     int                         retval = -1;
     struct stream_subscription *ss;
+    struct stream_filter       *sf;
+    xp_ctx                     *xr = NULL;
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    /* Evaluate each filter once, an error is no match */
+    if ((sf = es->es_filters) != NULL)
+        do {
+            sf->sf_match = 0;
+            if (xpath_tree_ctx(xevent, NULL, sf->sf_xpt, 0, &xr) == 0 &&
+                xr && xr->xc_type == XT_NODESET && xr->xc_size)
+                sf->sf_match = 1;
+            if (xr){
+                ctx_free(xr);
+                xr = NULL;
+            }
+            sf = NEXTQ(struct stream_filter *, sf);
+        } while (sf != es->es_filters);
     /* Go thru all subscriptions and find matches */
     if ((ss = es->es_subscription) != NULL)
         do {
@@ -516,9 +720,7 @@ stream_notify1(clicon_handle   h,
                 ss = ss1;
             }
             else{  /* xpath match */
-                if (ss->ss_xpath == NULL ||
-                    strlen(ss->ss_xpath)==0 ||
-                    xpath_first(xevent, NULL, "%s", ss->ss_xpath) != NULL)
+                if (ss->ss_filter == NULL || ss->ss_filter->sf_match)
                     if ((*ss->ss_fn)(h, 0, xevent, ss->ss_arg) < 0)
                         goto done;
                 ss = NEXTQ(struct stream_subscription *, ss);
@@ -596,11 +798,11 @@ stream_notify(clicon_handle h,
     if (es->es_replay_enabled){
         if (stream_replay_add(es, &tv, xev) < 0)
             goto done;
-        xev = NULL; /* xml stored in replay_add and should not be freed */
     }
  ok:
     retval = 0;
   done:
+    stream_event_clear(); /* Serializations are not valid after event is freed */
     if (cb)
         cbuf_free(cb);
     if (xev)
@@ -665,11 +867,11 @@ stream_notify_xml(clicon_handle h,
     if (es->es_replay_enabled){
         if (stream_replay_add(es, &tv, xev) < 0)
             goto done;
-        xev = NULL; /* xml stored in replay_add and should not be freed */
     }
  ok:
     retval = 0;
   done:
+    stream_event_clear(); /* Serializations are not valid after event is freed */
     if (cb)
         cbuf_free(cb);
     if (xev)
@@ -710,61 +912,86 @@ stream_replay_notify(clicon_handle               h,
                      event_stream_t             *es,
                      struct stream_subscription *ss)
 {
-    int                   retval = -1;
-    struct stream_replay *r;
+    int             retval = -1;
+    uint32_t        i;
+    struct timeval  tv;
+    cbuf           *cb = NULL;
+    cxobj          *xt = NULL;
+    cxobj          *xev;
+    yang_stmt      *yspec;
 
     /* If <startTime> is not present, this is not a replay */
     if (!timerisset(&ss->ss_starttime))
         goto ok;
-    if (!es->es_replay_enabled)
+    if (!es->es_replay_enabled || es->es_replay == NULL)
         goto ok;
-    /* Get replay linked list */
-    if ((r = es->es_replay) == NULL)
-        goto ok;
-    /* First loop to skip until start */
-    do {
-        if (timercmp(&r->r_tv, &ss->ss_starttime, >=))
-            break;
-        r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
-    if (r == NULL)
-        goto ok; /* No samples to replay */
-    /* Then notify until stop */
-    do {
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+        clicon_err(OE_YANG, 0, "No yang spec");
+        goto done;
+    }
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    /* Binary search for start, then notify until stop */
+    for (i = stream_replay_ring_find(es->es_replay, &ss->ss_starttime);
+         i < stream_replay_ring_len(es->es_replay);
+         i++){
+        cbuf_reset(cb);
+        if (stream_replay_ring_get(es->es_replay, i, &tv, cb) < 0)
+            goto done;
         if (timerisset(&ss->ss_stoptime) &&
-            timercmp(&r->r_tv, &ss->ss_stoptime, >))
+            timercmp(&tv, &ss->ss_stoptime, >))
             break;
-        if ((*ss->ss_fn)(h, 0, r->r_xml, ss->ss_arg) < 0)
+        if (clixon_xml_parse_string(cbuf_get(cb), YB_MODULE, yspec, &xt, NULL) < 0)
             goto done;
-        r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
+        if ((xev = xml_child_i_type(xt, 0, CX_ELMNT)) != NULL &&
+            (*ss->ss_fn)(h, 0, xev, ss->ss_arg) < 0)
+            goto done;
+        stream_event_clear();
+        xml_free(xt);
+        xt = NULL;
+    }
  ok:
     retval = 0;
  done:
+    stream_event_clear();
+    if (xt)
+        xml_free(xt);
+    if (cb)
+        cbuf_free(cb);
     return retval;
 }
 
 /*! Add replay sample to stream with timestamp
+ *
+ * The event is stored serialized, oldest events are dropped if the replay store is full
  * @param[in] es   Stream
  * @param[in] tv   Timestamp
- * @param[in] xv   XML
+ * @param[in] xv   XML, not consumed
+ * @retval    0    OK
+ * @retval   -1    Error
  */
 int
 stream_replay_add(event_stream_t *es,
                   struct timeval *tv,
                   cxobj          *xv)
 {
-    int                   retval = -1;
-    struct stream_replay *new;
+    int   retval = -1;
+    cbuf *cb;
+    int   ret;
 
-    if ((new = malloc(sizeof *new)) == NULL){
-        clicon_err(OE_UNIX, errno, "malloc");
+    if (es->es_replay == NULL)
+        goto ok;
+    /* Same serialization as sent to subscribers */
+    if (stream_event_cbuf(xv, FORMAT_XML, &cb) < 0)
         goto done;
-    }
-    memset(new, 0, (sizeof *new));
-    new->r_tv = *tv;
-    new->r_xml = xv;
-    ADDQ(new, es->es_replay);
+    if ((ret = stream_replay_ring_add(es->es_replay, tv, cbuf_get(cb), cbuf_len(cb))) < 0)
+        goto done;
+    if (ret == 0)
+        clicon_log(LOG_WARNING, "%s: event of %zu bytes larger than replay store of stream %s, not stored",
+                   __FUNCTION__, cbuf_len(cb), es->es_name);
+ ok:
     retval = 0;
  done:
     return retval;
@@ -860,6 +1087,15 @@ stream_replay_trigger(clicon_handle h,
 
 #include <curl/curl.h>
 
+/* Max events queued but not yet posted per stream, further events are dropped */
+#define PUBLISH_QUEUE_MAX   1024
+
+/* Max number of retries of a failed post, then the events are dropped */
+#define PUBLISH_RETRY_MAX   5
+
+/* Max backoff between retries [s], doubled from 1s */
+#define PUBLISH_BACKOFF_MAX 32
+
 /*
  * Types (curl)
  */
@@ -868,6 +1104,38 @@ struct curlbuf{
     char  *b_buf;
 };
 
+/* Event queued for publishing */
+struct publish_event{
+    qelem_t         pe_q;       /* queue header */
+    cbuf           *pe_cb;      /* Event as XML */
+};
+
+/* Asynchronous publisher of one stream.
+ * Events are queued and posted with curl-multi, driven by the clixon event loop.
+ * One post per stream is in flight at a time, so that events are published in order.
+ * A post contains one event, or up to CLICON_STREAM_PUB_BATCH events if set.
+ */
+struct publish_stream{
+    qelem_t               ps_q;       /* queue header */
+    char                 *ps_stream;  /* Name of stream */
+    char                 *ps_url;     /* Publish URL */
+    struct publish_event *ps_queue;   /* Events not yet posted */
+    int                   ps_nqueue;  /* Number of events in ps_queue */
+    int                   ps_batch;   /* Max number of events in one post */
+    cbuf                 *ps_body;    /* Events being posted, or NULL */
+    CURL                 *ps_curl;    /* Post in flight, or NULL */
+    struct curlbuf        ps_reply;   /* Reply of post in flight */
+    int                   ps_retries; /* Failed posts of ps_body */
+    int                   ps_backoff; /* Failed post of ps_body waits for retry timer */
+    uint32_t              ps_dropped; /* Events dropped since last log */
+};
+
+static CURLM                 *_publish_multi = NULL;
+static struct publish_stream *_publish_streams = NULL;
+
+static int publish_post(struct publish_stream *ps);
+static int publish_retry_cb(int fd, void *arg);
+
 /*
  * For the asynchronous case. I think we must handle the case where of many of these
  * come in before we can handle them in the upper-level polling routine.
@@ -891,73 +1159,255 @@ curl_get_cb(void *ptr,
     return len;
 }
 
-/*! Send a curl POST request
- * @retval  -1   fatal error
- * @retval   0   expect set but did not expected return or other non-fatal error
- * @retval   1   ok
- * Note: curl_easy_perform blocks
- * Note: New handle is created every time, the handle can be re-used for better TCP performance
- * @see same function (url_post) in grideye_curl.c
+/*! Post of a stream is completed, successfully or not
+ *
+ * On success, the queued events are posted next. On failure, the post is retried with
+ * exponential backoff, and dropped after PUBLISH_RETRY_MAX retries.
+ * @param[in]  ps      Publisher
+ * @param[in]  result  Curl result
  */
 static int
-url_post(char *url, 
-         char *postfields, 
-         char **getdata)
+publish_done(struct publish_stream *ps,
+             CURLcode               result)
 {
     int            retval = -1;
-    CURL          *curl = NULL;
-    char          *err = NULL;
-    struct curlbuf cb = {0, };
-    CURLcode       errcode;
+    struct timeval t;
+    struct timeval t1 = {0,};
 
-    /* Try it with  curl -X PUT -d '*/
-    clicon_debug(1, "%s:  curl -X POST -d '%s' %s",
-        __FUNCTION__, postfields, url);
-    /* Set up curl for doing the communication with the controller */
-    if ((curl = curl_easy_init()) == NULL) {
-        clicon_debug(1, "curl_easy_init");
+    curl_multi_remove_handle(_publish_multi, ps->ps_curl);
+    curl_easy_cleanup(ps->ps_curl);
+    ps->ps_curl = NULL;
+    if (ps->ps_reply.b_buf){
+        clicon_debug(1, "%s: %s", __FUNCTION__, ps->ps_reply.b_buf);
+        free(ps->ps_reply.b_buf);
+    }
+    memset(&ps->ps_reply, 0, sizeof(ps->ps_reply));
+    if (result == CURLE_OK){
+        cbuf_free(ps->ps_body);
+        ps->ps_body = NULL;
+        ps->ps_retries = 0;
+    }
+    else if (++ps->ps_retries > PUBLISH_RETRY_MAX){
+        clicon_log(LOG_WARNING, "%s: publish %s failed: %s, events dropped",
+                   __FUNCTION__, ps->ps_url, curl_easy_strerror(result));
+        cbuf_free(ps->ps_body);
+        ps->ps_body = NULL;
+        ps->ps_retries = 0;
+    }
+    else{
+        clicon_debug(1, "%s: publish %s failed: %s, retry %d", __FUNCTION__,
+                     ps->ps_url, curl_easy_strerror(result), ps->ps_retries);
+        t1.tv_sec = 1 << (ps->ps_retries - 1);
+        if (t1.tv_sec > PUBLISH_BACKOFF_MAX)
+            t1.tv_sec = PUBLISH_BACKOFF_MAX;
+        gettimeofday(&t, NULL);
+        timeradd(&t, &t1, &t);
+        if (clixon_event_reg_timeout(t, publish_retry_cb, ps, "publish retry") < 0)
+            goto done;
+        ps->ps_backoff = 1;
+        goto ok;
+    }
+    if (ps->ps_nqueue && publish_post(ps) < 0)
         goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Let curl act on sockets or timeout, then handle completed posts
+ *
+ * @param[in]  fd     Socket or CURL_SOCKET_TIMEOUT
+ * @param[in]  flags  CURL_CSELECT_IN or CURL_CSELECT_OUT, or 0
+ */
+static int
+publish_action(curl_socket_t fd,
+               int           flags)
+{
+    int                    running;
+    CURLMsg               *cmsg;
+    int                    n;
+    struct publish_stream *ps = NULL;
+    CURLMcode              mc;
+
+    if ((mc = curl_multi_socket_action(_publish_multi, fd, flags, &running)) != CURLM_OK){
+        clicon_err(OE_PLUGIN, 0, "curl_multi_socket_action: %s", curl_multi_strerror(mc));
+        return -1;
+    }
+    while ((cmsg = curl_multi_info_read(_publish_multi, &n)) != NULL){
+        if (cmsg->msg != CURLMSG_DONE)
+            continue;
+        curl_easy_getinfo(cmsg->easy_handle, CURLINFO_PRIVATE, (char**)&ps);
+        if (ps && publish_done(ps, cmsg->data.result) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Socket of a post is readable
+ */
+static int
+publish_in_cb(int   fd,
+              void *arg)
+{
+    return publish_action(fd, CURL_CSELECT_IN);
+}
+
+/*! Socket of a post is writable
+ */
+static int
+publish_out_cb(int   fd,
+               void *arg)
+{
+    return publish_action(fd, CURL_CSELECT_OUT);
+}
+
+/*! Curl timeout has expired
+ */
+static int
+publish_timeout_cb(int   fd,
+                   void *arg)
+{
+    return publish_action(CURL_SOCKET_TIMEOUT, 0);
+}
+
+/*! Curl-multi socket callback: register socket in clixon event loop
+ *
+ * @retval   0    OK
+ * @retval  -1    Error, curl aborts and curl_multi_socket_action fails
+ */
+static int
+publish_socket_cb(CURL         *easy,
+                  curl_socket_t fd,
+                  int           what,
+                  void         *userp,
+                  void         *socketp)
+{
+    /* Not registered is not an error here */
+    clixon_event_unreg_fd(fd, publish_in_cb);
+    clixon_event_unreg_fd(fd, publish_out_cb);
+    if ((what == CURL_POLL_IN || what == CURL_POLL_INOUT) &&
+        clixon_event_reg_fd(fd, publish_in_cb, NULL, "publish in") < 0)
+        return -1;
+    if ((what == CURL_POLL_OUT || what == CURL_POLL_INOUT) &&
+        clixon_event_reg_fd_write(fd, publish_out_cb, NULL, "publish out") < 0)
+        return -1;
+    return 0;
+}
+
+/*! Curl-multi timer callback: register timeout in clixon event loop
+ */
+static int
+publish_timer_cb(CURLM *multi,
+                 long   timeout_ms,
+                 void  *userp)
+{
+    struct timeval t;
+    struct timeval t1;
+
+    clixon_event_unreg_timeout(publish_timeout_cb, NULL);
+    if (timeout_ms < 0) /* Delete timer */
+        return 0;
+    gettimeofday(&t, NULL);
+    t1.tv_sec = timeout_ms/1000;
+    t1.tv_usec = (timeout_ms%1000)*1000;
+    timeradd(&t, &t1, &t);
+    return clixon_event_reg_timeout(t, publish_timeout_cb, NULL, "publish timer");
+}
+
+/*! Free queued event
+ */
+static void
+publish_event_free(struct publish_event *pe)
+{
+    if (pe->pe_cb)
+        cbuf_free(pe->pe_cb);
+    free(pe);
+}
+
+/*! Start post of queued events, or retry failed post
+ *
+ * Nothing is posted while a post is in flight or a failed post waits for its retry timer,
+ * queued events are then posted when done.
+ * @param[in]  ps    Publisher
+ */
+static int
+publish_post(struct publish_stream *ps)
+{
+    int                   retval = -1;
+    CURL                 *curl = NULL;
+    struct publish_event *pe;
+    int                   i;
+
+    if (ps->ps_curl || ps->ps_backoff)
+        goto ok;
+    if (ps->ps_body == NULL){ /* Not retry: next queued events */
+        if (ps->ps_nqueue == 0)
+            goto ok;
+        if ((ps->ps_body = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        for (i=0; i<ps->ps_batch && (pe = ps->ps_queue) != NULL; i++){
+            DELQ(pe, ps->ps_queue, struct publish_event *);
+            ps->ps_nqueue--;
+            cbuf_append_buf(ps->ps_body, cbuf_get(pe->pe_cb), cbuf_len(pe->pe_cb));
+            publish_event_free(pe);
+        }
     }
-    if ((err = malloc(CURL_ERROR_SIZE)) == NULL) {
-        clicon_debug(1, "%s: malloc", __FUNCTION__);
+    clicon_debug(1, "%s:  curl -X POST -d '%s' %s",
+                 __FUNCTION__, cbuf_get(ps->ps_body), ps->ps_url);
+    if ((curl = curl_easy_init()) == NULL) {
+        clicon_err(OE_UNIX, 0, "curl_easy_init");
         goto done;
     }
-    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_URL, ps->ps_url);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, ps);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_get_cb);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &cb);
-    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, err);
-    curl_easy_setopt(curl, CURLOPT_POST, 1);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postfields);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, strlen(postfields));
-
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ps->ps_reply);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, cbuf_get(ps->ps_body));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)cbuf_len(ps->ps_body));
     if (clicon_debug_get())
-        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);   
-    if ((errcode = curl_easy_perform(curl)) != CURLE_OK){
-        clicon_debug(1, "%s: curl: %s(%d)", __FUNCTION__, err, errcode);
-        retval = 0;
-        goto done; 
-    }
-    if (getdata && cb.b_buf){
-        *getdata = cb.b_buf;
-        cb.b_buf = NULL;
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);   
+    if (curl_multi_add_handle(_publish_multi, curl) != CURLM_OK){
+        clicon_err(OE_UNIX, 0, "curl_multi_add_handle");
+        goto done;
     }
-    retval = 1;
-  done:
-    if (err)
-        free(err);
-    if (cb.b_buf)
-        free(cb.b_buf);
+    ps->ps_curl = curl;
+    curl = NULL;
+ ok:
+    retval = 0;
+ done:
     if (curl)
-        curl_easy_cleanup(curl);   /* cleanup */ 
+        curl_easy_cleanup(curl);
     return retval;
 }
 
+/*! Backoff of failed post has expired, retry post
+ *
+ * @param[in]  fd    Ignored
+ * @param[in]  arg   Publisher
+ */
+static int
+publish_retry_cb(int   fd,
+                 void *arg)
+{
+    struct publish_stream *ps = (struct publish_stream *)arg;
+
+    ps->ps_backoff = 0;
+    return publish_post(ps);
+}
+
 /*! Stream callback for example stream notification 
- * Push via curl_post to publish stream event
+ *
+ * Queue event for asynchronous publishing. The event is posted at once if no post of the
+ * stream is in flight or waits for retry, otherwise when done.
  * @param[in]  h     Clicon handle
  * @param[in]  op    Operation: 0 OK, 1 Close
  * @param[in]  event Event as XML
- * @param[in]  arg   Extra argument provided in stream_ss_add
+ * @param[in]  arg   Publisher
  * @see stream_ss_add
  */
 static int 
@@ -966,50 +1416,73 @@ stream_publish_cb(clicon_handle h,
                   cxobj        *event,
                   void         *arg)
 {
-    int   retval = -1;
-    cbuf *u = NULL; /* stream pub (push) url */
-    cbuf *d = NULL; /* (XML) data to push */
-    char *pub_prefix;
-    char *result = NULL;
-    char *stream = (char*)arg;
+    int                    retval = -1;
+    struct publish_stream *ps = (struct publish_stream *)arg;
+    cbuf                  *d = NULL; /* (XML) data to push */
+    struct publish_event  *pe = NULL;
 
     clicon_debug(1, "%s", __FUNCTION__); 
     if (op != 0)
         goto ok;
-    /* Create pub url */
-    if ((u = cbuf_new()) == NULL){
-        clicon_err(OE_XML, errno, "cbuf_new");
-        goto done;
+    if (ps->ps_nqueue >= PUBLISH_QUEUE_MAX){
+        if (ps->ps_dropped++ == 0)
+            clicon_log(LOG_WARNING, "%s: publish %s: queue full, events dropped",
+                       __FUNCTION__, ps->ps_url);
+        goto ok;
     }
-    if ((pub_prefix = clicon_option_str(h, "CLICON_STREAM_PUB")) == NULL){
-        clicon_err(OE_CFG, ENOENT, "CLICON_STREAM_PUB not defined");
+    ps->ps_dropped = 0;
+    /* XML data as string, shared with other subscribers */
+    if (stream_event_cbuf(event, FORMAT_XML, &d) < 0)
         goto done;
-    }
-    cprintf(u, "%s/%s", pub_prefix, stream);
-    /* Create XML data as string */
-    if ((d = cbuf_new()) == NULL){
-        clicon_err(OE_XML, errno, "cbuf_new");
+    if ((pe = malloc(sizeof(*pe))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
         goto done;
     }
-    if (clixon_xml2cbuf(d, event, 0, 0, -1, 0) < 0)
+    memset(pe, 0, sizeof(*pe));
+    if ((pe->pe_cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
         goto done;
-    if (url_post(cbuf_get(u),     /* url+stream */
-                 cbuf_get(d),     /* postfields */
-                 &result) < 0)    /* result as xml */
+    }
+    cbuf_append_buf(pe->pe_cb, cbuf_get(d), cbuf_len(d));
+    ADDQ(pe, ps->ps_queue);
+    pe = NULL;
+    ps->ps_nqueue++;
+    if (publish_post(ps) < 0)
         goto done;
-    if (result)
-        clicon_debug(1, "%s: %s", __FUNCTION__, result);
  ok:
     retval = 0;
  done:
-    if (u)
-        cbuf_free(u);
-    if (d)
-        cbuf_free(d);
-    if (result)
-        free(result);
+    if (pe)
+        publish_event_free(pe);
     return retval;
 }
+
+/*! Free publisher
+ */
+static void
+publish_stream_free(struct publish_stream *ps)
+{
+    struct publish_event *pe;
+
+    clixon_event_unreg_timeout(publish_retry_cb, ps);
+    if (ps->ps_curl){
+        curl_multi_remove_handle(_publish_multi, ps->ps_curl);
+        curl_easy_cleanup(ps->ps_curl);
+    }
+    if (ps->ps_reply.b_buf)
+        free(ps->ps_reply.b_buf);
+    if (ps->ps_body)
+        cbuf_free(ps->ps_body);
+    while ((pe = ps->ps_queue) != NULL){
+        DELQ(pe, ps->ps_queue, struct publish_event *);
+        publish_event_free(pe);
+    }
+    if (ps->ps_url)
+        free(ps->ps_url);
+    if (ps->ps_stream)
+        free(ps->ps_stream);
+    free(ps);
+}
 #endif /* CLIXON_PUBLISH_STREAMS */
 
 /*! Publish all streams on a pubsub channel, eg using SSE
@@ -1019,12 +1492,41 @@ stream_publish(clicon_handle h,
                char         *stream)
 {
 #ifdef CLIXON_PUBLISH_STREAMS
-    int retval = -1;
+    int                    retval = -1;
+    struct publish_stream *ps = NULL;
+    char                  *pub_prefix;
+    size_t                 len;
 
-    if (stream_ss_add(h, stream, NULL, NULL, NULL, stream_publish_cb, (void*)stream) < 0)
+    if (_publish_multi == NULL){
+        clicon_err(OE_PLUGIN, EINVAL, "stream_publish_init not called");
         goto done;
+    }
+    if ((pub_prefix = clicon_option_str(h, "CLICON_STREAM_PUB")) == NULL){
+        clicon_err(OE_CFG, ENOENT, "CLICON_STREAM_PUB not defined");
+        goto done;
+    }
+    if ((ps = malloc(sizeof(*ps))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(ps, 0, sizeof(*ps));
+    len = strlen(pub_prefix) + strlen(stream) + 2;
+    if ((ps->ps_stream = strdup(stream)) == NULL ||
+        (ps->ps_url = malloc(len)) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    snprintf(ps->ps_url, len, "%s/%s", pub_prefix, stream);
+    if ((ps->ps_batch = clicon_option_int(h, "CLICON_STREAM_PUB_BATCH")) < 1)
+        ps->ps_batch = 1;
+    if (stream_ss_add(h, stream, NULL, NULL, NULL, stream_publish_cb, (void*)ps) == NULL)
+        goto done;
+    ADDQ(ps, _publish_streams);
+    ps = NULL;
     retval = 0;
  done:
+    if (ps)
+        publish_stream_free(ps);
     return retval;
 #else
    clicon_log(LOG_WARNING, "%s called but CLIXON_PUBLISH_STREAMS not enabled (enable with configure --enable-publish)", __FUNCTION__);
@@ -1043,6 +1545,13 @@ stream_publish_init()
         clicon_err(OE_PLUGIN, errno, "curl_global_init");
         goto done;
     }    
+    /* Posts are driven by the clixon event loop */
+    if ((_publish_multi = curl_multi_init()) == NULL){
+        clicon_err(OE_PLUGIN, 0, "curl_multi_init");
+        goto done;
+    }
+    curl_multi_setopt(_publish_multi, CURLMOPT_SOCKETFUNCTION, publish_socket_cb);
+    curl_multi_setopt(_publish_multi, CURLMOPT_TIMERFUNCTION, publish_timer_cb);
     retval = 0;
  done:
     return retval;
@@ -1055,6 +1564,17 @@ int
 stream_publish_exit()
 {
 #ifdef CLIXON_PUBLISH_STREAMS
+    struct publish_stream *ps;
+
+    while ((ps = _publish_streams) != NULL){
+        DELQ(ps, _publish_streams, struct publish_stream *);
+        publish_stream_free(ps);
+    }
+    if (_publish_multi){
+        clixon_event_unreg_timeout(publish_timeout_cb, NULL);
+        curl_multi_cleanup(_publish_multi);
+        _publish_multi = NULL;
+    }
     curl_global_cleanup();
 #endif 
     return 0;
@@ -0,0 +1,407 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Replay store of notification event streams (RFC 5277 replay)
+ *
+ * Events are stored serialized in a byte ring with bounded size, and are indexed by
+ * time in a second ring of entries, so that the start of a replay is found by binary
+ * search. Oldest events are dropped when the byte or event limit is reached, or when
+ * their retention time has passed.
+ * The byte ring is either allocated in memory or, for long retention windows, a
+ * memory-mapped file that the kernel may page out to disk.
+ *
+ *   entries:   [head] ... [head+len-1]     (modulo capacity)
+ *                 |             |
+ *   data:      ---+=============+---       positions modulo size
+ *               rr_start       rr_end
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include "clixon_queue.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_options.h"
+#include "clixon_stream.h"
+
+/* Initial number of index entries, doubled as needed */
+#define REPLAY_ENTRIES_INIT 64
+
+/*
+ * Types
+ */
+/* Index entry of one stored event */
+struct replay_entry{
+    struct timeval re_tv;   /* Event time */
+    uint64_t       re_pos;  /* Position of event in data ring */
+    uint32_t       re_len;  /* Length of serialized event */
+};
+
+/* Replay store of one stream */
+struct stream_replay_ring{
+    struct replay_entry *rr_entries; /* Index ring */
+    uint32_t             rr_cap;     /* Capacity of index ring */
+    uint32_t             rr_head;    /* Oldest entry */
+    uint32_t             rr_len;     /* Number of entries */
+    uint32_t             rr_maxlen;  /* Max number of entries, 0 is no limit */
+    char                *rr_data;    /* Data ring */
+    size_t               rr_size;    /* Size of data ring */
+    uint64_t             rr_start;   /* Position of oldest event */
+    uint64_t             rr_end;     /* Position after newest event */
+    int                  rr_mapped;  /* rr_data is a mapped file */
+};
+
+/*! Get entry i (0 is oldest)
+ */
+static struct replay_entry *
+replay_entry(struct stream_replay_ring *rr,
+             uint32_t                   i)
+{
+    return &rr->rr_entries[(rr->rr_head + i) % rr->rr_cap];
+}
+
+/*! Get unsigned 32-bit option
+ *
+ * @param[in]  h     Clicon handle
+ * @param[in]  name  Name of option
+ * @param[out] u32   Value of option, 0 if not set
+ * @retval     0     OK
+ * @retval    -1     Error, or invalid value
+ */
+static int
+replay_option_uint32(clicon_handle h,
+                     const char   *name,
+                     uint32_t     *u32)
+{
+    int   retval = -1;
+    char *s;
+    char *reason = NULL;
+    int   ret;
+
+    *u32 = 0;
+    if ((s = clicon_option_str(h, name)) == NULL)
+        return 0;
+    if ((ret = parse_uint32(s, u32, &reason)) < 0){
+        clicon_err(OE_UNIX, errno, "parse_uint32");
+        goto done;
+    }
+    if (ret == 0){
+        clicon_err(OE_CFG, EINVAL, "%s: %s", name, reason);
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (reason)
+        free(reason);
+    return retval;
+}
+
+/*! Create replay store of a stream
+ *
+ * Limits are given by CLICON_STREAM_REPLAY_MAX_BYTES and CLICON_STREAM_REPLAY_MAX_EVENTS.
+ * If CLICON_STREAM_REPLAY_DIR is set, the data is stored in a memory-mapped file in that
+ * directory, named after the stream. Its earlier content is discarded.
+ * @param[in]  h     Clicon handle
+ * @param[in]  name  Name of stream
+ * @param[out] rrp   Replay store, free with stream_replay_ring_free
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+int
+stream_replay_ring_new(clicon_handle               h,
+                       const char                 *name,
+                       struct stream_replay_ring **rrp)
+{
+    int                        retval = -1;
+    struct stream_replay_ring *rr = NULL;
+    char                      *dir;
+    cbuf                      *cb = NULL;
+    int                        fd = -1;
+    uint32_t                   u32;
+
+    if ((rr = malloc(sizeof(*rr))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(rr, 0, sizeof(*rr));
+    if (replay_option_uint32(h, "CLICON_STREAM_REPLAY_MAX_EVENTS", &rr->rr_maxlen) < 0)
+        goto done;
+    if (replay_option_uint32(h, "CLICON_STREAM_REPLAY_MAX_BYTES", &u32) < 0)
+        goto done;
+    if (u32 == 0){
+        clicon_err(OE_CFG, EINVAL, "CLICON_STREAM_REPLAY_MAX_BYTES must be > 0");
+        goto done;
+    }
+    rr->rr_size = u32;
+    if ((dir = clicon_option_str(h, "CLICON_STREAM_REPLAY_DIR")) != NULL){
+        if ((cb = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        cprintf(cb, "%s/%s.replay", dir, name);
+        if ((fd = open(cbuf_get(cb), O_RDWR|O_CREAT|O_TRUNC, 0600)) < 0){
+            clicon_err(OE_UNIX, errno, "open(%s)", cbuf_get(cb));
+            goto done;
+        }
+        if (ftruncate(fd, rr->rr_size) < 0){
+            clicon_err(OE_UNIX, errno, "ftruncate(%s)", cbuf_get(cb));
+            goto done;
+        }
+        if ((rr->rr_data = mmap(NULL, rr->rr_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+            rr->rr_data = NULL;
+            clicon_err(OE_UNIX, errno, "mmap(%s)", cbuf_get(cb));
+            goto done;
+        }
+        rr->rr_mapped = 1;
+    }
+    else if ((rr->rr_data = malloc(rr->rr_size)) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    *rrp = rr;
+    rr = NULL;
+    retval = 0;
+ done:
+    if (fd != -1)
+        close(fd);
+    if (cb)
+        cbuf_free(cb);
+    if (rr)
+        stream_replay_ring_free(rr);
+    return retval;
+}
+
+/*! Free replay store
+ */
+int
+stream_replay_ring_free(struct stream_replay_ring *rr)
+{
+    if (rr->rr_data){
+        if (rr->rr_mapped)
+            munmap(rr->rr_data, rr->rr_size);
+        else
+            free(rr->rr_data);
+    }
+    if (rr->rr_entries)
+        free(rr->rr_entries);
+    free(rr);
+    return 0;
+}
+
+/*! Drop oldest event
+ */
+static void
+replay_drop(struct stream_replay_ring *rr)
+{
+    rr->rr_head = (rr->rr_head + 1) % rr->rr_cap;
+    if (--rr->rr_len == 0)
+        rr->rr_start = rr->rr_end;
+    else
+        rr->rr_start = replay_entry(rr, 0)->re_pos;
+}
+
+/*! Grow index ring, keeping entries in order
+ */
+static int
+replay_grow(struct stream_replay_ring *rr)
+{
+    struct replay_entry *entries;
+    uint32_t             cap;
+    uint32_t             i;
+
+    cap = rr->rr_cap ? rr->rr_cap*2 : REPLAY_ENTRIES_INIT;
+    if (rr->rr_maxlen && cap > rr->rr_maxlen)
+        cap = rr->rr_maxlen;
+    if ((entries = malloc(cap*sizeof(*entries))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return -1;
+    }
+    for (i=0; i<rr->rr_len; i++)
+        entries[i] = *replay_entry(rr, i);
+    if (rr->rr_entries)
+        free(rr->rr_entries);
+    rr->rr_entries = entries;
+    rr->rr_cap = cap;
+    rr->rr_head = 0;
+    return 0;
+}
+
+/*! Add serialized event to replay store, drop oldest events if full
+ *
+ * @param[in]  rr    Replay store
+ * @param[in]  tv    Event time, not earlier than previous events
+ * @param[in]  data  Serialized event
+ * @param[in]  len   Length of data
+ * @retval     1     OK
+ * @retval     0     Event larger than the store, not stored
+ * @retval    -1     Error
+ */
+int
+stream_replay_ring_add(struct stream_replay_ring *rr,
+                       struct timeval            *tv,
+                       char                      *data,
+                       size_t                     len)
+{
+    struct replay_entry *re;
+    size_t               i;
+    size_t               n;
+
+    if (len > rr->rr_size)
+        return 0;
+    while (rr->rr_len && (rr->rr_end + len - rr->rr_start > rr->rr_size ||
+                          (rr->rr_maxlen && rr->rr_len >= rr->rr_maxlen)))
+        replay_drop(rr);
+    if (rr->rr_len == rr->rr_cap && replay_grow(rr) < 0)
+        return -1;
+    i = rr->rr_end % rr->rr_size;
+    n = rr->rr_size - i; /* Contiguous space until end of ring */
+    if (len <= n)
+        memcpy(rr->rr_data + i, data, len);
+    else{
+        memcpy(rr->rr_data + i, data, n);
+        memcpy(rr->rr_data, data + n, len - n);
+    }
+    re = replay_entry(rr, rr->rr_len++);
+    re->re_tv = *tv;
+    re->re_pos = rr->rr_end;
+    re->re_len = len;
+    if (rr->rr_len == 1)
+        rr->rr_start = rr->rr_end;
+    rr->rr_end += len;
+    return 1;
+}
+
+/*! Drop events older than a time, eg after retention time has passed
+ *
+ * @param[in]  rr    Replay store
+ * @param[in]  tv    Drop events before this time
+ * @retval     0     OK
+ */
+int
+stream_replay_ring_expire(struct stream_replay_ring *rr,
+                          struct timeval            *tv)
+{
+    while (rr->rr_len && timercmp(&replay_entry(rr, 0)->re_tv, tv, <))
+        replay_drop(rr);
+    return 0;
+}
+
+/*! Number of events in replay store
+ */
+uint32_t
+stream_replay_ring_len(struct stream_replay_ring *rr)
+{
+    return rr->rr_len;
+}
+
+/*! Find first event not earlier than a time, using binary search
+ *
+ * @param[in]  rr    Replay store
+ * @param[in]  tv    Start time
+ * @retval     i     Index of first event at or after tv, or number of events if none
+ */
+uint32_t
+stream_replay_ring_find(struct stream_replay_ring *rr,
+                        struct timeval            *tv)
+{
+    uint32_t lo = 0;
+    uint32_t hi = rr->rr_len;
+    uint32_t mid;
+
+    while (lo < hi){
+        mid = lo + (hi - lo)/2;
+        if (timercmp(&replay_entry(rr, mid)->re_tv, tv, <))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*! Get serialized event
+ *
+ * @param[in]  rr    Replay store
+ * @param[in]  i     Index of event, 0 is oldest
+ * @param[out] tv    Event time
+ * @param[out] cb    Serialized event is appended to this buffer
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+int
+stream_replay_ring_get(struct stream_replay_ring *rr,
+                       uint32_t                   i,
+                       struct timeval            *tv,
+                       cbuf                      *cb)
+{
+    struct replay_entry *re;
+    size_t               j;
+    size_t               n;
+
+    if (i >= rr->rr_len){
+        clicon_err(OE_UNIX, EINVAL, "Replay index %u out of range", i);
+        return -1;
+    }
+    re = replay_entry(rr, i);
+    j = re->re_pos % rr->rr_size;
+    n = rr->rr_size - j;
+    if (re->re_len <= n)
+        cbuf_append_buf(cb, rr->rr_data + j, re->re_len);
+    else{
+        cbuf_append_buf(cb, rr->rr_data + j, n);
+        cbuf_append_buf(cb, rr->rr_data, re->re_len - n);
+    }
+    *tv = re->re_tv;
+    return 0;
+}
@@ -50,6 +50,9 @@
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <sys/param.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <poll.h>
 #include <netinet/in.h>
 
 /* cligen */
@@ -80,12 +83,216 @@
 #include "clixon_xml_map.h"
 #include "clixon_xml_bind.h"
 #include "clixon_validate_minmax.h"
+#include "clixon_validate_deps.h"
 #include "clixon_validate.h"
 
+/* Initial size of a leafref target set, grows with number of targets */
+#define LEAFREF_SET_SIZE 64
+
+/* Set of bodies of leafref target instances, open addressing with linear probing
+ * Bodies are direct pointers into the XML tree and are not copied
+ */
+struct leafref_set{
+    char   **ls_vec;   /* Bodies, NULL if slot is empty */
+    size_t   ls_size;  /* Number of slots, power of two */
+    size_t   ls_len;   /* Number of bodies */
+};
+typedef struct leafref_set leafref_set;
+
+/*! Hash of a leafref target body
+ */
+static uint32_t
+leafref_set_hash(const char *str)
+{
+    return clicon_hash_fnv1a(CLICON_HASH_FNV_INIT, str);
+}
+
+/*! Find slot of body in leafref target set, or the empty slot where it should be added
+ */
+static char **
+leafref_set_slot(leafref_set *ls,
+                 const char  *body)
+{
+    size_t i;
+
+    i = leafref_set_hash(body) & (ls->ls_size - 1);
+    while (ls->ls_vec[i] != NULL && strcmp(ls->ls_vec[i], body) != 0)
+        i = (i + 1) & (ls->ls_size - 1);
+    return &ls->ls_vec[i];
+}
+
+/*! Create a leafref target set
+ */
+static leafref_set *
+leafref_set_new(void)
+{
+    leafref_set *ls;
+
+    if ((ls = malloc(sizeof(*ls))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    ls->ls_size = LEAFREF_SET_SIZE;
+    ls->ls_len = 0;
+    if ((ls->ls_vec = calloc(ls->ls_size, sizeof(char*))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        free(ls);
+        return NULL;
+    }
+    return ls;
+}
+
+/*! Free a leafref target set
+ */
+static void
+leafref_set_free(leafref_set *ls)
+{
+    free(ls->ls_vec);
+    free(ls);
+}
+
+/*! Add body to leafref target set, double the size if more than half full
+ * @param[in]  ls    Leafref target set
+ * @param[in]  body  Body of target, not copied
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+leafref_set_add(leafref_set *ls,
+                char        *body)
+{
+    char  **slot;
+    char  **vec0;
+    size_t  size0;
+    size_t  i;
+
+    if ((ls->ls_len + 1) * 2 > ls->ls_size){
+        vec0 = ls->ls_vec;
+        size0 = ls->ls_size;
+        if ((ls->ls_vec = calloc(size0 * 2, sizeof(char*))) == NULL){
+            clicon_err(OE_UNIX, errno, "calloc");
+            ls->ls_vec = vec0;
+            return -1;
+        }
+        ls->ls_size = size0 * 2;
+        for (i=0; i<size0; i++)
+            if (vec0[i] != NULL)
+                *leafref_set_slot(ls, vec0[i]) = vec0[i];
+        free(vec0);
+    }
+    slot = leafref_set_slot(ls, body);
+    if (*slot == NULL){
+        *slot = body;
+        ls->ls_len++;
+    }
+    return 0;
+}
+
+/*! Free a leafref target index
+ * @param[in]  lrindex  Leafref index, see leafref_index_find
+ */
+static int
+leafref_index_free(clicon_hash_t *lrindex)
+{
+    char         **keys = NULL;
+    size_t         klen = 0;
+    int            i;
+    leafref_set   *hset;
+    void          *v;
+
+    if (lrindex == NULL)
+        return 0;
+    if (clicon_hash_keys(lrindex, &keys, &klen) < 0)
+        return -1;
+    for (i=0; i<klen; i++){
+        if ((v = clicon_hash_value(lrindex, keys[i], NULL)) == NULL)
+            continue;
+        memcpy(&hset, v, sizeof(hset));
+        if (hset)
+            leafref_set_free(hset);
+    }
+    if (keys)
+        free(keys);
+    clicon_hash_free(lrindex);
+    return 0;
+}
+
+/*! Look up leafref value in a per-validation index of leafref targets
+ *
+ * The index maps a leafref path to a set of the bodies of all target instances of
+ * that path. The set grows with the number of targets, so that a lookup is constant time
+ * also for large lists. The set is built on first use of a path by evaluating the path once,
+ * thereafter each leafref check is a hash lookup instead of an xpath evaluation and a
+ * linear scan.
+ * Only absolute paths not using current() can be indexed since the result of other
+ * paths depends on the context node.
+ * The key includes the module of the referring node since the namespace context of the
+ * path is taken from it.
+ * @param[in]  lrindex  Leafref index, created by caller
+ * @param[in]  xt       XML leaf node of type leafref (context node)
+ * @param[in]  ys       Yang spec of leaf
+ * @param[in]  nsc      Namespace context of path
+ * @param[in]  path_arg Leafref path
+ * @param[in]  body     Leafref value to look for
+ * @retval     1        Found
+ * @retval     0        Not found
+ * @retval    -1        Error
+ * @note The index is only valid as long as the XML tree is not modified
+ */
+static int
+leafref_index_find(clicon_hash_t *lrindex,
+                   cxobj         *xt,
+                   yang_stmt     *ys,
+                   cvec          *nsc,
+                   char          *path_arg,
+                   char          *body)
+{
+    int            retval = -1;
+    cbuf          *cb = NULL;
+    leafref_set   *hset = NULL;
+    void          *v;
+    cxobj        **xvec = NULL;
+    size_t         xlen = 0;
+    char          *leafbody;
+    int            i;
+
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s:%s", yang_argument_get(ys_module(ys)), path_arg);
+    if ((v = clicon_hash_value(lrindex, cbuf_get(cb), NULL)) != NULL)
+        memcpy(&hset, v, sizeof(hset));
+    else {
+        if ((hset = leafref_set_new()) == NULL)
+            goto done;
+        if (clicon_hash_add(lrindex, cbuf_get(cb), &hset, sizeof(hset)) == NULL){
+            leafref_set_free(hset);
+            goto done;
+        }
+        if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, path_arg) < 0)
+            goto done;
+        for (i = 0; i < xlen; i++) {
+            if ((leafbody = xml_body(xvec[i])) == NULL)
+                continue;
+            if (leafref_set_add(hset, leafbody) < 0)
+                goto done;
+        }
+    }
+    retval = *leafref_set_slot(hset, body) != NULL;
+ done:
+    if (xvec)
+        free(xvec);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
 /*! Validate xml node of type leafref, ensure the value is one of that path's reference
  * @param[in]  xt    XML leaf node of type leafref
  * @param[in]  ys    Yang spec of leaf
  * @param[in]  ytype Yang type statement belonging to the XML node
+ * @param[in]  lrindex Leafref target index, or NULL
  * @param[out] xret  Error XML tree. Free with xml_free after use
  * @retval     1     Validation OK
  * @retval     0     Validation failed
@@ -112,13 +319,14 @@
  *      references the typedef. (ie ys)
  *   o  Otherwise, the context node is the node in the data tree for which
  *      the "path" statement is defined. (ie ys)
- * 
+ * @see leafref_index_find  for the indexed case
  */
 static int
-validate_leafref(cxobj     *xt,
-                 yang_stmt *ys,
-                 yang_stmt *ytype,
-                 cxobj    **xret)
+validate_leafref(cxobj         *xt,
+                 yang_stmt     *ys,
+                 yang_stmt     *ytype,
+                 clicon_hash_t *lrindex,
+                 cxobj        **xret)
 {
     int          retval = -1;
     yang_stmt   *ypath;
@@ -135,6 +343,7 @@ validate_leafref(cxobj     *xt,
     yang_stmt   *ymod;
     cg_var      *cv;
     int          require_instance = 1;
+    int          found = 0;
     
     /* require instance */
     if ((yreqi = yang_find(ytype, Y_REQUIRE_INSTANCE, NULL)) != NULL){
@@ -164,16 +373,25 @@ validate_leafref(cxobj     *xt,
         goto ok;
     if (xml_nsctx_yang(ys, &nsc) < 0)
         goto done;
-    if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, path_arg) < 0) 
-        goto done;
-    for (i = 0; i < xlen; i++) {
-        x = xvec[i];
-        if ((leafbody = xml_body(x)) == NULL)
-            continue;
-        if (strcmp(leafbody, leafrefbody) == 0)
-            break;
+    if (lrindex != NULL &&
+        path_arg[0] == '/' && strstr(path_arg, "current()") == NULL){
+        if ((found = leafref_index_find(lrindex, xt, ys, nsc, path_arg, leafrefbody)) < 0)
+            goto done;
     }
-    if (i==xlen){
+    else {
+        if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, path_arg) < 0) 
+            goto done;
+        for (i = 0; i < xlen; i++) {
+            x = xvec[i];
+            if ((leafbody = xml_body(x)) == NULL)
+                continue;
+            if (strcmp(leafbody, leafrefbody) == 0){
+                found = 1;
+                break;
+            }
+        }
+    }
+    if (!found){
         if ((cberr = cbuf_new()) == NULL){
             clicon_err(OE_UNIX, errno, "cbuf_new");
             goto done;
@@ -1127,11 +1345,12 @@ xml_yang_validate_list_key_only(cxobj        *xt,
 }
 
 static int
-xml_yang_validate_leaf_union(clicon_handle h,
-                             cxobj        *xt,
-                             yang_stmt    *yt,
-                             yang_stmt    *yrestype,
-                             cxobj       **xret)
+xml_yang_validate_leaf_union(clicon_handle  h,
+                             cxobj         *xt,
+                             yang_stmt     *yt,
+                             yang_stmt     *yrestype,
+                             clicon_hash_t *lrindex,
+                             cxobj        **xret)
 {
     int        retval = -1;
     int        ret;
@@ -1152,7 +1371,7 @@ xml_yang_validate_leaf_union(clicon_handle h,
         restype = ytype?yang_argument_get(ytype):NULL;
         ret = 1; /* If not leafref/identityref it is valid on this level */
         if (strcmp(restype, "leafref") == 0){
-            if ((ret = validate_leafref(xt, yt, ytype, &xret1)) < 0) // XXX
+            if ((ret = validate_leafref(xt, yt, ytype, lrindex, &xret1)) < 0) // XXX
                 goto done;
         }
         else if (strcmp(restype, "identityref") == 0){
@@ -1160,7 +1379,7 @@ xml_yang_validate_leaf_union(clicon_handle h,
                 goto done;
         }
         else if (strcmp("union", yang_argument_get(ytsub)) == 0){
-            if ((ret = xml_yang_validate_leaf_union(h, xt, yt, ytype, &xret1)) < 0)
+            if ((ret = xml_yang_validate_leaf_union(h, xt, yt, ytype, lrindex, &xret1)) < 0)
                 goto done;
         }
         if (ret == 1)
@@ -1187,29 +1406,21 @@ xml_yang_validate_leaf_union(clicon_handle h,
     goto done;
 }
 
-/*! Validate a single XML node with yang specification for all (not only added) entries
- * 1. Check leafrefs. Eg you delete a leaf and a leafref references it.
- * @param[in]  xt  XML node to be validated
- * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
- * @retval     1     Validation OK
- * @retval     0     Validation failed (cbret set)
- * @retval    -1     Error
- * @code
- *   cxobj *x;
- *   cbuf *xret = NULL;
- *   if ((ret = xml_yang_validate_all(h, x, &xret)) < 0)
- *      err;
- *   if (ret == 0)
- *      fail;
- *   xml_free(xret);
- * @endcode
- * @see xml_yang_validate_add
- * @see xml_yang_validate_rpc
+/*! Validate a single XML node with yang specification for all entries, internal
+ * @param[in]  h       Clicon handle
+ * @param[in]  xt      XML node to be validated
+ * @param[in]  lrindex Leafref target index, shared by the whole validation
+ * @param[out] xret    Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1       Validation OK
+ * @retval     0       Validation failed (cbret set)
+ * @retval    -1       Error
+ * @see xml_yang_validate_all
  */
-int
-xml_yang_validate_all(clicon_handle h,
-                      cxobj        *xt, 
-                      cxobj       **xret)
+static int
+xml_yang_validate_all1(clicon_handle  h,
+                       cxobj         *xt, 
+                       clicon_hash_t *lrindex,
+                       cxobj        **xret)
 {
     int        retval = -1;
     yang_stmt *yt;  /* yang node associated with xt */
@@ -1294,7 +1505,7 @@ xml_yang_validate_all(clicon_handle h,
             if (yang_type_get(yt, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
                 goto done;
             if (strcmp(yang_argument_get(yc), "leafref") == 0){
-                if ((ret = validate_leafref(xt, yt, yc, xret)) < 0)
+                if ((ret = validate_leafref(xt, yt, yc, lrindex, xret)) < 0)
                     goto done;
                 if (ret == 0)
                     goto fail;
@@ -1306,7 +1517,7 @@ xml_yang_validate_all(clicon_handle h,
                     goto fail;
             }
             else if (strcmp("union", yang_argument_get(yc)) == 0){
-                if ((ret = xml_yang_validate_leaf_union(h, xt, yt, yc, xret)) < 0)
+                if ((ret = xml_yang_validate_leaf_union(h, xt, yt, yc, lrindex, xret)) < 0)
                     goto done;
                 if (ret == 0)
                     goto fail;
@@ -1351,7 +1562,7 @@ xml_yang_validate_all(clicon_handle h,
     }
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
-        if ((ret = xml_yang_validate_all(h, x, xret)) < 0)
+        if ((ret = xml_yang_validate_all1(h, x, lrindex, xret)) < 0)
             goto done;
         if (ret == 0)
             goto fail;
@@ -1377,7 +1588,380 @@ xml_yang_validate_all(clicon_handle h,
     goto done;
 }
 
+/*! Validate a single XML node with yang specification for all (not only added) entries
+ * 1. Check leafrefs. Eg you delete a leaf and a leafref references it.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    XML node to be validated
+ * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (cbret set)
+ * @retval    -1     Error
+ * @code
+ *   cxobj *x;
+ *   cbuf *xret = NULL;
+ *   if ((ret = xml_yang_validate_all(h, x, &xret)) < 0)
+ *      err;
+ *   if (ret == 0)
+ *      fail;
+ *   xml_free(xret);
+ * @endcode
+ * @see xml_yang_validate_add
+ * @see xml_yang_validate_rpc
+ */
+int
+xml_yang_validate_all(clicon_handle h,
+                      cxobj        *xt, 
+                      cxobj       **xret)
+{
+    int            retval = -1;
+    clicon_hash_t *lrindex = NULL;
+
+    if ((lrindex = clicon_hash_init()) == NULL)
+        goto done;
+    retval = xml_yang_validate_all1(h, xt, lrindex, xret);
+ done:
+    if (lrindex)
+        leafref_index_free(lrindex);
+    return retval;
+}
+
+/*! Result header sent from a validation worker process to the parent over a pipe
+ * Followed by vw_len bytes of payload: serialized rpc-error:s if vw_status is 0,
+ * or the error reason if vw_status is -1
+ */
+struct validate_worker_hdr {
+    int    vw_status; /* 1: OK, 0: validation failed, -1: error */
+    int    vw_index;  /* Index in subtree vector of first failed subtree */
+    int    vw_errcat; /* Error category (clicon_errno) if vw_status is -1 */
+    size_t vw_len;    /* Length of payload */
+};
+
+/*! Validate a vector of top-level subtrees sequentially, stop at first failure
+ * @param[in]  h       Clicon handle
+ * @param[in]  xvec    Vector of top-level XML subtrees
+ * @param[in]  from    First index in xvec to validate
+ * @param[in]  to      Validate up to (but not including) this index
+ * @param[in]  lrindex Leafref target index
+ * @param[out] failed  Index of failed subtree (if retval=0)
+ * @param[out] xret    Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1       Validation OK
+ * @retval     0       Validation failed (xret set)
+ * @retval    -1       Error
+ */
+static int
+validate_top_vec(clicon_handle  h,
+                 cxobj        **xvec,
+                 int            from,
+                 int            to,
+                 clicon_hash_t *lrindex,
+                 int           *failed,
+                 cxobj        **xret)
+{
+    int ret;
+    int i;
+
+    for (i=from; i<to; i++){
+        if ((ret = xml_yang_validate_all1(h, xvec[i], lrindex, xret)) < 1){
+            *failed = i;
+            return ret;
+        }
+    }
+    return 1;
+}
+
+/*! Write all of a buffer to a file descriptor, restart on EINTR
+ */
+static int
+validate_worker_write(int    fd,
+                      void  *buf,
+                      size_t len)
+{
+    char   *s = buf;
+    ssize_t n;
+
+    while (len > 0){
+        if ((n = write(fd, s, len)) < 0){
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        s += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*! Validation worker process: validate a partition and write result to parent
+ * Does not return
+ * @param[in]  h     Clicon handle
+ * @param[in]  xvec  Vector of top-level XML subtrees
+ * @param[in]  from  First index in xvec of partition
+ * @param[in]  to    Last index (not including) of partition
+ * @param[in]  fd    Write end of pipe to parent
+ */
+static void
+validate_worker(clicon_handle h,
+                cxobj       **xvec,
+                int           from,
+                int           to,
+                int           fd)
+{
+    struct validate_worker_hdr hdr = {0,};
+    clicon_hash_t *lrindex = NULL;
+    cxobj         *xerr = NULL;
+    cbuf          *cb = NULL;
+    int            status = 0;
+
+    if ((cb = cbuf_new()) == NULL)
+        _exit(1);
+    if ((lrindex = clicon_hash_init()) == NULL)
+        hdr.vw_status = -1;
+    else
+        hdr.vw_status = validate_top_vec(h, xvec, from, to, lrindex, &hdr.vw_index, &xerr);
+    if (hdr.vw_status == 0 && xerr != NULL){
+        if (clixon_xml2cbuf(cb, xerr, 0, 0, -1, 1) < 0)
+            hdr.vw_status = -1;
+    }
+    if (hdr.vw_status < 0){
+        cbuf_reset(cb);
+        hdr.vw_errcat = clicon_errno;
+        cprintf(cb, "%s", clicon_err_reason);
+    }
+    hdr.vw_len = cbuf_len(cb);
+    if (validate_worker_write(fd, &hdr, sizeof(hdr)) < 0 ||
+        validate_worker_write(fd, cbuf_get(cb), hdr.vw_len) < 0)
+        status = 1;
+    close(fd);
+    /* Exit without atexit handlers or stdio flush of the parent's buffers */
+    _exit(status);
+}
+
+/*! Read results from all worker pipes concurrently until every worker has closed its pipe
+ *
+ * Pipes are polled instead of read one at a time, so that a worker with a result larger
+ * than the pipe buffer does not block while the parent waits for an earlier worker.
+ * @param[in]  fds  Read ends of worker pipes, closed and set to -1 on EOF
+ * @param[in]  cbs  Result buffer per worker
+ * @param[in]  nw   Number of workers
+ * @retval     0    OK, all pipes at EOF
+ * @retval    -1    Error
+ */
+static int
+validate_worker_drain(int   *fds,
+                      cbuf **cbs,
+                      int    nw)
+{
+    int            retval = -1;
+    struct pollfd *pfds = NULL;
+    char           buf[4096];
+    ssize_t        n;
+    int            nopen;
+    int            i;
+
+    if ((pfds = calloc(nw, sizeof(struct pollfd))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (i=0; i<nw; i++){
+        pfds[i].fd = fds[i];
+        pfds[i].events = POLLIN;
+    }
+    nopen = nw;
+    while (nopen > 0){
+        if (poll(pfds, nw, -1) < 0){
+            if (errno == EINTR)
+                continue;
+            clicon_err(OE_UNIX, errno, "poll");
+            goto done;
+        }
+        for (i=0; i<nw; i++){
+            if (pfds[i].fd < 0 || pfds[i].revents == 0)
+                continue;
+            if ((n = read(fds[i], buf, sizeof(buf))) < 0){
+                if (errno == EINTR || errno == EAGAIN)
+                    continue;
+                clicon_err(OE_UNIX, errno, "read");
+                goto done;
+            }
+            if (n == 0){ /* EOF: worker done */
+                close(fds[i]);
+                fds[i] = -1;
+                pfds[i].fd = -1; /* Ignored by poll */
+                nopen--;
+                continue;
+            }
+            if (cbuf_append_buf(cbs[i], buf, n) < 0){
+                clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+                goto done;
+            }
+        }
+    }
+    retval = 0;
+ done:
+    if (pfds)
+        free(pfds);
+    return retval;
+}
+
+/*! Validate top-level subtrees concurrently in forked worker processes
+ *
+ * The subtree vector is split in contiguous partitions, one per worker. Each worker
+ * validates its partition in a copy-on-write snapshot of the tree, with its own leafref
+ * index, and stops at its first failure.
+ * Forking copies the page tables of the whole process, which is only amortized if the
+ * validation itself is substantially more expensive, ie for large trees. The number of
+ * workers is limited to the number of online CPUs and to the number of subtrees.
+ * Results are merged in partition order, so that the error returned is the first error in
+ * document order, the same as in sequential validation.
+ * @param[in]  h       Clicon handle
+ * @param[in]  xvec    Vector of top-level XML subtrees
+ * @param[in]  xlen    Length of xvec
+ * @param[in]  workers Number of worker processes (at most xlen are used)
+ * @param[out] xret    Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1       Validation OK
+ * @retval     0       Validation failed (xret set)
+ * @retval    -1       Error
+ * @see CLICON_VALIDATE_WORKERS
+ */
+static int
+validate_top_parallel(clicon_handle h,
+                      cxobj       **xvec,
+                      int           xlen,
+                      int           workers,
+                      cxobj       **xret)
+{
+    int                         retval = -1;
+    pid_t                      *pids = NULL;
+    int                        *fds = NULL;
+    cbuf                      **cbs = NULL;
+    struct validate_worker_hdr  hdr;
+    int                         p[2];
+    int                         nw;
+    int                         i;
+    int                         j;
+    long                        ncpu;
+    char                       *payload;
+
+    nw = workers<xlen ? workers : xlen;
+    if ((ncpu = sysconf(_SC_NPROCESSORS_ONLN)) > 0 && nw > ncpu)
+        nw = ncpu;
+    if ((pids = calloc(nw, sizeof(pid_t))) == NULL ||
+        (fds = calloc(nw, sizeof(int))) == NULL ||
+        (cbs = calloc(nw, sizeof(cbuf*))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (i=0; i<nw; i++){
+        fds[i] = -1;
+        if ((cbs[i] = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+    }
+    for (i=0; i<nw; i++){
+        if (pipe(p) < 0){
+            clicon_err(OE_UNIX, errno, "pipe");
+            goto done;
+        }
+        if ((pids[i] = fork()) < 0){
+            clicon_err(OE_UNIX, errno, "fork");
+            close(p[0]);
+            close(p[1]);
+            goto done;
+        }
+        if (pids[i] == 0){   /* Child */
+            close(p[0]);
+            for (j=0; j<i; j++)
+                close(fds[j]);
+            validate_worker(h, xvec, i*xlen/nw, (i+1)*xlen/nw, p[1]);
+        }
+        /* Parent */
+        close(p[1]);
+        fds[i] = p[0];
+    }
+    /* Drain all pipes as results arrive, a worker blocks if its pipe is full */
+    if (validate_worker_drain(fds, cbs, nw) < 0)
+        goto done;
+    /* Merge: first partition not OK decides */
+    for (i=0; i<nw; i++){
+        if (cbuf_len(cbs[i]) < sizeof(hdr)){
+            clicon_err(OE_UNIX, 0, "Validation worker %d exited without result", i);
+            goto done;
+        }
+        memcpy(&hdr, cbuf_get(cbs[i]), sizeof(hdr));
+        payload = cbuf_get(cbs[i]) + sizeof(hdr);
+        if (hdr.vw_status == 1)
+            continue;
+        clicon_debug(1, "%s worker %d failed at subtree %d", __FUNCTION__, i, hdr.vw_index);
+        if (hdr.vw_status < 0){
+            clicon_err(hdr.vw_errcat, 0, "%s", payload);
+            goto done;
+        }
+        if (xret && hdr.vw_len){
+            if (*xret == NULL){
+                if ((*xret = xml_new("rpc-reply", NULL, CX_ELMNT)) == NULL)
+                    goto done;
+                if (xml_add_attr(*xret, "xmlns", NETCONF_BASE_NAMESPACE, NULL, NULL) < 0)
+                    goto done;
+            }
+            if (clixon_xml_parse_string(payload, YB_NONE, NULL, xret, NULL) < 0)
+                goto done;
+        }
+        retval = 0;
+        goto done;
+    }
+    retval = 1;
+ done:
+    if (fds){
+        for (i=0; i<nw; i++)
+            if (fds[i] != -1)
+                close(fds[i]);
+        free(fds);
+    }
+    if (pids){
+        for (i=0; i<nw; i++)
+            if (pids[i] > 0)
+                waitpid(pids[i], NULL, 0);
+        free(pids);
+    }
+    if (cbs){
+        for (i=0; i<nw; i++)
+            if (cbs[i])
+                cbuf_free(cbs[i]);
+        free(cbs);
+    }
+    return retval;
+}
+
+/*! Validate a vector of top-level subtrees, sequentially or by worker processes
+ * @param[in]  h       Clicon handle
+ * @param[in]  xvec    Vector of top-level XML subtrees
+ * @param[in]  xlen    Length of xvec
+ * @param[in]  lrindex Leafref target index, used if sequential
+ * @param[out] xret    Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1       Validation OK
+ * @retval     0       Validation failed (xret set)
+ * @retval    -1       Error
+ */
+static int
+validate_top_partition(clicon_handle  h,
+                       cxobj        **xvec,
+                       int            xlen,
+                       clicon_hash_t *lrindex,
+                       cxobj        **xret)
+{
+    int workers;
+    int failed;
+
+    workers = clicon_option_int(h, "CLICON_VALIDATE_WORKERS");
+    if (workers > 1 && xlen > 1)
+        return validate_top_parallel(h, xvec, xlen, workers, xret);
+    return validate_top_vec(h, xvec, 0, xlen, lrindex, &failed, xret);
+}
+
 /*! Validate a single XML node with yang specification
+ * A leafref target index is shared by all top-level subtrees, ie each distinct 
+ * leafref path is evaluated once per validation
  * @param[out] xret    Error XML tree (if ret == 0). Free with xml_free after use
  * @retval     1     Validation OK
  * @retval     0     Validation failed (xret set)
@@ -1388,17 +1972,152 @@ xml_yang_validate_all_top(clicon_handle h,
                           cxobj        *xt, 
                           cxobj       **xret)
 {
-    int    ret;
-    cxobj *x;
+    int            retval = -1;
+    int            ret;
+    cxobj         *x;
+    clicon_hash_t *lrindex = NULL;
+    cxobj        **xvec = NULL;
+    int            xlen = 0;
+
+    if ((lrindex = clicon_hash_init()) == NULL)
+        goto done;
+    if ((xvec = calloc(xml_child_nr_type(xt, CX_ELMNT)+1, sizeof(cxobj*))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL)
+        xvec[xlen++] = x;
+    if ((ret = validate_top_partition(h, xvec, xlen, lrindex, xret)) < 1){
+        retval = ret;
+        goto done;
+    }
+    if ((ret = xml_yang_minmax_recurse(xt, 0, xret)) < 1){
+        retval = ret;
+        goto done;
+    }
+    retval = 1;
+ done:
+    if (xvec)
+        free(xvec);
+    if (lrindex)
+        leafref_index_free(lrindex);
+    return retval;
+}
+
+/*! Mark YANG spec of top-level ancestor of each node in a vector as changed
+ * @param[in]     vec    Vector of XML nodes
+ * @param[in]     vlen   Length of vec
+ * @param[in,out] yvec   Vector of marked top-level YANG nodes (for unmarking)
+ * @param[in,out] ylen   Length of yvec
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+validate_changed_mark(cxobj       **vec,
+                      int           vlen,
+                      yang_stmt  ***yvec,
+                      int          *ylen)
+{
+    int        i;
+    cxobj     *x;
+    yang_stmt *y;
+
+    for (i=0; i<vlen; i++){
+        x = vec[i];
+        while (xml_parent(x) && xml_parent(xml_parent(x)))
+            x = xml_parent(x);
+        if ((y = xml_spec(x)) == NULL || yang_flag_get(y, YANG_FLAG_MARK))
+            continue;
+        yang_flag_set(y, YANG_FLAG_MARK);
+        if ((*yvec = realloc(*yvec, (*ylen+1)*sizeof(yang_stmt*))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        (*yvec)[(*ylen)++] = y;
+    }
+    return 0;
+}
+
+/*! Validate top-level subtrees affected by a change, using the YANG dependency graph
+ *
+ * A top-level subtree of xt is validated only if it is changed, or if its must/when/leafref
+ * expressions read another top-level subtree that is changed.
+ * Top-level min/max and unique checks are always made.
+ * Falls back to full validation if the dependency graph is not computed.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    Top of XML target tree
+ * @param[in]  dvec  Deleted nodes (in source tree)
+ * @param[in]  dlen  Length of dvec
+ * @param[in]  avec  Added nodes (in target tree)
+ * @param[in]  alen  Length of avec
+ * @param[in]  cvec  Changed nodes (in target tree)
+ * @param[in]  clen  Length of cvec
+ * @param[out] xret  Error XML tree (if ret == 0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all_top  for full validation
+ * @see yang_deps_init  where the dependency graph is computed
+ */
+int
+xml_yang_validate_all_top_changed(clicon_handle h,
+                                  cxobj        *xt,
+                                  cxobj       **dvec,
+                                  int           dlen,
+                                  cxobj       **avec,
+                                  int           alen,
+                                  cxobj       **cvec,
+                                  int           clen,
+                                  cxobj       **xret)
+{
+    int            retval = -1;
+    int            ret;
+    cxobj         *x;
+    clicon_hash_t *lrindex = NULL;
+    yang_stmt    **yvec = NULL;
+    int            ylen = 0;
+    int            i;
+    cxobj        **xvec = NULL;
+    int            xlen = 0;
 
+    if (validate_changed_mark(dvec, dlen, &yvec, &ylen) < 0)
+        goto done;
+    if (validate_changed_mark(avec, alen, &yvec, &ylen) < 0)
+        goto done;
+    if (validate_changed_mark(cvec, clen, &yvec, &ylen) < 0)
+        goto done;
+    if ((lrindex = clicon_hash_init()) == NULL)
+        goto done;
+    if ((xvec = calloc(xml_child_nr_type(xt, CX_ELMNT)+1, sizeof(cxobj*))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
-        if ((ret = xml_yang_validate_all(h, x, xret)) < 1)
-            return ret;
+        if (yang_deps_affected(h, xml_spec(x)) == 0)
+            continue;
+        xvec[xlen++] = x;
     }
-    if ((ret = xml_yang_minmax_recurse(xt, 0, xret)) < 1)
-        return ret;
-    return 1;
+    if ((ret = validate_top_partition(h, xvec, xlen, lrindex, xret)) < 1){
+        retval = ret;
+        goto done;
+    }
+    if ((ret = xml_yang_minmax_recurse(xt, 0, xret)) < 1){
+        retval = ret;
+        goto done;
+    }
+    retval = 1;
+ done:
+    for (i=0; i<ylen; i++)
+        yang_flag_reset(yvec[i], YANG_FLAG_MARK);
+    if (yvec)
+        free(yvec);
+    if (xvec)
+        free(xvec);
+    if (lrindex)
+        leafref_index_free(lrindex);
+    return retval;
 }
 
 /*! Check validity of outgoing RPC
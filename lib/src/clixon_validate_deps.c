@@ -0,0 +1,614 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * YANG dependency graph for incremental validation
+ *
+ * For every top-level data node in the YANG spec, the must, when and leafref expressions
+ * in its subtree are analyzed. The result is the set of _other_ top-level data nodes
+ * that the expressions may read. If the expressions may read data that cannot be
+ * determined statically (eg deref(), wildcards or ancestor axes above top-level), the
+ * top-level node is marked as "global" which means it is always re-validated.
+ *
+ * At commit, a top-level XML subtree of the target needs to be re-validated only if:
+ * 1. The subtree itself is added, deleted or changed, or
+ * 2. One of the top-level nodes it depends on is added, deleted or changed, or
+ * 3. It is global
+ * The changed top-level nodes are marked by the caller with YANG_FLAG_MARK.
+ *
+ * Relative paths are analyzed by counting the data-node depth of the context node and
+ * tracking the depth of each step. Only when a path reaches the root level, the next
+ * child step names a top-level node. Depths are lower bounds: if the exact context is
+ * unknown a smaller depth is used which only adds dependencies.
+ * @see xml_yang_validate_all_top_changed  where the graph is used
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/param.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_string.h"
+#include "clixon_handle.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_data.h"
+#include "clixon_yang_type.h"
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
+#include "clixon_xpath_function.h"
+#include "clixon_validate_deps.h"
+
+/*! Dependencies of one top-level data node
+ */
+struct yang_deps{
+    yang_stmt  *yd_top;    /* Top-level data node */
+    int         yd_global; /* Reads data that cannot be determined, always validate */
+    yang_stmt **yd_vec;    /* Other top-level data nodes read by expressions in subtree */
+    int         yd_len;    /* Length of yd_vec */
+};
+
+/*! Dependency graph of all top-level data nodes of a YANG spec
+ */
+struct yang_deps_graph{
+    struct yang_deps *dg_vec; /* One entry per top-level data node, sorted on yd_top */
+    int               dg_len; /* Length of dg_vec */
+};
+typedef struct yang_deps_graph yang_deps_graph;
+
+/*! Get dependency graph from handle */
+static yang_deps_graph *
+yang_deps_graph_get(clicon_handle h)
+{
+    yang_deps_graph *dg = NULL;
+
+    if (clicon_ptr_get(h, "validate_deps", (void**)&dg) < 0)
+        return NULL;
+    return dg;
+}
+
+/*! Compare dependency entries on top-level data node, for sorting and lookup
+ */
+static int
+yang_deps_cmp(const void *a,
+              const void *b)
+{
+    uintptr_t ya = (uintptr_t)((const struct yang_deps *)a)->yd_top;
+    uintptr_t yb = (uintptr_t)((const struct yang_deps *)b)->yd_top;
+
+    return ya < yb ? -1 : ya > yb ? 1 : 0;
+}
+
+/*! Get number of data node ancestors (including itself) up to module
+ * @param[in]  ys   YANG node
+ * @retval     n    Data-node depth, where a top-level data node has depth 1
+ */
+static int
+yang_datadepth(yang_stmt *ys)
+{
+    int n = 0;
+
+    while (ys != NULL &&
+           yang_keyword_get(ys) != Y_MODULE &&
+           yang_keyword_get(ys) != Y_SUBMODULE &&
+           yang_keyword_get(ys) != Y_SPEC){
+        if (yang_datanode(ys))
+            n++;
+        ys = yang_parent_get(ys);
+    }
+    return n;
+}
+
+/*! Add top-level data node(s) with a given name as dependency
+ *
+ * Namespaces are not considered, all top-level nodes with the name are added.
+ * If the name is not a top-level node, the path reads nothing and no dependency is added
+ * @param[in]  dg    Dependency graph
+ * @param[in]  yd    Dependency entry
+ * @param[in]  name  Local name of top-level node
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+deps_add_top(yang_deps_graph  *dg,
+             struct yang_deps *yd,
+             char             *name)
+{
+    int        i;
+    int        j;
+    yang_stmt *ytop;
+
+    for (i=0; i<dg->dg_len; i++){
+        ytop = dg->dg_vec[i].yd_top;
+        if (ytop == yd->yd_top || strcmp(yang_argument_get(ytop), name) != 0)
+            continue;
+        for (j=0; j<yd->yd_len; j++)
+            if (yd->yd_vec[j] == ytop)
+                break;
+        if (j < yd->yd_len)
+            continue;
+        if ((yd->yd_vec = realloc(yd->yd_vec, (yd->yd_len+1)*sizeof(yang_stmt*))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        yd->yd_vec[yd->yd_len++] = ytop;
+    }
+    return 0;
+}
+
+/* Forward */
+static int deps_xpath_walk(yang_deps_graph *dg, struct yang_deps *yd, xpath_tree *xs,
+                           int depth, int depth0);
+
+/*! Analyze steps of a relative location path
+ * @param[in]     dg     Dependency graph
+ * @param[in]     yd     Dependency entry
+ * @param[in]     xs     XPath parse-tree of type XP_RELLOCPATH or XP_STEP
+ * @param[in,out] level  Data-node depth (lower bound), 0 is root
+ * @param[in]     depth0 Depth of initial context node, for current()
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+deps_path_walk(yang_deps_graph  *dg,
+               struct yang_deps *yd,
+               xpath_tree       *xs,
+               int              *level,
+               int               depth0)
+{
+    xpath_tree *nodetest;
+
+    if (xs->xs_type == XP_RELLOCPATH){ /* left-recursive: c0 is path prefix, c1 is last step */
+        if (deps_path_walk(dg, yd, xs->xs_c0, level, depth0) < 0)
+            return -1;
+        if (xs->xs_c1 == NULL)
+            return 0;
+        if (xs->xs_int == A_DESCENDANT_OR_SELF){ /* // */
+            if (*level == 0){
+                yd->yd_global = 1;
+                return 0;
+            }
+            (*level)++;
+        }
+        return deps_path_walk(dg, yd, xs->xs_c1, level, depth0);
+    }
+    if (xs->xs_type != XP_STEP){
+        yd->yd_global = 1;
+        return 0;
+    }
+    switch (xs->xs_int){
+    case A_CHILD:
+        if (*level == 0){
+            nodetest = xs->xs_c0;
+            if (nodetest == NULL ||
+                nodetest->xs_type != XP_NODE ||
+                nodetest->xs_s1 == NULL ||
+                strcmp(nodetest->xs_s1, "*") == 0){
+                yd->yd_global = 1;
+                return 0;
+            }
+            if (deps_add_top(dg, yd, nodetest->xs_s1) < 0)
+                return -1;
+        }
+        (*level)++;
+        break;
+    case A_PARENT:
+        if (*level == 0){
+            yd->yd_global = 1;
+            return 0;
+        }
+        (*level)--;
+        break;
+    case A_SELF:
+    case A_ATTRIBUTE:
+        break;
+    case A_DESCENDANT:
+    case A_DESCENDANT_OR_SELF:
+        if (*level == 0){
+            yd->yd_global = 1;
+            return 0;
+        }
+        (*level)++;
+        break;
+    case A_FOLLOWING_SIBLING:
+    case A_PRECEDING_SIBLING:
+        if (*level <= 1){
+            yd->yd_global = 1;
+            return 0;
+        }
+        break;
+    default: /* ancestor, following, preceding, etc */
+        yd->yd_global = 1;
+        return 0;
+    }
+    /* Predicates are evaluated with the step as context */
+    if (xs->xs_c1)
+        return deps_xpath_walk(dg, yd, xs->xs_c1, *level, depth0);
+    return 0;
+}
+
+/*! Analyze an XPath parse-tree
+ * @param[in]  dg     Dependency graph
+ * @param[in]  yd     Dependency entry
+ * @param[in]  xs     XPath parse-tree
+ * @param[in]  depth  Data-node depth of context node (lower bound)
+ * @param[in]  depth0 Depth of initial context node, for current()
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+deps_xpath_walk(yang_deps_graph  *dg,
+                struct yang_deps *yd,
+                xpath_tree       *xs,
+                int               depth,
+                int               depth0)
+{
+    int         level;
+    xpath_tree *xf;
+
+    if (xs == NULL || yd->yd_global)
+        return 0;
+    switch (xs->xs_type){
+    case XP_ABSPATH:
+        if (xs->xs_int != A_ROOT || xs->xs_c0 == NULL){ /* "//" or "/" */
+            yd->yd_global = 1;
+            return 0;
+        }
+        level = 0;
+        if (deps_path_walk(dg, yd, xs->xs_c0, &level, depth0) < 0)
+            return -1;
+        break;
+    case XP_RELLOCPATH:
+        level = depth;
+        if (deps_path_walk(dg, yd, xs, &level, depth0) < 0)
+            return -1;
+        if (level == 0) /* Root node itself is read */
+            yd->yd_global = 1;
+        break;
+    case XP_PATHEXPR:
+        if (xs->xs_c1 == NULL)
+            return deps_xpath_walk(dg, yd, xs->xs_c0, depth, depth0);
+        /* filterexpr / rellocpath: only current()/... is analyzed */
+        xf = xs->xs_c0;
+        if (xf && xf->xs_type == XP_FILTEREXPR)
+            xf = xf->xs_c0;
+        if (xf == NULL ||
+            xf->xs_type != XP_PRIME_FN ||
+            xf->xs_int != XPATHFN_CURRENT ||
+            xs->xs_s0 == NULL || strcmp(xs->xs_s0, "/") != 0){
+            yd->yd_global = 1;
+            return 0;
+        }
+        level = depth0;
+        if (deps_path_walk(dg, yd, xs->xs_c1, &level, depth0) < 0)
+            return -1;
+        if (level == 0)
+            yd->yd_global = 1;
+        break;
+    case XP_PRIME_FN:
+        if (xs->xs_int == XPATHFN_DEREF){ /* May point anywhere */
+            yd->yd_global = 1;
+            return 0;
+        }
+        if (deps_xpath_walk(dg, yd, xs->xs_c0, depth, depth0) < 0)
+            return -1;
+        if (deps_xpath_walk(dg, yd, xs->xs_c1, depth, depth0) < 0)
+            return -1;
+        break;
+    default:
+        if (deps_xpath_walk(dg, yd, xs->xs_c0, depth, depth0) < 0)
+            return -1;
+        if (deps_xpath_walk(dg, yd, xs->xs_c1, depth, depth0) < 0)
+            return -1;
+        break;
+    }
+    return 0;
+}
+
+/*! Analyze an XPath expression string
+ * @param[in]  dg     Dependency graph
+ * @param[in]  yd     Dependency entry
+ * @param[in]  xpath  XPath expression (must, when or leafref path)
+ * @param[in]  depth  Data-node depth of context node
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+deps_xpath(yang_deps_graph  *dg,
+           struct yang_deps *yd,
+           char             *xpath,
+           int               depth)
+{
+    int         retval = -1;
+    xpath_tree *xptree = NULL;
+
+    if (xpath == NULL || yd->yd_global)
+        goto ok;
+    if (xpath_parse(xpath, &xptree) < 0)
+        goto done;
+    if (deps_xpath_walk(dg, yd, xptree, depth, depth) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    if (xptree)
+        xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Analyze leafref paths of a leaf type, including unions of leafrefs
+ * @param[in]  dg     Dependency graph
+ * @param[in]  yd     Dependency entry
+ * @param[in]  ys     Leaf or leaf-list
+ * @param[in]  ytype  Type statement
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+deps_type(yang_deps_graph  *dg,
+          struct yang_deps *yd,
+          yang_stmt        *ys,
+          yang_stmt        *ytype)
+{
+    yang_stmt *yrestype = NULL;
+    yang_stmt *ypath;
+    yang_stmt *ysub = NULL;
+    char      *restype;
+
+    if (yang_type_resolve(ys, ys, ytype, &yrestype, NULL, NULL, NULL, NULL, NULL) < 0)
+        return -1;
+    if (yrestype == NULL || (restype = yang_argument_get(yrestype)) == NULL)
+        return 0;
+    if (strcmp(restype, "leafref") == 0){
+        if ((ypath = yang_find(yrestype, Y_PATH, NULL)) != NULL)
+            return deps_xpath(dg, yd, yang_argument_get(ypath), yang_datadepth(ys));
+    }
+    else if (strcmp(restype, "union") == 0){
+        while ((ysub = yn_each(yrestype, ysub)) != NULL){
+            if (yang_keyword_get(ysub) != Y_TYPE)
+                continue;
+            if (deps_type(dg, yd, ys, ysub) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/*! Collect dependencies of all expressions in a YANG subtree
+ * @param[in]  dg     Dependency graph
+ * @param[in]  yd     Dependency entry
+ * @param[in]  ys     YANG schema node
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+deps_collect(yang_deps_graph  *dg,
+             struct yang_deps *yd,
+             yang_stmt        *ys)
+{
+    yang_stmt *yc = NULL;
+    int        depth;
+    char      *xpath;
+
+    depth = yang_datadepth(ys);
+    /* Augment/uses when: context is parent, use lower bound */
+    if ((xpath = yang_when_xpath_get(ys)) != NULL)
+        if (deps_xpath(dg, yd, xpath, depth>0?depth-1:0) < 0)
+            return -1;
+    while ((yc = yn_each(ys, yc)) != NULL && !yd->yd_global){
+        switch (yang_keyword_get(yc)){
+        case Y_MUST:
+        case Y_WHEN:
+            if (deps_xpath(dg, yd, yang_argument_get(yc), depth) < 0)
+                return -1;
+            break;
+        case Y_TYPE:
+            if (yang_keyword_get(ys) == Y_LEAF || yang_keyword_get(ys) == Y_LEAF_LIST)
+                if (deps_type(dg, yd, ys, yc) < 0)
+                    return -1;
+            break;
+        case Y_CONTAINER:
+        case Y_LIST:
+        case Y_LEAF:
+        case Y_LEAF_LIST:
+        case Y_CHOICE:
+        case Y_CASE:
+        case Y_ANYXML:
+        case Y_ANYDATA:
+            if (deps_collect(dg, yd, yc) < 0)
+                return -1;
+            break;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+/*! Add top-level data nodes of a module or choice to the graph
+ * @param[in]  dg   Dependency graph
+ * @param[in]  ys   Module, submodule, choice or case
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+deps_tops(yang_deps_graph *dg,
+          yang_stmt       *ys)
+{
+    yang_stmt *yc = NULL;
+
+    while ((yc = yn_each(ys, yc)) != NULL){
+        if (yang_keyword_get(yc) == Y_CHOICE || yang_keyword_get(yc) == Y_CASE){
+            if (deps_tops(dg, yc) < 0)
+                return -1;
+            continue;
+        }
+        if (!yang_datanode(yc))
+            continue;
+        if ((dg->dg_vec = realloc(dg->dg_vec, (dg->dg_len+1)*sizeof(struct yang_deps))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        memset(&dg->dg_vec[dg->dg_len], 0, sizeof(struct yang_deps));
+        dg->dg_vec[dg->dg_len++].yd_top = yc;
+    }
+    return 0;
+}
+
+/*! Free dependency graph
+ * @param[in]  h    Clixon handle
+ * @retval     0    OK
+ */
+int
+yang_deps_free(clicon_handle h)
+{
+    yang_deps_graph *dg;
+    int              i;
+
+    if ((dg = yang_deps_graph_get(h)) == NULL)
+        return 0;
+    for (i=0; i<dg->dg_len; i++)
+        if (dg->dg_vec[i].yd_vec)
+            free(dg->dg_vec[i].yd_vec);
+    if (dg->dg_vec)
+        free(dg->dg_vec);
+    free(dg);
+    clicon_ptr_del(h, "validate_deps");
+    return 0;
+}
+
+/*! Compute dependency graph of top-level data nodes and store it in handle
+ *
+ * Call after all YANG modules are loaded.
+ * @param[in]  h      Clixon handle
+ * @param[in]  yspec  YANG spec
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+yang_deps_init(clicon_handle h,
+               yang_stmt    *yspec)
+{
+    int              retval = -1;
+    yang_deps_graph *dg = NULL;
+    yang_stmt       *ymod = NULL;
+    struct yang_deps *yd;
+    int              i;
+    int              nglobal = 0;
+
+    if (yang_deps_free(h) < 0)
+        goto done;
+    if ((dg = malloc(sizeof(*dg))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(dg, 0, sizeof(*dg));
+    while ((ymod = yn_each(yspec, ymod)) != NULL) {
+        if (yang_keyword_get(ymod) != Y_MODULE &&
+            yang_keyword_get(ymod) != Y_SUBMODULE)
+            continue;
+        if (deps_tops(dg, ymod) < 0)
+            goto done;
+    }
+    for (i=0; i<dg->dg_len; i++){
+        yd = &dg->dg_vec[i];
+        if (deps_collect(dg, yd, yd->yd_top) < 0)
+            goto done;
+        if (yd->yd_global)
+            nglobal++;
+    }
+    /* Sort on top-level node for lookup in yang_deps_affected */
+    if (dg->dg_len)
+        qsort(dg->dg_vec, dg->dg_len, sizeof(struct yang_deps), yang_deps_cmp);
+    clicon_debug(1, "%s top-level nodes:%d global:%d", __FUNCTION__, dg->dg_len, nglobal);
+    if (clicon_ptr_set(h, "validate_deps", dg) < 0)
+        goto done;
+    dg = NULL;
+    retval = 0;
+ done:
+    if (dg){
+        for (i=0; i<dg->dg_len; i++)
+            if (dg->dg_vec[i].yd_vec)
+                free(dg->dg_vec[i].yd_vec);
+        if (dg->dg_vec)
+            free(dg->dg_vec);
+        free(dg);
+    }
+    return retval;
+}
+
+/*! Check if a top-level data node needs re-validation given the changed top-level nodes
+ *
+ * Changed top-level nodes are marked with YANG_FLAG_MARK by the caller
+ * @param[in]  h     Clixon handle
+ * @param[in]  ytop  Top-level data node
+ * @retval     1     Affected: node is changed, depends on a changed node, or is unknown
+ * @retval     0     Not affected, validation can be skipped
+ */
+int
+yang_deps_affected(clicon_handle h,
+                   yang_stmt    *ytop)
+{
+    yang_deps_graph  *dg;
+    struct yang_deps *yd;
+    struct yang_deps  key;
+    int               j;
+
+    if (ytop == NULL || yang_flag_get(ytop, YANG_FLAG_MARK))
+        return 1;
+    if ((dg = yang_deps_graph_get(h)) == NULL || dg->dg_len == 0)
+        return 1;
+    key.yd_top = ytop;
+    if ((yd = bsearch(&key, dg->dg_vec, dg->dg_len, sizeof(struct yang_deps),
+                      yang_deps_cmp)) == NULL)
+        return 1; /* Not found, eg mounted */
+    if (yd->yd_global)
+        return 1;
+    for (j=0; j<yd->yd_len; j++)
+        if (yang_flag_get(yd->yd_vec[j], YANG_FLAG_MARK))
+            return 1;
+    return 0;
+}
@@ -79,30 +79,164 @@
 #include "clixon_xml_bind.h"
 #include "clixon_validate_minmax.h"
 
-/*! New element last in list, check if already exists if sp return -1
- * @param[in]  vec   Vector of existing entries (new is last)
- * @param[in]  i1    The new entry is placed at vec[i1]
- * @param[in]  vlen  Length of entry
- * @param[in]  sorted Sorted by system, ie sorted by key, otherwise no assumption
- * @retval     0     OK, entry is unique
- * @retval    -1     Duplicate detected
- * @note This is currently quadratic complexity. It could be improved by inserting new element sorted and binary search.
- * @retval     1     Validation OK
- * @retval     0     Validation failed (cbret set)
+/*! Hash set of string tuples, used to detect duplicate list keys and unique values
+ *
+ * The set does not copy any strings: entries are indexes into an external vector of
+ * tuples, where tuple i consists of vec[i*vlen]..vec[i*vlen+vlen-1]. The vector is
+ * given in each call since it may be reallocated by the caller.
+ * Open addressing with linear probing, the table is doubled when half full.
+ */
+typedef struct {
+    int    *ts_tab;    /* Table of tuple index + 1, 0 means empty slot */
+    size_t  ts_size;   /* Table size, power of 2 */
+    size_t  ts_nr;     /* Number of entries in set */
+    int     ts_vlen;   /* Number of strings in each tuple */
+} tuple_set;
+
+#define TUPLE_SET_INITSIZE 64
+
+/*! Compute hash of tuple using FNV-1a over the concatenated strings
+ * @param[in]  vec   Vector of tuples
+ * @param[in]  i     Tuple index
+ * @param[in]  vlen  Number of strings in each tuple
+ */
+static uint32_t
+tuple_hash(char **vec,
+           int    i,
+           int    vlen)
+{
+    uint32_t h = CLICON_HASH_FNV_INIT;
+    int      v;
+
+    for (v=0; v<vlen; v++){
+        h = clicon_hash_fnv1a(h, vec[i*vlen+v]);
+        /* Separator (not valid UTF-8) so that "a","bc" differs from "ab","c" */
+        h = clicon_hash_fnv1a(h, "\xff");
+    }
+    return h;
+}
+
+/*! Check if two tuples are equal
+ */
+static int
+tuple_eq(char **vec,
+         int    i1,
+         int    i2,
+         int    vlen)
+{
+    int v;
+
+    for (v=0; v<vlen; v++)
+        if (strcmp(vec[i1*vlen+v], vec[i2*vlen+v]) != 0)
+            return 0;
+    return 1;
+}
+
+/*! Initialize tuple set
+ * @param[in]  ts    Tuple set
+ * @param[in]  vlen  Number of strings in each tuple
+ * @retval     0     OK
  * @retval    -1     Error
  */
 static int
-unique_search_xpath(cxobj  *x,
-                    char   *xpath,
-                    cvec   *nsc,
-                    char ***svec,
-                    size_t *slen)
+tuple_set_init(tuple_set *ts,
+               int        vlen)
+{
+    memset(ts, 0, sizeof(*ts));
+    ts->ts_vlen = vlen;
+    ts->ts_size = TUPLE_SET_INITSIZE;
+    if ((ts->ts_tab = calloc(ts->ts_size, sizeof(int))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    return 0;
+}
+
+/*! Free tuple set table (not the set itself)
+ */
+static void
+tuple_set_free(tuple_set *ts)
+{
+    if (ts->ts_tab)
+        free(ts->ts_tab);
+    ts->ts_tab = NULL;
+}
+
+/*! Insert tuple i in set, unless an equal tuple already exists
+ * @param[in]  ts    Tuple set
+ * @param[in]  vec   Vector of tuples, all strings of tuple i must be non-NULL
+ * @param[in]  i     Index of tuple to insert
+ * @retval     0     OK, tuple inserted (is unique)
+ * @retval     1     Duplicate detected, tuple not inserted
+ * @retval    -1     Error
+ */
+static int
+tuple_set_insert(tuple_set *ts,
+                 char     **vec,
+                 int        i)
+{
+    int    *tab;
+    size_t  size;
+    size_t  mask;
+    size_t  k;
+    size_t  j;
+    int     e;
+
+    if (2*(ts->ts_nr+1) > ts->ts_size){ /* Grow and rehash */
+        size = ts->ts_size*2;
+        mask = size - 1;
+        if ((tab = calloc(size, sizeof(int))) == NULL){
+            clicon_err(OE_UNIX, errno, "calloc");
+            return -1;
+        }
+        for (j=0; j<ts->ts_size; j++){
+            if ((e = ts->ts_tab[j]) == 0)
+                continue;
+            k = tuple_hash(vec, e-1, ts->ts_vlen) & mask;
+            while (tab[k] != 0)
+                k = (k+1) & mask;
+            tab[k] = e;
+        }
+        free(ts->ts_tab);
+        ts->ts_tab = tab;
+        ts->ts_size = size;
+    }
+    mask = ts->ts_size - 1;
+    k = tuple_hash(vec, i, ts->ts_vlen) & mask;
+    while ((e = ts->ts_tab[k]) != 0){
+        if (tuple_eq(vec, e-1, i, ts->ts_vlen))
+            return 1;
+        k = (k+1) & mask;
+    }
+    ts->ts_tab[k] = i+1;
+    ts->ts_nr++;
+    return 0;
+}
+
+/*! Collect search results of xpath and check them for duplicates
+ * @param[in]     x     List entry
+ * @param[in]     xpath Descendant schema node id as canonical xpath
+ * @param[in]     nsc   Namespace context of xpath
+ * @param[in,out] svec  Vector of values of previous entries
+ * @param[in,out] slen  Length of svec
+ * @param[in]     ts    Tuple set (of width 1) of svec values
+ * @retval        1     OK, all values are unique
+ * @retval        0     Duplicate detected
+ * @retval       -1     Error
+ */
+static int
+unique_search_xpath(cxobj     *x,
+                    char      *xpath,
+                    cvec      *nsc,
+                    char    ***svec,
+                    size_t    *slen,
+                    tuple_set *ts)
 {
     int     retval = -1;
     cxobj **xvec = NULL;
     size_t  xveclen;
     int     i;
-    int     s;
+    int     ret;
     cxobj  *xi;
     char   *bi;
 
@@ -113,20 +247,17 @@ unique_search_xpath(cxobj  *x,
         xi = xvec[i];
         if ((bi = xml_body(xi)) == NULL)
             break;
-        /* Check if bi is duplicate? 
-         * XXX: sort svec?
-         */
-        for (s=0; s<(*slen); s++){
-            if (strcmp(bi, (*svec)[s]) == 0){
-                goto fail;
-            }
-        }
         (*slen) ++;
         if (((*svec) = realloc((*svec), (*slen)*sizeof(char*))) == NULL){
             clicon_err(OE_UNIX, errno, "realloc");
             goto done;
         }
         (*svec)[(*slen)-1] = bi;
+        /* Check if bi is duplicate */
+        if ((ret = tuple_set_insert(ts, *svec, (*slen)-1)) < 0)
+            goto done;
+        if (ret == 1)
+            goto fail;
     } /* i search results */
     retval = 1;
  done:
@@ -138,51 +269,35 @@ unique_search_xpath(cxobj  *x,
     goto done;
 }
 
-/*! New element last in list, return error if already exists 
+/*! New element last in sorted list, check if previous element is a duplicate
  *
  * @param[in]  vec   Vector of existing entries (new is last)
  * @param[in]  i1    The new entry is placed at vec[i1]
  * @param[in]  vlen  Length of vec
- * @param[in]  sorted Sorted by system, ie sorted by key, otherwise no assumption
  * @retval     0     OK, entry is unique
- * @retval    -1     Duplicate detected
- * @note This is currently quadratic complexity. It could be improved by inserting new element sorted and binary search.
+ * @retval     1     Duplicate detected
+ * @note Only for lists sorted by system, ie sorted by key
  */
 static int
-check_insert_duplicate(char **vec,
-                       int    i1,
-                       int    vlen,
-                       int    sorted)
+check_previous_duplicate(char **vec,
+                         int    i1,
+                         int    vlen)
 {
-    int i;
-    int v;
+    int   i;
+    int   v;
     char *b;
 
-    if (sorted){
-        /* Just go look at previous element to see if it is duplicate (sorted by system) */
-        if (i1 == 0)
+    /* Just go look at previous element to see if it is duplicate (sorted by system) */
+    if (i1 == 0)
+        return 0;
+    i = i1-1;
+    for (v=0; v<vlen; v++){
+        b = vec[i*vlen+v];
+        if (b == NULL || strcmp(b, vec[i1*vlen+v]))
             return 0;
-        i = i1-1;
-        for (v=0; v<vlen; v++){
-            b = vec[i*vlen+v];
-            if (b == NULL || strcmp(b, vec[i1*vlen+v]))
-                return 0;
-        }
-        /* here we have passed thru all keys of previous element and they are all equal */
-        return -1;
-    }
-    else{
-        for (i=0; i<i1; i++){
-            for (v=0; v<vlen; v++){
-                b = vec[i*vlen+v];
-                if (b == NULL || strcmp(b, vec[i1*vlen+v]))
-                    break;
-            }
-            if (v==vlen) /* duplicate */
-                break;
-        }
-        return i==i1?0:-1;
     }
+    /* here we have passed thru all keys of previous element and they are all equal */
+    return 1;
 }
 
 /*! Given a list with unique constraint, detect duplicates
@@ -226,10 +341,12 @@ check_unique_list_direct(cxobj     *x,
     int        sorted;
     char      *str;
     cvec      *cvk;
+    tuple_set  ts = {0,};
+    int        dup;
 
     /* If list and is sorted by system, then it is assumed elements are in key-order which is optimized
-     * Other cases are "unique" constraint or list sorted by user which is quadratic in complexity
-     * This second case COULD be optimized if binary insert is made on the vec vector.
+     * Other cases are "unique" constraint or list sorted by user which use a hash set of the
+     * tuples
      */
     sorted = (yang_keyword_get(yu) == Y_LIST &&
               yang_find(y, Y_ORDERED_BY, "user") == NULL);
@@ -243,6 +360,8 @@ check_unique_list_direct(cxobj     *x,
         clicon_err(OE_UNIX, errno, "calloc");
         goto done;
     }
+    if (!sorted && tuple_set_init(&ts, clen) < 0)
+        goto done;
     /* A vector is built with key-values, for each iteration check "backward" in the vector
      * for duplicates
      */
@@ -267,7 +386,11 @@ check_unique_list_direct(cxobj     *x,
         }
         if (cvi==NULL){
             /* Last element (i) is newly inserted, see if it is already there */
-            if (check_insert_duplicate(vec, i, clen, sorted) < 0){
+            if (sorted)
+                dup = check_previous_duplicate(vec, i, clen);
+            else if ((dup = tuple_set_insert(&ts, vec, i)) < 0)
+                goto done;
+            if (dup){
                 if (xret && netconf_data_not_unique_xml(xret, x, cvk) < 0)
                     goto done;
                 goto fail;
@@ -280,6 +403,7 @@ check_unique_list_direct(cxobj     *x,
     /* It would be possible to cache vec here as an optimization */
     retval = 1;
  done:
+    tuple_set_free(&ts);
     if (vec)
         free(vec);
     return retval;
@@ -328,6 +452,7 @@ check_unique_list(cxobj     *x,
     cvec      *cvk;
     cvec      *nsc0 = NULL;
     cvec      *nsc1 = NULL;
+    tuple_set  ts = {0,};
 
     /* Check if multiple direct children */
     cvk = yang_cvec_get(yu);
@@ -353,9 +478,11 @@ check_unique_list(cxobj     *x,
         goto done;
     if (ret == 0)
         goto fail; // XXX set xret
+    if (tuple_set_init(&ts, 1) < 0)
+        goto done;
     do {
         /* Collect search results from one */
-        if ((ret = unique_search_xpath(x, xpath1, nsc1, &svec, &slen)) < 0)
+        if ((ret = unique_search_xpath(x, xpath1, nsc1, &svec, &slen, &ts)) < 0)
             goto done;
         if (ret == 0){
             if (xret && netconf_data_not_unique_xml(xret, x, cvk) < 0)
@@ -368,6 +495,7 @@ check_unique_list(cxobj     *x,
     /* It would be possible to cache vec here as an optimization */
     retval = 1;
  done:
+    tuple_set_free(&ts);
     if (nsc0)
         cvec_free(nsc0);
     if (nsc1)
@@ -0,0 +1,835 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ *
+ * Binary encoding of XML trees for the internal NETCONF protocol between clients and backend
+ *
+ * A binary message body starts with a header whose first byte is NUL, which cannot start a
+ * text XML body. The receiver can therefore detect the encoding of each message.
+ * Header (all integers in network byte order):
+ *   4 bytes  magic: "\0CXB"
+ *   1 byte   version
+ *   1 byte   flags, CLIXON_BIN_FLAG_SPEC if schema-node ids are encoded
+ *   2 bytes  reserved
+ *   4 bytes  payload length
+ *   8 bytes  schema fingerprint of sender, or 0
+ * The payload is a number of top-level nodes encoded as:
+ *   element:   type name prefix spec-id nr-children children...
+ *   attribute: type name prefix value
+ *   body:      type length bytes
+ * Integers are unsigned LEB128 varints. Names, prefixes and attribute values are interned in
+ * a per-message string table: 0 is NULL, 1..n refers to an earlier string, and n+1 is a new
+ * string given by length and bytes.
+ * Schema-node ids are the position of the YANG node in a depth-first walk of the modules
+ * and schema nodes of the YANG spec. The fingerprint is computed over the same walk and
+ * ids are only used if the fingerprints of both ends are equal, in which case the receiver
+ * can set the YANG binding of each node directly instead of binding it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_string.h"
+#include "clixon_handle.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_data.h"
+#include "clixon_xml_bin.h"
+
+/* Name of schema-node id table in clicon_ptr */
+#define YANG_NODEIDS_PTR "yang-node-ids"
+
+/* Max nesting when decoding, protects against malicious messages */
+#define CLIXON_BIN_MAXDEPTH 1024
+
+/*! Schema-node id table of a YANG spec
+ */
+struct yang_nodeids{
+    yang_stmt        *yn_yspec;     /* YANG spec of table */
+    uint64_t          yn_fp;        /* Fingerprint */
+    yang_stmt       **yn_vec;       /* Node by id */
+    int               yn_len;       /* Nr of nodes */
+    int               yn_max;       /* Allocated length of yn_vec */
+    struct yang_nodeid_sorted {
+        yang_stmt    *ys_y;
+        uint32_t      ys_id;
+    }                *yn_sorted;    /* Nodes sorted on pointer, for id lookup */
+};
+
+/*! Encoding state of one message
+ */
+struct bin_enc{
+    cbuf             *be_cb;        /* Output */
+    clicon_hash_t    *be_strings;   /* Interned strings -> index */
+    uint32_t          be_nstrings;  /* Nr of interned strings */
+    struct yang_nodeids *be_ids;    /* Schema-node ids, or NULL */
+};
+
+/*! Decoding state of one message
+ */
+struct bin_dec{
+    unsigned char    *bd_p;         /* Current position */
+    unsigned char    *bd_end;       /* End of payload */
+    char            **bd_strings;   /* Interned strings */
+    uint32_t          bd_nstrings;
+    uint32_t          bd_max;
+    struct yang_nodeids *bd_ids;    /* Schema-node ids, or NULL */
+};
+
+/*
+ * Schema-node ids
+ */
+
+/*! FNV-1a step over a byte buffer
+ */
+static uint64_t
+bin_fnv(uint64_t    fp,
+        const void *buf,
+        size_t      len)
+{
+    const unsigned char *p = buf;
+
+    while (len--){
+        fp ^= *p++;
+        fp *= 0x100000001b3ULL;
+    }
+    return fp;
+}
+
+static int
+yang_nodeids_walk(struct yang_nodeids *yn,
+                  yang_stmt           *yp)
+{
+    yang_stmt    *ys = NULL;
+    yang_stmt    *yrev;
+    enum rfc_6020 keyw;
+    char         *arg;
+    uint32_t      k;
+
+    while ((ys = yn_each(yp, ys)) != NULL){
+        keyw = yang_keyword_get(ys);
+        if (keyw != Y_MODULE && keyw != Y_SUBMODULE && !yang_schemanode(ys))
+            continue;
+        if (yn->yn_len >= yn->yn_max){
+            yn->yn_max = yn->yn_max ? 2*yn->yn_max : 1024;
+            if ((yn->yn_vec = realloc(yn->yn_vec, yn->yn_max*sizeof(*yn->yn_vec))) == NULL){
+                clicon_err(OE_UNIX, errno, "realloc");
+                return -1;
+            }
+        }
+        yn->yn_vec[yn->yn_len++] = ys;
+        k = keyw;
+        yn->yn_fp = bin_fnv(yn->yn_fp, &k, sizeof(k));
+        if ((arg = yang_argument_get(ys)) != NULL)
+            yn->yn_fp = bin_fnv(yn->yn_fp, arg, strlen(arg)+1);
+        if ((keyw == Y_MODULE || keyw == Y_SUBMODULE) &&
+            (yrev = yang_find(ys, Y_REVISION, NULL)) != NULL &&
+            (arg = yang_argument_get(yrev)) != NULL)
+            yn->yn_fp = bin_fnv(yn->yn_fp, arg, strlen(arg)+1);
+        if (yang_nodeids_walk(yn, ys) < 0)
+            return -1;
+        yn->yn_fp = bin_fnv(yn->yn_fp, "", 1); /* End of children */
+    }
+    return 0;
+}
+
+static int
+yang_nodeid_cmp(const void *a,
+                const void *b)
+{
+    const struct yang_nodeid_sorted *sa = a;
+    const struct yang_nodeid_sorted *sb = b;
+
+    if (sa->ys_y == sb->ys_y)
+        return 0;
+    return (uintptr_t)sa->ys_y < (uintptr_t)sb->ys_y ? -1 : 1;
+}
+
+static void
+yang_nodeids_free1(struct yang_nodeids *yn)
+{
+    if (yn->yn_vec)
+        free(yn->yn_vec);
+    if (yn->yn_sorted)
+        free(yn->yn_sorted);
+    free(yn);
+}
+
+/*! Get schema-node id table of a YANG spec, build it if needed
+ * @param[in]  h      Clixon handle
+ * @param[in]  yspec  YANG spec
+ * @param[out] ynp    Id table
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+yang_nodeids_get(clicon_handle         h,
+                 yang_stmt            *yspec,
+                 struct yang_nodeids **ynp)
+{
+    struct yang_nodeids *yn = NULL;
+    int                  i;
+
+    if (clicon_ptr_get(h, YANG_NODEIDS_PTR, (void**)&yn) == 0 && yn != NULL){
+        if (yn->yn_yspec == yspec){
+            *ynp = yn;
+            return 0;
+        }
+        yang_nodeids_free1(yn);
+        clicon_ptr_del(h, YANG_NODEIDS_PTR);
+    }
+    if ((yn = malloc(sizeof(*yn))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return -1;
+    }
+    memset(yn, 0, sizeof(*yn));
+    yn->yn_yspec = yspec;
+    yn->yn_fp = 0xcbf29ce484222325ULL;
+    if (yang_nodeids_walk(yn, yspec) < 0)
+        goto err;
+    if (yn->yn_fp == 0) /* 0 means no fingerprint */
+        yn->yn_fp = 1;
+    if (yn->yn_len &&
+        (yn->yn_sorted = malloc(yn->yn_len*sizeof(*yn->yn_sorted))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto err;
+    }
+    for (i=0; i<yn->yn_len; i++){
+        yn->yn_sorted[i].ys_y = yn->yn_vec[i];
+        yn->yn_sorted[i].ys_id = i;
+    }
+    qsort(yn->yn_sorted, yn->yn_len, sizeof(*yn->yn_sorted), yang_nodeid_cmp);
+    if (clicon_ptr_set(h, YANG_NODEIDS_PTR, yn) < 0)
+        goto err;
+    *ynp = yn;
+    return 0;
+ err:
+    yang_nodeids_free1(yn);
+    return -1;
+}
+
+/*! Get schema-node id of a YANG node
+ * @retval  id+1  Found
+ * @retval  0     Not found, eg node in a mounted YANG spec
+ */
+static uint32_t
+yang_nodeid(struct yang_nodeids *yn,
+            yang_stmt           *y)
+{
+    struct yang_nodeid_sorted  key = {y, 0};
+    struct yang_nodeid_sorted *s;
+
+    if ((s = bsearch(&key, yn->yn_sorted, yn->yn_len, sizeof(key), yang_nodeid_cmp)) == NULL)
+        return 0;
+    return s->ys_id + 1;
+}
+
+/*! Get schema fingerprint of a YANG spec
+ *
+ * Two specs with equal fingerprints have the same schema-node ids.
+ * @param[in]  h      Clixon handle
+ * @param[in]  yspec  YANG spec
+ * @param[out] fp     Fingerprint, never 0
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+clixon_bin_fingerprint(clicon_handle h,
+                       yang_stmt    *yspec,
+                       uint64_t     *fp)
+{
+    struct yang_nodeids *yn;
+
+    if (yang_nodeids_get(h, yspec, &yn) < 0)
+        return -1;
+    *fp = yn->yn_fp;
+    return 0;
+}
+
+/*! Free schema-node id table
+ * @param[in]  h      Clixon handle
+ */
+int
+clixon_bin_exit(clicon_handle h)
+{
+    struct yang_nodeids *yn = NULL;
+
+    if (clicon_ptr_get(h, YANG_NODEIDS_PTR, (void**)&yn) == 0 && yn != NULL){
+        yang_nodeids_free1(yn);
+        clicon_ptr_del(h, YANG_NODEIDS_PTR);
+    }
+    return 0;
+}
+
+/*
+ * Encode
+ */
+
+static int
+bin_put_varint(cbuf    *cb,
+               uint64_t v)
+{
+    unsigned char buf[10];
+    int           i = 0;
+
+    do {
+        buf[i] = v & 0x7f;
+        v >>= 7;
+        if (v)
+            buf[i] |= 0x80;
+        i++;
+    } while (v);
+    return cbuf_append_buf(cb, buf, i);
+}
+
+static int
+bin_put_string(struct bin_enc *be,
+               char           *str)
+{
+    uint32_t *ip;
+    uint32_t  i;
+    size_t    len;
+
+    if (str == NULL)
+        return bin_put_varint(be->be_cb, 0);
+    if ((ip = clicon_hash_value(be->be_strings, str, NULL)) != NULL)
+        return bin_put_varint(be->be_cb, *ip + 1);
+    i = be->be_nstrings++;
+    if (clicon_hash_add(be->be_strings, str, &i, sizeof(i)) == NULL)
+        return -1;
+    len = strlen(str);
+    if (bin_put_varint(be->be_cb, i + 1) < 0 ||
+        bin_put_varint(be->be_cb, len) < 0)
+        return -1;
+    return cbuf_append_buf(be->be_cb, str, len);
+}
+
+/*! Nr of children of x that are encoded, same rules as clixon_xml2cbuf
+ */
+static int
+bin_nchildren(cxobj  *x,
+              int32_t depth)
+{
+    cxobj *xc = NULL;
+    int    n = 0;
+
+    while ((xc = xml_child_each(x, xc, -1)) != NULL){
+        switch (xml_type(xc)){
+        case CX_ATTR:
+            n++;
+            break;
+        case CX_BODY:
+            if (depth != 1 && xml_value(xc) != NULL)
+                n++;
+            break;
+        case CX_ELMNT:
+            if (depth != 1)
+                n++;
+            break;
+        default:
+            break;
+        }
+    }
+    return n;
+}
+
+static int
+bin_encode1(struct bin_enc *be,
+            cxobj          *x,
+            int32_t         depth)
+{
+    cxobj     *xc;
+    yang_stmt *y;
+    char      *val;
+    size_t     len;
+    cbuf      *cb = be->be_cb;
+
+    if (depth == 0)
+        return 0;
+    switch (xml_type(x)){
+    case CX_BODY:
+        if ((val = xml_value(x)) == NULL) /* incomplete tree */
+            break;
+        len = strlen(val);
+        if (cbuf_append(cb, CX_BODY) < 0 ||
+            bin_put_varint(cb, len) < 0 ||
+            cbuf_append_buf(cb, val, len) < 0)
+            return -1;
+        break;
+    case CX_ATTR:
+        if (cbuf_append(cb, CX_ATTR) < 0 ||
+            bin_put_string(be, xml_name(x)) < 0 ||
+            bin_put_string(be, xml_prefix(x)) < 0 ||
+            bin_put_string(be, xml_value(x)) < 0)
+            return -1;
+        break;
+    case CX_ELMNT:
+        if (cbuf_append(cb, CX_ELMNT) < 0 ||
+            bin_put_string(be, xml_name(x)) < 0 ||
+            bin_put_string(be, xml_prefix(x)) < 0)
+            return -1;
+        if (be->be_ids && (y = xml_spec(x)) != NULL){
+            if (bin_put_varint(cb, yang_nodeid(be->be_ids, y)) < 0)
+                return -1;
+        }
+        else if (bin_put_varint(cb, 0) < 0)
+            return -1;
+        if (bin_put_varint(cb, bin_nchildren(x, depth)) < 0)
+            return -1;
+        /* Attributes first, as in clixon_xml2cbuf */
+        xc = NULL;
+        while ((xc = xml_child_each(x, xc, CX_ATTR)) != NULL)
+            if (bin_encode1(be, xc, -1) < 0)
+                return -1;
+        xc = NULL;
+        while ((xc = xml_child_each(x, xc, -1)) != NULL)
+            if (xml_type(xc) != CX_ATTR)
+                if (bin_encode1(be, xc, depth-1) < 0)
+                    return -1;
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/*! Encode XML trees in binary form and append to a cbuf
+ *
+ * The trees may be wrapped in an element which is not part of the trees, eg rpc-reply
+ * @param[in]  h       Clixon handle
+ * @param[in]  cb      Cligen buffer to append message body to
+ * @param[in]  wrapper Name of wrapper element, or NULL
+ * @param[in]  wrapns  Default namespace of wrapper element, or NULL
+ * @param[in]  xvec    Top-level XML nodes
+ * @param[in]  xlen    Length of xvec
+ * @param[in]  depth   Limit levels of child resources: -1: all, 0: none, 1: node itself
+ * @param[in]  peerfp  Schema fingerprint of receiver, or 0. Schema-node ids are encoded only
+ *                     if equal to own fingerprint
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @note cb contains NUL characters, use cbuf_len() for its length
+ * @code
+ *   if (clixon_xml2bin(h, cb, "rpc-reply", NETCONF_BASE_NAMESPACE, &xdata, 1, -1, peerfp) < 0)
+ *      err;
+ * @endcode
+ * @see clixon_bin2xml  for decoding
+ * @see clixon_xml2cbuf  for the text form, depth has the same semantics
+ */
+int
+clixon_xml2bin(clicon_handle h,
+               cbuf         *cb,
+               char         *wrapper,
+               char         *wrapns,
+               cxobj       **xvec,
+               int           xlen,
+               int32_t       depth,
+               uint64_t      peerfp)
+{
+    int                  retval = -1;
+    struct bin_enc       be = {0,};
+    struct yang_nodeids *yn;
+    yang_stmt           *yspec;
+    size_t               hdrpos;
+    uint32_t             u32;
+    uint32_t             len;
+    unsigned char        hdr[CLIXON_BIN_HDRLEN] = {0,};
+    int                  i;
+
+    be.be_cb = cb;
+    if ((be.be_strings = clicon_hash_init()) == NULL)
+        goto done;
+    if (peerfp != 0 && (yspec = clicon_dbspec_yang(h)) != NULL){
+        if (yang_nodeids_get(h, yspec, &yn) < 0)
+            goto done;
+        if (yn->yn_fp == peerfp)
+            be.be_ids = yn;
+    }
+    hdrpos = cbuf_len(cb);
+    memcpy(hdr, CLIXON_BIN_MAGIC, 4);
+    hdr[4] = CLIXON_BIN_VERSION;
+    if (be.be_ids){
+        hdr[5] = CLIXON_BIN_FLAG_SPEC;
+        u32 = htonl(be.be_ids->yn_fp >> 32);
+        memcpy(&hdr[12], &u32, 4);
+        u32 = htonl(be.be_ids->yn_fp & 0xffffffff);
+        memcpy(&hdr[16], &u32, 4);
+    }
+    if (cbuf_append_buf(cb, hdr, sizeof(hdr)) < 0)
+        goto done;
+    if (wrapper){
+        if (bin_put_varint(cb, 1) < 0 ||
+            cbuf_append(cb, CX_ELMNT) < 0 ||
+            bin_put_string(&be, wrapper) < 0 ||
+            bin_put_string(&be, NULL) < 0 ||
+            bin_put_varint(cb, 0) < 0 ||
+            bin_put_varint(cb, (wrapns?1:0) + (depth?xlen:0)) < 0)
+            goto done;
+        if (wrapns)
+            if (cbuf_append(cb, CX_ATTR) < 0 ||
+                bin_put_string(&be, "xmlns") < 0 ||
+                bin_put_string(&be, NULL) < 0 ||
+                bin_put_string(&be, wrapns) < 0)
+                goto done;
+    }
+    else if (bin_put_varint(cb, depth?xlen:0) < 0)
+        goto done;
+    for (i=0; i<xlen; i++)
+        if (bin_encode1(&be, xvec[i], depth) < 0)
+            goto done;
+    /* Patch payload length, cbuf may have been reallocated */
+    len = htonl(cbuf_len(cb) - hdrpos - CLIXON_BIN_HDRLEN);
+    memcpy(cbuf_get(cb) + hdrpos + 8, &len, 4);
+    retval = 0;
+ done:
+    if (be.be_strings)
+        clicon_hash_free(be.be_strings);
+    return retval;
+}
+
+/*
+ * Decode
+ */
+
+/*! Check if a message body is binary encoded
+ * @param[in]  buf   Message body
+ * @param[in]  len   Length of buf
+ * @retval     1     Binary
+ * @retval     0     Not binary, eg text XML
+ */
+int
+clixon_bin_is(char  *buf,
+              size_t len)
+{
+    return len >= CLIXON_BIN_HDRLEN && memcmp(buf, CLIXON_BIN_MAGIC, 4) == 0;
+}
+
+/*! Length of binary message including header
+ * @param[in]  buf   Binary message body, checked with clixon_bin_is
+ */
+size_t
+clixon_bin_len(char *buf)
+{
+    uint32_t len;
+
+    memcpy(&len, buf+8, 4);
+    return CLIXON_BIN_HDRLEN + ntohl(len);
+}
+
+static int
+bin_get_varint(struct bin_dec *bd,
+               uint64_t       *vp)
+{
+    uint64_t v = 0;
+    int      shift = 0;
+    unsigned char c;
+
+    do {
+        if (bd->bd_p >= bd->bd_end || shift > 63)
+            return -1;
+        c = *bd->bd_p++;
+        v |= (uint64_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    *vp = v;
+    return 0;
+}
+
+static int
+bin_get_string(struct bin_dec *bd,
+               char          **strp)
+{
+    uint64_t v;
+    uint64_t len;
+    char    *str;
+
+    if (bin_get_varint(bd, &v) < 0)
+        return -1;
+    if (v == 0){
+        *strp = NULL;
+        return 0;
+    }
+    if (v <= bd->bd_nstrings){
+        *strp = bd->bd_strings[v-1];
+        return 0;
+    }
+    if (v != bd->bd_nstrings + 1 || bin_get_varint(bd, &len) < 0 ||
+        len > bd->bd_end - bd->bd_p)
+        return -1;
+    if ((str = malloc(len+1)) == NULL)
+        return -1;
+    memcpy(str, bd->bd_p, len);
+    str[len] = '\0';
+    bd->bd_p += len;
+    if (bd->bd_nstrings >= bd->bd_max){
+        bd->bd_max = bd->bd_max ? 2*bd->bd_max : 64;
+        if ((bd->bd_strings = realloc(bd->bd_strings, bd->bd_max*sizeof(char*))) == NULL){
+            free(str);
+            return -1;
+        }
+    }
+    bd->bd_strings[bd->bd_nstrings++] = str;
+    *strp = str;
+    return 0;
+}
+
+/*! Check that a schema node given by id is consistent with the decoded element
+ *
+ * The id is in range of the receiver's id table, but a sender may still be buggy or
+ * malicious. The YANG node must have the name of the element, and its schema parent,
+ * skipping choice, case, input and output, must be the YANG binding of the parent element.
+ * If the parent element is not bound (eg rpc or data wrapper) or is anydata, the YANG
+ * node may also be top-level in a module.
+ * @param[in]  y    YANG node given by id
+ * @param[in]  name Element name
+ * @param[in]  xp   Parent element
+ * @retval     1    Consistent, the binding can be used
+ * @retval     0    Not consistent, leave the element unbound
+ */
+static int
+bin_spec_check(yang_stmt *y,
+               char      *name,
+               cxobj     *xp)
+{
+    yang_stmt *yp;
+    yang_stmt *yxp;
+
+    if (strcmp(yang_argument_get(y), name) != 0)
+        return 0;
+    yp = yang_parent_get(y);
+    while (yp != NULL &&
+           (yang_keyword_get(yp) == Y_CHOICE || yang_keyword_get(yp) == Y_CASE ||
+            yang_keyword_get(yp) == Y_INPUT || yang_keyword_get(yp) == Y_OUTPUT))
+        yp = yang_parent_get(yp);
+    if (yp == NULL)
+        return 0;
+    if ((yxp = xml_spec(xp)) != NULL && yxp == yp)
+        return 1;
+    if ((yxp == NULL || yang_keyword_get(yxp) == Y_ANYDATA) &&
+        (yang_keyword_get(yp) == Y_MODULE || yang_keyword_get(yp) == Y_SUBMODULE))
+        return 1;
+    return 0;
+}
+
+static int
+bin_decode1(struct bin_dec *bd,
+            cxobj          *xp,
+            int             level)
+{
+    int        type;
+    char      *name;
+    char      *prefix;
+    char      *val;
+    uint64_t   id;
+    uint64_t   n;
+    uint64_t   i;
+    cxobj     *x;
+
+    if (bd->bd_p >= bd->bd_end || level > CLIXON_BIN_MAXDEPTH)
+        return -1;
+    type = *bd->bd_p++;
+    switch (type){
+    case CX_BODY:
+        if (bin_get_varint(bd, &n) < 0 || n > bd->bd_end - bd->bd_p)
+            return -1;
+        if ((x = xml_new("body", xp, CX_BODY)) == NULL)
+            return -1;
+        if ((val = malloc(n+1)) == NULL)
+            return -1;
+        memcpy(val, bd->bd_p, n);
+        val[n] = '\0';
+        bd->bd_p += n;
+        if (xml_value_set(x, val) < 0){
+            free(val);
+            return -1;
+        }
+        free(val);
+        break;
+    case CX_ATTR:
+        if (bin_get_string(bd, &name) < 0 ||
+            bin_get_string(bd, &prefix) < 0 ||
+            bin_get_string(bd, &val) < 0 || name == NULL)
+            return -1;
+        if ((x = xml_new(name, xp, CX_ATTR)) == NULL)
+            return -1;
+        if (prefix && xml_prefix_set(x, prefix) < 0)
+            return -1;
+        if (val && xml_value_set(x, val) < 0)
+            return -1;
+        break;
+    case CX_ELMNT:
+        if (bin_get_string(bd, &name) < 0 ||
+            bin_get_string(bd, &prefix) < 0 || name == NULL ||
+            bin_get_varint(bd, &id) < 0 ||
+            bin_get_varint(bd, &n) < 0)
+            return -1;
+        if ((x = xml_new(name, xp, CX_ELMNT)) == NULL)
+            return -1;
+        if (prefix && xml_prefix_set(x, prefix) < 0)
+            return -1;
+        if (id && bd->bd_ids){
+            /* Range check against the receiver's own id table */
+            if (id > bd->bd_ids->yn_len)
+                return -1;
+            /* Else unbound, and bound by the receiver as text XML */
+            if (bin_spec_check(bd->bd_ids->yn_vec[id-1], name, xp))
+                xml_spec_set(x, bd->bd_ids->yn_vec[id-1]);
+        }
+        for (i=0; i<n; i++)
+            if (bin_decode1(bd, x, level+1) < 0)
+                return -1;
+        break;
+    default:
+        return -1;
+    }
+    return 0;
+}
+
+/*! Decode binary message body to XML tree
+ *
+ * If the sender encoded schema-node ids of the same YANG spec, the YANG binding of the
+ * decoded nodes is set and no binding is needed, see clixon_bin_bound.
+ * Ids out of range of the receiver's table make the message malformed. Ids that are not
+ * consistent with the element name and its parent are ignored, the element is then
+ * unbound and the caller falls back to binding, eg xml_bind_yang_rpc.
+ * @param[in]     h      Clixon handle
+ * @param[in]     buf    Message body, checked with clixon_bin_is
+ * @param[in]     len    Length of buf
+ * @param[in,out] xt     Pointer to XML tree. If empty, create "top" as in clixon_xml_parse_string
+ * @retval        0      OK
+ * @retval       -1      Error, eg malformed message
+ * @see clixon_xml2bin  for encoding
+ */
+int
+clixon_bin2xml(clicon_handle h,
+               char         *buf,
+               size_t        len,
+               cxobj       **xt)
+{
+    int                  retval = -1;
+    struct bin_dec       bd = {0,};
+    struct yang_nodeids *yn;
+    yang_stmt           *yspec;
+    uint64_t             fp;
+    uint32_t             u32;
+    uint64_t             n;
+    uint64_t             i;
+    cxobj               *xtop = NULL;
+
+    if (!clixon_bin_is(buf, len) || clixon_bin_len(buf) > len ||
+        (unsigned char)buf[4] != CLIXON_BIN_VERSION){
+        clicon_err(OE_PROTO, EINVAL, "Malformed binary message");
+        goto done;
+    }
+    if (buf[5] & CLIXON_BIN_FLAG_SPEC){
+        memcpy(&u32, buf+12, 4);
+        fp = (uint64_t)ntohl(u32) << 32;
+        memcpy(&u32, buf+16, 4);
+        fp |= ntohl(u32);
+        if ((yspec = clicon_dbspec_yang(h)) != NULL){
+            if (yang_nodeids_get(h, yspec, &yn) < 0)
+                goto done;
+            if (yn->yn_fp == fp)
+                bd.bd_ids = yn;
+        }
+    }
+    bd.bd_p = (unsigned char*)buf + CLIXON_BIN_HDRLEN;
+    bd.bd_end = (unsigned char*)buf + clixon_bin_len(buf);
+    if (*xt == NULL){
+        if ((xtop = xml_new("top", NULL, CX_ELMNT)) == NULL)
+            goto done;
+        *xt = xtop;
+    }
+    if (bin_get_varint(&bd, &n) < 0)
+        goto malformed;
+    for (i=0; i<n; i++)
+        if (bin_decode1(&bd, *xt, 0) < 0)
+            goto malformed;
+    if (bd.bd_p != bd.bd_end)
+        goto malformed;
+    xtop = NULL;
+    retval = 0;
+ done:
+    if (bd.bd_strings){
+        for (i=0; i<bd.bd_nstrings; i++)
+            free(bd.bd_strings[i]);
+        free(bd.bd_strings);
+    }
+    if (xtop){
+        xml_free(xtop);
+        *xt = NULL;
+    }
+    return retval;
+ malformed:
+    clicon_err(OE_PROTO, EINVAL, "Malformed binary message");
+    goto done;
+}
+
+/*! Check if all element descendants of an XML node are bound to YANG
+ *
+ * Used after clixon_bin2xml to skip binding, x itself is typically a wrapper such as rpc
+ * or data without binding.
+ * @param[in]  x   XML node
+ * @retval     1   All element descendants of x have YANG binding
+ * @retval     0   At least one does not, or x has no element children
+ */
+int
+clixon_bin_bound(cxobj *x)
+{
+    cxobj *xc = NULL;
+    int    n = 0;
+
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+        if (xml_spec(xc) == NULL)
+            return 0;
+        if (xml_child_nr_type(xc, CX_ELMNT) && !clixon_bin_bound(xc))
+            return 0;
+        n++;
+    }
+    return n > 0;
+}
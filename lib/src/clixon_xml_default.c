@@ -71,6 +71,7 @@
 #include "clixon_xml_sort.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_xml_map.h"
+#include "clixon_yang_module.h"
 #include "clixon_xml_default.h"
 
 /* Forward */
@@ -696,3 +697,222 @@ xml_flag_default_value(cxobj   *x,
   done:
     return 0;
 }
+
+/*! Skip expression nodes of an xpath tree that have a single child
+ *
+ * @param[in]  xs   XPath tree
+ * @retval     xs   First node that is not a single-child expression
+ */
+static xpath_tree *
+xml_defaults_xpath_unwrap(xpath_tree *xs)
+{
+    while (xs != NULL && xs->xs_c0 != NULL && xs->xs_c1 == NULL){
+        switch (xs->xs_type){
+        case XP_EXP:
+        case XP_AND:
+        case XP_RELEX:
+        case XP_ADD:
+        case XP_UNION:
+        case XP_PATHEXPR:
+        case XP_FILTEREXPR:
+        case XP_LOCPATH:
+            xs = xs->xs_c0;
+            break;
+        default:
+            return xs;
+        }
+    }
+    return xs;
+}
+
+/*! Check if a predicate only compares keys of a list with literals
+ *
+ * @param[in]  xs     XPath tree of predicate expression
+ * @param[in]  ylist  YANG list of the step of the predicate
+ * @retval     1      Predicate only compares keys, eg [name='a'] or [a=1 and b=2]
+ * @retval     0      Other predicate
+ * @retval    -1      Error
+ */
+static int
+xml_defaults_xpath_keypred(xpath_tree *xs,
+                           yang_stmt  *ylist)
+{
+    int         ret;
+    xpath_tree *xl;
+    xpath_tree *xr;
+    xpath_tree *xstep;
+    xpath_tree *xp;
+
+    if ((xs = xml_defaults_xpath_unwrap(xs)) == NULL)
+        return 0;
+    if (xs->xs_type == XP_AND && xs->xs_int == XO_AND){
+        if ((ret = xml_defaults_xpath_keypred(xs->xs_c0, ylist)) != 1)
+            return ret;
+        return xml_defaults_xpath_keypred(xs->xs_c1, ylist);
+    }
+    if (xs->xs_type != XP_RELEX || xs->xs_int != XO_EQ || xs->xs_c1 == NULL)
+        return 0;
+    xl = xml_defaults_xpath_unwrap(xs->xs_c0);
+    xr = xml_defaults_xpath_unwrap(xs->xs_c1);
+    if (xl && (xl->xs_type == XP_PRIME_STR || xl->xs_type == XP_PRIME_NR)){
+        xp = xl;
+        xl = xr;
+        xr = xp;
+    }
+    if (xr == NULL || (xr->xs_type != XP_PRIME_STR && xr->xs_type != XP_PRIME_NR))
+        return 0;
+    /* Other side is a single child step without predicates */
+    if (xl == NULL || xl->xs_type != XP_RELLOCPATH || xl->xs_c1 != NULL ||
+        xl->xs_int == A_DESCENDANT_OR_SELF)
+        return 0;
+    xstep = xl->xs_c0;
+    if (xstep == NULL || xstep->xs_type != XP_STEP || xstep->xs_int != A_CHILD)
+        return 0;
+    if ((xp = xstep->xs_c1) != NULL && (xp->xs_c0 != NULL || xp->xs_c1 != NULL))
+        return 0;
+    if (xstep->xs_c0 == NULL || xstep->xs_c0->xs_type != XP_NODE || xstep->xs_c0->xs_s1 == NULL)
+        return 0;
+    return yang_key_match(ylist, xstep->xs_c0->xs_s1, NULL);
+}
+
+/*! Walk an xpath tree, see xml_defaults_xpath_independent
+ *
+ * @param[in]     xs     XPath tree
+ * @param[in]     nsc    XML namespace context of xpath
+ * @param[in]     yspec  Top-level YANG specification tree
+ * @param[in,out] yp     YANG node of current step, or NULL if not known
+ * @param[in,out] top    Set if current step is the root
+ * @retval        1      Selection does not depend on default values
+ * @retval        0      Selection may depend on default values
+ * @retval       -1      Error
+ */
+static int
+xml_defaults_xpath_walk(xpath_tree *xs,
+                        cvec       *nsc,
+                        yang_stmt  *yspec,
+                        yang_stmt **yp,
+                        int        *top)
+{
+    int         ret;
+    yang_stmt  *y0;
+    int         top0;
+    yang_stmt  *ymod;
+    char       *ns;
+    xpath_tree *xn;
+    xpath_tree *xp;
+
+    switch (xs->xs_type){
+    case XP_EXP:
+    case XP_AND:
+    case XP_RELEX:
+    case XP_ADD:
+    case XP_PATHEXPR:
+    case XP_LOCPATH:
+        /* Operators and filter expressions */
+        if (xs->xs_c1 != NULL || xs->xs_c0 == NULL)
+            return 0;
+        return xml_defaults_xpath_walk(xs->xs_c0, nsc, yspec, yp, top);
+    case XP_UNION:
+        if (xs->xs_c1 == NULL)
+            return xml_defaults_xpath_walk(xs->xs_c0, nsc, yspec, yp, top);
+        /* Each location path of a union from the same context */
+        y0 = *yp;
+        top0 = *top;
+        if ((ret = xml_defaults_xpath_walk(xs->xs_c0, nsc, yspec, &y0, &top0)) != 1)
+            return ret;
+        return xml_defaults_xpath_walk(xs->xs_c1, nsc, yspec, yp, top);
+    case XP_ABSPATH:
+        *yp = NULL;
+        *top = (xs->xs_int != A_DESCENDANT_OR_SELF);
+        if (xs->xs_c0 == NULL)
+            return 1;
+        return xml_defaults_xpath_walk(xs->xs_c0, nsc, yspec, yp, top);
+    case XP_RELLOCPATH:
+        if ((ret = xml_defaults_xpath_walk(xs->xs_c0, nsc, yspec, yp, top)) != 1)
+            return ret;
+        if (xs->xs_int == A_DESCENDANT_OR_SELF){
+            *yp = NULL;
+            *top = 0;
+        }
+        if (xs->xs_c1 == NULL)
+            return 1;
+        return xml_defaults_xpath_walk(xs->xs_c1, nsc, yspec, yp, top);
+    case XP_STEP:
+        switch (xs->xs_int){
+        case A_CHILD:
+            xn = xs->xs_c0;
+            if (xn && xn->xs_type == XP_NODE && xn->xs_s1 && strcmp(xn->xs_s1, "*") != 0){
+                if (*top){
+                    ymod = NULL;
+                    if ((ns = xml_nsctx_get(nsc, xn->xs_s0)) != NULL)
+                        ymod = yang_find_module_by_namespace(yspec, ns);
+                    *yp = ymod ? yang_find_datanode(ymod, xn->xs_s1) : NULL;
+                }
+                else if (*yp)
+                    *yp = yang_find_datanode(*yp, xn->xs_s1);
+            }
+            else
+                *yp = NULL;
+            *top = 0;
+            break;
+        case A_SELF:
+            break;
+        case A_DESCENDANT:
+        case A_DESCENDANT_OR_SELF:
+            *yp = NULL;
+            *top = 0;
+            break;
+        default: /* Parent, ancestor and sibling axes */
+            return 0;
+        }
+        /* Predicates, only of list keys */
+        for (xp = xs->xs_c1; xp != NULL; xp = xp->xs_c0){
+            if (xp->xs_c1 == NULL)
+                continue;
+            if (*yp == NULL || yang_keyword_get(*yp) != Y_LIST)
+                return 0;
+            if ((ret = xml_defaults_xpath_keypred(xp->xs_c1, *yp)) != 1)
+                return ret;
+        }
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*! Check if what an xpath selects does not depend on default values in the tree
+ *
+ * A default leaf, or a non-presence container created for default values, may then be
+ * selected, but does not change the selection of other nodes. That is, the xpath only has
+ * child, self and descendant steps and unions of such, and predicates only compare list
+ * keys with literals, since keys do not have default values.
+ * Defaults can then be left out of a tree that is evaluated with the xpath, if default
+ * values are not reported.
+ * @param[in]  xpath  XPath, or NULL for "/"
+ * @param[in]  nsc    XML namespace context of xpath
+ * @param[in]  yspec  Top-level YANG specification tree
+ * @retval     1      Selection does not depend on default values
+ * @retval     0      Selection may depend on default values
+ * @retval    -1      Error
+ * @see xml_default_recurse
+ */
+int
+xml_defaults_xpath_independent(const char *xpath,
+                               cvec       *nsc,
+                               yang_stmt  *yspec)
+{
+    int         retval = -1;
+    xpath_tree *xpt = NULL;
+    yang_stmt  *y = NULL;
+    int         top = 1;
+
+    if (xpath == NULL || strcmp(xpath, "/") == 0)
+        return 1;
+    if (xpath_parse(xpath, &xpt) < 0)
+        goto done;
+    retval = xml_defaults_xpath_walk(xpt, nsc, yspec, &y, &top);
+ done:
+    if (xpt)
+        xpath_tree_free(xpt);
+    return retval;
+}
@@ -80,6 +80,26 @@
 /* Size of xml read buffer */
 #define BUFLEN 1024  
 
+/*
+ * Types
+ */
+/* Element being serialized by clixon_xml2cbuf_chunk */
+struct xml2cbuf_frame{
+    cxobj   *xf_x;      /* Element whose start tag is written */
+    cxobj   *xf_xc;     /* Last child written, or NULL */
+    int32_t  xf_depth;  /* Depth of element */
+};
+
+/* Resumable serializer state, see clixon_xml2cbuf_chunk */
+struct xml2cbuf_chunk{
+    cxobj                 *xch_x;     /* Top-level element */
+    int32_t                xch_depth; /* Depth of top-level element */
+    int                    xch_begun; /* Start tag of top-level element written */
+    struct xml2cbuf_frame *xch_vec;   /* Stack of elements with start tag written */
+    int                    xch_len;   /* Number of elements in stack */
+    int                    xch_max;   /* Allocated length of stack */
+};
+
 /*------------------------------------------------------------------------
  * XML printing functions. Output a parse tree to file, string cligen buf
  *------------------------------------------------------------------------*/
@@ -459,6 +479,169 @@ clixon_xml2cbuf(cbuf   *cb,
     return retval;
 }
 
+/*! Create resumable serializer of XML tree, see clixon_xml2cbuf_chunk
+ *
+ * @param[in]  xn     Top-level xml object, must not be changed until serializer is freed
+ * @param[in]  depth  Limit levels of child resources: -1: all, 0: none, 1: node itself
+ * @retval     xch    Serializer, free with clixon_xml2cbuf_chunk_free
+ * @retval     NULL   Error
+ */
+xml2cbuf_chunk *
+clixon_xml2cbuf_chunk_new(cxobj  *xn,
+                          int32_t depth)
+{
+    xml2cbuf_chunk *xch;
+
+    if ((xch = calloc(1, sizeof(*xch))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        return NULL;
+    }
+    xch->xch_x = xn;
+    xch->xch_depth = depth;
+    return xch;
+}
+
+/*! Free resumable serializer
+ *
+ * @param[in]  xch    Serializer
+ * @retval     0      OK
+ */
+int
+clixon_xml2cbuf_chunk_free(xml2cbuf_chunk *xch)
+{
+    if (xch->xch_vec)
+        free(xch->xch_vec);
+    free(xch);
+    return 0;
+}
+
+/*! Write start tag of element with element children and push it on serializer stack
+ *
+ * @param[in]  xch    Serializer
+ * @param[in]  cb     Cligen buffer to write to
+ * @param[in]  x      Element
+ * @param[in]  depth  Depth of element
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+xml2cbuf_chunk_push(xml2cbuf_chunk *xch,
+                    cbuf           *cb,
+                    cxobj          *x,
+                    int32_t         depth)
+{
+    int                    retval = -1;
+    struct xml2cbuf_frame *xf;
+    cxobj                 *xa = NULL;
+    char                  *prefix;
+
+    if (xch->xch_len == xch->xch_max){
+        xch->xch_max = xch->xch_max ? 2*xch->xch_max : 16;
+        if ((xf = realloc(xch->xch_vec, xch->xch_max*sizeof(*xf))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            goto done;
+        }
+        xch->xch_vec = xf;
+    }
+    xf = &xch->xch_vec[xch->xch_len++];
+    xf->xf_x = x;
+    xf->xf_xc = NULL;
+    xf->xf_depth = depth;
+    cbuf_append_str(cb, "<");
+    if ((prefix = xml_prefix(x)) != NULL){
+        cbuf_append_str(cb, prefix);
+        cbuf_append_str(cb, ":");
+    }
+    cbuf_append_str(cb, xml_name(x));
+    while ((xa = xml_child_each(x, xa, CX_ATTR)) != NULL)
+        if (clixon_xml2cbuf1(cb, xa, 0, 0, -1) < 0)
+            goto done;
+    cbuf_append_str(cb, ">");
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Print part of an XML tree to a cligen buffer, resuming where the previous call stopped
+ *
+ * Serializes the tree subtree by subtree until at least len bytes have been appended to
+ * cb, so that a large tree can be written without holding all of its text in memory.
+ * Elements without element children are written in one piece, so a call may append
+ * more than len bytes. The output of all calls is the same as clixon_xml2cbuf without
+ * pretty-print.
+ * @param[in]  xch    Serializer, see clixon_xml2cbuf_chunk_new
+ * @param[in]  cb     Cligen buffer to append to
+ * @param[in]  len    Number of bytes to append before returning
+ * @retval     1      More remains, call again
+ * @retval     0      Done, whole tree written
+ * @retval    -1      Error
+ * @code
+ *   xml2cbuf_chunk *xch;
+ *   if ((xch = clixon_xml2cbuf_chunk_new(xn, -1)) == NULL)
+ *      goto err;
+ *   do {
+ *      cbuf_reset(cb);
+ *      if ((ret = clixon_xml2cbuf_chunk(xch, cb, 8192)) < 0)
+ *         goto err;
+ *      write(fd, cbuf_get(cb), cbuf_len(cb));
+ *   } while (ret == 1);
+ *   clixon_xml2cbuf_chunk_free(xch);
+ * @endcode
+ * @see clixon_xml2cbuf
+ */
+int
+clixon_xml2cbuf_chunk(xml2cbuf_chunk *xch,
+                      cbuf           *cb,
+                      size_t          len)
+{
+    int                    retval = -1;
+    struct xml2cbuf_frame *xf;
+    cxobj                 *xc;
+    char                  *prefix;
+    size_t                 len0 = cbuf_len(cb);
+
+    if (!xch->xch_begun){
+        xch->xch_begun = 1;
+        if (xch->xch_depth != 0 && xml_type(xch->xch_x) == CX_ELMNT &&
+            xml_child_nr_type(xch->xch_x, CX_ELMNT) > 0){
+            if (xml2cbuf_chunk_push(xch, cb, xch->xch_x, xch->xch_depth) < 0)
+                goto done;
+        }
+        else if (clixon_xml2cbuf1(cb, xch->xch_x, 0, 0, xch->xch_depth) < 0)
+            goto done;
+    }
+    while (xch->xch_len > 0 && cbuf_len(cb) - len0 < len){
+        xf = &xch->xch_vec[xch->xch_len-1];
+        xc = xf->xf_xc;
+        while ((xc = xml_child_each(xf->xf_x, xc, -1)) != NULL &&
+               xml_type(xc) == CX_ATTR)
+            ;
+        if (xc == NULL){ /* All children written: end tag and pop */
+            cbuf_append_str(cb, "</");
+            if ((prefix = xml_prefix(xf->xf_x)) != NULL){
+                cbuf_append_str(cb, prefix);
+                cbuf_append_str(cb, ":");
+            }
+            cbuf_append_str(cb, xml_name(xf->xf_x));
+            cbuf_append_str(cb, ">");
+            xch->xch_len--;
+            continue;
+        }
+        xf->xf_xc = xc;
+        if (xf->xf_depth-1 != 0 && xml_type(xc) == CX_ELMNT &&
+            xml_child_nr_type(xc, CX_ELMNT) > 0){
+            /* May reallocate stack, xf is not used after */
+            if (xml2cbuf_chunk_push(xch, cb, xc, xf->xf_depth-1) < 0)
+                goto done;
+        }
+        else if (clixon_xml2cbuf1(cb, xc, 0, 0, xf->xf_depth-1) < 0)
+            goto done;
+    }
+    retval = xch->xch_len > 0;
+ done:
+    return retval;
+}
+
 /*! Print actual xml tree datastructures (not xml), mainly for debugging
  * @param[in,out] cb          Cligen buffer to write to
  * @param[in]     xn          Clicon xml tree
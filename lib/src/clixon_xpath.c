@@ -618,11 +618,41 @@ xpath_vec_ctx(cxobj      *xcur,
 {
     int         retval = -1;
     xpath_tree *xptree = NULL;
-    xp_ctx      xc = {0,};
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     if (xpath_parse(xpath, &xptree) < 0)
         goto done;
+    if (xpath_tree_ctx(xcur, nsc, xptree, localonly, xrp) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xptree)
+        xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Given XML tree and parsed xpath, eval it and return xpath context
+ *
+ * Use this to evaluate the same xpath on several XML trees without parsing it each time
+ * @param[in]  xcur   XML-tree where to search
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xptree Parsed XPATH, see xpath_parse
+ * @param[in]  localonly Skip prefix and namespace tests (non-standard)
+ * @param[out] xrp    Return XPATH context
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xpath_vec_ctx
+ */
+int
+xpath_tree_ctx(cxobj      *xcur,
+               cvec       *nsc,
+               xpath_tree *xptree,
+               int         localonly,
+               xp_ctx    **xrp)
+{
+    int    retval = -1;
+    xp_ctx xc = {0,};
+
     xc.xc_type = XT_NODESET;
     xc.xc_node = xcur;
     xc.xc_initial = xcur;
@@ -632,12 +662,8 @@ xpath_vec_ctx(cxobj      *xcur,
         goto done;
     retval = 0;
  done:
-    if (xc.xc_nodeset){
+    if (xc.xc_nodeset)
         free(xc.xc_nodeset);
-        xc.xc_nodeset = NULL;
-    }
-    if (xptree)
-        xpath_tree_free(xptree);
     return retval;
 }
 
@@ -84,6 +84,7 @@
 #include "clixon_yang_parse_lib.h"
 #include "clixon_yang_cardinality.h"
 #include "clixon_yang_type.h"
+#include "clixon_regex.h"
 #include "clixon_yang_schema_mount.h"
 #include "clixon_yang_internal.h" /* internal included by this file only, not API*/
 
@@ -3654,6 +3655,13 @@ yang_type_cache_free(yang_type_cache *ycache)
     if (ycache->yc_regexps){
         cv = NULL;
         while ((cv = cvec_each(ycache->yc_regexps, cv)) != NULL){
+            if (cv_name_get(cv) && strcmp(cv_name_get(cv), REGEX_FAST_NAME) == 0){
+                if ((p = cv_void_get(cv)) != NULL){
+                    regex_fast_free(p);
+                    cv_void_set(cv, NULL);
+                }
+                continue;
+            }
             /* need to store mode since clicon_handle is not available */
             switch (ycache->yc_rxmode){
             case REGEXP_POSIX:
@@ -190,9 +190,34 @@ compile_pattern2regexp(clicon_handle h,
     void   *re = NULL;
     int     ret;
     char   *pattern;
+    char   *native = NULL; /* Typedef whose patterns are covered by native validator */
 
     pcv = NULL;
     while ((pcv = cvec_each(patterns, pcv)) != NULL){
+        if (native && cv_name_get(pcv) && strcmp(cv_name_get(pcv), native) == 0)
+            continue;
+        native = NULL;
+        /* Native typedef validator or DFA, else regexp engine */
+        if ((ret = regex_fast_compile(h, patterns, pcv, &re)) < 0)
+            goto done;
+        if (ret > 0){
+            if ((rcv = cvec_add(regexps, CGV_VOID)) == NULL){
+                clicon_err(OE_UNIX, errno, "cvec_add");
+                regex_fast_free(re);
+                goto done;
+            }
+            cv_void_set(rcv, re);
+            re = NULL;
+            if (cv_name_set(rcv, REGEX_FAST_NAME) == NULL){
+                clicon_err(OE_UNIX, errno, "cv_name_set");
+                goto done;
+            }
+            if (ret == 2)
+                native = cv_name_get(pcv);
+            else if (cv_flag(pcv, V_INVERT))
+                cv_flag_set(rcv, V_INVERT);
+            continue;
+        }
         pattern = cv_string_get(pcv);
         /* Compile yang pattern. handle necessary to select regex engine */
         if ((ret = regex_compile(h, pattern, &re)) < 0)
@@ -396,11 +421,16 @@ cv_validate_pattern(clicon_handle h,
     cg_var *cvr;
     void   *re = NULL;
     int     ret;
+    char   *name;
 
     cvr = NULL; /* Loop over compiled regexps */
     while ((cvr = cvec_each(regexps, cvr)) != NULL){
         re = cv_void_get(cvr);
-        if ((ret = regex_exec(h, re, str?str:"")) < 0)
+        if ((name = cv_name_get(cvr)) != NULL && strcmp(name, REGEX_FAST_NAME) == 0)
+            ret = regex_fast_exec(h, re, str?str:"");
+        else
+            ret = regex_exec(h, re, str?str:"");
+        if (ret < 0)
             goto done;
         if (cv_flag(cvr, V_INVERT))
             ret = !ret; /* swap 0 and 1 */
@@ -621,7 +651,7 @@ cv_validate1(clicon_handle h,
                 retu = range_check(uu, cv1, cv2, uint32);
                 break;
             case CGV_UINT64:
-                uu =  cv_uint32_get(cv);
+                uu =  cv_uint64_get(cv);
                 retu = range_check(uu, cv1, cv2, uint64);
                 break;
             case CGV_STRING:
@@ -1238,8 +1268,10 @@ yang_type_resolve_restrictions(yang_stmt   *ytype,
 {
     int        retval = -1;
     yang_stmt *ys;
+    yang_stmt *yp;
     cg_var    *cv;
     char      *pattern;
+    cbuf      *cb = NULL;
 
     if (options && cvv &&
         (ys = yang_find(ytype, Y_RANGE, NULL)) != NULL){
@@ -1266,6 +1298,20 @@ yang_type_resolve_restrictions(yang_stmt   *ytype,
             if (yang_find(ys, Y_MODIFIER, "invert-match") != NULL)
                 cv_flag_set(cv, V_INVERT);
             cv_string_set(cv, pattern);
+            /* Tag with typedef identity, see regex_fast_compile */
+            if ((yp = yang_parent_get(ytype)) != NULL &&
+                yang_keyword_get(yp) == Y_TYPEDEF){
+                if (cb == NULL && (cb = cbuf_new()) == NULL){
+                    clicon_err(OE_UNIX, errno, "cbuf_new");
+                    goto done;
+                }
+                cbuf_reset(cb);
+                cprintf(cb, "%s:%s", yang_argument_get(ys_module(yp)), yang_argument_get(yp));
+                if (cv_name_set(cv, cbuf_get(cb)) == NULL){
+                    clicon_err(OE_UNIX, errno, "cv_name_set");
+                    goto done;
+                }
+            }
         }
     }
     if (options && fraction && 
@@ -1275,6 +1321,8 @@ yang_type_resolve_restrictions(yang_stmt   *ytype,
     }
     retval = 0;
  done:
+    if (cb)
+        cbuf_free(cb);
     return retval;
 }
 
@@ -708,6 +708,8 @@ function endtest()
     unset clixon_util_json
     unset clixon_util_xml
     unset clixon_util_path
+    unset clixon_util_regexp
+    unset clixon_util_replay
     unset clixon_util_socket
     unset clixon_util_stream
     unset clixon_util_xpath
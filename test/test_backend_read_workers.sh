@@ -0,0 +1,108 @@
+#!/usr/bin/env bash
+# Read-only requests in backend worker processes, see CLICON_BACKEND_READ_WORKERS
+# Check that get, get-config and get-schema replies are correct when handled by workers,
+# also after changes are committed, and that requests of one client are replied in order.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Raw unit tester of backend unix socket
+: ${clixon_util_socket:=clixon_util_socket}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/readworkers.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>$sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_BACKEND_READ_WORKERS>2</CLICON_BACKEND_READ_WORKERS>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>true</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module readworkers{
+    yang-version 1.1;
+    namespace "urn:example:readworkers";
+    prefix ex;
+    container table{
+        list parameter{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+        }
+    }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "add parameter a"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:readworkers\"><parameter><name>a</name><value>1</value></parameter></table></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf get-config running"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:readworkers\"><parameter><name>a</name><value>1</value></parameter></table></data></rpc-reply>"
+
+new "add parameter b"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:readworkers\"><parameter><name>b</name><value>2</value></parameter></table></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit b"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf get after commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"config\"><filter type=\"xpath\" select=\"/ex:table\" xmlns:ex=\"urn:example:readworkers\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:readworkers\"><parameter><name>a</name><value>1</value></parameter><parameter><name>b</name><value>2</value></parameter></table></data></rpc-reply>"
+
+new "netconf get-schema"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-schema xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\"><identifier>readworkers</identifier></get-schema></rpc>" "" "<rpc-reply $DEFAULTNS><data xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\">module readworkers{"
+
+new "netconf get-config error"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><notexist/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error>"
+
+new "pipelined get-config replied in order"
+expectpart "$(echo "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG -n 4)" 0 "1: <rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:readworkers\">" "4: <rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:readworkers\">"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,165 @@
+#!/usr/bin/env bash
+# State data with read-only requests in backend worker processes, see CLICON_BACKEND_READ_WORKERS
+# 1. The example state callback fails in a worker since its state file is removed. Check that
+#    the client gets an error reply and that the backend continues to serve requests.
+# 2. Read workers combined with state deadline and state cache of the example plugin.
+#    Check that the late result of the state worker and the cached state are kept by the
+#    backend between requests, ie get of state data is not handled by read workers.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fstate=$dir/state.xml
+fyang=$dir/readworkers.yang
+
+# Deadline and delay of state callback [ms]
+deadline=300
+delay=1000
+
+# Max age of cached state [ms], longer than the test
+maxage=30000
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_YANG_LIBRARY>false</CLICON_YANG_LIBRARY>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_BACKEND_READ_WORKERS>2</CLICON_BACKEND_READ_WORKERS>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module readworkers{
+    yang-version 1.1;
+    namespace "urn:example:example";
+    prefix ex;
+    container sensors{
+        config false;
+        list sensor{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+        }
+    }
+}
+EOF
+
+# Write state file
+# @param[in] $1  Value of sensor
+function state_write(){
+    cat <<EOF > $fstate
+   <sensors xmlns="urn:example:example">
+      <sensor><name>a</name><value>$1</value></sensor>
+   </sensors>
+EOF
+}
+
+getstate="<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>"
+
+state_write 42
+
+new "test params: -f $cfg -- -sS $fstate"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate"
+    start_backend -s init -f $cfg -- -sS $fstate
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get state in worker"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$getstate" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+rm -f $fstate
+
+for i in 1 2 3; do
+    new "netconf get state error in worker $i"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$getstate" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-failed</error-tag>"
+done
+
+state_write 17
+
+new "netconf get state in worker after errors"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$getstate" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>17</value></sensor></sensors></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+state_write 42
+
+new "test params: -f $cfg -- -sS $fstate -d $deadline -w $delay -m $maxage"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate -d $deadline -w $delay -m $maxage"
+    start_backend -s init -f $cfg -- -sS $fstate -d $deadline -w $delay -m $maxage
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get state missed deadline, no previous state"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$getstate" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+# Late result arrives after delay and is cached
+sleep 2
+
+state_write 17
+
+new "netconf get state, late result from cache"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$getstate" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf get state, from cache again"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$getstate" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf stats state-cache hits kept by backend"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "" "<state-cache $LIBNS><name>example_backend</name><entries>1</entries><hits>2</hits>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,126 @@
+#!/usr/bin/env bash
+# Default values and xpath filters of get-config, see xml_defaults_xpath_independent
+# Defaults are added only to the copy of the datastore cache if they can not change what the
+# xpath selects. Check with-defaults modes with xpaths that do and do not depend on defaults.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/defxpath.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module defxpath{
+    yang-version 1.1;
+    namespace "urn:example:defxpath";
+    prefix ex;
+    container table{
+        list parameter{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+                default 7;
+            }
+        }
+        leaf mode{
+            type string;
+            default "auto";
+        }
+    }
+}
+EOF
+
+# Get-config of running
+# Args:
+# 1. with-defaults mode
+# 2. xpath filter, or empty
+function getdef()
+{
+    wdef=$1
+    xpath=$2
+    filter=""
+    if [ -n "$xpath" ]; then
+        filter="<filter type=\"xpath\" select=\"$xpath\" xmlns:ex=\"urn:example:defxpath\"/>"
+    fi
+    echo "<rpc $DEFAULTNS><get-config><source><running/></source>$filter<with-defaults xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-with-defaults\">$wdef</with-defaults></get-config></rpc>"
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "add entries, value of a is default"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name></parameter><parameter><name>b</name><value>3</value></parameter></table></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "report-all, all"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef report-all)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name><value>7</value></parameter><parameter><name>b</name><value>3</value></parameter><mode>auto</mode></table></data></rpc-reply>"
+
+new "explicit, all"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef explicit)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name></parameter><parameter><name>b</name><value>3</value></parameter></table></data></rpc-reply>"
+
+new "trim, all"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef trim)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name></parameter><parameter><name>b</name><value>3</value></parameter></table></data></rpc-reply>"
+
+new "explicit, key predicate"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef explicit "/ex:table/ex:parameter[ex:name='b']")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>b</name><value>3</value></parameter></table></data></rpc-reply>"
+
+new "explicit, default leaf"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef explicit "/ex:table/ex:parameter[ex:name='a']/ex:value")" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "report-all, default leaf"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef report-all "/ex:table/ex:parameter[ex:name='a']/ex:value")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name><value>7</value></parameter></table></data></rpc-reply>"
+
+new "explicit, predicate on default value"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef explicit "/ex:table/ex:parameter[ex:value=7]")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name></parameter></table></data></rpc-reply>"
+
+new "report-all, all after predicate on default value"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdef report-all)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:defxpath\"><parameter><name>a</name><value>7</value></parameter><parameter><name>b</name><value>3</value></parameter><mode>auto</mode></table></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
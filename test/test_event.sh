@@ -0,0 +1,106 @@
+#!/usr/bin/env bash
+# Backend event loop, see clixon_event_loop
+# Many concurrent client sessions are registered and unregistered, so that file
+# descriptor numbers are reused while other sessions are active. Check that all sessions
+# get their replies, and that the periodic stream timer is called meanwhile.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/event.yang
+
+# Number of concurrent sessions in each round
+: ${nr:=50}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module event{
+    yang-version 1.1;
+    namespace "urn:example:event";
+    prefix ex;
+    container c{
+        leaf x{
+            type string;
+        }
+    }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+rpc+=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>")
+
+for round in 1 2 3; do
+    new "round $round: $nr concurrent sessions"
+    for (( i=0; i<$nr; i++ )); do
+        # Sessions of different length so that they close in varying order
+        (echo "$DEFAULTHELLO$rpc"; sleep 0.0$(( $i % 10 ))) | $clixon_netconf -qef $cfg > $dir/session.$i &
+    done
+    wait
+
+    for (( i=0; i<$nr; i++ )); do
+        new "round $round: session $i replies"
+        n=$(grep -o "<rpc-reply $DEFAULTNS><data/></rpc-reply>" $dir/session.$i | wc -l)
+        if [ $n -ne 2 ]; then
+            err "2 replies" "$(cat $dir/session.$i)"
+        fi
+    done
+done
+
+new "netconf stats: client callbacks"
+stats=$(chunked_framing "<rpc $DEFAULTNS><stats $LIBNS/></rpc>")
+expectpart "$(echo "$DEFAULTHELLO$stats" | $clixon_netconf -qef $cfg)" 0 "<event-loop $LIBNS><passes>" "<callback><name>server socket</name>" "<callback><name>local netconf client socket</name>"
+
+new "wait for stream timer"
+sleep 6
+
+new "netconf stats: timer called"
+expectpart "$(echo "$DEFAULTHELLO$stats" | $clixon_netconf -qef $cfg)" 0 "<event-loop $LIBNS>" --not-- "<timer-calls>0</timer-calls>"
+
+new "netconf get-config after sessions closed"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,138 @@
+#!/usr/bin/env bash
+# Fair scheduling in the backend event loop, see clixon_event_loop
+# One client sends a long pipelined stream of get-config requests. Meanwhile check that
+# another client is served, and that the periodic stream timer is called without being
+# delayed by the busy client: the timer-late-max counter of the stats RPC is bounded.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/fair.yang
+fconfig=$dir/config.xml
+fload=$dir/load.xml
+
+# Number of list entries
+: ${perfnr:=1000}
+
+# Number of pipelined requests of the busy client
+: ${perfreq:=5000}
+
+# Max allowed timer lateness in us
+latemax=1000000
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module fair{
+    yang-version 1.1;
+    namespace "urn:example:fair";
+    prefix ex;
+    container c{
+        list e{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type string;
+            }
+        }
+    }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "generate config with $perfnr entries"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:fair\">"
+for (( i=0; i<$perfnr; i++ )); do
+    rpc+="<e><name>e$i</name><value>$i</value></e>"
+done
+rpc+="</c></config></edit-config></rpc>"
+echo -n "$DEFAULTHELLO" > $fconfig
+echo "$(chunked_framing "$rpc")" >> $fconfig
+
+new "netconf write config"
+expecteof_file "$clixon_netconf -qef $cfg" 0 "$fconfig" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>$"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "generate $perfreq pipelined requests"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+echo -n "$DEFAULTHELLO" > $fload
+for (( i=0; i<$perfreq; i++ )); do
+    echo -n "$rpc" >> $fload
+done
+echo >> $fload
+
+new "start busy client"
+$clixon_netconf -qef $cfg < $fload > /dev/null &
+busy=$!
+
+new "wait for stream timer under load"
+sleep 6
+
+new "other client is served under load"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:c/ex:e[ex:name='e7']\" xmlns:ex=\"urn:example:fair\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:fair\"><e><name>e7</name><value>7</value></e></c></data></rpc-reply>"
+
+new "netconf stats under load"
+stats=$(chunked_framing "<rpc $DEFAULTNS><stats $LIBNS/></rpc>")
+ret=$(echo "$DEFAULTHELLO$stats" | $clixon_netconf -qef $cfg)
+expectpart "$ret" 0 "<event-loop $LIBNS>" --not-- "<timer-calls>0</timer-calls>"
+
+new "timer lateness under $latemax us"
+late=$(echo "$ret" | sed -n 's/.*<timer-late-max>\([0-9]*\)<\/timer-late-max>.*/\1/p')
+if [ -z "$late" ]; then
+    err "<timer-late-max>" "$ret"
+fi
+if [ $late -gt $latemax ]; then
+    err "timer-late-max <= $latemax" "$late"
+fi
+
+new "stop busy client"
+kill $busy 2> /dev/null
+wait $busy 2> /dev/null
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
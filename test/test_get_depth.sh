@@ -0,0 +1,150 @@
+#!/usr/bin/env bash
+# Depth-limited get-config and get, see xmldb_get0_depth
+# Only the levels that are returned are copied from the datastore cache. Check that the reply
+# is the same as of a complete copy: nodes at the depth limit are empty, and a non-presence
+# container at the limit is removed only if it has no explicit values.
+# With get, state data from the example state file is filtered with the XPath and merged with
+# the depth-limited config.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/depth.yang
+fstate=$dir/state.xml
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module depth{
+    yang-version 1.1;
+    namespace "urn:example:depth";
+    prefix ex;
+    container table{
+        list parameter{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+            container sub{
+                leaf x{
+                    type uint32;
+                    default 0;
+                }
+            }
+        }
+    }
+    container stats{
+        config false;
+        leaf count{
+            type uint32;
+        }
+    }
+}
+EOF
+
+cat <<EOF > $fstate
+   <stats xmlns="urn:example:depth"><count>7</count></stats>
+EOF
+
+# Get-config of running, or get, with depth
+# Args:
+# 1. depth
+# 2. xpath filter, or empty
+# 3. get for config and state, or empty for get-config
+function getdepth()
+{
+    depth=$1
+    xpath=$2
+    op=$3
+    filter=""
+    if [ -n "$xpath" ]; then
+        filter="<filter type=\"xpath\" select=\"$xpath\" xmlns:ex=\"urn:example:depth\"/>"
+    fi
+    if [ -n "$op" ]; then
+        echo "<rpc $DEFAULTNS><$op cl:depth=\"$depth\" xmlns:cl=\"http://clicon.org/lib\">$filter</$op></rpc>"
+    else
+        echo "<rpc $DEFAULTNS><get-config cl:depth=\"$depth\" xmlns:cl=\"http://clicon.org/lib\"><source><running/></source>$filter</get-config></rpc>"
+    fi
+}
+
+new "test params: -f $cfg -- -sS $fstate"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate"
+    start_backend -s init -f $cfg -- -sS $fstate
+fi
+
+new "wait backend"
+wait_backend
+
+new "add entries, sub of a has explicit value"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:depth\"><parameter><name>a</name><value>1</value><sub><x>5</x></sub></parameter><parameter><name>b</name><value>2</value></parameter></table></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "depth 1"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 1)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"></table></data></rpc-reply>"
+
+new "depth 2"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 2)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter></parameter><parameter></parameter></table></data></rpc-reply>"
+
+new "depth 3, sub of b has only default and is removed"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 3)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter><name>a</name><value>1</value><sub></sub></parameter><parameter><name>b</name><value>2</value></parameter></table></data></rpc-reply>"
+
+new "depth 4"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 4)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter><name>a</name><value>1</value><sub><x>5</x></sub></parameter><parameter><name>b</name><value>2</value></parameter></table></data></rpc-reply>"
+
+new "depth 3, xpath of list entry"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 3 "/ex:table/ex:parameter[ex:name='a']")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter><name>a</name><value>1</value><sub></sub></parameter></table></data></rpc-reply>"
+
+new "depth 2, xpath below depth"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 2 "/ex:table/ex:parameter/ex:value")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter></parameter><parameter></parameter></table></data></rpc-reply>"
+
+new "get depth 3, config and state"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 3 "" get)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter><name>a</name><value>1</value><sub></sub></parameter><parameter><name>b</name><value>2</value></parameter></table><stats xmlns=\"urn:example:depth\"><count>7</count></stats></data></rpc-reply>"
+
+new "get depth 3, xpath of list entry, state is filtered"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 3 "/ex:table/ex:parameter[ex:name='a']" get)" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:depth\"><parameter><name>a</name><value>1</value><sub></sub></parameter></table></data></rpc-reply>"
+
+new "get depth 3, xpath of state"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getdepth 3 "/ex:stats" get)" "" "<rpc-reply $DEFAULTNS><data><stats xmlns=\"urn:example:depth\"><count>7</count></stats></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,120 @@
+#!/usr/bin/env bash
+# Leafref validation with the per-validation leafref target index, see leafref_index_find
+# A large list of leafref targets is validated with one index lookup per leafref.
+# Check that existing targets are found and that a missing target is still detected.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/leafref-index.yang
+fconfig=$dir/large.xml
+
+# Number of list entries
+: ${perfnr:=20000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module leafref-index{
+    yang-version 1.1;
+    namespace "urn:example:lrindex";
+    prefix ex;
+    container targets{
+        list target{
+            key name;
+            leaf name{
+                type string;
+            }
+        }
+    }
+    container refs{
+        list ref{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf target{
+                type leafref{
+                    path "/ex:targets/ex:target/ex:name";
+                }
+            }
+        }
+    }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "generate config with $perfnr targets and leafrefs"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><targets xmlns=\"urn:example:lrindex\">"
+for (( i=0; i<$perfnr; i++ )); do
+    rpc+="<target><name>vrf$i</name></target>"
+done
+rpc+="</targets><refs xmlns=\"urn:example:lrindex\">"
+for (( i=0; i<$perfnr; i++ )); do
+    rpc+="<ref><name>r$i</name><target>vrf$(( $perfnr - 1 - $i ))</target></ref>"
+done
+rpc+="</refs></config></edit-config></rpc>"
+echo -n "$DEFAULTHELLO" > $fconfig
+echo "$(chunked_framing "$rpc")" >> $fconfig
+
+new "netconf write large config"
+expecteof_file "$clixon_netconf -qef $cfg" 0 "$fconfig" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>$"
+
+new "netconf validate large config"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "add leafref to missing target"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><refs xmlns=\"urn:example:lrindex\"><ref><name>x</name><target>vrf$perfnr</target></ref></refs></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf validate fails on missing target"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>vrf$perfnr</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf vrf$perfnr matching path /ex:targets/ex:target/ex:name" ""
+
+new "add missing target"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><targets xmlns=\"urn:example:lrindex\"><target><name>vrf$perfnr</name></target></targets></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit large config"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
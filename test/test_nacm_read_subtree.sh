@@ -0,0 +1,175 @@
+#!/usr/bin/env bash
+# Authentication and authorization and IETF NACM
+# NACM read of subtrees using the read decision map, see nacm_ydecision_build
+# Subtrees that all rules match as their top node are not traversed. Check that rules that
+# match only part of a subtree still apply: a module rule on augmented nodes of another
+# module, and a path rule on a leaf of a list entry.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/nacm-example.yang
+fyang2=$dir/nacm-example2.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+  <CLICON_NACM_DISABLED_ON_EMPTY>true</CLICON_NACM_DISABLED_ON_EMPTY>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module nacm-example{
+  yang-version 1.1;
+  namespace "urn:example:nacm";
+  prefix ex;
+  import ietf-netconf-acm {
+    prefix nacm;
+  }
+  container table{
+    list parameter{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf value{
+        type string;
+      }
+    }
+  }
+  container other{
+    leaf value{
+      type string;
+    }
+  }
+}
+EOF
+
+# Augments list entries with a leaf of another module
+cat <<EOF > $fyang2
+module nacm-example2{
+  yang-version 1.1;
+  namespace "urn:example:nacm2";
+  prefix ex2;
+  import nacm-example {
+    prefix ex;
+  }
+  augment "/ex:table/ex:parameter" {
+    leaf extra{
+      type string;
+    }
+  }
+}
+EOF
+
+RULES=$(cat <<EOF
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+
+     $NGROUPS
+
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>deny-extra</name>
+         <module-name>nacm-example2</module-name>
+         <access-operations>read</access-operations>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>deny-value-b</name>
+         <module-name>*</module-name>
+         <access-operations>read</access-operations>
+         <path xmlns:ex="urn:example:nacm">/ex:table/ex:parameter[ex:name='b']/ex:value</path>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>permit-other</name>
+         <module-name>*</module-name>
+         <access-operations>read</access-operations>
+         <path xmlns:ex="urn:example:nacm">/ex:other</path>
+         <action>permit</action>
+       </rule>
+     </rule-list>
+
+     $NADMIN
+
+   </nacm>
+EOF
+)
+
+CONFIG="<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value><extra xmlns=\"urn:example:nacm2\">x</extra></parameter><parameter><name>b</name><value>2</value><extra xmlns=\"urn:example:nacm2\">y</extra></parameter></table><other xmlns=\"urn:example:nacm\"><value>99</value></other>"
+
+# Get-config of app config in running
+GETCONFIG="<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table|/ex:other\" xmlns:ex=\"urn:example:nacm\"/></get-config></rpc>"
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "set nacm and app config"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$RULES$CONFIG</config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "commit it"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "guest reads all, no rules"
+expecteof_netconf "$clixon_netconf -U guest -qf $cfg" 0 "$DEFAULTHELLO" "$GETCONFIG" "" "<rpc-reply $DEFAULTNS><data>$CONFIG</data></rpc-reply>"
+
+new "wilma read-default permit: augmented leaf and value of b removed"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$GETCONFIG" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value></parameter><parameter><name>b</name></parameter></table><other xmlns=\"urn:example:nacm\"><value>99</value></other></data></rpc-reply>"
+
+new "set read-default deny"
+expecteof_netconf "$clixon_netconf -U andy -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><nacm xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-acm\"><read-default>deny</read-default></nacm></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "commit it"
+expecteof_netconf "$clixon_netconf -U andy -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "wilma read-default deny: only permitted subtree"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$GETCONFIG" "" "<rpc-reply $DEFAULTNS><data><other xmlns=\"urn:example:nacm\"><value>99</value></other></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,200 @@
+#!/usr/bin/env bash
+# Authentication and authorization and IETF NACM
+# NACM write of subtrees using the decision map, see nacm_datanode_write_recurse
+# Rule paths are matched with the ancestors of the changed nodes, and subtrees that all rules
+# match as their top node are not traversed. Check that rules that match only part of a created
+# or deleted subtree still apply: a module rule on augmented nodes of another module, and a
+# path rule on a leaf of a list entry.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/nacm-example.yang
+fyang2=$dir/nacm-example2.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+  <CLICON_NACM_DISABLED_ON_EMPTY>true</CLICON_NACM_DISABLED_ON_EMPTY>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module nacm-example{
+  yang-version 1.1;
+  namespace "urn:example:nacm";
+  prefix ex;
+  import ietf-netconf-acm {
+    prefix nacm;
+  }
+  container table{
+    list parameter{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf value{
+        type string;
+      }
+    }
+  }
+  container other{
+    leaf value{
+      type string;
+    }
+  }
+}
+EOF
+
+# Augments list entries with a leaf of another module
+cat <<EOF > $fyang2
+module nacm-example2{
+  yang-version 1.1;
+  namespace "urn:example:nacm2";
+  prefix ex2;
+  import nacm-example {
+    prefix ex;
+  }
+  augment "/ex:table/ex:parameter" {
+    leaf extra{
+      type string;
+    }
+  }
+}
+EOF
+
+RULES=$(cat <<EOF
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+
+     $NGROUPS
+
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>deny-extra</name>
+         <module-name>nacm-example2</module-name>
+         <access-operations>create update delete</access-operations>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>deny-value-b</name>
+         <module-name>*</module-name>
+         <access-operations>*</access-operations>
+         <path xmlns:ex="urn:example:nacm">/ex:table/ex:parameter[ex:name='b']/ex:value</path>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>permit-table</name>
+         <module-name>*</module-name>
+         <access-operations>*</access-operations>
+         <path xmlns:ex="urn:example:nacm">/ex:table</path>
+         <action>permit</action>
+       </rule>
+     </rule-list>
+
+     $NADMIN
+
+   </nacm>
+EOF
+)
+
+CONFIG="<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value><extra xmlns=\"urn:example:nacm2\">x</extra></parameter><parameter><name>b</name><value>2</value><extra xmlns=\"urn:example:nacm2\">y</extra></parameter></table><other xmlns=\"urn:example:nacm\"><value>99</value></other>"
+
+# Edit-config of app config in candidate
+# Args:
+# 1. config
+function editconfig()
+{
+    echo "<rpc $DEFAULTNS xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><edit-config><target><candidate/></target><config>$1</config></edit-config></rpc>"
+}
+
+OK="<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+DENIED="<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>access-denied</error-tag><error-severity>error</error-severity><error-message>access denied</error-message></rpc-error></rpc-reply>"
+DEFDENIED="<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>access-denied</error-tag><error-severity>error</error-severity><error-message>default deny</error-message></rpc-error></rpc-reply>"
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "set nacm and app config"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "$RULES$CONFIG")" "" "$OK"
+
+new "commit it"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "$OK"
+
+new "wilma creates parameter c"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\"><parameter><name>c</name><value>3</value></parameter></table>")" "" "$OK"
+
+new "wilma creates parameter d with augmented leaf: denied"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\"><parameter><name>d</name><value>4</value><extra xmlns=\"urn:example:nacm2\">z</extra></parameter></table>")" "" "$DENIED"
+
+new "wilma updates value of a"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>11</value></parameter></table>")" "" "$OK"
+
+new "wilma updates value of b: denied"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\"><parameter><name>b</name><value>12</value></parameter></table>")" "" "$DENIED"
+
+new "wilma deletes parameter a with augmented leaf: denied"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\"><parameter nc:operation=\"delete\"><name>a</name></parameter></table>")" "" "$DENIED"
+
+new "wilma deletes parameter c"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\"><parameter nc:operation=\"delete\"><name>c</name></parameter></table>")" "" "$OK"
+
+new "wilma deletes table: denied"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\" nc:operation=\"delete\"/>")" "" "$DENIED"
+
+new "wilma updates other: default deny"
+expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<other xmlns=\"urn:example:nacm\"><value>98</value></other>")" "" "$DEFDENIED"
+
+new "candidate has only permitted changes"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:table|/ex:other\" xmlns:ex=\"urn:example:nacm\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>11</value><extra xmlns=\"urn:example:nacm2\">x</extra></parameter><parameter><name>b</name><value>2</value><extra xmlns=\"urn:example:nacm2\">y</extra></parameter></table><other xmlns=\"urn:example:nacm\"><value>99</value></other></data></rpc-reply>"
+
+new "admin deletes table"
+expecteof_netconf "$clixon_netconf -U andy -qf $cfg" 0 "$DEFAULTHELLO" "$(editconfig "<table xmlns=\"urn:example:nacm\" nc:operation=\"delete\"/>")" "" "$OK"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,161 @@
+#!/usr/bin/env bash
+# Notification fan-out to several subscribers of a stream with the same filter
+# Subscriptions with the same XPath filter share one parsed filter, and an event is
+# serialized once and shared by all subscribers.
+# Several subscribers with a matching filter, with a non-matching filter, and without
+# filter are started. One subscriber with the matching filter leaves early.
+# Check that all remaining subscribers get the same events, also after the early one has
+# left, and that subscribers with the non-matching filter get no events.
+# See RFC5277 NETCONF Event Notifications and test_netconf_notifications.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of subscribers with the same filter
+: ${nsub:=5}
+
+# Time subscribers are connected [s], the example stream has an event every 5s
+sublong=17
+subshort=7
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>60</CLICON_STREAM_RETENTION>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+    namespace "urn:example:clixon";
+    prefix ex;
+    notification event {
+        leaf event-class {
+            type string;
+        }
+        container reportingEntity {
+            leaf card {
+                type string;
+            }
+        }
+        leaf severity {
+            type string;
+        }
+    }
+}
+EOF
+
+# Start subscriber in background
+# @param[in] $1  Name of output file
+# @param[in] $2  Time connected [s]
+# @param[in] $3  Filter, or empty
+function subscribe(){
+    sub="<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream>$3</create-subscription></rpc>"
+    (echo "$DEFAULTHELLO$(chunked_framing "$sub")"; sleep $2) | $clixon_netconf -qef $cfg > $dir/$1 &
+}
+
+# Number of notifications received by subscriber
+# @param[in] $1  Name of output file
+function notifications(){
+    grep -o "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>" $dir/$1 | wc -l
+}
+
+# Event time of second notification received by subscriber
+# @param[in] $1  Name of output file
+function eventtime2(){
+    grep -o "<eventTime>[^<]*</eventTime>" $dir/$1 | sed -n 2p
+}
+
+match="<filter type=\"xpath\" select=\"event[event-class='fault']\"/>"
+nomatch="<filter type=\"xpath\" select=\"event[event-class='warning']\"/>"
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -n"
+    start_backend -s init -f $cfg -- -n # create example notification stream
+fi
+
+new "wait backend"
+wait_backend
+
+new "start $nsub subscribers with same filter, one leaves after $subshort s"
+subscribe short $subshort "$match"
+for (( i=0; i<$nsub; i++ )); do
+    subscribe match.$i $sublong "$match"
+done
+
+new "start 2 subscribers with non-matching filter and 1 without filter"
+subscribe nomatch.0 $sublong "$nomatch"
+subscribe nomatch.1 $sublong "$nomatch"
+subscribe all $sublong ""
+
+new "wait for subscribers"
+wait
+
+new "early subscriber got events"
+n=$(notifications short)
+if [ $n -lt 1 ]; then
+    err "at least 1 notification" "$(cat $dir/short)"
+fi
+
+new "subscriber without filter got events"
+n=$(notifications all)
+if [ $n -lt 3 ]; then
+    err "at least 3 notifications" "$(cat $dir/all)"
+fi
+t=$(eventtime2 all)
+
+for (( i=0; i<$nsub; i++ )); do
+    new "subscriber $i with same filter got events after early subscriber left"
+    expectpart "$(cat $dir/match.$i)" 0 "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20[0-9-]*T[0-9:.]*Z</eventTime><event xmlns=\"urn:example:clixon\"><event-class>fault</event-class><reportingEntity><card>Ethernet0</card></reportingEntity><severity>major</severity></event></notification>"
+    n=$(notifications match.$i)
+    if [ $n -lt 3 ]; then
+        err "at least 3 notifications" "$(cat $dir/match.$i)"
+    fi
+
+    new "subscriber $i with same filter got same event"
+    if [ "$(eventtime2 match.$i)" != "$t" ]; then
+        err "$t" "$(eventtime2 match.$i)"
+    fi
+done
+
+for i in 0 1; do
+    new "subscriber $i with non-matching filter got no events"
+    expectpart "$(cat $dir/nomatch.$i)" 0 "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" --not-- "<notification"
+done
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
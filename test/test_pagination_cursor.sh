@@ -0,0 +1,145 @@
+#!/usr/bin/env bash
+# List pagination with sort-by, direction, where and cursor
+# A config list is paged from an index of the datastore cache. Check sort-by a non-key leaf,
+# direction backwards, where filter, and scrolling with the cursor of the previous page,
+# also after the list is changed and the entry of the cursor is deleted.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/cursor.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module cursor{
+    yang-version 1.1;
+    namespace "urn:example:cursor";
+    prefix ex;
+    container table{
+        list parameter{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf ace{
+                type uint32;
+            }
+        }
+    }
+}
+EOF
+
+# Note the sort-by pattern of ietf-list-pagination only allows hex digits in node names,
+# therefore the leaf to sort on is named ace
+
+# Get page of /ex:table/ex:parameter
+# Args:
+# 1. list-pagination parameters
+# 2. cursor attribute of list-pagination, or empty
+function getpage()
+{
+    params=$1
+    cursor=$2
+    attr=""
+    if [ -n "$cursor" ]; then
+        attr=" cl:cursor=\"$cursor\" xmlns:cl=\"http://clicon.org/lib\""
+    fi
+    echo "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter\" xmlns:ex=\"urn:example:cursor\"/><list-pagination xmlns=\"urn:ietf:params:xml:ns:yang:ietf-list-pagination-nc\"$attr>$params</list-pagination></get-config></rpc>"
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "add entries"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:cursor\"><parameter><name>a</name><ace>30</ace></parameter><parameter><name>b</name><ace>10</ace></parameter><parameter><name>c</name><ace>50</ace></parameter><parameter><name>d</name><ace>9</ace></parameter><parameter><name>e</name><ace>40</ace></parameter></table></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "limit 2, list order"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<limit>2</limit>")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"1,b\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>a</name><ace>30</ace></parameter><parameter><name>b</name><ace>10</ace></parameter></table></data></rpc-reply>"
+
+new "sort-by ace is numeric, limit 2"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<sort-by>ace</sort-by><limit>2</limit>")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"1,=10,b\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>d</name><ace>9</ace></parameter><parameter><name>b</name><ace>10</ace></parameter></table></data></rpc-reply>"
+
+new "sort-by ace, next page from cursor"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<sort-by>ace</sort-by><limit>2</limit>" "1,=10,b")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"3,=40,e\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>a</name><ace>30</ace></parameter><parameter><name>e</name><ace>40</ace></parameter></table></data></rpc-reply>"
+
+new "sort-by ace, last page has no cursor"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<sort-by>ace</sort-by><limit>2</limit>" "3,=40,e")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:cursor\"><parameter><name>c</name><ace>50</ace></parameter></table></data></rpc-reply>"
+
+new "sort-by ace, direction backwards, offset 1"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<sort-by>ace</sort-by><direction>backwards</direction><offset>1</offset><limit>2</limit>")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"2,=30,a\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>e</name><ace>40</ace></parameter><parameter><name>a</name><ace>30</ace></parameter></table></data></rpc-reply>"
+
+new "where ace > 20"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<where>ace &gt; 20</where>")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:cursor\"><parameter><name>a</name><ace>30</ace></parameter><parameter><name>c</name><ace>50</ace></parameter><parameter><name>e</name><ace>40</ace></parameter></table></data></rpc-reply>"
+
+new "where ace > 20, offset 1, limit 1"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<where>ace &gt; 20</where><offset>1</offset><limit>1</limit>")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"2,c\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>c</name><ace>50</ace></parameter></table></data></rpc-reply>"
+
+new "where with prefix bound on where element"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<where xmlns:c=\"urn:example:cursor\">c:ace &gt; 40</where>")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:cursor\"><parameter><name>c</name><ace>50</ace></parameter></table></data></rpc-reply>"
+
+new "sort-by unknown leaf, expect fail"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<sort-by>bad</sort-by>")" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>sort-by is not a descendant leaf of the list</error-message></rpc-error></rpc-reply>"
+
+new "delete entry a"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:cursor\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><parameter nc:operation=\"delete\"><name>a</name></parameter></table></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "cursor after change, entry found by key"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<limit>2</limit>" "1,b")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"2,d\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>c</name><ace>50</ace></parameter><parameter><name>d</name><ace>9</ace></parameter></table></data></rpc-reply>"
+
+new "cursor of deleted entry, next page starts at following entry"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<limit>2</limit>" "0,a")" "" "<rpc-reply $DEFAULTNS><data cl:cursor=\"1,c\" xmlns:cl=\"http://clicon.org/lib\"><table xmlns=\"urn:example:cursor\"><parameter><name>b</name><ace>10</ace></parameter><parameter><name>c</name><ace>50</ace></parameter></table></data></rpc-reply>"
+
+new "sort-by ace, cursor of deleted entry, next page starts at following entry"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<sort-by>ace</sort-by><limit>2</limit>" "2,=30,a")" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:cursor\"><parameter><name>e</name><ace>40</ace></parameter><parameter><name>c</name><ace>50</ace></parameter></table></data></rpc-reply>"
+
+new "cursor with too many keys, expect fail"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$(getpage "<limit>2</limit>" "0,a,b")" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>list-pagination cursor is not valid</error-message></rpc-error></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,117 @@
+#!/usr/bin/env bash
+# Differential test of the fast path DFA regexp engine, see regex_fast_compile
+# Patterns from yang-models (as in test_pattern.sh) and matching and non-matching strings
+# are matched with the fast path and with the posix (and libxml2 if configured) engines.
+# The fast path must give the same result as posix. If posix and libxml2 agree, the fast
+# path must also give the same result as libxml2.
+# Patterns without fast path (clixon_util_regexp -f prints 2) are only counted.
+# This is an unit test, not a clixon system test
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+: ${clixon_util_regexp:=clixon_util_regexp}
+
+# Number of patterns with and without fast path
+nfast=0
+nslow=0
+
+# Match strings against a pattern with all engines and compare
+# Arguments:
+# 1:  XSD regexp
+# 2-: content strings
+function difftest(){
+    re="$1"
+    shift
+    fast=$($clixon_util_regexp -f -r "$re" -c "")
+    if [ "$fast" = 2 ]; then
+        nslow=$(( $nslow + 1 ))
+        return
+    fi
+    nfast=$(( $nfast + 1 ))
+    for str in "$@"; do
+        trunc=$(echo "$str"|cut -c1-15)
+        new "fast vs posix: $re string: $trunc"
+        posix=$($clixon_util_regexp -p -r "$re" -c "$str")
+        fast=$($clixon_util_regexp -f -r "$re" -c "$str")
+        if [ "$fast" != "$posix" ]; then
+            err "$posix" "$fast"
+        fi
+        if [ "${WITH_LIBXML2}" = yes ] ; then
+            libxml2=$($clixon_util_regexp -x -r "$re" -c "$str")
+            if [ "$libxml2" = "$posix" ]; then
+                new "fast vs libxml2: $re string: $trunc"
+                if [ "$fast" != "$libxml2" ]; then
+                    err "$libxml2" "$fast"
+                fi
+            fi
+        fi
+    done
+}
+
+new "RFC7950 Sec 9.4.7 examples"
+difftest '[0-9a-fA-F]*' 'AB' '9A00' '00ABAB' 'xx00' ''
+difftest '[a-zA-Z_][a-zA-Z0-9\-_.]*' 'ab.c' '_9-x' '9ab' '-x' ''
+
+new "Alternation and nested quantifiers"
+difftest '((A|B{0,1})A)' 'A' 'AA' 'BA' 'BBA' ''
+difftest '(ab|cd)+' 'ab' 'abcd' 'cdab' 'abc' ''
+difftest 'a{2,3}' 'a' 'aa' 'aaa' 'aaaa'
+difftest 'x?y*z+' 'z' 'xz' 'xyyz' 'xx' 'y'
+
+new "RFC8341 NACM"
+difftest '[^\*].*' 'admin' 'x*' '*' ''
+difftest '\*' '*' 'x' '**'
+
+new "ietf-inet-types ipv4-address-no-zone"
+difftest '(([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])\.){3}([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])' '0.0.0.0' '10.1.2.3' '255.255.255.255' '256.1.1.1' '1.2.3' '01.2.3.4' '1.2.3.4.5'
+
+new "ietf-inet-types ipv4-address with zone"
+difftest '(([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])\.){3}([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])(%[\p{N}\p{L}]+)?' '10.1.2.3' '10.1.2.3%eth0' '10.1.2.3%' '10.1.2.300'
+
+new "ietf-inet-types ipv4-prefix"
+difftest '(([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])\.){3}([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])/(([0-9])|([1-2][0-9])|(3[0-2]))' '10.0.0.0/8' '0.0.0.0/0' '1.2.3.4/32' '1.2.3.4/33' '1.2.3.4'
+
+new "ietf-inet-types ipv6-address"
+difftest '((:|[0-9a-fA-F]{0,4}):)([0-9a-fA-F]{0,4}:){0,5}((([0-9a-fA-F]{0,4}:)?(:|[0-9a-fA-F]{0,4}))|(((25[0-5]|2[0-4][0-9]|[01]?[0-9]?[0-9])\.){3}(25[0-5]|2[0-4][0-9]|[01]?[0-9]?[0-9])))(%[\p{N}\p{L}]+)?' '::' '::1' '2001:db8::1' 'fe80::1%eth0' '::ffff:10.1.2.3' '2001:db8:0:0:0:0:0:1' '2001:db8::g' '1:2:3:4:5:6:7:8:9'
+difftest '(([^:]+:){6}(([^:]+:[^:]+)|(.*\..*)))|((([^:]+:)*[^:]+)?::(([^:]+:)*[^:]+)?)(%.+)?' '::' '2001:db8::1' '1:2:3:4:5:6:7:8' '1:2:3:4:5:6:1.2.3.4' '1:2'
+
+new "ietf-inet-types ipv6-prefix"
+difftest '((:|[0-9a-fA-F]{0,4}):)([0-9a-fA-F]{0,4}:){0,5}((([0-9a-fA-F]{0,4}:)?(:|[0-9a-fA-F]{0,4}))|(((25[0-5]|2[0-4][0-9]|[01]?[0-9]?[0-9])\.){3}(25[0-5]|2[0-4][0-9]|[01]?[0-9]?[0-9])))(/(([0-9])|([0-9]{2})|(1[0-1][0-9])|(12[0-8])))' '2001:db8::/32' '::/0' '::1/128' '::1/129' '2001:db8::'
+
+new "ietf-inet-types domain-name"
+difftest '((([a-zA-Z0-9_]([a-zA-Z0-9\-_]){0,61})?[a-zA-Z0-9]\.)*([a-zA-Z0-9_]([a-zA-Z0-9\-_]){0,61})?[a-zA-Z0-9]\.?)|\.' 'example.com' 'a.b.c.' '.' 'x' '-x.com' 'a..b'
+
+new "ietf-yang-types"
+difftest '[0-9a-fA-F]{2}(:[0-9a-fA-F]{2}){5}' '00:11:22:aa:BB:cc' '00:11:22:aa:BB' '00-11-22-aa-bb-cc' '00:11:22:aa:BB:cg'
+difftest '([0-9a-fA-F]{2}(:[0-9a-fA-F]{2})*)?' '' '0a' '0a:1b:2c' '0a:' 'a'
+difftest '[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}' '0cfa3a08-2f2e-4a2b-9a6e-2a1e9b1c4d5e' '0cfa3a08-2f2e-4a2b-9a6e-2a1e9b1c4d5' '0cfa3a082f2e4a2b9a6e2a1e9b1c4d5e'
+difftest '\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(\.\d+)?(Z|[\+\-]\d{2}:\d{2})' '2023-03-01T12:00:00Z' '2023-03-01T12:00:00.123+01:00' '2023-03-01 12:00:00Z' '2023-03-01T12:00:00'
+difftest '(([0-1](\.[1-3]?[0-9]))|(2\.(0|([1-9]\d*))))(\.(0|([1-9]\d*)))*' '1.3.6.1' '2.0' '2.5.4.3' '3.1' '1.40' '1.3.06'
+difftest '[a-zA-Z_][a-zA-Z0-9\-_.]*' 'ietf-interfaces' '_x' '1abc'
+difftest '\d{4}-\d{2}-\d{2}' '2023-03-01' '23-03-01' '2023-3-1'
+
+new "ieee802 and routing types"
+difftest '[0-9a-fA-F]{2}(-[0-9a-fA-F]{2}){5}' '00-11-22-AA-bb-cc' '00:11:22:aa:bb:cc'
+difftest '([1-9][0-9]{0,3}(-[1-9][0-9]{0,3})?(,[1-9][0-9]{0,3}(-[1-9][0-9]{0,3})?)*)' '1' '1-10' '1,3-5,4094' '0' '1-' ',1'
+difftest '0[xX][0-9a-fA-F]{4}' '0x88A8' '0X8100' '0x810' '8100'
+difftest '0[xX]((1(\.[0-9a-fA-F]{6})?)|(0\.0{6}))[pP](\+)?(12[0-7]|1[01][0-9]|0?[0-9]?[0-9])' '0x1p10' '0x1.000000p+127' '0x0.000000p0' '0x2p1'
+difftest '(0:(6553[0-5]|655[0-2][0-9]|65[0-4][0-9]{2}|6[0-4][0-9]{3}|[1-5][0-9]{4}|[1-9][0-9]{0,3}|0):(429496729[0-5]|42949672[0-8][0-9]|4294967[01][0-9]{2}|429496[0-6][0-9]{3}|42949[0-5][0-9]{4}|4294[0-8][0-9]{5}|429[0-3][0-9]{6}|42[0-8][0-9]{7}|4[01][0-9]{8}|[1-3][0-9]{9}|[1-9][0-9]{0,8}|0))|(6(:[a-fA-F0-9]{2}){6})|(([3-9a-fA-F]|[1-9a-fA-F][0-9a-fA-F]{1,3}):[0-9a-fA-F]{1,12})' '0:100:1' '0:65536:1' '6:00:11:22:33:44:55' '3:abc' '2:abc'
+
+new "Country code and identifiers"
+difftest '[A-Z]{2}' 'SE' 'se' 'SWE' ''
+difftest '[a-zA-Z][a-zA-Z0-9_]*' 'ieName1' '1ie' 'ie-name'
+
+new "Unicode categories and non-ASCII strings"
+difftest '\p{L}+' 'abc' 'åäö' '123' ''
+difftest '[\w\-]+' 'a-b_c' 'a b' 'é'
+
+new "Patterns with fast path: $nfast, without: $nslow"
+if [ $nfast -eq 0 ]; then
+    err "at least one pattern with fast path" "$nfast"
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -77,6 +77,9 @@ EOF
     new "hello session-id 2"
     expecteof "$clixon_util_socket -a $family -s $sock -D $DBG" 0 "<hello $DEFAULTONLY/>" "<hello $DEFAULTONLY><session-id>4</session-id></hello>"
 
+    new "pipelined requests replied in order"
+    expectpart "$(echo "<rpc $DEFAULTNS><ping $LIBNS/></rpc>" | $clixon_util_socket -a $family -s $sock -D $DBG -n 3)" 0 "1: <rpc-reply $DEFAULTNS><ok/></rpc-reply>" "2: <rpc-reply $DEFAULTNS><ok/></rpc-reply>" "3: <rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
     if [ $BE -ne 0 ]; then
         new "Kill backend"
         # Check if premature kill
@@ -0,0 +1,119 @@
+#!/usr/bin/env bash
+# Chunked serialization of get replies to the client socket, see CLICON_SOCK_CHUNK
+# The chunk size is much smaller than the largest reply. Check that replies serialized in
+# many chunks, in one chunk and empty replies are complete, also when pipelined.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Raw unit tester of backend unix socket
+: ${clixon_util_socket:=clixon_util_socket}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/chunk.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+# Number of list entries, full reply is many chunks
+: ${perfnr:=1000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>$sock</CLICON_SOCK>
+  <CLICON_SOCK_CHUNK>1024</CLICON_SOCK_CHUNK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module chunk{
+    yang-version 1.1;
+    namespace "urn:example:chunk";
+    prefix ex;
+    container table{
+        list parameter{
+            key name;
+            leaf name{
+                type uint32;
+            }
+            leaf value{
+                type string;
+            }
+        }
+    }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get-config empty reply"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "generate config with $perfnr entries"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:chunk\">"
+for (( i=0; i<$perfnr; i++ )); do
+    rpc+="<parameter><name>$i</name><value>value$i&amp;</value></parameter>"
+done
+rpc+="</table></config></edit-config></rpc>"
+
+new "add entries"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "$rpc" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "netconf get-config one chunk"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='7']\" xmlns:ex=\"urn:example:chunk\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:chunk\"><parameter><name>7</name><value>value7&amp;</value></parameter></table></data></rpc-reply>"
+
+last=$((perfnr-1))
+
+new "netconf get-config many chunks"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:chunk\"><parameter><name>0</name><value>value0&amp;</value></parameter><parameter><name>1</name><value>value1&amp;</value></parameter>" "<parameter><name>$last</name><value>value$last&amp;</value></parameter></table></data></rpc-reply>"
+
+new "netconf get many chunks"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"config\"/></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:chunk\"><parameter><name>0</name><value>value0&amp;</value></parameter>" "<parameter><name>$last</name><value>value$last&amp;</value></parameter></table></data></rpc-reply>"
+
+new "pipelined get-config replied in order"
+expectpart "$(echo "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG -n 4)" 0 "1: <rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:chunk\">" "<parameter><name>$last</name><value>value$last&amp;</value></parameter></table></data></rpc-reply>" "4: <rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:chunk\">"
+
+new "cli show config"
+expectpart "$($clixon_cli -1 -f $cfg show config)" 0 "<name>0</name>" "<name>$last</name>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
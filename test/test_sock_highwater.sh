@@ -0,0 +1,129 @@
+#!/usr/bin/env bash
+# Back-pressure of backend output queues, see CLICON_SOCK_HIGHWATER
+# A slow client sends many pipelined get-config requests with large replies, but does
+# not read them for a while. The backend queues the replies up to the high-water mark and
+# then pauses reading requests from the client. Check that other clients are served
+# meanwhile, and that the slow client gets all replies when it starts reading
+# and the backend resumes.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Raw unit tester of backend unix socket
+: ${clixon_util_socket:=clixon_util_socket}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/highwater.yang
+fconfig=$dir/config.xml
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+# Number of list entries, each reply is larger than the high-water mark
+: ${perfnr:=500}
+
+# Number of pipelined requests of the slow client
+: ${perfreq:=100}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>$sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_SOCK_HIGHWATER>4096</CLICON_SOCK_HIGHWATER>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module highwater{
+    yang-version 1.1;
+    namespace "urn:example:highwater";
+    prefix ex;
+    container table{
+        list parameter{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type string;
+            }
+        }
+    }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "generate config with $perfnr entries"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:highwater\">"
+for (( i=0; i<$perfnr; i++ )); do
+    rpc+="<parameter><name>p$i</name><value>value of parameter $i</value></parameter>"
+done
+rpc+="</table></config></edit-config></rpc>"
+echo -n "$DEFAULTHELLO" > $fconfig
+echo "$(chunked_framing "$rpc")" >> $fconfig
+
+new "netconf write config"
+expecteof_file "$clixon_netconf -qef $cfg" 0 "$fconfig" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>$"
+
+new "netconf commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "start slow client: $perfreq requests, read after 3s"
+echo "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG -n $perfreq -w 3 > $dir/slow.txt &
+slow=$!
+
+sleep 1
+
+new "other client is served while slow client is paused"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='p7']\" xmlns:ex=\"urn:example:highwater\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:highwater\"><parameter><name>p7</name><value>value of parameter 7</value></parameter></table></data></rpc-reply>"
+
+new "wait for slow client"
+wait $slow
+if [ $? -ne 0 ]; then
+    err "slow client exit 0" "$(cat $dir/slow.txt)"
+fi
+
+new "slow client got all replies"
+n=$(grep -c "<parameter><name>p$(( $perfnr - 1 ))</name>" $dir/slow.txt)
+if [ $n -ne $perfreq ]; then
+    err "$perfreq complete replies" "$n"
+fi
+
+new "slow client first and last reply"
+expectpart "$(cat $dir/slow.txt)" 0 "^1: <rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:highwater\">" "$perfreq: <rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:highwater\">"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
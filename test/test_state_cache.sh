@@ -0,0 +1,148 @@
+#!/usr/bin/env bash
+# State data cache with max age per plugin, see ca_statedata_maxage
+# The example state callback reads state from file, the file is changed between requests.
+# Check that cached state is returned while fresh, that new state is returned after max age,
+# and the hit and miss counters of the stats RPC.
+# The same prefixed XPath with the prefix bound to another namespace is cached separately.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fstate=$dir/state.xml
+fyang=$dir/statecache.yang
+fyang2=$dir/statecache2.yang
+
+# Max age of cached state [ms]
+maxage=3000
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_YANG_LIBRARY>false</CLICON_YANG_LIBRARY>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module statecache{
+    yang-version 1.1;
+    namespace "urn:example:example";
+    prefix ex;
+    import statecache2 {
+        prefix o;
+    }
+    container sensors{
+        config false;
+        list sensor{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+        }
+    }
+}
+EOF
+
+cat <<EOF > $fyang2
+module statecache2{
+    yang-version 1.1;
+    namespace "urn:example:other";
+    prefix o;
+    container sensors{
+        config false;
+        list sensor{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+        }
+    }
+}
+EOF
+
+cat <<EOF > $fstate
+   <sensors xmlns="urn:example:example">
+      <sensor><name>a</name><value>42</value></sensor>
+   </sensors>
+   <sensors xmlns="urn:example:other">
+      <sensor><name>b</name><value>7</value></sensor>
+   </sensors>
+EOF
+
+new "test params: -f $cfg -- -sS $fstate -m $maxage"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate -m $maxage"
+    start_backend -s init -f $cfg -- -sS $fstate -m $maxage
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get state, callback called"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+# Change state
+cat <<EOF > $fstate
+   <sensors xmlns="urn:example:example">
+      <sensor><name>a</name><value>17</value></sensor>
+   </sensors>
+   <sensors xmlns="urn:example:other">
+      <sensor><name>b</name><value>7</value></sensor>
+   </sensors>
+EOF
+
+new "netconf get state, from cache"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf stats state-cache"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "" "<state-cache $LIBNS><name>example_backend</name><entries>1</entries><hits>1</hits><misses>1</misses><refreshes>0</refreshes></state-cache>"
+
+new "netconf get state, same XPath with prefix of other namespace, callback called"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:other\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:other\"><sensor><name>b</name><value>7</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf stats state-cache, one entry per namespace context"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "" "<state-cache $LIBNS><name>example_backend</name><entries>2</entries><hits>1</hits><misses>2</misses><refreshes>0</refreshes></state-cache>"
+
+sleep $((maxage/1000+1))
+
+new "netconf get state after max age, callback called"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>17</value></sensor></sensors></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
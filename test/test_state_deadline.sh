@@ -0,0 +1,100 @@
+#!/usr/bin/env bash
+# State callback in worker process with deadline, see ca_statedata_deadline
+# The example state callback reads state from file with a delay longer than its deadline.
+# Check that a get is replied without the state when there is no previous state, and with
+# the previous state when the late result has arrived.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fstate=$dir/state.xml
+fyang=$dir/deadline.yang
+
+# Deadline and delay of state callback [ms]
+deadline=300
+delay=1000
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_YANG_LIBRARY>false</CLICON_YANG_LIBRARY>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module deadline{
+    yang-version 1.1;
+    namespace "urn:example:example";
+    prefix ex;
+    container sensors{
+        config false;
+        list sensor{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+        }
+    }
+}
+EOF
+
+cat <<EOF > $fstate
+   <sensors xmlns="urn:example:example">
+      <sensor><name>a</name><value>42</value></sensor>
+   </sensors>
+EOF
+
+new "test params: -f $cfg -- -sS $fstate -d $deadline -w $delay"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate -d $deadline -w $delay"
+    start_backend -s init -f $cfg -- -sS $fstate -d $deadline -w $delay
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get state missed deadline, no previous state"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+# Late result arrives after delay
+sleep 2
+
+new "netconf get state missed deadline, previous state"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
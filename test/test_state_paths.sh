@@ -0,0 +1,117 @@
+#!/usr/bin/env bash
+# Routing of state requests to plugins by registered state paths,
+# see clixon_plugin_statedata_path_register
+# The example state callback is registered for /ex:sensors only. A state cache is used to
+# count calls of the callback (misses) with the stats RPC.
+# Check that the callback is not called for a request of another subtree, and that it is
+# called for requests of, above and below the registered path.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fstate=$dir/state.xml
+fyang=$dir/statepaths.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_YANG_LIBRARY>false</CLICON_YANG_LIBRARY>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module statepaths{
+    yang-version 1.1;
+    namespace "urn:example:example";
+    prefix ex;
+    container sensors{
+        config false;
+        list sensor{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf value{
+                type uint32;
+            }
+        }
+    }
+    container other{
+        config false;
+        leaf x{
+            type string;
+        }
+    }
+}
+EOF
+
+cat <<EOF > $fstate
+   <sensors xmlns="urn:example:example">
+      <sensor><name>a</name><value>42</value></sensor>
+   </sensors>
+EOF
+
+# State cache counts calls as misses, max age 0.001s so that each request is a miss
+ARGS="-sS $fstate -m 1 -p /ex:sensors"
+
+new "test params: -f $cfg -- $ARGS"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- $ARGS"
+    start_backend -s init -f $cfg -- $ARGS
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get other subtree"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:other\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "netconf stats: callback not called"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><stats $LIBNS/></rpc>")
+expectpart "$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg)" 0 "<rpc-reply $DEFAULTNS>" --not-- "<state-cache"
+
+new "netconf get registered path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf get below registered path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/ex:sensors/ex:sensor[ex:name='a']/ex:value\" xmlns:ex=\"urn:example:example\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf get all"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"/></rpc>" "" "<rpc-reply $DEFAULTNS><data><sensors xmlns=\"urn:example:example\"><sensor><name>a</name><value>42</value></sensor></sensors></data></rpc-reply>"
+
+new "netconf stats: callback called three times"
+expectpart "$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg)" 0 "<state-cache $LIBNS><name>example_backend</name><entries>3</entries><hits>0</hits><misses>3</misses>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,227 @@
+#!/usr/bin/env bash
+# Asynchronous publishing of notification streams, see CLICON_STREAM_PUB
+# A local HTTP server stands in for the pub/sub server, eg nginx/nchan. It logs the posts of
+# the EXAMPLE stream, may fail the first posts, and may delay its first reply so that
+# events are queued meanwhile.
+# 1. One event per post, also with events queued during a slow post
+# 2. Batching with CLICON_STREAM_PUB_BATCH: queued events are sent in one post
+# 3. Failed posts are retried with exponential backoff, and no post is made while a retry
+#    is pending, even if new events arrive
+# Requires configure --enable-publish and python3
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+if [ "${ENABLE_PUBLISH}" != "yes" ]; then
+    echo "Skipping test, stream publish not enabled."
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+if ! which python3 > /dev/null; then
+    echo "Skipping test, python3 not found."
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+fserver=$dir/server.py
+fport=$dir/port
+flog=$dir/posts.log
+
+cat <<EOF > $fyang
+module example {
+    namespace "urn:example:clixon";
+    prefix ex;
+    notification event {
+        leaf event-class {
+            type string;
+        }
+        container reportingEntity {
+            leaf card {
+                type string;
+            }
+        }
+        leaf severity {
+            type string;
+        }
+    }
+}
+EOF
+
+# HTTP stand-in for the pub/sub server
+# Arguments: <log file> <port file> <number of failed posts> <delay of first reply [s]>
+# Each post is logged on one line: <nr> <time> <status> <body>
+cat <<'EOF' > $fserver
+import sys, time
+from http.server import HTTPServer, BaseHTTPRequestHandler
+flog, fport, nfail, delay = sys.argv[1], sys.argv[2], int(sys.argv[3]), float(sys.argv[4])
+nr = 0
+class Handler(BaseHTTPRequestHandler):
+    def do_POST(self):
+        global nr
+        nr += 1
+        body = self.rfile.read(int(self.headers['Content-Length'])).decode()
+        t = time.time()
+        if nr == 1:
+            time.sleep(delay)
+        status = 500 if nr <= nfail else 200
+        with open(flog, 'a') as f:
+            f.write("%d %.3f %d %s\n" % (nr, t, status, body.replace('\n', '')))
+        self.send_response(status)
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+    def log_message(self, *args):
+        pass
+server = HTTPServer(('127.0.0.1', 0), Handler)
+with open(fport, 'w') as f:
+    f.write(str(server.server_port))
+server.serve_forever()
+EOF
+
+# Start HTTP stand-in and backend publishing the EXAMPLE stream to it
+# @param[in] $1  Number of failed posts
+# @param[in] $2  Delay of first reply [s]
+# @param[in] $3  CLICON_STREAM_PUB_BATCH
+function start_publish(){
+    rm -f $flog $fport
+    python3 $fserver $flog $fport $1 $2 &
+    server=$!
+    for (( i=0; i<50; i++ )); do
+        if [ -s $fport ]; then
+            break
+        fi
+        sleep 0.1
+    done
+    if [ ! -s $fport ]; then
+        err "HTTP stand-in port" ""
+    fi
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_PUB>http://127.0.0.1:$(cat $fport)/pub</CLICON_STREAM_PUB>
+  <CLICON_STREAM_PUB_BATCH>$3</CLICON_STREAM_PUB_BATCH>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+    new "test params: -f $cfg -- -n"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s init -f $cfg -- -n"
+        start_backend -s init -f $cfg -- -n # create example notification stream
+    fi
+    new "wait backend"
+    wait_backend
+}
+
+# Stop backend and HTTP stand-in
+function stop_publish(){
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+    kill $server 2> /dev/null
+    wait $server 2> /dev/null
+}
+
+# Number of notifications in body of post
+# @param[in] $1  Number of post
+function post_events(){
+    grep "^$1 " $flog | grep -o "<notification " | wc -l
+}
+
+# Time of post
+# @param[in] $1  Number of post
+function post_time(){
+    grep "^$1 " $flog | cut -d' ' -f2
+}
+
+notification="<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20[0-9-]*T[0-9:.]*Z</eventTime><event xmlns=\"urn:example:clixon\"><event-class>fault</event-class><reportingEntity><card>Ethernet0</card></reportingEntity><severity>major</severity></event></notification>"
+
+# The example stream has an event every 5s. The first reply is delayed so that two events
+# are queued meanwhile
+new "1. One event per post"
+start_publish 0 12 1
+
+sleep 20
+
+new "posts of EXAMPLE stream"
+expectpart "$(cat $flog)" 0 "^1 [0-9.]* 200 $notification$" "^2 [0-9.]* 200 $notification$" "^3 [0-9.]* 200 $notification$"
+
+for p in 1 2 3; do
+    new "post $p has one event"
+    n=$(post_events $p)
+    if [ $n -ne 1 ]; then
+        err 1 "$n"
+    fi
+done
+
+stop_publish
+
+new "2. Batching of queued events"
+start_publish 0 12 10
+
+sleep 20
+
+new "posts of EXAMPLE stream"
+expectpart "$(cat $flog)" 0 "^1 [0-9.]* 200 $notification$" "^2 [0-9.]* 200 $notification$notification"
+
+new "post 2 has queued events"
+n=$(post_events 2)
+if [ $n -lt 2 ]; then
+    err "at least 2" "$n"
+fi
+
+stop_publish
+
+# Three failed posts are retried after 1, 2 and 4s. An event arriving during the 4s backoff
+# must not trigger a post before the retry timer
+new "3. Retry with backoff"
+start_publish 3 0 1
+
+sleep 16
+
+new "failed posts and retry"
+expectpart "$(cat $flog)" 0 "^1 [0-9.]* 500 $notification$" "^2 [0-9.]* 500 $notification$" "^3 [0-9.]* 500 $notification$" "^4 [0-9.]* 200 $notification$"
+
+new "retry of failed post is the same event"
+if [ "$(grep '^1 ' $flog | cut -d' ' -f4-)" != "$(grep '^4 ' $flog | cut -d' ' -f4-)" ]; then
+    err "$(grep '^1 ' $flog)" "$(grep '^4 ' $flog)"
+fi
+
+for p in 1 2 3; do
+    new "backoff after failed post $p"
+    backoff=$(( 1 << ($p - 1) ))
+    t0=$(post_time $p)
+    t1=$(post_time $(( $p + 1 )))
+    if ! python3 -c "import sys; sys.exit(0 if $t1 - $t0 >= $backoff - 0.1 else 1)"; then
+        err ">= $backoff s" "$t0 $t1"
+    fi
+done
+
+stop_publish
+
+rm -rf $dir
+
+new "endtest"
+endtest
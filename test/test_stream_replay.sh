@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+# Replay store of event streams, see clixon_stream_replay.c
+# Check the byte limit CLICON_STREAM_REPLAY_MAX_BYTES, also with events wrapping around the
+# end of the ring, the event limit CLICON_STREAM_REPLAY_MAX_EVENTS, a memory-mapped store
+# in CLICON_STREAM_REPLAY_DIR, and the binary search of the first event at a start time.
+# This is an unit test, not a clixon system test
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+: ${clixon_util_replay:=clixon_util_replay}
+
+new "no limit: all events stored"
+expectpart "$($clixon_util_replay -D $DBG -n 100)" 0 "^len: 100$" "^0.000000: event0$" "^99.000000: event99$"
+
+new "event limit: newest events stored"
+expectpart "$($clixon_util_replay -D $DBG -n 100 -e 10)" 0 "^len: 10$" "^90.000000: event90$" "^99.000000: event99$" --not-- "event89"
+
+new "byte limit: newest events stored"
+expectpart "$($clixon_util_replay -D $DBG -n 100 -b 100 -l 10)" 0 "^len: 10$" "^90.000000: event90\.\.\.$" "^99.000000: event99\.\.\.$" --not-- "event89"
+
+new "byte limit: events wrap around end of ring"
+expectpart "$($clixon_util_replay -D $DBG -n 100 -b 100 -l 15)" 0 "^len: 6$" "^94.000000: event94\.\.\.\.\.\.\.\.$" "^99.000000: event99\.\.\.\.\.\.\.\.$" --not-- "event93"
+
+new "byte and event limit: lowest limit applies"
+expectpart "$($clixon_util_replay -D $DBG -n 100 -b 100 -l 10 -e 5)" 0 "^len: 5$" "^95.000000: event95" --not-- "event94"
+
+new "event larger than store not stored"
+expectpart "$($clixon_util_replay -D $DBG -n 5 -b 10 -l 20)" 0 "^len: 0$" --not-- "event"
+
+new "memory-mapped store: byte limit"
+expectpart "$($clixon_util_replay -D $DBG -n 100 -b 100 -l 15 -d $dir)" 0 "^len: 6$" "^94.000000: event94" "^99.000000: event99" --not-- "event93"
+
+new "memory-mapped store: file size"
+size=$(stat -c %s $dir/test.replay)
+if [ "$size" != 100 ]; then
+    err "100" "$size"
+fi
+
+new "memory-mapped store: max bytes larger than int"
+expectpart "$($clixon_util_replay -D $DBG -n 10 -b 2147483648 -d $dir)" 0 "^len: 10$" "^0.000000: event0$" "^9.000000: event9$"
+rm -f $dir/test.replay
+
+new "start time: first event at start time"
+expectpart "$($clixon_util_replay -D $DBG -n 30 -p 3 -s 5)" 0 "^len: 30$" "^5.000000: event15$" "^5.333333: event16$" "^9.666666: event29$" --not-- "event14"
+
+new "start time: before oldest event"
+expectpart "$($clixon_util_replay -D $DBG -n 30 -p 3 -e 10 -s 2)" 0 "^len: 10$" "^6.666666: event20$" "^9.666666: event29$" --not-- "event19"
+
+new "start time: between events"
+expectpart "$($clixon_util_replay -D $DBG -n 10 -p 1 -s 4.5)" 0 "^5.000000: event5$" --not-- "event4"
+
+new "start time: after newest event"
+expectpart "$($clixon_util_replay -D $DBG -n 30 -p 3 -s 100)" 0 "^len: 30$" --not-- "event"
+
+new "invalid max bytes: 0"
+expectpart "$($clixon_util_replay -D $DBG -b 0 2>&1)" 255 "CLICON_STREAM_REPLAY_MAX_BYTES must be > 0"
+
+new "invalid max bytes: out of range"
+expectpart "$($clixon_util_replay -D $DBG -b 4294967296 2>&1)" 255 "CLICON_STREAM_REPLAY_MAX_BYTES"
+
+new "invalid max events: negative"
+expectpart "$($clixon_util_replay -D $DBG -e -1 2>&1)" 255 "CLICON_STREAM_REPLAY_MAX_EVENTS"
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,169 @@
+#!/usr/bin/env bash
+# Validation in worker processes vs sequential validation, see CLICON_VALIDATE_WORKERS
+# The same sequence of edits of a large configuration spread over several top-level
+# containers, with must and leafref constraints across containers, is validated with
+# 0 and with 4 workers. Check that the validate replies are equal.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/workers.yang
+fconfig=$dir/large.xml
+
+# Number of top-level containers
+ncont=8
+
+# Number of list entries per container
+: ${perfnr:=2000}
+
+# Create YANG: containers c0..c<ncont-1>, each entry refers to an entry in the next container
+echo "module workers{" > $fyang
+echo "    yang-version 1.1;" >> $fyang
+echo "    namespace \"urn:example:workers\";" >> $fyang
+echo "    prefix ex;" >> $fyang
+for (( c=0; c<$ncont; c++ )); do
+    next=$(( ($c + 1) % $ncont ))
+    cat <<EOF >> $fyang
+    container c$c{
+        list e{
+            key name;
+            leaf name{
+                type string;
+            }
+            leaf x{
+                must ". < 1000" {
+                    error-message "c$c too large";
+                }
+                type uint32;
+            }
+            leaf ref{
+                type leafref{
+                    path "/ex:c$next/ex:e/ex:name";
+                }
+            }
+        }
+    }
+EOF
+done
+echo "}" >> $fyang
+
+# Validate the candidate and save the reply
+# @param[in] $1  Name of saved reply
+function validate_save(){
+    echo "$DEFAULTHELLO$(chunked_framing "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>")" | $clixon_netconf -qf $cfg > $dir/$1
+    if [ $? -ne 0 ]; then
+        err "validate $1"
+    fi
+}
+
+new "generate config with $ncont containers of $perfnr entries"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>"
+for (( c=0; c<$ncont; c++ )); do
+    rpc+="<c$c xmlns=\"urn:example:workers\">"
+    for (( i=0; i<$perfnr; i++ )); do
+        rpc+="<e><name>e$i</name><x>$i</x><ref>e$(( $perfnr - 1 - $i ))</ref></e>"
+    done
+    rpc+="</c$c>"
+done
+rpc+="</config></edit-config></rpc>"
+echo -n "$DEFAULTHELLO" > $fconfig
+echo "$(chunked_framing "$rpc")" >> $fconfig
+
+for workers in 0 4; do
+    new "test params: -f $cfg workers: $workers"
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_VALIDATE_INCREMENTAL>false</CLICON_VALIDATE_INCREMENTAL>
+  <CLICON_VALIDATE_WORKERS>$workers</CLICON_VALIDATE_WORKERS>
+  <CLICON_STREAM_DISCOVERY_RFC8040>false</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_NETCONF_MONITORING>false</CLICON_NETCONF_MONITORING>
+</clixon-config>
+EOF
+
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s init -f $cfg"
+        start_backend -s init -f $cfg
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    new "netconf write large config"
+    expecteof_file "$clixon_netconf -qef $cfg" 0 "$fconfig" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>$"
+
+    new "validate valid config"
+    validate_save valid.$workers
+
+    new "make c6 too large and c2 refer to missing entry"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c6 xmlns=\"urn:example:workers\"><e><name>e7</name><x>2000</x></e></c6><c2 xmlns=\"urn:example:workers\"><e><name>e9</name><ref>missing</ref></e></c2></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "validate two errors"
+    validate_save two.$workers
+
+    new "fix c2"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c2 xmlns=\"urn:example:workers\"><e><name>e9</name><ref>e0</ref></e></c2></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "validate one error"
+    validate_save one.$workers
+
+    new "delete entry referred to from c7"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c0 xmlns=\"urn:example:workers\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><e nc:operation=\"delete\"><name>e3</name></e></c0><c6 xmlns=\"urn:example:workers\"><e><name>e7</name><x>7</x></e></c6></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "validate error in last container"
+    validate_save last.$workers
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+done
+
+new "valid config is ok"
+match=$(grep "<ok/>" $dir/valid.0)
+if [ -z "$match" ]; then
+    err "<ok/>" "$(cat $dir/valid.0)"
+fi
+
+for step in valid two one last; do
+    new "compare sequential and worker replies: $step"
+    if ! cmp -s $dir/$step.0 $dir/$step.4; then
+        err "$(cat $dir/$step.0)" "$(cat $dir/$step.4)"
+    fi
+done
+
+new "first error is in c2"
+match=$(grep "missing" $dir/two.0)
+if [ -z "$match" ]; then
+    err "missing" "$(cat $dir/two.0)"
+fi
+
+new "last error is in c7"
+match=$(grep "e3" $dir/last.0)
+if [ -z "$match" ]; then
+    err "e3" "$(cat $dir/last.0)"
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
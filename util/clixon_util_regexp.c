@@ -42,6 +42,7 @@
 #endif
 
 #include <unistd.h> /* unistd */
+#include <errno.h>
 #include <string.h>
 #include <regex.h> /* posix regex */
 #include <syslog.h>
@@ -138,6 +139,59 @@ regex_posix(char *regexp,
     return retval;
 }
 
+/*! Fast path regex implementation, DFA compiled from a subset of XSD regex syntax
+ * Without typedef identity, so native validators are not used
+ * @retval -1   Error
+ * @retval  0   Not match
+ * @retval  1   Match
+ * @retval  2   Pattern has no fast path
+ * @see regex_fast_compile
+ */
+static int
+regex_fast(clicon_handle h,
+           char         *regexp,
+           char         *content,
+           int           nr,
+           int           debug)
+{
+    int     retval = -1;
+    cvec   *patterns = NULL;
+    cg_var *pcv;
+    void   *fast = NULL;
+    int     ret;
+    int     i;
+
+    if ((patterns = cvec_new(0)) == NULL){
+        clicon_err(OE_UNIX, errno, "cvec_new");
+        goto done;
+    }
+    if ((pcv = cvec_add(patterns, CGV_STRING)) == NULL){
+        clicon_err(OE_UNIX, errno, "cvec_add");
+        goto done;
+    }
+    if (cv_string_set(pcv, regexp) == NULL){
+        clicon_err(OE_UNIX, errno, "cv_string_set");
+        goto done;
+    }
+    if ((ret = regex_fast_compile(h, patterns, pcv, &fast)) < 0)
+        goto done;
+    if (ret == 0){
+        retval = 2;
+        goto done;
+    }
+    ret = 1;
+    for (i=0; i<nr; i++)
+        if ((ret = regex_fast_exec(h, fast, content)) < 0)
+            goto done;
+    retval = ret;
+ done:
+    if (fast)
+        regex_fast_free(fast);
+    if (patterns)
+        cvec_free(patterns);
+    return retval;
+}
+
 static int
 usage(char *argv0)
 {
@@ -147,6 +201,7 @@ usage(char *argv0)
             "\t-D <level>\tDebug\n"
             "\t-p          \txsd->posix translation regexp (default)\n"
             "\t-x          \tlibxml2 regexp (alternative to -p)\n"
+            "\t-f          \tfast path DFA regexp, prints 2 if no fast path (alternative to -p)\n"
             "\t-n <nr>     \tIterate content match (default: 1, 0: no match only compile)\n"
             "\t-r <regexp> \tregexp (mandatory)\n"
             "\t-c <string> \tValue content string(mandatory if -n > 0)\n",
@@ -166,12 +221,13 @@ main(int    argc,
     char       *content = NULL;
     int         ret = 0;
     int         nr = 1;
-    int         mode = 0; /* 0 is posix, 1 is libxml */
+    int         mode = 0; /* 0 is posix, 1 is libxml, 2 is fast path */
     int         dbg = 0;
+    clicon_handle h = NULL;
 
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:pxn:r:c:")) != -1)
+    while ((c = getopt(argc, argv, "hD:pxfn:r:c:")) != -1)
         switch (c) {
         case 'h':
             usage(argv0);
@@ -190,6 +246,9 @@ main(int    argc,
         case 'x': /* libxml2 */
             mode = 1;
             break;
+        case 'f': /* fast path */
+            mode = 2;
+            break;
         case 'r': /* regexp */
             regexp = optarg;
             break;
@@ -211,8 +270,8 @@ main(int    argc,
         fprintf(stderr, "-c mandatory (if -n > 0)\n");
         usage(argv0);
     }
-    if (mode != 0 && mode != 1){
-        fprintf(stderr, "Neither posix or libxml2 set\n");
+    if (mode != 0 && mode != 1 && mode != 2){
+        fprintf(stderr, "Neither posix, libxml2 or fast path set\n");
         usage(argv0);
     }
     clicon_debug(1, "regexp:%s", regexp);
@@ -226,6 +285,15 @@ main(int    argc,
         if ((ret = regex_libxml2(regexp, content, nr, dbg)) < 0)
             goto done;
     }
+    else if (mode == 2){
+        /* Undecided strings fall back to the default posix engine */
+        if ((h = clicon_handle_init()) == NULL)
+            goto done;
+        ret = regex_fast(h, regexp, content, nr, dbg);
+        clicon_handle_exit(h);
+        if (ret < 0)
+            goto done;
+    }
     else
         usage(argv0);
     fprintf(stdout, "%d\n", ret);
@@ -0,0 +1,182 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2023 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+  * Utility for testing the replay store of event streams, see clixon_stream_replay.c
+  * Events "event<i>" are added with event time i/<per> seconds, optionally padded to a
+  * fixed length. Then the number of stored events is printed, followed by the events from
+  * the first event at or after the start time:
+  *   len: <nr>
+  *   <sec>.<usec>: <event>
+  */
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <syslog.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon/clixon.h"
+
+static int
+usage(char *argv0)
+{
+    fprintf(stderr, "usage:%s [options]\n"
+            "where options are\n"
+            "\t-h \t\tHelp\n"
+            "\t-D <level>\tDebug\n"
+            "\t-b <bytes>\tCLICON_STREAM_REPLAY_MAX_BYTES (default: 1048576)\n"
+            "\t-e <events>\tCLICON_STREAM_REPLAY_MAX_EVENTS (default: 0)\n"
+            "\t-d <dir>  \tCLICON_STREAM_REPLAY_DIR\n"
+            "\t-n <nr>   \tNumber of events to add (default: 100)\n"
+            "\t-l <len>  \tPad events to this length (default: 0, no padding)\n"
+            "\t-p <per>  \tEvents per second (default: 1)\n"
+            "\t-s <sec>  \tPrint events from this time, may be fractional (default: 0)\n",
+            argv0
+            );
+    exit(0);
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+    int                        retval = -1;
+    char                      *argv0 = argv[0];
+    int                        c;
+    int                        dbg = 0;
+    clicon_handle              h = NULL;
+    struct stream_replay_ring *rr = NULL;
+    cbuf                      *cb = NULL;
+    struct timeval             tv;
+    int                        nr = 100;
+    int                        len = 0;
+    int                        per = 1;
+    double                     start = 0;
+    int                        i;
+    uint32_t                   j;
+    uint32_t                   n;
+    int                        ret;
+
+    optind = 1;
+    opterr = 0;
+    if ((h = clicon_handle_init()) == NULL)
+        goto done;
+    clicon_option_str_set(h, "CLICON_STREAM_REPLAY_MAX_BYTES", "1048576");
+    while ((c = getopt(argc, argv, "hD:b:e:d:n:l:p:s:")) != -1)
+        switch (c) {
+        case 'h':
+            usage(argv0);
+            break;
+        case 'D':
+            if (sscanf(optarg, "%d", &dbg) != 1)
+                usage(argv0);
+            break;
+        case 'b': /* max bytes */
+            clicon_option_str_set(h, "CLICON_STREAM_REPLAY_MAX_BYTES", optarg);
+            break;
+        case 'e': /* max events */
+            clicon_option_str_set(h, "CLICON_STREAM_REPLAY_MAX_EVENTS", optarg);
+            break;
+        case 'd': /* mapped file directory */
+            clicon_option_str_set(h, "CLICON_STREAM_REPLAY_DIR", optarg);
+            break;
+        case 'n': /* number of events */
+            if ((nr = atoi(optarg)) < 0)
+                usage(argv0);
+            break;
+        case 'l': /* event length */
+            if ((len = atoi(optarg)) < 0)
+                usage(argv0);
+            break;
+        case 'p': /* events per second */
+            if ((per = atoi(optarg)) <= 0)
+                usage(argv0);
+            break;
+        case 's': /* start time */
+            if (sscanf(optarg, "%lf", &start) != 1 || start < 0)
+                usage(argv0);
+            break;
+        default:
+            usage(argv0);
+            break;
+        }
+    clicon_log_init(__FILE__, dbg?LOG_DEBUG:LOG_INFO, CLICON_LOG_STDERR);
+    clicon_debug_init(dbg, NULL);
+
+    if (stream_replay_ring_new(h, "test", &rr) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    for (i=0; i<nr; i++){
+        cbuf_reset(cb);
+        cprintf(cb, "event%d", i);
+        while (cbuf_len(cb) < len)
+            cprintf(cb, ".");
+        tv.tv_sec = i/per;
+        tv.tv_usec = (i%per)*(1000000/per);
+        if ((ret = stream_replay_ring_add(rr, &tv, cbuf_get(cb), cbuf_len(cb))) < 0)
+            goto done;
+        if (ret == 0)
+            clicon_debug(1, "%s not stored", cbuf_get(cb));
+    }
+    n = stream_replay_ring_len(rr);
+    fprintf(stdout, "len: %u\n", n);
+    tv.tv_sec = (time_t)start;
+    tv.tv_usec = (suseconds_t)((start - tv.tv_sec)*1000000);
+    for (j=stream_replay_ring_find(rr, &tv); j<n; j++){
+        cbuf_reset(cb);
+        if (stream_replay_ring_get(rr, j, &tv, cb) < 0)
+            goto done;
+        fprintf(stdout, "%ld.%06ld: %s\n", (long)tv.tv_sec, (long)tv.tv_usec, cbuf_get(cb));
+    }
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    if (rr)
+        stream_replay_ring_free(rr);
+    if (h)
+        clicon_handle_exit(h);
+    return retval;
+}
@@ -55,6 +55,7 @@
 #include <signal.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -62,6 +63,79 @@
 /* clixon */
 #include "clixon/clixon.h"
 
+/*! Slow reader: send request nr times from a child process, and read replies after a delay
+ *
+ * The replies are not read while the requests are sent, so that output is queued in the
+ * backend, see CLICON_SOCK_HIGHWATER. Replies are printed prefixed with request number.
+ * @param[in]  s     Socket
+ * @param[in]  msg   Encoded request
+ * @param[in]  nr    Number of requests
+ * @param[in]  wait  Seconds to wait before reading replies
+ * @retval     0     OK
+ * @retval    -1    Error
+ */
+static int
+socket_slow_reader(int                s,
+                   struct clicon_msg *msg,
+                   int                nr,
+                   int                wait)
+{
+    int                retval = -1;
+    struct clicon_msg *reply = NULL;
+    pid_t              pid;
+    int                status = 0;
+    int                eof = 0;
+    int                i;
+
+    if ((pid = fork()) < 0){
+        clicon_err(OE_UNIX, errno, "fork");
+        goto done;
+    }
+    if (pid == 0){ /* Child: send requests, blocks while the backend does not read */
+        for (i=0; i<nr; i++)
+            if (clicon_msg_send(s, msg) < 0)
+                _exit(1);
+        _exit(0);
+    }
+    sleep(wait);
+    for (i=0; i<nr; i++){
+        if (clicon_msg_rcv(s, 0, &reply, &eof) < 0)
+            goto done;
+        if (eof){
+            clicon_err(OE_PROTO, ESHUTDOWN, "Socket unexpected close");
+            goto done;
+        }
+        fprintf(stdout, "%d: %s\n", i+1, reply->op_body);
+        free(reply);
+        reply = NULL;
+    }
+    if (waitpid(pid, &status, 0) < 0 || status != 0){
+        clicon_err(OE_UNIX, errno, "sender failed");
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (reply)
+        free(reply);
+    return retval;
+}
+
+/*! Print reply of pipelined request
+ * @see clicon_rpc_msg_async
+ */
+static int
+socket_async_cb(clicon_handle h,
+                uint32_t      id,
+                cxobj        *xret,
+                void         *arg)
+{
+    fprintf(stdout, "%u: ", id);
+    if (clixon_xml2file(stdout, xret, 0, 0, fprintf, 1, 0) < 0)
+        return -1;
+    fprintf(stdout, "\n");
+    return 0;
+}
+
 static int
 usage(char *argv0)
 {
@@ -73,6 +147,8 @@ usage(char *argv0)
             "\t-s <sockpath> \tPath to unix domain socket (or IP addr)\n"
             "\t-f <file>\tXML input file (overrides stdin)\n"
             "\t-J \t\tInput as JSON (instead of XML)\n"
+            "\t-n <nr>\tSend request nr times pipelined, print replies prefixed with request id\n"
+            "\t-w <sec>\tWith -n: wait sec seconds before reading replies (slow reader)\n"
             ,
             argv0);
     exit(0);
@@ -101,6 +177,9 @@ main(int    argc,
     int                dbg = 0;
     int                s;
     int                eof = 0;
+    int                nr = 0;
+    int                wait = 0;
+    int                i;
 
     /* In the startup, logs to stderr & debug flag set later */
     clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
@@ -110,7 +189,7 @@ main(int    argc,
 
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:s:f:Ja:")) != -1)
+    while ((c = getopt(argc, argv, "hD:s:f:Ja:n:w:")) != -1)
         switch (c) {
         case 'h':
             usage(argv[0]);
@@ -131,6 +210,12 @@ main(int    argc,
         case 'a':
             family = optarg;
             break;
+        case 'n':
+            nr = atoi(optarg);
+            break;
+        case 'w':
+            wait = atoi(optarg);
+            break;
         default:
             usage(argv[0]);
             break;
@@ -171,6 +256,32 @@ main(int    argc,
         goto done;
     if ((msg = clicon_msg_encode(getpid(), "%s", cbuf_get(cb))) < 0)
         goto done;
+    if (nr > 0 && wait > 0){ /* Pipelined requests, replies read after a delay */
+        if (strcmp(family, "UNIX")==0){
+            if (clicon_rpc_connect_unix(h, sockpath, &s) < 0)
+                goto done;
+        }
+        else
+            if (clicon_rpc_connect_inet(h, sockpath, 4535, &s) < 0)
+                goto done;
+        if (socket_slow_reader(s, msg, nr, wait) < 0)
+            goto done;
+        close(s);
+        retval = 0;
+        goto done;
+    }
+    if (nr > 0){ /* Pipelined requests on the client socket */
+        clicon_option_str_set(h, "CLICON_SOCK", sockpath);
+        clicon_option_str_set(h, "CLICON_SOCK_FAMILY", family);
+        clicon_option_str_set(h, "CLICON_SOCK_PORT", "4535");
+        for (i=0; i<nr; i++)
+            if (clicon_rpc_msg_async(h, msg, socket_async_cb, NULL, NULL) < 0)
+                goto done;
+        if (clicon_rpc_async_wait(h, 0) < 0)
+            goto done;
+        retval = 0;
+        goto done;
+    }
     if (strcmp(family, "UNIX")==0){
         if (clicon_rpc_connect_unix(h, sockpath, &s) < 0)
             goto done;